@@ -0,0 +1,97 @@
+// ingest_codec_bench.cpp
+// Host benchmark: POST /api/wans batch size and parse time, JSON vs MessagePack
+//
+// Builds representative ingest batches (the 2-WAN example from docs/api.md
+// and an 8-WAN batch shaped like the daemon's counter reports), encodes
+// each with serializeJson()/serializeMsgPack() and times the matching
+// deserialize call, which is the part http_routes.cpp pays per request.
+// ArduinoJson is header-only, so this builds with a host compiler; see
+// run.sh. Host times are not ESP32 times, compare the ratios.
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+static const int ITERATIONS = 20000;
+
+static void add_rate_wan(JsonDocument& doc, const char* name) {
+    JsonObject w = doc[name].to<JsonObject>();
+    w["state"] = "up";
+    w["loss_pct"] = 0;
+    w["latency_ms"] = 6;
+    w["jitter_ms"] = 0;
+    w["down_mbps"] = 2.0;
+    w["up_mbps"] = 3.3;
+    w["down_1m"] = 2.1;
+    w["up_1m"] = 3.2;
+    w["down_5m"] = 2.5;
+    w["up_5m"] = 3.0;
+    w["down_15m"] = 2.3;
+    w["up_15m"] = 3.1;
+    w["local_ip"] = "100.64.1.5";
+    w["gateway_ip"] = "100.64.1.1";
+    w["monitor_ip"] = "8.8.8.8";
+}
+
+// What wan_watcher_daemon.sh sends: dpinger figures plus raw counters
+static void add_counter_wan(JsonDocument& doc, int n) {
+    char name[8], local_ip[16], gateway_ip[16];
+    snprintf(name, sizeof(name), "wan%d", n);
+    snprintf(local_ip, sizeof(local_ip), "192.168.%d.2", 100 + n);
+    snprintf(gateway_ip, sizeof(gateway_ip), "192.168.%d.1", 100 + n);
+
+    JsonObject w = doc[name].to<JsonObject>();
+    w["loss_pct"] = (n % 3 == 0) ? 0.5 : 0;
+    w["latency_ms"] = 5 + 3 * n;
+    w["jitter_ms"] = n % 4;
+    w["local_ip"] = local_ip;
+    w["gateway_ip"] = gateway_ip;
+    w["monitor_ip"] = (n % 2) ? "1.1.1.1" : "8.8.8.8";
+    w["rx_bytes"] = 81234567890ULL + 1000003ULL * n;
+    w["tx_bytes"] = 9876543210ULL + 999983ULL * n;
+}
+
+static void add_header(JsonDocument& doc) {
+    doc["router_ip"] = "192.168.1.1";
+    doc["timestamp"] = "2025-01-15T10:30:00Z";
+}
+
+template <typename Parse>
+static double time_parse(Parse parse) {
+    JsonDocument doc;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        if (parse(doc) != DeserializationError::Ok) return -1.0;
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ITERATIONS;
+}
+
+static void run(const char* label, const JsonDocument& doc) {
+    std::string json, msgpack;
+    serializeJson(doc, json);
+    serializeMsgPack(doc, msgpack);
+
+    double json_us = time_parse([&](JsonDocument& d) { return deserializeJson(d, json); });
+    double msgpack_us = time_parse([&](JsonDocument& d) { return deserializeMsgPack(d, msgpack); });
+
+    printf("%-6s  %5zu B  %5zu B  %4.0f%%   %7.2f us  %7.2f us  %4.0f%%\n", label,
+           json.size(), msgpack.size(), 100.0 * msgpack.size() / json.size(),
+           json_us, msgpack_us, 100.0 * msgpack_us / json_us);
+}
+
+int main() {
+    JsonDocument two;
+    add_header(two);
+    add_rate_wan(two, "wan1");
+    add_counter_wan(two, 2);
+
+    JsonDocument eight;
+    add_header(eight);
+    for (int n = 1; n <= 8; n++) add_counter_wan(eight, n);
+
+    printf("batch    JSON   MsgPack  size    JSON parse  MsgPack parse\n");
+    run("2 WAN", two);
+    run("8 WAN", eight);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Build and run the host ingest codec benchmark (ingest_codec_bench.cpp).
+# Uses the ArduinoJson copy PlatformIO fetched for the firmware (run
+# "pio pkg install" or a firmware build first), or ARDUINOJSON_DIR if set.
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+if [ -z "$ARDUINOJSON_DIR" ]; then
+    ARDUINOJSON_DIR=$(ls -d "$BENCH_DIR"/../.pio/libdeps/*/ArduinoJson 2>/dev/null | head -n 1)
+fi
+if [ ! -f "$ARDUINOJSON_DIR/src/ArduinoJson.h" ]; then
+    echo "ArduinoJson not found; set ARDUINOJSON_DIR to a checkout of bblanchon/ArduinoJson v7" >&2
+    exit 1
+fi
+
+OUT="${TMPDIR:-/tmp}/ingest_codec_bench"
+${CXX:-c++} -std=c++17 -O2 -I"$ARDUINOJSON_DIR/src" "$BENCH_DIR/ingest_codec_bench.cpp" -o "$OUT"
+"$OUT"
@@ -130,16 +130,61 @@
       digit.querySelector('.seg-dp').classList.toggle('on',false);
     }
   }
-  ['w1-pkt','w1-bw','w2-pkt','w2-bw','lp-pkt','lp-bw'].forEach(initDisplay);
+  ['lp-pkt','lp-bw'].forEach(initDisplay);
 
   var pktIdx=0,bwIdx=0;
   var P=document.getElementById('seg-panel').dataset;
+  var W=[];  // per-WAN display values, in /api/status "wans" order
+
+  // === WAN rows (created as WANs appear; ids use the 1-based position) ===
+  function addRow(tbodyId,cells){
+    var tbody=document.getElementById(tbodyId);
+    var tr=document.createElement('tr');
+    cells.forEach(function(c){
+      var td=document.createElement('td');
+      if(c.id)td.id=c.id;
+      td.textContent=c.text||'';
+      tr.appendChild(td);
+    });
+    tbody.insertBefore(tr,tbody.lastElementChild);  // Local stays last
+  }
+  function addGridRow(n){
+    var lpLabel=document.getElementById('lp-label');
+    var grid=lpLabel.parentNode;
+    var p='w'+n;
+    var label=document.createElement('div');
+    label.className='row-label';label.textContent='WAN'+n;
+    var ledGroup=document.createElement('div');
+    ledGroup.className='led-group';
+    var led=document.createElement('div');
+    led.className='state-led';led.id=p+'-led';
+    ledGroup.appendChild(led);
+    var pkt=document.createElement('div');
+    pkt.className='seg-display pkt-display';pkt.id=p+'-pkt';
+    pkt.addEventListener('click',function(){pktIdx=(pktIdx+1)%3;updDisp();});
+    var bw=document.createElement('div');
+    bw.className='seg-display bw-display';bw.id=p+'-bw';
+    bw.addEventListener('click',function(){bwIdx=(bwIdx+1)%2;updDisp();});
+    [label,ledGroup,pkt,bw].forEach(function(e){grid.insertBefore(e,lpLabel);});
+    initDisplay(p+'-pkt');initDisplay(p+'-bw');
+  }
+  function ensureWanRows(wans){
+    while(W.length<wans.length){
+      var n=W.length+1,p='w'+n;
+      addRow('iface-rows',[{text:'WAN'+n},{id:p+'-desc'},{id:p+'-state'},{id:p+'-mon'},{id:p+'-gw'},{id:p+'-lip'}]);
+      addRow('metric-rows',[{text:'WAN'+n},{id:p+'-lat'},{id:p+'-jit'},{id:p+'-loss'},
+        {id:p+'-bw15'},{id:p+'-avg1'},{id:p+'-avg5'},{id:p+'-avg15'},{id:p+'-p95'}]);
+      addRow('pkt-rows-m',[{text:'WAN'+n},{id:p+'-lat-m'},{id:p+'-jit-m'},{id:p+'-loss-m'}]);
+      addRow('bw-rows-m',[{text:'WAN'+n},{id:p+'-bw15-m'},{id:p+'-avg1-m'},{id:p+'-avg5-m'},{id:p+'-avg15-m'},{id:p+'-p95-m'}]);
+      addGridRow(n);
+      W.push({state:'down',lat:0,jit:0,loss:100,down:'0.0',up:'0.0',seen:null});
+    }
+  }
 
-  // === Stale state helper ===
-  function isStale(){
-    if(!updateTime)return true;
-    var elapsed=(Date.now()-updateTime.getTime())/1000;
-    return elapsed>=F.redBufferEnd;
+  // === Stale state helper (per WAN: age of its own last report) ===
+  function wanStale(w){
+    if(w.seen===null)return true;
+    return (Date.now()-w.seen)/1000>=F.redBufferEnd;
   }
 
   // === State LED update (single bicolor LED per row) ===
@@ -156,9 +201,7 @@
     }
   }
   function updLeds(){
-    var stale=isStale();
-    setLeds('w1',P.w1State,stale);
-    setLeds('w2',P.w2State,stale);
+    W.forEach(function(w,i){setLeds('w'+(i+1),w.state,wanStale(w));});
     setLeds('lp',P.lpState,false);  // Local pinger doesn't depend on pfSense freshness
   }
   updLeds();
@@ -166,28 +209,24 @@
   function updDisp(){
     var pktM=['L','J','P'],bwM=['d','U'];
     var pm=pktM[pktIdx],bm=bwM[bwIdx];
-    var stale=isStale();
     // Show dashes when stale or when WAN is down
-    if(stale||P.w1State==='down'){
-      setDisplayDashes('w1-pkt');setDisplayDashes('w1-bw');
-    }else{
-      setDisplay('w1-pkt',pm,[P.w1Lat,P.w1Jit,P.w1Loss][pktIdx]);
-      setDisplay('w1-bw',bm,[P.w1Down,P.w1Up][bwIdx]);
-    }
-    if(stale||P.w2State==='down'){
-      setDisplayDashes('w2-pkt');setDisplayDashes('w2-bw');
-    }else{
-      setDisplay('w2-pkt',pm,[P.w2Lat,P.w2Jit,P.w2Loss][pktIdx]);
-      setDisplay('w2-bw',bm,[P.w2Down,P.w2Up][bwIdx]);
-    }
+    W.forEach(function(w,i){
+      var p='w'+(i+1);
+      if(wanStale(w)||w.state==='down'){
+        setDisplayDashes(p+'-pkt');setDisplayDashes(p+'-bw');
+      }else{
+        setDisplay(p+'-pkt',pm,[w.lat,w.jit,w.loss][pktIdx]);
+        setDisplay(p+'-bw',bm,[w.down,w.up][bwIdx]);
+      }
+    });
     // Local pinger doesn't depend on pfSense freshness
     if(P.lpState==='down'){
       setDisplayDashes('lp-pkt');
     }else{
       setDisplay('lp-pkt',pm,[P.lpLat,P.lpJit,P.lpLoss][pktIdx]);
     }
-    // Local bandwidth is sum of WAN1 + WAN2 (show dashes if stale)
-    if(stale){
+    // Local bandwidth is the sum over the WANs still reporting (dashes if none)
+    if(W.every(wanStale)){
       setDisplayDashes('lp-bw');
     }else{
       setDisplay('lp-bw',bm,[P.lpDown,P.lpUp][bwIdx]);
@@ -204,6 +243,7 @@
 
   // === State emoji helper ===
   function stateHtml(s){
+    if(s==='stale')return'\u26AA STALE';
     if(s==='up')return'\u{1F7E2} UP';
     if(s==='degraded')return'\u{1F7E1} DEGRADED';
     return'\u{1F534} DOWN';
@@ -226,6 +266,7 @@
     if(src==='15s')return{down:wan.down_mbps,up:wan.up_mbps};
     if(src==='5m')return{down:wan.down_5m,up:wan.up_5m};
     if(src==='15m')return{down:wan.down_15m,up:wan.up_15m};
+    if(src==='p95')return{down:wan.down_p95,up:wan.up_p95};
     return{down:wan.down_1m,up:wan.up_1m}; // default 1m
   }
 
@@ -247,17 +288,24 @@
       if(!r.ok)throw new Error('HTTP '+r.status);
       return r.json();
     }).then(function(d){
-      if(!d||!d.wan1||!d.wan2||!d.local)throw new Error('Invalid response');
+      if(!d||!Array.isArray(d.wans)||!d.local)throw new Error('Invalid response');
+      ensureWanRows(d.wans);
       // Update 7-segment data using selected bandwidth source
       var bwSrc=getBwSource();
-      var w1bw=getBwValues(d.wan1,bwSrc);
-      var w2bw=getBwValues(d.wan2,bwSrc);
-      P.w1State=d.wan1.state;P.w1Lat=d.wan1.latency_ms;P.w1Jit=d.wan1.jitter_ms;P.w1Loss=d.wan1.loss_pct;
-      P.w1Down=w1bw.down.toFixed(1);P.w1Up=w1bw.up.toFixed(1);
-      P.w2State=d.wan2.state;P.w2Lat=d.wan2.latency_ms;P.w2Jit=d.wan2.jitter_ms;P.w2Loss=d.wan2.loss_pct;
-      P.w2Down=w2bw.down.toFixed(1);P.w2Up=w2bw.up.toFixed(1);
+      var sum={down:0,up:0,down_mbps:0,up_mbps:0,down_1m:0,up_1m:0,down_5m:0,up_5m:0,down_15m:0,up_15m:0,down_p95:0,up_p95:0};
+      d.wans.forEach(function(wan,i){
+        var bw=getBwValues(wan,bwSrc);
+        W[i]={state:wan.state,lat:wan.latency_ms,jit:wan.jitter_ms,loss:wan.loss_pct,
+          down:bw.down.toFixed(1),up:bw.up.toFixed(1),
+          seen:wan.age_s>=0?Date.now()-wan.age_s*1000:null};
+        if(wanStale(W[i]))return;  // stale WANs stay out of the local sum
+        sum.down+=bw.down;sum.up+=bw.up;
+        ['down_mbps','up_mbps','down_1m','up_1m','down_5m','up_5m','down_15m','up_15m','down_p95','up_p95'].forEach(function(k){
+          sum[k]+=wan[k];
+        });
+      });
       P.lpState=d.local.state;P.lpLat=d.local.latency_ms;P.lpJit=d.local.jitter_ms;P.lpLoss=d.local.loss_pct;
-      P.lpDown=(w1bw.down+w2bw.down).toFixed(1);P.lpUp=(w1bw.up+w2bw.up).toFixed(1);
+      P.lpDown=sum.down.toFixed(1);P.lpUp=sum.up.toFixed(1);
       updLeds();
       updDisp();
       updateFavicon(d.local.state);
@@ -278,28 +326,25 @@
         F.fillDuration=d.freshness.fill_duration;
       }
       // Update table cells (both wide and narrow versions)
-      $('w1-state').innerHTML=stateHtml(d.wan1.state);
-      $('w1-mon').textContent=d.wan1.monitor_ip||'';
-      $('w1-gw').textContent=d.wan1.gateway_ip||'';
-      $('w1-lip').textContent=d.wan1.local_ip||'';
-      setText('w1-loss',fmtPct(d.wan1.loss_pct));
-      setText('w1-lat',fmtMs(d.wan1.latency_ms));
-      setText('w1-jit',fmtMs(d.wan1.jitter_ms));
-      setText('w1-bw15',fmtBw(d.wan1.down_mbps,d.wan1.up_mbps));
-      setText('w1-avg1',fmtBw(d.wan1.down_1m,d.wan1.up_1m));
-      setText('w1-avg5',fmtBw(d.wan1.down_5m,d.wan1.up_5m));
-      setText('w1-avg15',fmtBw(d.wan1.down_15m,d.wan1.up_15m));
-      $('w2-state').innerHTML=stateHtml(d.wan2.state);
-      $('w2-mon').textContent=d.wan2.monitor_ip||'';
-      $('w2-gw').textContent=d.wan2.gateway_ip||'';
-      $('w2-lip').textContent=d.wan2.local_ip||'';
-      setText('w2-loss',fmtPct(d.wan2.loss_pct));
-      setText('w2-lat',fmtMs(d.wan2.latency_ms));
-      setText('w2-jit',fmtMs(d.wan2.jitter_ms));
-      setText('w2-bw15',fmtBw(d.wan2.down_mbps,d.wan2.up_mbps));
-      setText('w2-avg1',fmtBw(d.wan2.down_1m,d.wan2.up_1m));
-      setText('w2-avg5',fmtBw(d.wan2.down_5m,d.wan2.up_5m));
-      setText('w2-avg15',fmtBw(d.wan2.down_15m,d.wan2.up_15m));
+      d.wans.forEach(function(wan,i){
+        var p='w'+(i+1);
+        $(p+'-desc').textContent=wan.name;
+        $(p+'-state').innerHTML=stateHtml(wanStale(W[i])?'stale':wan.state);
+        $(p+'-mon').textContent=wan.monitor_ip||'';
+        $(p+'-gw').textContent=wan.gateway_ip||'';
+        $(p+'-lip').textContent=wan.local_ip||'';
+        setText(p+'-loss',fmtPct(wan.loss_pct));
+        setText(p+'-lat',fmtMs(wan.latency_ms));
+        setText(p+'-jit',fmtMs(wan.jitter_ms));
+        setText(p+'-bw15',fmtBw(wan.down_mbps,wan.up_mbps));
+        setText(p+'-avg1',fmtBw(wan.down_1m,wan.up_1m));
+        setText(p+'-avg5',fmtBw(wan.down_5m,wan.up_5m));
+        setText(p+'-avg15',fmtBw(wan.down_15m,wan.up_15m));
+        setText(p+'-p95',fmtBw(wan.down_p95,wan.up_p95));
+        $(p+'-p95').title='peak '+wan.down_peak.toFixed(1)+'/'+wan.up_peak.toFixed(1)+
+          (wan.down_peak_at?'\ndown at '+new Date(wan.down_peak_at).toLocaleString():'')+
+          (wan.up_peak_at?'\nup at '+new Date(wan.up_peak_at).toLocaleString():'');
+      });
       $('lp-state').innerHTML=stateHtml(d.local.state);
       $('lp-mon').textContent=d.local.monitor_ip||'';
       $('lp-gw').textContent=d.router_ip||'';
@@ -307,16 +352,111 @@
       setText('lp-lat',fmtMs(d.local.latency_ms));
       setText('lp-jit',fmtMs(d.local.jitter_ms));
       setText('lp-loss',fmtPct(d.local.loss_pct));
-      // Sum WAN1 + WAN2 bandwidth for local row
-      setText('lp-bw15',fmtBw(d.wan1.down_mbps+d.wan2.down_mbps,d.wan1.up_mbps+d.wan2.up_mbps));
-      setText('lp-avg1',fmtBw(d.wan1.down_1m+d.wan2.down_1m,d.wan1.up_1m+d.wan2.up_1m));
-      setText('lp-avg5',fmtBw(d.wan1.down_5m+d.wan2.down_5m,d.wan1.up_5m+d.wan2.up_5m));
-      setText('lp-avg15',fmtBw(d.wan1.down_15m+d.wan2.down_15m,d.wan1.up_15m+d.wan2.up_15m));
+      // Sum of all WANs' bandwidth for local row
+      setText('lp-bw15',fmtBw(sum.down_mbps,sum.up_mbps));
+      setText('lp-avg1',fmtBw(sum.down_1m,sum.up_1m));
+      setText('lp-avg5',fmtBw(sum.down_5m,sum.up_5m));
+      setText('lp-avg15',fmtBw(sum.down_15m,sum.up_15m));
+      setText('lp-p95',fmtBw(sum.down_p95,sum.up_p95));
+      if(d.availability)renderAvailability(d.availability);
+      if(d.usage)renderUsage(d.usage);
     }).catch(function(e){console.error('Fetch error:',e);});
   }
+  // === Availability (rolling time in state from /api/status) ===
+  var fmtDur=function(s){
+    if(s<60)return s+'s';
+    if(s<3600)return Math.floor(s/60)+'m';
+    if(s<86400)return Math.floor(s/3600)+'h '+Math.floor(s%3600/60)+'m';
+    return Math.floor(s/86400)+'d '+Math.floor(s%86400/3600)+'h';
+  };
+  var AVAIL_WINDOWS=['1h','24h','7d','30d'];
+  function renderAvailability(a){
+    var names=Object.keys(a);
+    if(!names.length)return;
+    var tbody=$('avail-rows');
+    tbody.textContent='';
+    names.forEach(function(name){
+      var tr=document.createElement('tr');
+      var td=document.createElement('td');
+      td.textContent=name==='local'?'Local':name;
+      tr.appendChild(td);
+      AVAIL_WINDOWS.forEach(function(w){
+        var t=a[name][w];
+        td=document.createElement('td');
+        if(t&&t.observed_s>0){
+          td.textContent=t.up_pct.toFixed(2)+'%';
+          td.title='observed '+fmtDur(t.observed_s)+'\nup '+fmtDur(t.up_s)+'\ndegraded '+fmtDur(t.degraded_s)+
+            '\ndown '+fmtDur(t.down_s)+'\nstale '+fmtDur(t.stale_s);
+        }else{
+          td.textContent='--';
+        }
+        tr.appendChild(td);
+      });
+      tbody.appendChild(tr);
+    });
+  }
+
+  // === Data usage (billing cycle totals from /api/status) ===
+  var fmtBytes=function(b){
+    if(b==null)return '--';
+    var units=['B','kB','MB','GB','TB'],i=0;
+    while(b>=1000&&i<units.length-1){b/=1000;i++;}
+    return (i?b.toFixed(i>2?2:1):b)+' '+units[i];
+  };
+  function renderUsage(u){
+    var names=Object.keys(u);
+    if(!names.length)return;
+    var tbody=$('usage-rows');
+    tbody.textContent='';
+    names.forEach(function(name){
+      var w=u[name];
+      var pct=w.used_pct==null?'--':w.used_pct.toFixed(1)+'%'+
+        (w.projected_pct==null?'':' ('+w.projected_pct.toFixed(0)+'%)');
+      if(w.projected_pct>100)pct='\u{1F534} '+pct; // on course to go over
+      var cells=[name,fmtBytes(w.total_bytes),fmtBytes(w.projected_bytes),fmtBytes(w.cap_bytes),pct];
+      var tr=document.createElement('tr');
+      cells.forEach(function(c){var td=document.createElement('td');td.textContent=c;tr.appendChild(td);});
+      tr.children[1].title='down '+fmtBytes(w.rx_bytes)+'\nup '+fmtBytes(w.tx_bytes)+'\nfrom '+w.source;
+      tbody.appendChild(tr);
+    });
+  }
+
   fetchData(); // Run immediately
   setInterval(fetchData,5000); // Then every 5 seconds
 
+  // === Recent events (state transitions from /api/events) ===
+  var EVENTS_SHOWN=20;
+  var events=[],eventsNext=0,eventsNow=0;
+  function renderEvents(){
+    var tbody=$('event-rows');
+    if(!events.length)return;
+    tbody.textContent='';
+    events.forEach(function(e){
+      var tr=document.createElement('tr');
+      var cells=[fmtDur(Math.max(0,eventsNow-e.t))+' ago',e.source,
+        e.from.toUpperCase()+' \u2192 '+e.to.toUpperCase(),fmtDur(e.duration_s),
+        e.latency_ms+' ms / '+e.jitter_ms+' ms / '+e.loss_pct+'%'];
+      cells.forEach(function(c){var td=document.createElement('td');td.textContent=c;tr.appendChild(td);});
+      tbody.appendChild(tr);
+    });
+  }
+  function fetchEvents(){
+    fetch('/api/events'+(eventsNext?'?since='+eventsNext:'')).then(function(r){
+      if(!r.ok)throw new Error('HTTP '+r.status);
+      return r.json();
+    }).then(function(d){
+      if(!d||!Array.isArray(d.events))throw new Error('Invalid response');
+      // A lower "next" means the panel restarted: start over
+      if(d.next<eventsNext){events=[];eventsNext=0;fetchEvents();return;}
+      d.events.forEach(function(e){events.unshift(e);});
+      events=events.slice(0,EVENTS_SHOWN);
+      eventsNext=d.next;eventsNow=d.now_s;
+      renderEvents();
+    }).catch(function(e){console.error('Events fetch error:',e);});
+  }
+  fetchEvents();
+  setInterval(fetchEvents,5000);
+
   // === Brightness dial control ===
   var brightnessDial = document.getElementById('brightness-dial');
   var brightnessVal = document.getElementById('brightness-val');
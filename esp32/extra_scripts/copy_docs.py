@@ -2,6 +2,7 @@
 PlatformIO build script for pre-filesystem tasks:
 1. Copy documentation files to data/docs/
 2. Generate version.json with version, git hash, and build time
+3. Define FIRMWARE_VERSION for the firmware build
 
 Runs before building the LittleFS filesystem image.
 """
@@ -133,6 +134,11 @@ def copy_documentation(source, target, env):
     print(f"Copied {len(copied)} documentation files to data/docs/")
 
 
+# Firmware version for code that reports it (e.g. mDNS TXT records)
+env.Append(CPPDEFINES=[
+    ("FIRMWARE_VERSION", env.StringifyMacro(get_openapi_version(env.get("PROJECT_DIR", "."))))
+])
+
 # Run when script is loaded (pre: prefix ensures this runs before build)
 generate_version_json(None, None, env)
 copy_documentation(None, None, env)
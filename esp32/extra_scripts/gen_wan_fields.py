@@ -0,0 +1,172 @@
+"""
+PlatformIO build script: generate the WanMetrics field table.
+
+Reads components.schemas.WanMetrics from data/openapi.yaml and writes
+src/wan_fields_gen.h, a constexpr table of field descriptors
+(name, offset, size, type, scale, default) that ingest, /api/status and
+/metrics iterate instead of naming each field by hand.
+
+Supported property shapes:
+  $ref: '#/components/schemas/WanState'   -> STATE
+  type: integer, maximum <= 255           -> U8
+  type: integer, maximum <= 65535         -> U16
+  type: number, format: float             -> F32
+  type: string                            -> STR (char array)
+
+Optional keys: `default` (value when a field is missing on ingest) and
+`x-scale` (multiplier to base units, e.g. 0.001 for *_ms -> seconds).
+
+The header is only rewritten when its content changes, so an unchanged
+schema does not trigger a rebuild. Can also be run directly:
+    python3 extra_scripts/gen_wan_fields.py
+"""
+import os
+import re
+import sys
+
+SCHEMA_NAME = "WanMetrics"
+OUTPUT_NAME = "wan_fields_gen.h"
+
+STATE_VALUES = {"up": "UP", "degraded": "DEGRADED", "down": "DOWN"}
+
+
+def read_schema_properties(openapi_path):
+    """Return [(name, {key: value})] for the schema's properties, in order.
+
+    This is a minimal indentation-based reader for the subset of YAML used
+    by the schema (no PyYAML dependency in the build environment).
+    """
+    with open(openapi_path, "r") as f:
+        lines = f.read().splitlines()
+
+    start = None
+    for i, line in enumerate(lines):
+        if re.match(r"^ {4}%s:\s*$" % SCHEMA_NAME, line):
+            start = i
+            break
+    if start is None:
+        raise RuntimeError(f"schema {SCHEMA_NAME} not found in {openapi_path}")
+
+    props = []
+    in_properties = False
+    for line in lines[start + 1:]:
+        if not line.strip():
+            continue
+        indent = len(line) - len(line.lstrip())
+        if indent <= 4:
+            break  # next schema
+        if indent == 6:
+            in_properties = line.strip() == "properties:"
+            continue
+        if not in_properties:
+            continue
+        if indent == 8:
+            props.append((line.strip().rstrip(":"), {}))
+        elif indent == 10 and props:
+            key, _, value = line.strip().partition(":")
+            props[-1][1][key] = value.strip().strip("'\"")
+    return props
+
+
+def field_type(name, attrs):
+    if attrs.get("$ref", "").endswith("/WanState"):
+        return "STATE"
+    kind = attrs.get("type")
+    if kind == "integer":
+        maximum = int(attrs.get("maximum", "0"))
+        if 0 < maximum <= 0xFF:
+            return "U8"
+        if 0 < maximum <= 0xFFFF:
+            return "U16"
+        raise RuntimeError(f"{name}: integer fields need maximum <= 65535")
+    if kind == "number" and attrs.get("format") == "float":
+        return "F32"
+    if kind == "string":
+        return "STR"
+    raise RuntimeError(f"{name}: unsupported property shape {attrs}")
+
+
+def default_literal(name, ftype, attrs):
+    value = attrs.get("default")
+    if value is None:
+        return "0.0f" if ftype != "STATE" else "(float)WanState::DOWN"
+    if ftype == "STATE":
+        if value not in STATE_VALUES:
+            raise RuntimeError(f"{name}: unknown state default '{value}'")
+        return f"(float)WanState::{STATE_VALUES[value]}"
+    if ftype == "STR":
+        if value:
+            raise RuntimeError(f"{name}: string fields only support an empty default")
+        return "0.0f"
+    return f"{float(value)}f"
+
+
+def scale_literal(attrs):
+    return f"{float(attrs.get('x-scale', '1'))}f"
+
+
+SIZE_CHECKS = {"STATE": "sizeof(WanState)", "U8": "1", "U16": "2", "F32": "4"}
+
+
+def render(props):
+    out = []
+    out.append(f"// {OUTPUT_NAME}")
+    out.append("// GENERATED by extra_scripts/gen_wan_fields.py from")
+    out.append(f"// data/openapi.yaml (components.schemas.{SCHEMA_NAME}). Do not edit.")
+    out.append("#pragma once")
+    out.append("")
+    out.append("// Field ids, in table order")
+    out.append("enum class WanFieldId : uint8_t {")
+    for name, _ in props:
+        out.append(f"    {name.upper()},")
+    out.append("    COUNT")
+    out.append("};")
+    out.append("")
+    out.append("static constexpr WanField WAN_FIELDS[] = {")
+    for name, attrs in props:
+        ftype = field_type(name, attrs)
+        out.append(
+            f"    {{ \"{name}\", offsetof(WanMetrics, {name}), sizeof(WanMetrics::{name}), "
+            f"WanFieldType::{ftype}, {scale_literal(attrs)}, {default_literal(name, ftype, attrs)} }},"
+        )
+    out.append("};")
+    out.append("")
+    out.append("static constexpr size_t WAN_FIELD_COUNT = sizeof(WAN_FIELDS) / sizeof(WAN_FIELDS[0]);")
+    out.append("static_assert(WAN_FIELD_COUNT == (size_t)WanFieldId::COUNT, \"field id mismatch\");")
+    out.append("")
+    out.append("// Schema and struct must agree on storage width")
+    for name, attrs in props:
+        ftype = field_type(name, attrs)
+        if ftype in SIZE_CHECKS:
+            out.append(
+                f"static_assert(sizeof(WanMetrics::{name}) == {SIZE_CHECKS[ftype]}, "
+                f"\"{name}: schema type does not match WanMetrics\");"
+            )
+    out.append("")
+    return "\n".join(out)
+
+
+def generate(project_dir):
+    openapi_path = os.path.join(project_dir, "data", "openapi.yaml")
+    output_path = os.path.join(project_dir, "src", OUTPUT_NAME)
+
+    content = render(read_schema_properties(openapi_path))
+
+    existing = None
+    if os.path.exists(output_path):
+        with open(output_path, "r") as f:
+            existing = f.read()
+    if existing == content:
+        return
+
+    with open(output_path, "w") as f:
+        f.write(content)
+    print(f"Generated {OUTPUT_NAME} from openapi.yaml")
+
+
+try:
+    Import("env")
+    generate(env.get("PROJECT_DIR", "."))
+except NameError:
+    # Run directly, outside PlatformIO
+    generate(os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0]))))
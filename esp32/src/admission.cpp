@@ -0,0 +1,100 @@
+// admission.cpp
+#include "admission.h"
+#include "logger.h"
+
+struct ClientBucket {
+    uint32_t ip;             // 0 = free slot
+    float tokens;
+    unsigned long last_ms;   // last refill (also used for eviction)
+};
+
+static ClientBucket g_clients[ADMISSION_MAX_CLIENTS];
+static AdmissionStats g_stats;
+static AdmissionSettings g_settings;
+static IPAddress g_router;               // parsed router_ip (0.0.0.0 = none)
+
+static unsigned long g_period_start_ms = 0;
+static uint8_t g_period_used = 0;
+
+// Find the client's bucket, or claim the least recently used slot
+static ClientBucket& bucket_for(uint32_t ip, unsigned long now) {
+    ClientBucket* oldest = &g_clients[0];
+    for (int i = 0; i < ADMISSION_MAX_CLIENTS; i++) {
+        if (g_clients[i].ip == ip) return g_clients[i];
+        if (g_clients[i].ip == 0 || (oldest->ip != 0 && g_clients[i].last_ms < oldest->last_ms)) {
+            oldest = &g_clients[i];
+        }
+    }
+    oldest->ip = ip;
+    oldest->tokens = ADMISSION_CLIENT_BURST;
+    oldest->last_ms = now;
+    return *oldest;
+}
+
+bool admission_is_priority(IPAddress ip) {
+    return (uint32_t)g_router != 0 && g_router == ip;
+}
+
+bool admission_take_budget() {
+    unsigned long now = millis();
+    if (now - g_period_start_ms >= ADMISSION_PERIOD_MS) {
+        g_period_start_ms = now;
+        g_period_used = 0;
+    }
+    if (g_period_used >= ADMISSION_PERIOD_BUDGET) {
+        return false;
+    }
+    g_period_used++;
+    return true;
+}
+
+bool admission_take_client(IPAddress ip) {
+    unsigned long now = millis();
+    ClientBucket& b = bucket_for((uint32_t)ip, now);
+
+    b.tokens += (now - b.last_ms) * (ADMISSION_CLIENT_RATE / 1000.0f);
+    if (b.tokens > ADMISSION_CLIENT_BURST) b.tokens = ADMISSION_CLIENT_BURST;
+    b.last_ms = now;
+
+    if (b.tokens < 1.0f) {
+        g_stats.rejected++;
+        return false;
+    }
+    b.tokens -= 1.0f;
+    g_stats.admitted++;
+    return true;
+}
+
+void admission_note_deferred() {
+    g_stats.deferred++;
+}
+
+void admission_note_priority() {
+    g_stats.priority++;
+}
+
+bool admission_settings_valid(const AdmissionSettings& s) {
+    if (s.router_ip[0] == '\0') return true;
+    if (strnlen(s.router_ip, sizeof(s.router_ip)) >= sizeof(s.router_ip)) return false;
+    IPAddress ip;
+    return ip.fromString(s.router_ip) && (uint32_t)ip != 0;
+}
+
+void admission_set_settings(const AdmissionSettings& settings) {
+    if (!admission_settings_valid(settings)) {
+        LOG_WARN("Admission: invalid router address ignored");
+        return;
+    }
+    g_settings = settings;
+    g_router = IPAddress();
+    if (g_settings.router_ip[0] != '\0') g_router.fromString(g_settings.router_ip);
+    LOG_INFO("Admission: trusted router %s", g_settings.router_ip[0] ? g_settings.router_ip : "(none)");
+}
+
+const AdmissionSettings& admission_get_settings() {
+    return g_settings;
+}
+
+const AdmissionStats& admission_get_stats() {
+    return g_stats;
+}
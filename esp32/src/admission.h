@@ -0,0 +1,58 @@
+// admission.h
+// Admission control for HTTP requests
+//
+// Two limits keep UI traffic from starving display updates and ingest:
+// - Per-client token bucket (keyed by IP): a client that exceeds its rate
+//   is answered with 429 without running a handler.
+// - Global budget per period: once spent, further requests wait in their
+//   socket until the next period, so loop() gets back to the displays.
+// Requests from the configured router address (trusted_router_ip in
+// /api/config) bypass both. It is never taken from request bodies, so a
+// client cannot claim priority by reporting its own address.
+#pragma once
+
+#include <Arduino.h>
+
+// Per-client token bucket
+static const float ADMISSION_CLIENT_RATE = 4.0f;     // sustained requests/sec per client
+static const float ADMISSION_CLIENT_BURST = 12.0f;   // bucket size (a full page load)
+static const int ADMISSION_MAX_CLIENTS = 8;          // tracked clients (least recent evicted)
+
+// Global budget
+static const unsigned long ADMISSION_PERIOD_MS = 100;
+static const uint8_t ADMISSION_PERIOD_BUDGET = 4;    // non-priority requests per period
+
+// Persisted as part of PanelConfig
+struct AdmissionSettings {
+    char router_ip[16];         // dotted IPv4, "" = no client gets priority
+};
+
+struct AdmissionStats {
+    uint32_t admitted;    // non-priority requests admitted
+    uint32_t priority;    // router requests (never limited)
+    uint32_t rejected;    // answered with 429 (client over rate)
+    uint32_t deferred;    // requests held back by the global budget
+};
+
+// True if the client gets priority (the configured router)
+bool admission_is_priority(IPAddress ip);
+
+// Take one request from the current period's global budget.
+// Returns false when the budget is spent (defer the request).
+bool admission_take_budget();
+
+// Take one token from the client's bucket. Returns false when the client
+// is over its rate (reject the request).
+bool admission_take_client(IPAddress ip);
+
+// Count a deferred request (once per request, not per retry)
+void admission_note_deferred();
+
+// Count a priority request
+void admission_note_priority();
+
+bool admission_settings_valid(const AdmissionSettings& settings);
+void admission_set_settings(const AdmissionSettings& settings);
+const AdmissionSettings& admission_get_settings();
+
+const AdmissionStats& admission_get_stats();
@@ -0,0 +1,327 @@
+// availability.cpp
+#include "availability.h"
+#include <LittleFS.h>
+#include "metrics_history.h"
+#include "metrics_log.h"
+#include "billing_cycle.h"
+#include "local_pinger.h"
+#include "wan_freshness.h"
+#include "logger.h"
+
+static const char* SAVE_TMP_PATH = "/avail.tmp";
+static const char* LOCAL_NAME = "local";    // reserved, never a WAN name
+static const int SOURCES = MAX_WANS + 1;
+
+struct AvailSlot {
+    uint16_t seconds[AVAIL_CLASSES];
+};
+
+struct AvailSource {
+    bool seen;
+    AvailSlot slots[AVAIL_TOTAL_SLOTS];     // all windows' rings, back to back
+    uint32_t totals[AVAIL_WINDOWS][AVAIL_CLASSES];
+};
+
+// Saved file: one entry per source (the file is ignored if its size
+// differs). Each window's ring starts at the slot that was current when
+// saved_unix_s was taken, then goes back in time.
+struct AvailEntry {
+    char name[WAN_NAME_LEN];    // "" = unused
+    uint32_t saved_unix_s;
+    AvailSlot slots[AVAIL_TOTAL_SLOTS];
+};
+
+static AvailSource g_sources[SOURCES];
+
+// Period number of each window's current slot (shared by all sources, as
+// every source is charged on the same tick)
+static uint32_t g_period[AVAIL_WINDOWS];
+static uint32_t g_last_tick_s;
+static unsigned long g_last_tick_ms;
+static bool g_started;
+
+// Entries of the saved file not merged yet (by file position, "" = done)
+static char g_pending[SOURCES][WAN_NAME_LEN];
+static bool g_have_pending = false;
+static bool g_save_now = false;
+static unsigned long g_last_save_ms = 0;
+
+static int ring_offset(int w) {
+    int offset = 0;
+    for (int i = 0; i < w; i++) offset += AVAIL_SLOTS[i];
+    return offset;
+}
+
+// Clear the slots of periods that ended since the last tick and take them
+// out of the window's total
+static void advance_ring(AvailSource& src, int w, uint32_t from_period, uint32_t to_period) {
+    AvailSlot* ring = src.slots + ring_offset(w);
+    uint32_t* total = src.totals[w];
+
+    if (to_period - from_period >= (uint32_t)AVAIL_SLOTS[w]) {
+        memset(ring, 0, sizeof(AvailSlot) * AVAIL_SLOTS[w]);
+        memset(total, 0, sizeof(src.totals[w]));
+        return;
+    }
+    for (uint32_t p = from_period + 1; p <= to_period; p++) {
+        AvailSlot& slot = ring[p % AVAIL_SLOTS[w]];
+        for (int c = 0; c < AVAIL_CLASSES; c++) {
+            total[c] -= slot.seconds[c];
+            slot.seconds[c] = 0;
+        }
+    }
+}
+
+static void charge(AvailSource& src, AvailClass cls, uint32_t secs) {
+    src.seen = true;
+    for (int w = 0; w < AVAIL_WINDOWS; w++) {
+        AvailSlot& slot = src.slots[ring_offset(w) + g_period[w] % AVAIL_SLOTS[w]];
+        uint32_t room = 0xFFFF - slot.seconds[(int)cls];
+        uint32_t add = (secs < room) ? secs : room;
+        slot.seconds[(int)cls] += add;
+        src.totals[w][(int)cls] += add;
+    }
+}
+
+static AvailClass class_of(WanState state) {
+    switch (state) {
+        case WanState::UP: return AvailClass::UP;
+        case WanState::DEGRADED: return AvailClass::DEGRADED;
+        default: return AvailClass::DOWN;
+    }
+}
+
+// ---- Persistence ----
+
+static const char* source_name(int source) {
+    return source == LOCAL_PINGER_ID ? LOCAL_NAME : wan_metrics_key(source);
+}
+
+static int source_find(const char* name) {
+    return strcmp(name, LOCAL_NAME) == 0 ? LOCAL_PINGER_ID : wan_metrics_find(name);
+}
+
+static bool read_entry(File& f, int index, AvailEntry& e) {
+    return f.seek(index * sizeof(e)) && f.read((uint8_t*)&e, sizeof(e)) == sizeof(e);
+}
+
+// Add a saved entry into a source's rings, moved on by the wall time since
+// it was saved. Slot k of a saved ring lands k periods before the period
+// the history clock was in at saved_unix_s.
+static void merge_entry(AvailSource& src, const AvailEntry& e, uint32_t now_s, uint32_t now_unix) {
+    int64_t elapsed_s = (now_unix > e.saved_unix_s) ? now_unix - e.saved_unix_s : 0;
+    for (int w = 0; w < AVAIL_WINDOWS; w++) {
+        const AvailSlot* saved = e.slots + ring_offset(w);
+        AvailSlot* ring = src.slots + ring_offset(w);
+        int64_t slots = AVAIL_SLOTS[w];
+        int64_t period = AVAIL_PERIOD_S[w];
+        int64_t period_now = g_period[w];
+        int64_t t = (int64_t)now_s - elapsed_s;    // history clock at saved_unix_s
+        int64_t period_saved = (t >= 0) ? t / period : (t - period + 1) / period;
+        for (int k = 0; k < slots; k++) {
+            int64_t p = period_saved - k;
+            if (p > period_now || period_now - p >= slots) continue;
+            AvailSlot& slot = ring[((p % slots) + slots) % slots];
+            for (int c = 0; c < AVAIL_CLASSES; c++) {
+                uint32_t room = 0xFFFF - slot.seconds[c];
+                uint32_t add = (saved[k].seconds[c] < room) ? saved[k].seconds[c] : room;
+                slot.seconds[c] += add;
+                src.totals[w][c] += add;
+            }
+        }
+    }
+    src.seen = true;
+}
+
+// Merge saved entries whose source is in the table now
+static void merge_pending(uint32_t now_s, uint32_t now_unix) {
+    File f = LittleFS.open(AVAIL_SAVE_PATH, "r");
+    if (!f) {
+        g_have_pending = false;
+        return;
+    }
+    static AvailEntry e;  // too big for the loop task's stack
+    bool pending = false;
+    for (int i = 0; i < SOURCES; i++) {
+        if (g_pending[i][0] == '\0') continue;
+        int source = source_find(g_pending[i]);
+        if (source < LOCAL_PINGER_ID) {
+            pending = true;
+            continue;
+        }
+        if (read_entry(f, i, e) && strncmp(e.name, g_pending[i], WAN_NAME_LEN) == 0) {
+            merge_entry(g_sources[source], e, now_s, now_unix);
+            LOG_INFO("Availability: restored %s", g_pending[i]);
+        }
+        g_pending[i][0] = '\0';
+    }
+    f.close();
+    g_have_pending = pending;
+}
+
+// Write every seen source, plus saved entries still waiting for their WAN,
+// to a new file and swap it in
+static void save(uint32_t now_unix) {
+    g_last_save_ms = millis();
+    g_save_now = false;
+
+    File old;
+    if (g_have_pending) old = LittleFS.open(AVAIL_SAVE_PATH, "r");
+    File f = LittleFS.open(SAVE_TMP_PATH, "w");
+    if (!f) {
+        LOG_WARN("Availability: cannot write %s", SAVE_TMP_PATH);
+        if (old) old.close();
+        return;
+    }
+
+    static AvailEntry e;  // too big for the loop task's stack
+    bool ok = true;
+    int written = 0;
+    for (int source = LOCAL_PINGER_ID; source <= wan_metrics_count() && ok; source++) {
+        const AvailSource& src = g_sources[source];
+        if (!src.seen) continue;
+        memset(&e, 0, sizeof(e));
+        strlcpy(e.name, source_name(source), sizeof(e.name));
+        e.saved_unix_s = now_unix;
+        for (int w = 0; w < AVAIL_WINDOWS; w++) {
+            const AvailSlot* ring = src.slots + ring_offset(w);
+            int slots = AVAIL_SLOTS[w];
+            for (int k = 0; k < slots; k++) {
+                int64_t p = (int64_t)g_period[w] - k;   // negative before the clock started
+                e.slots[ring_offset(w) + k] = ring[((p % slots) + slots) % slots];
+            }
+        }
+        ok = f.write((const uint8_t*)&e, sizeof(e)) == sizeof(e);
+        written++;
+    }
+    // Carry over saved entries whose WAN is not in the table yet; they keep
+    // their own saved_unix_s, at their new file positions
+    char pending[SOURCES][WAN_NAME_LEN] = {};
+    bool carried = false;
+    for (int i = 0; old && i < SOURCES && written < SOURCES && ok; i++) {
+        if (g_pending[i][0] == '\0') continue;
+        if (!read_entry(old, i, e) || strncmp(e.name, g_pending[i], WAN_NAME_LEN) != 0) continue;
+        ok = f.write((const uint8_t*)&e, sizeof(e)) == sizeof(e);
+        strlcpy(pending[written++], e.name, WAN_NAME_LEN);
+        carried = true;
+    }
+    if (old) old.close();
+    memcpy(g_pending, pending, sizeof(g_pending));
+    g_have_pending = carried;
+    memset(&e, 0, sizeof(e));
+    while (written < SOURCES && ok) {
+        ok = f.write((const uint8_t*)&e, sizeof(e)) == sizeof(e);
+        written++;
+    }
+    f.close();
+
+    if (!ok || !LittleFS.rename(SAVE_TMP_PATH, AVAIL_SAVE_PATH)) {
+        LOG_WARN("Availability: saving %s failed", AVAIL_SAVE_PATH);
+    }
+}
+
+void avail_init() {
+    if (!mlog_get_stats().mounted || !LittleFS.exists(AVAIL_SAVE_PATH)) return;
+    File f = LittleFS.open(AVAIL_SAVE_PATH, "r");
+    if (!f) return;
+    if (f.size() == SOURCES * sizeof(AvailEntry)) {
+        static AvailEntry e;
+        for (int i = 0; i < SOURCES; i++) {
+            if (!read_entry(f, i, e)) break;
+            e.name[WAN_NAME_LEN - 1] = '\0';
+            strlcpy(g_pending[i], e.name, WAN_NAME_LEN);
+            if (e.name[0] != '\0') g_have_pending = true;
+        }
+    }
+    f.close();
+}
+
+// ---- Ticks ----
+
+void avail_update() {
+    unsigned long now_ms = millis();
+    if (g_started && now_ms - g_last_tick_ms < AVAIL_TICK_MS) return;
+    g_last_tick_ms = now_ms;
+
+    uint32_t now_s = history_now_s();
+    if (!g_started) {
+        for (int w = 0; w < AVAIL_WINDOWS; w++) g_period[w] = now_s / AVAIL_PERIOD_S[w];
+        g_last_tick_s = now_s;
+        g_started = true;
+        return;
+    }
+    uint32_t secs = now_s - g_last_tick_s;
+    if (secs == 0) return;
+    if (secs > AVAIL_MAX_TICK_S) secs = AVAIL_MAX_TICK_S;
+    g_last_tick_s = now_s;
+
+    for (int w = 0; w < AVAIL_WINDOWS; w++) {
+        uint32_t period = now_s / AVAIL_PERIOD_S[w];
+        if (period == g_period[w]) continue;
+        for (AvailSource& src : g_sources) {
+            if (src.seen) advance_ring(src, w, g_period[w], period);
+        }
+        g_period[w] = period;
+    }
+
+    // The local pinger counts as stale until its first stats pass
+    const LocalPingerMetrics& lp = local_pinger_get();
+    charge(g_sources[LOCAL_PINGER_ID],
+           lp.last_update_ms == 0 ? AvailClass::STALE : class_of(lp.state), secs);
+
+    // WANs are charged from their first report on
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        AvailClass cls = wan_is_stale(id) ? AvailClass::STALE : class_of(wan_metrics_get(id).state);
+        charge(g_sources[id], cls, secs);
+    }
+
+    // Saved rings can only be placed, and new ones stamped, on the wall clock
+    uint32_t now_unix;
+    if (!mlog_get_stats().mounted || !billing_clock_now(now_unix)) return;
+    if (g_have_pending) merge_pending(now_s, now_unix);
+    if (g_save_now || now_ms - g_last_save_ms >= AVAIL_SAVE_MS) save(now_unix);
+}
+
+void avail_forget(int wan_id) {
+    if (wan_id < 1) return;
+    const char* name = wan_metrics_key(wan_id);
+    for (char* pending : g_pending) {
+        if (strcmp(pending, name) == 0) pending[0] = '\0';
+    }
+    wan_id_erase(g_sources, wan_id);
+    g_save_now = true;      // so the saved copy goes too
+}
+
+bool avail_get(int source, AvailWindow window, AvailTotals& out) {
+    if (source < LOCAL_PINGER_ID || source > MAX_WANS) return false;
+    if (window >= AvailWindow::COUNT) return false;
+    const AvailSource& src = g_sources[source];
+    if (!src.seen) return false;
+
+    out.observed_s = 0;
+    for (int c = 0; c < AVAIL_CLASSES; c++) {
+        out.seconds[c] = src.totals[(int)window][c];
+        out.observed_s += out.seconds[c];
+    }
+    return true;
+}
+
+const char* avail_window_to_string(AvailWindow window) {
+    switch (window) {
+        case AvailWindow::H1: return "1h";
+        case AvailWindow::H24: return "24h";
+        case AvailWindow::D7: return "7d";
+        case AvailWindow::D30: return "30d";
+        default: return "unknown";
+    }
+}
+
+const char* avail_class_to_string(AvailClass cls) {
+    switch (cls) {
+        case AvailClass::UP: return "up";
+        case AvailClass::DEGRADED: return "degraded";
+        case AvailClass::DOWN: return "down";
+        case AvailClass::STALE: return "stale";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,66 @@
+// availability.h
+// Rolling time-in-state totals per WAN and for the local pinger
+//
+// Once a second every source is charged the time since the last tick in
+// its current state: UP, DEGRADED, DOWN, or STALE while its reports are
+// too old to show (see wan_freshness.h). Each window is a ring of slots
+// holding seconds per state plus a running total of the ring, so a tick is
+// O(1): add to the slot for "now" and its total, and when a new period
+// starts subtract the slot that falls out of the window before reusing it.
+// Reading a window is a copy of its total, never a rescan.
+//
+// A window covers its current (partial) slot and the slots before it, so
+// it spans at most its length and trails by under one slot. Times are on
+// the history clock (see metrics_history.h). Memory is fixed: about 1.4 KB
+// per source.
+//
+// The rings are saved to LittleFS (AVAIL_SAVE_PATH, next to the metrics
+// log; too big for NVS) every AVAIL_SAVE_MS once the billing wall clock is
+// set, keyed by WAN name and stamped with the wall clock. After a reboot a
+// saved source is merged back once the clock is set again and the WAN has
+// reported: its slots move on by the wall time that passed, so downtime is
+// a gap (not observed) instead of being skipped, and slots that fell out
+// of a window are dropped.
+#pragma once
+
+#include <Arduino.h>
+#include "wan_metrics.h"
+
+enum class AvailWindow : uint8_t { H1, H24, D7, D30, COUNT };
+enum class AvailClass : uint8_t { UP, DEGRADED, DOWN, STALE, COUNT };
+
+static const int AVAIL_WINDOWS = (int)AvailWindow::COUNT;
+static const int AVAIL_CLASSES = (int)AvailClass::COUNT;
+
+// Slot period and count per window; a slot's seconds fit a uint16_t
+static const uint32_t AVAIL_PERIOD_S[AVAIL_WINDOWS] = { 60, 3600, 6 * 3600, 12 * 3600 };
+static const int AVAIL_SLOTS[AVAIL_WINDOWS] = { 60, 24, 28, 60 };
+static const int AVAIL_TOTAL_SLOTS = 60 + 24 + 28 + 60;
+static const unsigned long AVAIL_TICK_MS = 1000;
+static const uint32_t AVAIL_MAX_TICK_S = 60;    // longer gaps (loop stalls) are capped
+static const unsigned long AVAIL_SAVE_MS = 15 * 60 * 1000;
+static const char* AVAIL_SAVE_PATH = "/avail.bin";
+
+struct AvailTotals {
+    uint32_t seconds[AVAIL_CLASSES];    // indexed by AvailClass
+    uint32_t observed_s;                // sum of the above
+};
+
+// Read the saved rings (call once in setup(), after mlog_init() mounted LittleFS)
+void avail_init();
+
+// Charge every source for the time since the last tick (call from loop())
+void avail_update();
+
+// Totals of one window (source: LOCAL_PINGER_ID or a WAN id); false if
+// the source has not been observed since boot
+bool avail_get(int source, AvailWindow window, AvailTotals& out);
+
+// Drop a forgotten WAN's totals; later WANs move down with their ids
+void avail_forget(int wan_id);
+
+// "1h", "24h", "7d", "30d"
+const char* avail_window_to_string(AvailWindow window);
+
+// "up", "degraded", "down", "stale"
+const char* avail_class_to_string(AvailClass cls);
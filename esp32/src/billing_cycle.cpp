@@ -0,0 +1,136 @@
+// billing_cycle.cpp
+#include "billing_cycle.h"
+#include "wan_metrics.h"
+#include "logger.h"
+
+static BillingSettings g_settings = { BILLING_DEFAULT_CYCLE_DAY };
+
+// Router timestamp the clock was last set from
+static char g_sync_text[32] = "";
+static uint32_t g_sync_unix_s = 0;
+static unsigned long g_sync_ms = 0;
+static bool g_synced = false;
+
+// ---- Civil calendar (proleptic Gregorian, UTC) ----
+
+// Days since 1970-01-01 for a date (m: 1-12)
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+static void civil_from_days(int32_t z, int32_t& y, uint32_t& m, uint32_t& d) {
+    z += 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int32_t)yoe + era * 400 + (m <= 2);
+}
+
+bool parse_iso8601(const char* text, uint32_t& unix_s) {
+    int y, mo, d, h, mi, s, consumed = 0;
+    if (sscanf(text, "%4d-%2d-%2dT%2d:%2d:%2d%n", &y, &mo, &d, &h, &mi, &s, &consumed) != 6) return false;
+    if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 60) return false;
+
+    const char* zone = text + consumed;
+    if (*zone == '.') {
+        zone++;
+        while (*zone >= '0' && *zone <= '9') zone++;
+    }
+    int32_t offset_s = 0;
+    if (*zone == '+' || *zone == '-') {
+        int oh, om;
+        if (sscanf(zone + 1, "%2d:%2d", &oh, &om) != 2 || oh > 23 || om > 59) return false;
+        offset_s = (oh * 3600 + om * 60) * (*zone == '-' ? -1 : 1);
+    } else if (*zone != 'Z') {
+        return false;
+    }
+
+    int64_t t = (int64_t)days_from_civil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s - offset_s;
+    if (t < BILLING_MIN_UNIX_S || t > UINT32_MAX) return false;
+    unix_s = (uint32_t)t;
+    return true;
+}
+
+void format_iso8601(uint32_t unix_s, char* buf, size_t size) {
+    int32_t y;
+    uint32_t m, d;
+    civil_from_days((int32_t)(unix_s / 86400), y, m, d);
+    uint32_t sod = unix_s % 86400;
+    snprintf(buf, size, "%04ld-%02lu-%02luT%02lu:%02lu:%02luZ", (long)y, (unsigned long)m,
+             (unsigned long)d, (unsigned long)(sod / 3600), (unsigned long)(sod / 60 % 60),
+             (unsigned long)(sod % 60));
+}
+
+// ---- Wall clock ----
+
+bool billing_clock_now(uint32_t& unix_s) {
+    // Re-sync whenever the router sends a new timestamp
+    const char* text = wan_metrics_get_timestamp();
+    if (text[0] != '\0' && strcmp(text, g_sync_text) != 0) {
+        strlcpy(g_sync_text, text, sizeof(g_sync_text));
+        uint32_t t;
+        if (parse_iso8601(text, t)) {
+            if (!g_synced) LOG_INFO("Billing: wall clock set from router (%s)", text);
+            g_sync_unix_s = t;
+            g_sync_ms = millis();
+            g_synced = true;
+        }
+    }
+    if (!g_synced) return false;
+    unix_s = g_sync_unix_s + (millis() - g_sync_ms) / 1000;
+    return true;
+}
+
+// ---- Cycles ----
+
+uint32_t billing_cycle_start(uint32_t unix_s) {
+    int32_t y;
+    uint32_t m, d;
+    civil_from_days((int32_t)(unix_s / 86400), y, m, d);
+    if (d < g_settings.cycle_day) {  // still in the cycle that began last month
+        if (--m == 0) {
+            m = 12;
+            y--;
+        }
+    }
+    return (uint32_t)days_from_civil(y, m, g_settings.cycle_day) * 86400;
+}
+
+uint32_t billing_cycle_end(uint32_t unix_s) {
+    int32_t y;
+    uint32_t m, d;
+    civil_from_days((int32_t)(billing_cycle_start(unix_s) / 86400), y, m, d);
+    if (++m == 13) {
+        m = 1;
+        y++;
+    }
+    return (uint32_t)days_from_civil(y, m, g_settings.cycle_day) * 86400;
+}
+
+// ---- Settings ----
+
+bool billing_settings_valid(const BillingSettings& s) {
+    return s.cycle_day >= 1 && s.cycle_day <= BILLING_MAX_CYCLE_DAY;
+}
+
+void billing_set_settings(const BillingSettings& settings) {
+    if (!billing_settings_valid(settings)) {
+        LOG_WARN("Billing: invalid settings ignored");
+        return;
+    }
+    g_settings = settings;
+    LOG_INFO("Billing: cycle starts on day %u", g_settings.cycle_day);
+}
+
+const BillingSettings& billing_get_settings() {
+    return g_settings;
+}
@@ -0,0 +1,41 @@
+// billing_cycle.h
+// Billing cycle bounds on a wall clock taken from router timestamps
+//
+// The panel has no RTC or NTP client. Every batch from the collector
+// carries the router's UTC time ("timestamp", ISO 8601), so the wall clock
+// is the last timestamp seen plus the millis() since it arrived. In SNMP
+// pull mode the poller sets that timestamp from the agent's hrSystemDate
+// instead. Until the first timestamp there is no wall clock, and callers
+// must cope with not knowing which cycle they are in.
+//
+// A billing cycle starts at 00:00 UTC on cycle_day (1-28, so every month
+// has it) and ends where the next one starts.
+#pragma once
+
+#include <Arduino.h>
+
+static const uint8_t BILLING_DEFAULT_CYCLE_DAY = 1;
+static const uint8_t BILLING_MAX_CYCLE_DAY = 28;
+static const uint32_t BILLING_MIN_UNIX_S = 1577836800;   // 2020-01-01: older clocks are ignored
+
+// Persisted as part of PanelConfig
+struct BillingSettings {
+    uint8_t cycle_day;          // day of the month a cycle starts (1-28)
+};
+
+// Current UTC time in Unix seconds; false until a router timestamp arrived
+bool billing_clock_now(uint32_t& unix_s);
+
+// Start / end (exclusive) of the cycle containing unix_s
+uint32_t billing_cycle_start(uint32_t unix_s);
+uint32_t billing_cycle_end(uint32_t unix_s);
+
+// Parse "YYYY-MM-DDTHH:MM:SS[.fff](Z|+HH:MM|-HH:MM)"; false if malformed
+bool parse_iso8601(const char* text, uint32_t& unix_s);
+
+// Format as "YYYY-MM-DDTHH:MM:SSZ" (buf: at least 21 bytes)
+void format_iso8601(uint32_t unix_s, char* buf, size_t size);
+
+bool billing_settings_valid(const BillingSettings& settings);
+void billing_set_settings(const BillingSettings& settings);
+const BillingSettings& billing_get_settings();
@@ -1,6 +1,7 @@
 // brightness_pot.cpp
 #include "brightness_pot.h"
 #include "leds.h"
+#include "logger.h"
 
 BrightnessPotentiometer::BrightnessPotentiometer()
     : _pin(0)
@@ -22,7 +23,7 @@ void BrightnessPotentiometer::begin(uint8_t gpio_pin) {
     // Set initial brightness to match pot position
     set_display_brightness(_current_level);
 
-    Serial.printf("Brightness pot initialized on GPIO %d, level: %d (raw: %d)\n",
+    LOG_INFO("Brightness pot initialized on GPIO %d, level: %d (raw: %d)",
                   _pin, _current_level, _last_raw);
 }
 
@@ -57,7 +58,7 @@ void BrightnessPotentiometer::update() {
 
         // Pot movement overrides current brightness
         set_display_brightness(_current_level);
-        Serial.printf("Brightness pot: %d (raw: %d)\n", _current_level, raw);
+        LOG_DEBUG("Brightness pot: %d (raw: %d)", _current_level, raw);
     }
 }
 
@@ -1,5 +1,6 @@
 // button_handler.cpp
 #include "button_handler.h"
+#include "logger.h"
 
 ButtonHandler::ButtonHandler()
     : _pin(0)
@@ -29,15 +30,15 @@ void ButtonHandler::begin(uint8_t pin, ButtonPinType type, Adafruit_MCP23X17* mc
 
     if (_type == ButtonPinType::MCP) {
         if (_mcp == nullptr) {
-            Serial.println("ERROR: ButtonHandler MCP mode requires MCP pointer");
+            LOG_ERROR("ButtonHandler MCP mode requires MCP pointer");
             _enabled = false;
             return;
         }
         _mcp->pinMode(_pin, INPUT_PULLUP);
-        Serial.printf("Button handler initialized on MCP pin %d\n", _pin);
+        LOG_INFO("Button handler initialized on MCP pin %d", _pin);
     } else {
         pinMode(_pin, INPUT_PULLUP);
-        Serial.printf("Button handler initialized on GPIO %d\n", _pin);
+        LOG_INFO("Button handler initialized on GPIO %d", _pin);
     }
 
     _enabled = true;
@@ -111,7 +112,7 @@ void ButtonHandler::update() {
     if (_was_pressed && !_long_press_fired && _stable_state == LOW) {
         unsigned long held_ms = now - _press_start_ms;
         if (held_ms >= _long_press_threshold_ms) {
-            Serial.printf("Long press detected after %lu ms\n", held_ms);
+            LOG_DEBUG("Long press detected after %lu ms", held_ms);
             _long_press_fired = true;
             if (_long_press_cb) {
                 _long_press_cb();
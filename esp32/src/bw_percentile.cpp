@@ -0,0 +1,200 @@
+// bw_percentile.cpp
+#include "bw_percentile.h"
+#include <Preferences.h>
+#include "billing_cycle.h"
+#include "logger.h"
+
+static const char* BLOB_KEY = "cycle";
+
+// Saved form of the estimators (the blob is ignored if its size differs)
+struct BwBlob {
+    uint32_t cycle_start;
+    char name[MAX_WANS][WAN_NAME_LEN];
+    WanBandwidthPercentiles wans[MAX_WANS];
+};
+
+static WanBandwidthPercentiles g_wans[MAX_WANS];
+static BwPercentileStats g_stats;
+static bool g_ready = false;
+
+static Preferences g_prefs;
+static bool g_nvs_ok = false;
+static BwBlob g_saved;                  // loaded at boot
+static bool g_have_saved = false;       // loaded, cycle not checked yet
+static bool g_saved_pending = false;    // same cycle, entries not picked up yet are left in g_saved
+static bool g_dirty = false;
+static bool g_save_now = false;
+static unsigned long g_last_save_ms = 0;
+
+static void reset_all() {
+    for (WanBandwidthPercentiles& w : g_wans) {
+        memset(&w, 0, sizeof(w));
+        p2_init(w.down, BW_PERCENTILE);
+        p2_init(w.up, BW_PERCENTILE);
+    }
+    g_stats.samples = 0;
+    g_ready = true;
+}
+
+// ---- Persistence ----
+
+static void check_saved(uint32_t cycle_start) {
+    if (!g_have_saved) return;
+    g_have_saved = false;
+    if (g_saved.cycle_start != cycle_start) {
+        LOG_INFO("Bandwidth p95: saved state is from an earlier billing cycle, dropped");
+        return;
+    }
+    g_saved_pending = true;
+}
+
+// Take over a WAN's saved estimators at its first sample in the cycle
+static void restore_saved(int wan_id) {
+    const char* name = wan_metrics_key(wan_id);
+    bool pending = false;
+    for (int i = 0; i < MAX_WANS; i++) {
+        char* saved_name = g_saved.name[i];
+        if (saved_name[0] == '\0') continue;
+        if (strcmp(saved_name, name) != 0) {
+            pending = true;
+            continue;
+        }
+        WanBandwidthPercentiles& w = g_wans[wan_id - 1];
+        g_stats.samples = g_stats.samples - w.down.count + g_saved.wans[i].down.count;
+        w = g_saved.wans[i];
+        saved_name[0] = '\0';
+        g_stats.restored = true;
+        LOG_INFO("Bandwidth p95: restored %s for the current billing cycle", name);
+    }
+    g_saved_pending = pending;
+}
+
+static void save() {
+    if (!g_nvs_ok || g_stats.cycle_start == 0) return;
+
+    static BwBlob blob;  // too big for the loop task's stack
+    memset(&blob, 0, sizeof(blob));
+    blob.cycle_start = g_stats.cycle_start;
+    int count = wan_metrics_count();
+    for (int i = 0; i < count && i < MAX_WANS; i++) {
+        strlcpy(blob.name[i], wan_metrics_key(i + 1), WAN_NAME_LEN);
+        blob.wans[i] = g_wans[i];
+    }
+    // Keep saved WANs that have not reported since boot
+    for (int i = 0; g_saved_pending && i < MAX_WANS; i++) {
+        if (g_saved.name[i][0] == '\0' || wan_metrics_find(g_saved.name[i]) != 0) continue;
+        for (int j = 0; j < MAX_WANS; j++) {
+            if (blob.name[j][0] != '\0') continue;
+            memcpy(blob.name[j], g_saved.name[i], WAN_NAME_LEN);
+            blob.wans[j] = g_saved.wans[i];
+            break;
+        }
+    }
+
+    g_last_save_ms = millis();
+    g_save_now = false;
+    if (g_prefs.putBytes(BLOB_KEY, &blob, sizeof(blob)) != sizeof(blob)) {
+        g_stats.save_errors++;
+        LOG_WARN("Bandwidth p95: NVS write failed");
+        return;
+    }
+    g_dirty = false;
+    g_stats.saves++;
+}
+
+void bw_percentile_init() {
+    g_nvs_ok = g_prefs.begin(BW_NVS_NAMESPACE, false);
+    if (!g_nvs_ok) {
+        LOG_WARN("Bandwidth p95: NVS unavailable, figures will not persist");
+        return;
+    }
+    if (g_prefs.getBytesLength(BLOB_KEY) != sizeof(g_saved)) return;
+    g_have_saved = g_prefs.getBytes(BLOB_KEY, &g_saved, sizeof(g_saved)) == sizeof(g_saved);
+    for (int i = 0; g_have_saved && i < MAX_WANS; i++) {
+        g_saved.name[i][WAN_NAME_LEN - 1] = '\0';
+    }
+}
+
+void bw_percentile_update() {
+    if (g_save_now || (g_dirty && millis() - g_last_save_ms >= BW_SAVE_MS)) save();
+}
+
+// ---- Samples ----
+
+static void track_peak(float mbps, float& peak, uint32_t& peak_at, bool clock_ok, uint32_t now) {
+    if (mbps <= peak) return;
+    peak = mbps;
+    peak_at = clock_ok ? now : 0;
+}
+
+void bw_percentile_add(int wan_id, float down_mbps, float up_mbps) {
+    if (wan_id < 1 || wan_id > MAX_WANS) return;
+    if (!g_ready) reset_all();
+
+    uint32_t now = 0;
+    bool clock_ok = billing_clock_now(now);
+    if (clock_ok) {
+        uint32_t start = billing_cycle_start(now);
+        if (g_stats.cycle_start == 0) {
+            check_saved(start);
+        } else if (start != g_stats.cycle_start) {
+            LOG_INFO("Bandwidth p95: new billing cycle, starting over");
+            reset_all();
+            g_stats.cycle_resets++;
+            g_saved_pending = false;
+            g_save_now = true;
+        }
+        g_stats.cycle_start = start;
+        if (g_saved_pending) restore_saved(wan_id);
+    }
+
+    WanBandwidthPercentiles& w = g_wans[wan_id - 1];
+    p2_add(w.down, down_mbps);
+    p2_add(w.up, up_mbps);
+    track_peak(down_mbps, w.down_peak_mbps, w.down_peak_at, clock_ok, now);
+    track_peak(up_mbps, w.up_peak_mbps, w.up_peak_at, clock_ok, now);
+    g_stats.samples++;
+    g_dirty = true;
+}
+
+void bw_percentile_forget(int wan_id) {
+    if (wan_id < 1 || wan_id > MAX_WANS) return;
+    if (!g_ready) reset_all();
+
+    const char* name = wan_metrics_key(wan_id);
+    for (int i = 0; i < MAX_WANS; i++) {
+        if (strcmp(g_saved.name[i], name) == 0) g_saved.name[i][0] = '\0';
+    }
+    g_stats.samples -= g_wans[wan_id - 1].down.count;
+    wan_id_erase(g_wans, wan_id - 1);
+    WanBandwidthPercentiles& freed = g_wans[MAX_WANS - 1];
+    p2_init(freed.down, BW_PERCENTILE);
+    p2_init(freed.up, BW_PERCENTILE);
+
+    // The saved copy must not bring it back
+    if (g_stats.cycle_start != 0) {
+        g_save_now = true;
+    } else if (g_have_saved && g_nvs_ok) {
+        g_prefs.putBytes(BLOB_KEY, &g_saved, sizeof(g_saved));
+    }
+}
+
+float bw_percentile_down(int wan_id) {
+    return p2_value(bw_percentile_get(wan_id).down);
+}
+
+float bw_percentile_up(int wan_id) {
+    return p2_value(bw_percentile_get(wan_id).up);
+}
+
+// ---- Readers ----
+
+const WanBandwidthPercentiles& bw_percentile_get(int wan_id) {
+    if (!g_ready) reset_all();
+    if (wan_id < 1 || wan_id > MAX_WANS) return g_wans[0];
+    return g_wans[wan_id - 1];
+}
+
+const BwPercentileStats& bw_percentile_get_stats() {
+    return g_stats;
+}
@@ -0,0 +1,67 @@
+// bw_percentile.h
+// 95th percentile and peak bandwidth per WAN over the billing cycle
+//
+// Burstable transit is billed at the 95th percentile of the month's rate
+// samples. Every committed WAN record (wan_metrics_commit_at()) feeds its
+// instant down/up rate into a P² estimator per direction (p2_quantile.h),
+// so memory is fixed however many samples the cycle holds. The highest
+// rate and when it was seen (Unix seconds, 0 before the wall clock is set)
+// are kept alongside.
+//
+// Everything starts over when the billing cycle changes (see
+// billing_cycle.h). Samples taken before the wall clock is set count
+// towards the cycle it then turns out to be.
+//
+// The estimators are keyed by WAN name and saved to NVS every
+// BW_SAVE_MS and at a cycle change, like data_usage.h. A saved WAN is
+// picked up again at its first sample once the clock shows the same
+// cycle, replacing what it gathered since boot before that.
+#pragma once
+
+#include <Arduino.h>
+#include "wan_metrics.h"
+#include "p2_quantile.h"
+
+static const float BW_PERCENTILE = 0.95f;
+
+static const char* BW_NVS_NAMESPACE = "bwpct";
+static const unsigned long BW_SAVE_MS = 15 * 60 * 1000;
+
+struct WanBandwidthPercentiles {
+    P2Quantile down;
+    P2Quantile up;
+    float down_peak_mbps;
+    float up_peak_mbps;
+    uint32_t down_peak_at;      // Unix seconds (0 = unknown)
+    uint32_t up_peak_at;
+};
+
+struct BwPercentileStats {
+    uint32_t cycle_start;       // Unix seconds of the cycle being tracked (0 = not known yet)
+    uint32_t samples;           // since the cycle started
+    uint32_t cycle_resets;      // cycle changes since boot
+    uint32_t saves;             // NVS writes since boot
+    uint32_t save_errors;
+    bool restored;              // state saved by an earlier boot was picked up for this cycle
+};
+
+// Load the state saved by an earlier boot (merged once the cycle is known)
+void bw_percentile_init();
+
+// Periodic NVS save; call from loop()
+void bw_percentile_update();
+
+// Fold in a WAN's latest instant rates (wan_id: 1..count)
+void bw_percentile_add(int wan_id, float down_mbps, float up_mbps);
+
+// Drop a forgotten WAN's estimators, also from the saved state (later WANs
+// move down with their ids)
+void bw_percentile_forget(int wan_id);
+
+// Current 95th percentile of a WAN's rates (0 before its first sample)
+float bw_percentile_down(int wan_id);
+float bw_percentile_up(int wan_id);
+
+const WanBandwidthPercentiles& bw_percentile_get(int wan_id);
+
+const BwPercentileStats& bw_percentile_get_stats();
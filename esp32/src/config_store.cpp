@@ -0,0 +1,493 @@
+// config_store.cpp
+#include "config_store.h"
+#include <Preferences.h>
+#include <stddef.h>
+#include <string.h>
+#include "leds.h"
+#include "wan_metrics.h"
+#include "udp_ingest.h"
+#include "logger.h"
+
+static const char* BLOB_KEY = "cfg";
+
+static Preferences g_prefs;
+static ConfigStoreStats g_stats;
+
+static PanelConfig g_saved;        // what NVS holds
+static PanelConfig g_live;         // last sampled live values
+static unsigned long g_last_poll_ms = 0;
+static unsigned long g_first_change_ms = 0;
+static unsigned long g_last_change_ms = 0;
+
+// ---- Live values ----
+
+// Read the current settings from their owning modules
+static void capture(PanelConfig& cfg) {
+    memset(&cfg, 0, sizeof(cfg));  // zero padding so memcmp is meaningful
+    cfg.brightness = get_display_brightness();
+    cfg.displays_on = get_displays_on();
+    cfg.bw_source = (uint8_t)wan_metrics_get_bw_source();
+    cfg.packet_auto_cycle = g_display_manager.isPacketAutoCycleEnabled();
+    cfg.bw_auto_cycle = g_display_manager.isBandwidthAutoCycleEnabled();
+    strncpy(cfg.ping_target, local_pinger_get_target(), sizeof(cfg.ping_target) - 1);
+    cfg.mqtt = mqtt_get_settings();
+    cfg.webhooks = webhook_get_settings();
+    cfg.log = log_get_settings();
+    cfg.snmp = snmp_get_settings();
+    cfg.gossip = gossip_get_settings();
+    cfg.state = state_policy_get_settings();
+    cfg.billing = billing_get_settings();
+    cfg.usage = data_usage_get_settings();
+    cfg.admission = admission_get_settings();
+}
+
+// Push settings to their owning modules (only what differs)
+static void apply(const PanelConfig& cfg) {
+    static PanelConfig cur;  // too big for the loop task's stack
+    capture(cur);
+
+    if (cfg.brightness != cur.brightness) set_display_brightness(cfg.brightness);
+    if (cfg.displays_on != cur.displays_on) set_displays_on(cfg.displays_on);
+    if (cfg.bw_source != cur.bw_source) wan_metrics_set_bw_source((BandwidthSource)cfg.bw_source);
+    if (cfg.packet_auto_cycle != cur.packet_auto_cycle) {
+        g_display_manager.setPacketAutoCycleEnabled(cfg.packet_auto_cycle);
+    }
+    if (cfg.bw_auto_cycle != cur.bw_auto_cycle) {
+        g_display_manager.setBandwidthAutoCycleEnabled(cfg.bw_auto_cycle);
+    }
+    if (strcmp(cfg.ping_target, cur.ping_target) != 0) local_pinger_set_target(cfg.ping_target);
+    if (memcmp(&cfg.mqtt, &cur.mqtt, sizeof(cfg.mqtt)) != 0) mqtt_set_settings(cfg.mqtt);
+    if (memcmp(&cfg.webhooks, &cur.webhooks, sizeof(cfg.webhooks)) != 0) webhook_set_settings(cfg.webhooks);
+    if (memcmp(&cfg.log, &cur.log, sizeof(cfg.log)) != 0) log_set_settings(cfg.log);
+    if (memcmp(&cfg.snmp, &cur.snmp, sizeof(cfg.snmp)) != 0) snmp_set_settings(cfg.snmp);
+    if (memcmp(&cfg.gossip, &cur.gossip, sizeof(cfg.gossip)) != 0) gossip_set_settings(cfg.gossip);
+    if (memcmp(&cfg.state, &cur.state, sizeof(cfg.state)) != 0) state_policy_set_settings(cfg.state);
+    if (memcmp(&cfg.billing, &cur.billing, sizeof(cfg.billing)) != 0) billing_set_settings(cfg.billing);
+    if (memcmp(&cfg.usage, &cur.usage, sizeof(cfg.usage)) != 0) data_usage_set_settings(cfg.usage);
+    if (memcmp(&cfg.admission, &cur.admission, sizeof(cfg.admission)) != 0) {
+        admission_set_settings(cfg.admission);
+    }
+}
+
+// ---- NVS ----
+
+static void save() {
+    size_t written = g_prefs.putBytes(BLOB_KEY, &g_live, sizeof(g_live));
+    if (written != sizeof(g_live)) {
+        LOG_WARN("Config: NVS write failed");
+        return;
+    }
+    g_saved = g_live;
+    g_stats.saves++;
+    g_stats.last_save_ms = millis();
+    LOG_INFO("Config: saved to NVS (%u writes since boot)", g_stats.saves);
+}
+
+void config_init() {
+    capture(g_live);  // defaults, as set up by the modules themselves
+    g_saved = g_live;
+
+    if (!g_prefs.begin(CONFIG_NVS_NAMESPACE, false)) {
+        LOG_WARN("Config: NVS unavailable, settings will not persist");
+        return;
+    }
+
+    size_t len = g_prefs.getBytesLength(BLOB_KEY);
+    if (len == 0) {
+        LOG_INFO("Config: no stored settings, using defaults");
+        return;
+    }
+
+    // Older (shorter) blobs load over the defaults
+    static PanelConfig stored;  // too big for the loop task's stack
+    stored = g_live;
+    g_prefs.getBytes(BLOB_KEY, &stored, min(len, sizeof(stored)));
+    stored.ping_target[sizeof(stored.ping_target) - 1] = '\0';
+    if (stored.brightness > 15) stored.brightness = 15;
+    if (!billing_settings_valid(stored.billing)) stored.billing = g_live.billing;
+    for (auto& name : stored.usage.cap_wan) name[WAN_NAME_LEN - 1] = '\0';
+    if (!usage_settings_valid(stored.usage)) stored.usage = g_live.usage;
+    stored.admission.router_ip[sizeof(stored.admission.router_ip) - 1] = '\0';
+    if (!admission_settings_valid(stored.admission)) stored.admission = g_live.admission;
+
+    // Blobs from before StateSettings carry the local pinger's thresholds;
+    // they become the enter limits of the default profile
+    if (len < offsetof(PanelConfig, state) + sizeof(stored.state) &&
+        stored.legacy_ping.latency_degraded_ms != 0) {
+        StateProfile& p = stored.state.profiles[0];
+        p.latency_enter_ms = stored.legacy_ping.latency_degraded_ms;
+        p.loss_enter_pct = stored.legacy_ping.loss_degraded_pct;
+        p.down_enter_pct = stored.legacy_ping.loss_down_pct;
+        p.latency_exit_ms = min(p.latency_exit_ms, p.latency_enter_ms);
+        p.loss_exit_pct = min(p.loss_exit_pct, p.loss_enter_pct);
+        p.down_exit_pct = min(p.down_exit_pct, p.down_enter_pct);
+        LOG_INFO("Config: migrated ping thresholds into the default state profile");
+    }
+    memset(&stored.legacy_ping, 0, sizeof(stored.legacy_ping));
+
+    apply(stored);
+    capture(g_live);
+    g_saved = stored;
+    g_stats.loaded = true;
+    LOG_INFO("Config: restored (brightness=%d, displays=%s, ping=%s)",
+                  g_live.brightness, g_live.displays_on ? "on" : "off", g_live.ping_target);
+}
+
+void config_update() {
+    unsigned long now = millis();
+    if (now - g_last_poll_ms < CONFIG_POLL_MS) return;
+    g_last_poll_ms = now;
+
+    static PanelConfig snap;  // too big for the loop task's stack
+    capture(snap);
+    if (memcmp(&snap, &g_live, sizeof(snap)) != 0) {
+        g_live = snap;
+        if (!g_stats.pending) {
+            g_stats.pending = true;
+            g_first_change_ms = now;
+        }
+        g_last_change_ms = now;
+    }
+
+    if (!g_stats.pending) return;
+
+    bool quiet = now - g_last_change_ms >= CONFIG_SAVE_DELAY_MS;
+    bool overdue = now - g_first_change_ms >= CONFIG_SAVE_MAX_DELAY_MS;
+    if (!quiet && !overdue) return;
+
+    g_stats.pending = false;
+    if (memcmp(&g_live, &g_saved, sizeof(g_live)) != 0) {
+        save();  // skipped when the value was changed back
+    }
+}
+
+// ---- JSON mapping ----
+
+// Limits of a state profile, by JSON key
+struct LimitField {
+    const char* key;
+    size_t offset;
+    bool wide;                  // uint16_t, otherwise uint8_t
+    long max;
+};
+static const LimitField LIMIT_FIELDS[] = {
+    { "latency_enter_ms", offsetof(StateProfile, latency_enter_ms), true, 65535 },
+    { "latency_exit_ms", offsetof(StateProfile, latency_exit_ms), true, 65535 },
+    { "loss_enter_pct", offsetof(StateProfile, loss_enter_pct), false, 100 },
+    { "loss_exit_pct", offsetof(StateProfile, loss_exit_pct), false, 100 },
+    { "down_enter_pct", offsetof(StateProfile, down_enter_pct), false, 100 },
+    { "down_exit_pct", offsetof(StateProfile, down_exit_pct), false, 100 },
+    { "dwell_worse_s", offsetof(StateProfile, dwell_worse_s), true, 3600 },
+    { "dwell_better_s", offsetof(StateProfile, dwell_better_s), true, 3600 },
+};
+
+void config_to_json(JsonObject obj) {
+    static PanelConfig cfg;  // too big for the loop task's stack
+    capture(cfg);
+    obj["brightness"] = cfg.brightness;
+    obj["display_power"] = cfg.displays_on;
+    obj["bw_source"] = bw_source_to_string((BandwidthSource)cfg.bw_source);
+    obj["packet_auto_cycle"] = cfg.packet_auto_cycle;
+    obj["bw_auto_cycle"] = cfg.bw_auto_cycle;
+    obj["ping_target"] = cfg.ping_target;
+    obj["mqtt_host"] = cfg.mqtt.host;
+    obj["mqtt_port"] = cfg.mqtt.port;
+    obj["mqtt_user"] = cfg.mqtt.user;
+    obj["mqtt_interval_s"] = cfg.mqtt.interval_s;
+    // mqtt_password is write-only
+    JsonArray urls = obj["webhook_urls"].to<JsonArray>();
+    for (int u = 0; u < WEBHOOK_MAX_URLS; u++) {
+        if (cfg.webhooks.urls[u][0] != '\0') urls.add(cfg.webhooks.urls[u]);
+    }
+    obj["log_level"] = log_level_to_string((LogLevel)cfg.log.level);
+    obj["log_serial"] = cfg.log.serial;
+    obj["syslog_host"] = cfg.log.syslog_host;
+    obj["syslog_port"] = cfg.log.syslog_port;
+    obj["snmp_host"] = cfg.snmp.host;
+    obj["snmp_community"] = cfg.snmp.community;
+    obj["snmp_interval_s"] = cfg.snmp.interval_s;
+    JsonArray ifindex = obj["snmp_ifindex"].to<JsonArray>();
+    JsonArray oids = obj["snmp_gateway_oids"].to<JsonArray>();
+    for (int w = 0; w < SNMP_MAX_WANS; w++) {
+        ifindex.add(cfg.snmp.ifindex[w]);
+        oids.add(cfg.snmp.gateway_oid[w]);
+    }
+    obj["peer_gossip"] = cfg.gossip.enabled;
+    JsonObject profiles = obj["state_profiles"].to<JsonObject>();
+    for (StateProfile& p : cfg.state.profiles) {  // non-const: names are copied
+        if (p.name[0] == '\0') continue;
+        JsonObject limits = profiles[p.name].to<JsonObject>();
+        for (const LimitField& f : LIMIT_FIELDS) {
+            const uint8_t* field = (const uint8_t*)&p + f.offset;
+            limits[f.key] = f.wide ? *(const uint16_t*)field : *field;
+        }
+    }
+    JsonObject assignments = obj["state_assignments"].to<JsonObject>();
+    for (int a = 0; a < STATE_MAX_ASSIGNMENTS; a++) {
+        if (cfg.state.assign_source[a][0] != '\0') {
+            assignments[cfg.state.assign_source[a]] = cfg.state.assign_profile[a];
+        }
+    }
+    obj["billing_cycle_day"] = cfg.billing.cycle_day;
+    JsonObject caps = obj["usage_caps_gb"].to<JsonObject>();
+    for (int i = 0; i < MAX_WANS; i++) {
+        if (cfg.usage.cap_wan[i][0] != '\0') caps[cfg.usage.cap_wan[i]] = cfg.usage.cap_gb[i];
+    }
+    obj["usage_on_display"] = cfg.usage.on_display;
+    obj["trusted_router_ip"] = cfg.admission.router_ip;
+}
+
+static bool read_int(JsonVariantConst v, long lo, long hi, long& out) {
+    if (!v.is<long>()) return false;
+    out = v.as<long>();
+    return out >= lo && out <= hi;
+}
+
+// Webhook URL list: up to WEBHOOK_MAX_URLS http(s) URLs
+static bool read_urls(JsonVariantConst v, WebhookSettings& out) {
+    if (!v.is<JsonArrayConst>()) return false;
+    JsonArrayConst arr = v.as<JsonArrayConst>();
+    if (arr.size() > (size_t)WEBHOOK_MAX_URLS) return false;
+
+    memset(&out, 0, sizeof(out));
+    int u = 0;
+    for (JsonVariantConst item : arr) {
+        const char* s = item.is<const char*>() ? item.as<const char*>() : "";
+        bool scheme = strncmp(s, "http://", 7) == 0 || strncmp(s, "https://", 8) == 0;
+        if (!scheme || strlen(s) >= WEBHOOK_URL_LEN || strchr(s, ' ') != nullptr) return false;
+        strlcpy(out.urls[u++], s, WEBHOOK_URL_LEN);
+    }
+    return true;
+}
+
+// One ifIndex per WAN (0 = not polled)
+static bool read_ifindex(JsonVariantConst v, uint16_t* out) {
+    if (!v.is<JsonArrayConst>() || v.size() != (size_t)SNMP_MAX_WANS) return false;
+    for (int w = 0; w < SNMP_MAX_WANS; w++) {
+        long n;
+        if (!read_int(v[w], 0, 65535, n)) return false;
+        out[w] = (uint16_t)n;
+    }
+    return true;
+}
+
+// One dotted OID per WAN ("" = none)
+static bool read_oids(JsonVariantConst v, char out[][SNMP_OID_TEXT_LEN]) {
+    if (!v.is<JsonArrayConst>() || v.size() != (size_t)SNMP_MAX_WANS) return false;
+    for (int w = 0; w < SNMP_MAX_WANS; w++) {
+        const char* s = v[w].is<const char*>() ? v[w].as<const char*>() : nullptr;
+        if (s == nullptr || strlen(s) >= SNMP_OID_TEXT_LEN) return false;
+        if (s[0] != '\0' && !snmp_oid_is_valid(s)) return false;
+        strlcpy(out[w], s, SNMP_OID_TEXT_LEN);
+    }
+    return true;
+}
+
+// Profile table: {"<name>": {<limits>}, ...}, replacing every profile.
+// "default" is required; limits left out take the built-in defaults.
+static bool read_profiles(JsonVariantConst v, StateSettings& out) {
+    if (!v.is<JsonObjectConst>() || v.size() > (size_t)STATE_MAX_PROFILES) return false;
+
+    StateSettings s = out;
+    memset(s.profiles, 0, sizeof(s.profiles));
+    int next = 1;
+    for (JsonPairConst kv : v.as<JsonObjectConst>()) {
+        const char* name = kv.key().c_str();
+        if (!kv.value().is<JsonObjectConst>() || strlen(name) >= STATE_PROFILE_NAME_LEN) return false;
+        bool is_default = strcmp(name, STATE_DEFAULT_PROFILE) == 0;
+        if (!is_default && next >= STATE_MAX_PROFILES) return false;
+
+        StateProfile& p = s.profiles[is_default ? 0 : next++];
+        p = STATE_DEFAULT_LIMITS;
+        memset(p.name, 0, sizeof(p.name));
+        strlcpy(p.name, name, sizeof(p.name));
+        for (JsonPairConst limit : kv.value().as<JsonObjectConst>()) {
+            const LimitField* f = nullptr;
+            for (const LimitField& candidate : LIMIT_FIELDS) {
+                if (strcmp(candidate.key, limit.key().c_str()) == 0) f = &candidate;
+            }
+            long n;
+            if (f == nullptr || !read_int(limit.value(), 0, f->max, n)) return false;
+            uint8_t* field = (uint8_t*)&p + f->offset;
+            if (f->wide) *(uint16_t*)field = (uint16_t)n;
+            else *field = (uint8_t)n;
+        }
+    }
+
+    // Check the profiles on their own; assignments are checked on the merged result
+    memset(s.assign_source, 0, sizeof(s.assign_source));
+    if (!state_settings_valid(s)) return false;
+    memcpy(out.profiles, s.profiles, sizeof(out.profiles));
+    return true;
+}
+
+// Profile assignments: {"<source>": "<profile>", ...}, replacing every
+// assignment. Sources are "local" or WAN names.
+static bool read_assignments(JsonVariantConst v, StateSettings& out) {
+    if (!v.is<JsonObjectConst>() || v.size() > (size_t)STATE_MAX_ASSIGNMENTS) return false;
+
+    memset(out.assign_source, 0, sizeof(out.assign_source));
+    memset(out.assign_profile, 0, sizeof(out.assign_profile));
+    int a = 0;
+    for (JsonPairConst kv : v.as<JsonObjectConst>()) {
+        const char* source = kv.key().c_str();
+        const char* profile = kv.value().is<const char*>() ? kv.value().as<const char*>() : "";
+        if (strlen(source) >= WAN_NAME_LEN || strlen(profile) >= STATE_PROFILE_NAME_LEN) return false;
+        strlcpy(out.assign_source[a], source, WAN_NAME_LEN);
+        strlcpy(out.assign_profile[a], profile, STATE_PROFILE_NAME_LEN);
+        a++;
+    }
+    return true;
+}
+
+// Copy a string field into a fixed buffer (empty allowed, no spaces)
+static bool read_str(JsonVariantConst v, char* out, size_t size) {
+    if (!v.is<const char*>()) return false;
+    const char* s = v.as<const char*>();
+    size_t len = strlen(s);
+    if (len >= size || strchr(s, ' ') != nullptr) return false;
+    memset(out, 0, size);
+    memcpy(out, s, len);
+    return true;
+}
+
+// Data caps by WAN name: replaces the whole table
+static bool read_caps(JsonVariantConst v, UsageSettings& out) {
+    if (!v.is<JsonObjectConst>()) return false;
+    JsonObjectConst obj = v.as<JsonObjectConst>();
+    if (obj.size() > (size_t)MAX_WANS) return false;
+
+    memset(out.cap_wan, 0, sizeof(out.cap_wan));
+    memset(out.cap_gb, 0, sizeof(out.cap_gb));
+    int i = 0;
+    for (JsonPairConst kv : obj) {
+        long gb;
+        if (!wan_name_is_valid(kv.key().c_str())) return false;
+        if (!read_int(kv.value(), 1, USAGE_MAX_CAP_GB, gb)) return false;
+        strlcpy(out.cap_wan[i], kv.key().c_str(), WAN_NAME_LEN);
+        out.cap_gb[i++] = (uint32_t)gb;
+    }
+    return usage_settings_valid(out);
+}
+
+bool config_patch(JsonObjectConst obj, String& error) {
+    static PanelConfig cfg;  // too big for the loop task's stack
+    capture(cfg);
+    bool reset_udp_time = false;   // action, not a stored setting
+
+    for (JsonPairConst kv : obj) {
+        const char* key = kv.key().c_str();
+        JsonVariantConst v = kv.value();
+        long n;
+
+        if (strcmp(key, "brightness") == 0) {
+            if (!read_int(v, 0, 15, n)) { error = key; return false; }
+            cfg.brightness = (uint8_t)n;
+        } else if (strcmp(key, "display_power") == 0) {
+            if (!v.is<bool>()) { error = key; return false; }
+            cfg.displays_on = v.as<bool>();
+        } else if (strcmp(key, "bw_source") == 0) {
+            const char* s = v.is<const char*>() ? v.as<const char*>() : "";
+            BandwidthSource src = bw_source_from_string(s);
+            if (strcmp(bw_source_to_string(src), s) != 0) { error = key; return false; }
+            cfg.bw_source = (uint8_t)src;
+        } else if (strcmp(key, "packet_auto_cycle") == 0) {
+            if (!v.is<bool>()) { error = key; return false; }
+            cfg.packet_auto_cycle = v.as<bool>();
+        } else if (strcmp(key, "bw_auto_cycle") == 0) {
+            if (!v.is<bool>()) { error = key; return false; }
+            cfg.bw_auto_cycle = v.as<bool>();
+        } else if (strcmp(key, "ping_target") == 0) {
+            const char* s = v.is<const char*>() ? v.as<const char*>() : "";
+            size_t len = strlen(s);
+            if (len == 0 || len >= sizeof(cfg.ping_target) || strchr(s, ' ') != nullptr) {
+                error = key;
+                return false;
+            }
+            memset(cfg.ping_target, 0, sizeof(cfg.ping_target));
+            memcpy(cfg.ping_target, s, len);
+        } else if (strcmp(key, "mqtt_host") == 0) {
+            if (!read_str(v, cfg.mqtt.host, sizeof(cfg.mqtt.host))) { error = key; return false; }
+        } else if (strcmp(key, "mqtt_port") == 0) {
+            if (!read_int(v, 1, 65535, n)) { error = key; return false; }
+            cfg.mqtt.port = (uint16_t)n;
+        } else if (strcmp(key, "mqtt_user") == 0) {
+            if (!read_str(v, cfg.mqtt.user, sizeof(cfg.mqtt.user))) { error = key; return false; }
+        } else if (strcmp(key, "mqtt_password") == 0) {
+            if (!read_str(v, cfg.mqtt.password, sizeof(cfg.mqtt.password))) { error = key; return false; }
+        } else if (strcmp(key, "mqtt_interval_s") == 0) {
+            if (!read_int(v, 1, 3600, n)) { error = key; return false; }
+            cfg.mqtt.interval_s = (uint16_t)n;
+        } else if (strcmp(key, "webhook_urls") == 0) {
+            if (!read_urls(v, cfg.webhooks)) { error = key; return false; }
+        } else if (strcmp(key, "log_level") == 0) {
+            LogLevel level;
+            const char* s = v.is<const char*>() ? v.as<const char*>() : "";
+            if (!log_level_from_string(s, level)) { error = key; return false; }
+            cfg.log.level = (uint8_t)level;
+        } else if (strcmp(key, "log_serial") == 0) {
+            if (!v.is<bool>()) { error = key; return false; }
+            cfg.log.serial = v.as<bool>();
+        } else if (strcmp(key, "syslog_host") == 0) {
+            if (!read_str(v, cfg.log.syslog_host, sizeof(cfg.log.syslog_host))) { error = key; return false; }
+        } else if (strcmp(key, "syslog_port") == 0) {
+            if (!read_int(v, 1, 65535, n)) { error = key; return false; }
+            cfg.log.syslog_port = (uint16_t)n;
+        } else if (strcmp(key, "snmp_host") == 0) {
+            if (!read_str(v, cfg.snmp.host, sizeof(cfg.snmp.host))) { error = key; return false; }
+        } else if (strcmp(key, "snmp_community") == 0) {
+            if (!read_str(v, cfg.snmp.community, sizeof(cfg.snmp.community))) { error = key; return false; }
+        } else if (strcmp(key, "snmp_interval_s") == 0) {
+            if (!read_int(v, 1, 3600, n)) { error = key; return false; }
+            cfg.snmp.interval_s = (uint16_t)n;
+        } else if (strcmp(key, "snmp_ifindex") == 0) {
+            if (!read_ifindex(v, cfg.snmp.ifindex)) { error = key; return false; }
+        } else if (strcmp(key, "snmp_gateway_oids") == 0) {
+            if (!read_oids(v, cfg.snmp.gateway_oid)) { error = key; return false; }
+        } else if (strcmp(key, "peer_gossip") == 0) {
+            if (!v.is<bool>()) { error = key; return false; }
+            cfg.gossip.enabled = v.as<bool>();
+        } else if (strcmp(key, "state_profiles") == 0) {
+            if (!read_profiles(v, cfg.state)) { error = key; return false; }
+        } else if (strcmp(key, "state_assignments") == 0) {
+            if (!read_assignments(v, cfg.state)) { error = key; return false; }
+        } else if (strcmp(key, "billing_cycle_day") == 0) {
+            if (!read_int(v, 1, BILLING_MAX_CYCLE_DAY, n)) { error = key; return false; }
+            cfg.billing.cycle_day = (uint8_t)n;
+        } else if (strcmp(key, "usage_caps_gb") == 0) {
+            if (!read_caps(v, cfg.usage)) { error = key; return false; }
+        } else if (strcmp(key, "usage_on_display") == 0) {
+            if (!v.is<bool>()) { error = key; return false; }
+            cfg.usage.on_display = v.as<bool>();
+        } else if (strcmp(key, "trusted_router_ip") == 0) {
+            AdmissionSettings a;
+            if (!read_str(v, a.router_ip, sizeof(a.router_ip)) || !admission_settings_valid(a)) {
+                error = key;
+                return false;
+            }
+            cfg.admission = a;
+        } else if (strcmp(key, "udp_reset_time") == 0) {
+            if (!v.is<bool>()) { error = key; return false; }
+            reset_udp_time = v.as<bool>();
+        } else {
+            error = String("unknown field ") + key;
+            return false;
+        }
+    }
+
+    // Cross-field checks on the merged result
+    // (profiles are valid on their own; an assignment may name a profile
+    // that is not in the table, or a source twice)
+    if (!state_settings_valid(cfg.state)) {
+        error = "state_assignments";
+        return false;
+    }
+
+    apply(cfg);
+    if (reset_udp_time) udp_ingest_reset_time();
+    return true;
+}
+
+const ConfigStoreStats& config_get_stats() {
+    return g_stats;
+}
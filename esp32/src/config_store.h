@@ -0,0 +1,81 @@
+// config_store.h
+// Persistent panel settings (NVS) and the /api/config field mapping
+//
+// Settings are stored as one blob, so a save is atomic. The blob has no
+// version field: fields are only appended, and its length says which
+// firmware wrote it (a shorter blob loads over the defaults). The live
+// values are polled from their owning modules, which means changes from any
+// source (API, buttons, pot, power switch) are picked up. Saves are
+// debounced and skipped when nothing differs from what is stored, so
+// turning the brightness dial produces a single flash write.
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "local_pinger.h"
+#include "mqtt_publisher.h"
+#include "webhook_alerts.h"
+#include "logger.h"
+#include "snmp_poller.h"
+#include "peer_gossip.h"
+#include "state_policy.h"
+#include "billing_cycle.h"
+#include "data_usage.h"
+#include "admission.h"
+
+static const char* CONFIG_NVS_NAMESPACE = "wanwatcher";
+static const unsigned long CONFIG_POLL_MS = 250;            // live value sampling
+static const unsigned long CONFIG_SAVE_DELAY_MS = 5000;     // quiet time before a save
+static const unsigned long CONFIG_SAVE_MAX_DELAY_MS = 30000; // upper bound while values keep changing
+
+// Local pinger thresholds of older firmware, superseded by StateSettings.
+// Kept for the blob layout; migrated into the default profile at load.
+struct LegacyPingThresholds {
+    uint16_t latency_degraded_ms;
+    uint8_t loss_degraded_pct;
+    uint8_t loss_down_pct;
+};
+
+// Persisted settings. Append new fields at the end only: a shorter blob from
+// older firmware loads over the defaults.
+struct PanelConfig {
+    uint8_t brightness;         // 0-15
+    bool displays_on;
+    uint8_t bw_source;          // BandwidthSource
+    bool packet_auto_cycle;
+    bool bw_auto_cycle;
+    char ping_target[64];
+    LegacyPingThresholds legacy_ping;  // zero since StateSettings
+    MqttSettings mqtt;
+    WebhookSettings webhooks;
+    LogSettings log;
+    SnmpSettings snmp;
+    GossipSettings gossip;
+    StateSettings state;
+    BillingSettings billing;
+    UsageSettings usage;
+    AdmissionSettings admission;
+};
+
+struct ConfigStoreStats {
+    bool loaded;                // settings were restored from NVS at boot
+    bool pending;               // a change is waiting for the debounce window
+    uint32_t saves;             // NVS writes since boot
+    unsigned long last_save_ms; // millis() of the last write (0 = none)
+};
+
+// Load settings from NVS and apply them (call in setup() after the displays,
+// power switch and pot are initialized, before the first render)
+void config_init();
+
+// Track changes and save when the debounce window has passed (call from loop())
+void config_update();
+
+// Write the current settings as a flat JSON object
+void config_to_json(JsonObject obj);
+
+// Apply a partial update atomically: every field is validated first and
+// nothing changes if any field is invalid. On failure, error names the field.
+bool config_patch(JsonObjectConst obj, String& error);
+
+const ConfigStoreStats& config_get_stats();
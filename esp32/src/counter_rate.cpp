@@ -0,0 +1,59 @@
+// counter_rate.cpp
+#include "counter_rate.h"
+#include <math.h>
+
+void counter_rate_reset(CounterRate& r) {
+    memset(&r, 0, sizeof(r));
+}
+
+bool counter_rate_update(CounterRate& r, uint64_t value, uint32_t now_ms, uint8_t bits) {
+    if (!r.primed) {
+        r.last = value;
+        r.last_ms = now_ms;
+        r.primed = true;
+        return false;
+    }
+
+    uint32_t dt_ms = now_ms - r.last_ms;
+    if (dt_ms == 0) return false;
+    if ((int32_t)dt_ms < 0) {
+        // Sample clock went backwards (collector restarted): re-prime
+        r.last = value;
+        r.last_ms = now_ms;
+        r.resets++;
+        return false;
+    }
+    float dt = dt_ms / 1000.0f;
+
+    uint64_t delta = 0;
+    bool reset = false;
+    if (value >= r.last) {
+        delta = value - r.last;
+    } else if (bits < 64) {
+        delta = value + (1ULL << bits) - r.last;
+        reset = delta * 8.0f / dt / 1e6f > COUNTER_RATE_MAX_MBPS;  // implausible wrap
+        if (!reset) r.wraps++;
+    } else {
+        reset = true;
+    }
+
+    r.last = value;
+    r.last_ms = now_ms;
+    if (reset) {
+        r.resets++;
+        return false;  // keep the averages, re-prime the baseline
+    }
+
+    r.delta = delta;
+    r.mbps = delta * 8.0f / dt / 1e6f;
+    for (int w = 0; w < COUNTER_RATE_WINDOWS; w++) {
+        if (!r.has_rate) {
+            r.avg_mbps[w] = r.mbps;  // seed with the first rate
+        } else {
+            float alpha = 1.0f - expf(-dt / COUNTER_RATE_WINDOW_S[w]);
+            r.avg_mbps[w] += alpha * (r.mbps - r.avg_mbps[w]);
+        }
+    }
+    r.has_rate = true;
+    return true;
+}
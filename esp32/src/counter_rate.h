@@ -0,0 +1,36 @@
+// counter_rate.h
+// Bandwidth rates and EWMA averages from interface byte counters
+//
+// Same math as the pfSense daemon: rate = delta bytes * 8 / dt, and each
+// average uses alpha = 1 - e^(-dt/window) so uneven sample spacing is
+// weighted correctly. A counter that goes backwards is treated as a wrap
+// when the counter is narrower than 64 bits and the wrapped delta gives a
+// plausible rate; otherwise it is a reset (agent restart, interface
+// re-created) and the sample only re-primes the baseline. So does a sample
+// time that goes backwards (the clock of a restarted collector).
+#pragma once
+
+#include <Arduino.h>
+
+static const int COUNTER_RATE_WINDOWS = 3;
+static const float COUNTER_RATE_WINDOW_S[COUNTER_RATE_WINDOWS] = { 60.0f, 300.0f, 900.0f };
+static const float COUNTER_RATE_MAX_MBPS = 100000.0f;  // above this a delta is a reset
+
+struct CounterRate {
+    uint64_t last;              // previous counter value (bytes)
+    uint32_t last_ms;           // when it was taken
+    bool primed;                // last/last_ms are valid
+    bool has_rate;              // mbps/avg_mbps are valid
+    float mbps;                 // rate over the last interval
+    uint64_t delta;             // bytes over the last interval
+    float avg_mbps[COUNTER_RATE_WINDOWS];  // 1m / 5m / 15m EWMA
+    uint32_t resets;            // counter resets seen
+    uint32_t wraps;             // counter wraps seen
+};
+
+// Clear all state (the next sample only primes the baseline)
+void counter_rate_reset(CounterRate& r);
+
+// Feed a counter sample taken at now_ms (any millisecond clock). bits is
+// the counter width (32 or 64). Returns true when a new rate was computed.
+bool counter_rate_update(CounterRate& r, uint64_t value, uint32_t now_ms, uint8_t bits = 64);
@@ -0,0 +1,301 @@
+// data_usage.cpp
+#include "data_usage.h"
+#include <Preferences.h>
+#include "billing_cycle.h"
+#include "metrics_history.h"
+#include "logger.h"
+
+static const char* BLOB_KEY = "cycle";
+static const unsigned long UPDATE_MS = 1000;
+
+// Saved form of the totals (the blob is ignored if its size differs)
+struct UsageBlob {
+    uint32_t cycle_start;
+    char name[MAX_WANS][WAN_NAME_LEN];
+    uint64_t rx_bytes[MAX_WANS];
+    uint64_t tx_bytes[MAX_WANS];
+};
+
+static UsageSettings g_settings;
+static WanUsage g_slots[MAX_WANS];
+static int8_t g_slot_of[MAX_WANS + 1];  // wan_id -> slot + 1 (0 = not looked up yet)
+static UsageStats g_stats;
+
+static Preferences g_prefs;
+static bool g_nvs_ok = false;
+static UsageBlob g_saved;               // loaded at boot, merged once the cycle is known
+static bool g_have_saved = false;
+
+static uint32_t g_cycle_start = 0;      // 0 = wall clock not set yet
+static bool g_dirty = false;
+static unsigned long g_last_save_ms = 0;
+static unsigned long g_last_update_ms = 0;
+
+// ---- Slots ----
+
+static WanUsage* slot_for_name(const char* name) {
+    for (WanUsage& u : g_slots) {
+        if (u.name[0] != '\0' && strcmp(u.name, name) == 0) return &u;
+    }
+    for (WanUsage& u : g_slots) {
+        if (u.name[0] == '\0') {
+            strlcpy(u.name, name, WAN_NAME_LEN);
+            return &u;
+        }
+    }
+    return nullptr;  // all taken by WANs saved in an earlier boot
+}
+
+static WanUsage* slot_for(int wan_id) {
+    if (wan_id < 1 || wan_id > wan_metrics_count()) return nullptr;
+    if (g_slot_of[wan_id] == 0) {
+        WanUsage* u = slot_for_name(wan_metrics_key(wan_id));
+        if (u == nullptr) return nullptr;
+        g_slot_of[wan_id] = (int8_t)(u - g_slots) + 1;
+    }
+    return &g_slots[g_slot_of[wan_id] - 1];
+}
+
+// Hourly buckets on the history clock, for the recent rate
+static void add_recent(WanUsage& u, uint64_t bytes) {
+    uint32_t now_s = history_now_s();
+    uint32_t hour = now_s / 3600;
+    if (u.since_s == 0) {
+        u.since_s = max(now_s, (uint32_t)1);
+        u.hour = hour;
+    }
+    if (hour != u.hour) {
+        if (hour - u.hour >= (uint32_t)USAGE_RECENT_HOURS) {
+            memset(u.hour_bytes, 0, sizeof(u.hour_bytes));
+        } else {
+            for (uint32_t h = u.hour + 1; h <= hour; h++) u.hour_bytes[h % USAGE_RECENT_HOURS] = 0;
+        }
+        u.hour = hour;
+    }
+    u.hour_bytes[hour % USAGE_RECENT_HOURS] += bytes;
+}
+
+static void add(WanUsage& u, uint64_t rx, uint64_t tx) {
+    if (rx == 0 && tx == 0) return;
+    u.rx_bytes += rx;
+    u.tx_bytes += tx;
+    add_recent(u, rx + tx);
+    g_dirty = true;
+}
+
+void data_usage_add_bytes(int wan_id, uint64_t rx_bytes, uint64_t tx_bytes) {
+    WanUsage* u = slot_for(wan_id);
+    if (u == nullptr) return;
+    u->from_counters = true;
+    u->last_counter_ms = max(millis(), 1UL);
+    add(*u, rx_bytes, tx_bytes);
+}
+
+void data_usage_add_rates(int wan_id, float down_mbps, float up_mbps) {
+    WanUsage* u = slot_for(wan_id);
+    if (u == nullptr) return;
+
+    unsigned long now = millis();
+    unsigned long last = u->last_rate_ms;
+    u->last_rate_ms = max(now, 1UL);
+    if (u->last_counter_ms != 0 && now - u->last_counter_ms < USAGE_MAX_GAP_MS) return;  // counted exactly
+    if (last == 0) return;
+
+    // Mbit/s * ms -> bytes: * 10^6 / 8 / 1000
+    unsigned long dt_ms = min(now - last, USAGE_MAX_GAP_MS);
+    u->from_counters = false;
+    add(*u, (uint64_t)(max(down_mbps, 0.0f) * 125.0f * dt_ms),
+        (uint64_t)(max(up_mbps, 0.0f) * 125.0f * dt_ms));
+}
+
+// ---- Persistence ----
+
+static void save() {
+    if (!g_nvs_ok || g_cycle_start == 0) return;
+
+    UsageBlob blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.cycle_start = g_cycle_start;
+    for (int i = 0; i < MAX_WANS; i++) {
+        memcpy(blob.name[i], g_slots[i].name, WAN_NAME_LEN);
+        blob.rx_bytes[i] = g_slots[i].rx_bytes;
+        blob.tx_bytes[i] = g_slots[i].tx_bytes;
+    }
+    g_last_save_ms = millis();
+    if (g_prefs.putBytes(BLOB_KEY, &blob, sizeof(blob)) != sizeof(blob)) {
+        g_stats.save_errors++;
+        LOG_WARN("Usage: NVS write failed");
+        return;
+    }
+    g_dirty = false;
+    g_stats.saves++;
+}
+
+// Add the totals saved by an earlier boot, if they are for this cycle
+static void merge_saved(uint32_t cycle_start) {
+    if (!g_have_saved) return;
+    g_have_saved = false;
+
+    if (g_saved.cycle_start != cycle_start) {
+        LOG_INFO("Usage: saved totals are from an earlier billing cycle, dropped");
+        return;
+    }
+    for (int i = 0; i < MAX_WANS; i++) {
+        g_saved.name[i][WAN_NAME_LEN - 1] = '\0';
+        if (g_saved.name[i][0] == '\0') continue;
+        WanUsage* u = slot_for_name(g_saved.name[i]);
+        if (u == nullptr) continue;
+        u->rx_bytes += g_saved.rx_bytes[i];
+        u->tx_bytes += g_saved.tx_bytes[i];
+    }
+    g_stats.restored = true;
+    LOG_INFO("Usage: restored totals of the current billing cycle");
+}
+
+void data_usage_init() {
+    g_nvs_ok = g_prefs.begin(USAGE_NVS_NAMESPACE, false);
+    if (!g_nvs_ok) {
+        LOG_WARN("Usage: NVS unavailable, totals will not persist");
+        return;
+    }
+    if (g_prefs.getBytesLength(BLOB_KEY) != sizeof(g_saved)) return;
+    g_have_saved = g_prefs.getBytes(BLOB_KEY, &g_saved, sizeof(g_saved)) == sizeof(g_saved);
+}
+
+void data_usage_forget(int wan_id) {
+    const char* name = wan_metrics_key(wan_id);
+    for (WanUsage& u : g_slots) {
+        if (strcmp(u.name, name) == 0) memset(&u, 0, sizeof(u));
+    }
+    for (int i = 0; i < MAX_WANS; i++) {
+        if (strcmp(g_saved.name[i], name) == 0) g_saved.name[i][0] = '\0';
+    }
+    memset(g_slot_of, 0, sizeof(g_slot_of));  // later ids move down
+
+    // Before the clock is known the blob from the earlier boot is still the
+    // saved copy: rewrite it without the WAN
+    if (g_cycle_start != 0) {
+        save();
+    } else if (g_have_saved && g_nvs_ok) {
+        g_prefs.putBytes(BLOB_KEY, &g_saved, sizeof(g_saved));
+    }
+}
+
+void data_usage_update() {
+    unsigned long now = millis();
+    if (now - g_last_update_ms < UPDATE_MS) return;
+    g_last_update_ms = now;
+
+    uint32_t now_unix;
+    if (!billing_clock_now(now_unix)) return;
+    uint32_t start = billing_cycle_start(now_unix);
+
+    if (g_cycle_start == 0) {
+        // First wall clock since boot: bytes counted so far belong to this cycle
+        g_cycle_start = start;
+        merge_saved(start);
+    } else if (start != g_cycle_start) {
+        LOG_INFO("Usage: new billing cycle, totals start over");
+        for (WanUsage& u : g_slots) {
+            u.rx_bytes = 0;
+            u.tx_bytes = 0;
+        }
+        g_cycle_start = start;
+        g_stats.cycle_resets++;
+        save();
+        return;
+    }
+
+    if (g_dirty && now - g_last_save_ms >= USAGE_SAVE_MS) save();
+}
+
+// ---- Readers ----
+
+const WanUsage* data_usage_find(const char* name) {
+    for (const WanUsage& u : g_slots) {
+        if (u.name[0] != '\0' && strcmp(u.name, name) == 0) return &u;
+    }
+    return nullptr;
+}
+
+const WanUsage* data_usage_slots() {
+    return g_slots;
+}
+
+bool data_usage_projection(const WanUsage& u, uint64_t& out) {
+    uint32_t now_unix;
+    if (g_cycle_start == 0 || !billing_clock_now(now_unix)) return false;
+    uint64_t used = u.rx_bytes + u.tx_bytes;
+
+    // Recent rate: the buckets of the last 24 hours, over the time they cover
+    double rate = 0.0;
+    uint32_t now_s = history_now_s();
+    uint32_t hour = now_s / 3600;
+    uint32_t oldest = (hour >= (uint32_t)USAGE_RECENT_HOURS - 1) ? hour - (USAGE_RECENT_HOURS - 1) : 0;
+    uint32_t span = 0;
+    if (u.since_s != 0) span = now_s - max(u.since_s, oldest * 3600);
+    if (span >= USAGE_MIN_RECENT_S) {
+        uint64_t recent = 0;
+        for (int i = 0; i < USAGE_RECENT_HOURS; i++) {
+            uint32_t h = u.hour - i;
+            if (h >= oldest && h <= hour) recent += u.hour_bytes[h % USAGE_RECENT_HOURS];
+            if (h == 0) break;
+        }
+        rate = (double)recent / span;
+    } else if (now_unix > g_cycle_start) {
+        rate = (double)used / (now_unix - g_cycle_start);
+    }
+
+    uint32_t end = billing_cycle_end(now_unix);
+    out = used + (uint64_t)(rate * (end - now_unix));
+    return true;
+}
+
+uint64_t data_usage_cap_bytes(const char* name) {
+    for (int i = 0; i < MAX_WANS; i++) {
+        if (g_settings.cap_wan[i][0] != '\0' && strcmp(g_settings.cap_wan[i], name) == 0) {
+            return (uint64_t)g_settings.cap_gb[i] * 1000000000ULL;
+        }
+    }
+    return 0;
+}
+
+bool data_usage_cap_pct(const char* name, float& pct) {
+    uint64_t cap = data_usage_cap_bytes(name);
+    if (cap == 0) return false;
+    const WanUsage* u = data_usage_find(name);
+    pct = (u == nullptr) ? 0.0f : (float)((double)(u->rx_bytes + u->tx_bytes) * 100.0 / cap);
+    return true;
+}
+
+// ---- Settings ----
+
+bool usage_settings_valid(const UsageSettings& s) {
+    for (int i = 0; i < MAX_WANS; i++) {
+        const char* name = s.cap_wan[i];
+        if (name[0] == '\0') continue;
+        if (!wan_name_is_valid(name)) return false;
+        if (s.cap_gb[i] < 1 || s.cap_gb[i] > USAGE_MAX_CAP_GB) return false;
+        for (int j = 0; j < i; j++) {
+            if (strcmp(s.cap_wan[j], name) == 0) return false;
+        }
+    }
+    return true;
+}
+
+void data_usage_set_settings(const UsageSettings& settings) {
+    if (!usage_settings_valid(settings)) {
+        LOG_WARN("Usage: invalid settings ignored");
+        return;
+    }
+    g_settings = settings;
+    LOG_INFO("Usage: settings updated");
+}
+
+const UsageSettings& data_usage_get_settings() {
+    return g_settings;
+}
+
+const UsageStats& data_usage_get_stats() {
+    return g_stats;
+}
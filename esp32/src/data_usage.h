@@ -0,0 +1,92 @@
+// data_usage.h
+// Per-WAN data usage over the billing cycle, with a data cap projection
+//
+// Each WAN's received and sent bytes are summed over the billing cycle
+// (see billing_cycle.h). When the collector or the SNMP poller reports raw
+// byte counters, their deltas are added exactly (data_usage_add_bytes());
+// otherwise every committed report adds its instant rate times the time
+// since the WAN's previous report, capped at USAGE_MAX_GAP_MS so a WAN
+// that stopped reporting is not extrapolated.
+//
+// Totals are keyed by WAN name and saved to NVS every USAGE_SAVE_MS and at
+// a cycle change, so a reboot loses at most that much. At boot the saved
+// totals are restored once the wall clock shows they belong to the current
+// cycle; a saved cycle that has ended is dropped.
+//
+// The end-of-cycle projection extends the recent rate (the last 24 hours,
+// from hourly buckets) over the rest of the cycle; until an hour of data
+// has been seen since boot it uses the average since the cycle started.
+#pragma once
+
+#include <Arduino.h>
+#include "wan_metrics.h"
+
+static const char* USAGE_NVS_NAMESPACE = "wanusage";
+static const unsigned long USAGE_SAVE_MS = 15 * 60 * 1000;
+static const unsigned long USAGE_MAX_GAP_MS = 120000;   // longest interval a rate is integrated over
+static const int USAGE_RECENT_HOURS = 24;
+static const uint32_t USAGE_MIN_RECENT_S = 3600;        // recent rate needs this much data
+static const uint32_t USAGE_MAX_CAP_GB = 1000000;
+
+// Persisted as part of PanelConfig. Caps are keyed by WAN name.
+struct UsageSettings {
+    char cap_wan[MAX_WANS][WAN_NAME_LEN];   // "" = unused
+    uint32_t cap_gb[MAX_WANS];              // decimal GB (10^9 bytes)
+    bool on_display;            // add percent of cap ('C') to the bandwidth display cycle
+};
+
+struct WanUsage {
+    char name[WAN_NAME_LEN];    // "" = unused slot
+    uint64_t rx_bytes;          // this cycle
+    uint64_t tx_bytes;
+    bool from_counters;         // the latest bytes came from byte counters
+    // Not persisted: recent rate and integration state
+    uint64_t hour_bytes[USAGE_RECENT_HOURS];
+    uint32_t hour;              // history clock hour of the newest bucket
+    uint32_t since_s;           // history clock of the first bytes since boot (0 = none yet)
+    unsigned long last_rate_ms;
+    unsigned long last_counter_ms;
+};
+
+struct UsageStats {
+    bool restored;              // saved totals of the current cycle were restored
+    uint32_t saves;             // NVS writes since boot
+    uint32_t save_errors;
+    uint32_t cycle_resets;      // cycle changes since boot
+};
+
+// Load the saved totals (call in setup() after config_init())
+void data_usage_init();
+
+// Counter bytes since the previous sample (wan_id: 1..count)
+void data_usage_add_bytes(int wan_id, uint64_t rx_bytes, uint64_t tx_bytes);
+
+// Instant rates of a committed report (ignored while counters are fed)
+void data_usage_add_rates(int wan_id, float down_mbps, float up_mbps);
+
+// Drop a forgotten WAN's totals, also from the saved state
+void data_usage_forget(int wan_id);
+
+// Restore once the clock is known, handle cycle changes, save (call from loop())
+void data_usage_update();
+
+// Usage of a WAN (nullptr before its first bytes this cycle)
+const WanUsage* data_usage_find(const char* name);
+
+// Every usage slot, in the order WANs were first seen (saved ones first)
+const WanUsage* data_usage_slots();
+
+// Projected bytes (rx + tx) at the end of the cycle; false without a wall clock
+bool data_usage_projection(const WanUsage& u, uint64_t& out);
+
+// Cap of a WAN in bytes (0 = none)
+uint64_t data_usage_cap_bytes(const char* name);
+
+// Percent of its cap a WAN has used this cycle; false when it has no cap
+bool data_usage_cap_pct(const char* name, float& pct);
+
+bool usage_settings_valid(const UsageSettings& settings);
+void data_usage_set_settings(const UsageSettings& settings);
+const UsageSettings& data_usage_get_settings();
+
+const UsageStats& data_usage_get_stats();
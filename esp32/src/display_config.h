@@ -14,7 +14,8 @@ enum class PacketMetric : uint8_t {
 // Bandwidth metrics (displayed on bandwidth display)
 enum class BandwidthMetric : uint8_t {
     DOWNLOAD = 0,  // d
-    UPLOAD   = 1   // U
+    UPLOAD   = 1,  // U
+    CAP      = 2   // C (percent of the data cap, when enabled)
 };
 
 // Display type
@@ -32,10 +33,14 @@ enum class ButtonPinSource {
 
 // Number of metrics per display type
 static const uint8_t PACKET_METRIC_COUNT = 3;
-static const uint8_t BANDWIDTH_METRIC_COUNT = 2;
+static const uint8_t BANDWIDTH_METRIC_COUNT = 2;   // CAP is added when usage_on_display is set
+
+// WAN table positions with 7-segment displays (the HT16K33 address range
+// holds 2 per WAN for two WANs, plus the local pair and the freshness bar)
+static const int DISPLAY_WAN_COUNT = 2;
 
 // Maximum displays supported (2 WANs x 2 displays each + 2 local: packet + bandwidth)
-static const uint8_t MAX_DISPLAYS = 6;
+static const uint8_t MAX_DISPLAYS = DISPLAY_WAN_COUNT * 2 + 2;
 
 // Local pinger display I2C addresses
 static const uint8_t LOCAL_PINGER_DISPLAY_ADDR = 0x75;  // Local packet (L/J/P)
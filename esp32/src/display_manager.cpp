@@ -2,6 +2,8 @@
 #include "display_manager.h"
 #include "wan_metrics.h"
 #include "local_pinger.h"
+#include "data_usage.h"
+#include "logger.h"
 
 DisplayManager::DisplayManager()
     : _active_count(0)
@@ -29,7 +31,7 @@ void DisplayManager::begin(const DisplaySystemConfig& config,
 
     // Initialize displays
     // Address layout: base+0=wan1_packet, base+1=wan1_bw, base+2=wan2_packet, base+3=wan2_bw
-    for (int wan = 1; wan <= MAX_WANS; wan++) {
+    for (int wan = 1; wan <= DISPLAY_WAN_COUNT; wan++) {
         for (int t = 0; t < 2; t++) {
             DisplayType dtype = (t == 0) ? DisplayType::PACKET : DisplayType::BANDWIDTH;
             int idx = displayIndex(wan, dtype);
@@ -38,12 +40,12 @@ void DisplayManager::begin(const DisplaySystemConfig& config,
             if (_displays[idx].begin(addr, wire)) {
                 _displays[idx].configure(dtype, wan);
                 _active_count++;
-                Serial.printf("Display %d (WAN%d %s) at 0x%02X: OK\n",
+                LOG_INFO("Display %d (WAN%d %s) at 0x%02X: OK",
                               idx, wan,
                               (dtype == DisplayType::PACKET ? "packet" : "bandwidth"),
                               addr);
             } else {
-                Serial.printf("Display %d (WAN%d %s) at 0x%02X: not found\n",
+                LOG_WARN("Display %d (WAN%d %s) at 0x%02X: not found",
                               idx, wan,
                               (dtype == DisplayType::PACKET ? "packet" : "bandwidth"),
                               addr);
@@ -57,23 +59,23 @@ void DisplayManager::begin(const DisplaySystemConfig& config,
     if (_displays[LOCAL_PINGER_IDX].begin(LOCAL_PINGER_DISPLAY_ADDR, wire)) {
         _displays[LOCAL_PINGER_IDX].configure(DisplayType::PACKET, 0);  // wan_id=0 for local pinger
         _active_count++;
-        Serial.printf("Display %d (Local Packet) at 0x%02X: OK\n",
+        LOG_INFO("Display %d (Local Packet) at 0x%02X: OK",
                       LOCAL_PINGER_IDX, LOCAL_PINGER_DISPLAY_ADDR);
     } else {
-        Serial.printf("Display %d (Local Packet) at 0x%02X: not found\n",
+        LOG_WARN("Display %d (Local Packet) at 0x%02X: not found",
                       LOCAL_PINGER_IDX, LOCAL_PINGER_DISPLAY_ADDR);
     }
 
     // Initialize local bandwidth display at index 5 (0x76)
-    // wan_id=0 signals to sum WAN1 + WAN2 bandwidth
+    // wan_id=0 signals to sum the bandwidth of every WAN
     const int LOCAL_BW_IDX = 5;
     if (_displays[LOCAL_BW_IDX].begin(LOCAL_BW_DISPLAY_ADDR, wire)) {
         _displays[LOCAL_BW_IDX].configure(DisplayType::BANDWIDTH, 0);  // wan_id=0 for combined bandwidth
         _active_count++;
-        Serial.printf("Display %d (Local Bandwidth) at 0x%02X: OK\n",
+        LOG_INFO("Display %d (Local Bandwidth) at 0x%02X: OK",
                       LOCAL_BW_IDX, LOCAL_BW_DISPLAY_ADDR);
     } else {
-        Serial.printf("Display %d (Local Bandwidth) at 0x%02X: not found\n",
+        LOG_WARN("Display %d (Local Bandwidth) at 0x%02X: not found",
                       LOCAL_BW_IDX, LOCAL_BW_DISPLAY_ADDR);
     }
 
@@ -81,7 +83,7 @@ void DisplayManager::begin(const DisplaySystemConfig& config,
     syncAllDisplayMetrics();
     renderAllDisplays();
 
-    Serial.printf("DisplayManager: %d display(s) active, cycle=%lums\n",
+    LOG_INFO("DisplayManager: %d display(s) active, cycle=%lums",
                   _active_count,
                   config.cycle_interval_ms);
 }
@@ -116,7 +118,9 @@ void DisplayManager::cyclePacketMetric() {
 }
 
 void DisplayManager::cycleBandwidthMetric() {
-    uint8_t next = (static_cast<uint8_t>(_current_bw_metric) + 1) % BANDWIDTH_METRIC_COUNT;
+    uint8_t count = BANDWIDTH_METRIC_COUNT;
+    if (data_usage_get_settings().on_display) count++;  // CAP
+    uint8_t next = (static_cast<uint8_t>(_current_bw_metric) + 1) % count;
     _current_bw_metric = static_cast<BandwidthMetric>(next);
 }
 
@@ -147,7 +151,7 @@ void DisplayManager::advancePacketMetric() {
     cyclePacketMetric();
     syncAllDisplayMetrics();
     renderAllDisplays();
-    Serial.println("Packet metric advanced");
+    LOG_DEBUG("Packet metric advanced");
 }
 
 void DisplayManager::advanceBandwidthMetric() {
@@ -155,19 +159,19 @@ void DisplayManager::advanceBandwidthMetric() {
     cycleBandwidthMetric();
     syncAllDisplayMetrics();
     renderAllDisplays();
-    Serial.println("Bandwidth metric advanced");
+    LOG_DEBUG("Bandwidth metric advanced");
 }
 
 void DisplayManager::togglePacketAutoCycle() {
     _packet_auto_cycle = !_packet_auto_cycle;
     _last_cycle_ms = millis();  // Reset timer to keep displays in sync
-    Serial.printf("Packet auto-cycle: %s\n", _packet_auto_cycle ? "ON" : "OFF");
+    LOG_INFO("Packet auto-cycle: %s", _packet_auto_cycle ? "ON" : "OFF");
 }
 
 void DisplayManager::toggleBandwidthAutoCycle() {
     _bw_auto_cycle = !_bw_auto_cycle;
     _last_cycle_ms = millis();  // Reset timer to keep displays in sync
-    Serial.printf("Bandwidth auto-cycle: %s\n", _bw_auto_cycle ? "ON" : "OFF");
+    LOG_INFO("Bandwidth auto-cycle: %s", _bw_auto_cycle ? "ON" : "OFF");
 }
 
 void DisplayManager::setBrightness(uint8_t brightness) {
@@ -218,3 +222,11 @@ bool DisplayManager::isDisplayReady(int wan_id, DisplayType type) const {
     int idx = displayIndex(wan_id, type);
     return (idx >= 0 && idx < MAX_DISPLAYS) && _displays[idx].isReady();
 }
+
+uint32_t DisplayManager::i2cWriteCount() const {
+    uint32_t total = 0;
+    for (int i = 0; i < MAX_DISPLAYS; i++) {
+        total += _displays[i].writeCount();
+    }
+    return total;
+}
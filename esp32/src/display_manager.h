@@ -44,6 +44,9 @@ public:
     // Check if specific display is available
     bool isDisplayReady(int wan_id, DisplayType type) const;
 
+    // Total I2C writes issued to all 7-segment displays
+    uint32_t i2cWriteCount() const;
+
 private:
     DisplaySystemConfig _config;
 
@@ -0,0 +1,79 @@
+// event_journal.cpp
+#include "event_journal.h"
+#include "metrics_history.h"
+#include "local_pinger.h"
+
+static WanEvent g_ring[EVENT_RING_LEN];
+static uint32_t g_next_seq = 1;
+
+// millis() of each source's last transition (0 = none since boot)
+static unsigned long g_since_ms[MAX_WANS + 1];
+
+static void on_state_change(int wan_id, WanState from, WanState to) {
+    if (wan_id < LOCAL_PINGER_ID || wan_id > MAX_WANS) return;
+
+    unsigned long now = millis();
+    WanEvent& e = g_ring[g_next_seq % EVENT_RING_LEN];
+    e.seq = g_next_seq;
+    e.t_s = history_now_s();
+    e.duration_s = (now - g_since_ms[wan_id]) / 1000;
+    e.source = (int8_t)wan_id;
+    e.from = from;
+    e.to = to;
+
+    if (wan_id == LOCAL_PINGER_ID) {
+        const LocalPingerMetrics& lp = local_pinger_get();
+        e.loss_pct = lp.loss_pct;
+        e.latency_ms = lp.latency_ms;
+        e.jitter_ms = lp.jitter_ms;
+        e.down_mbps = 0.0f;
+        e.up_mbps = 0.0f;
+    } else {
+        const WanMetrics& m = wan_metrics_get(wan_id);
+        e.loss_pct = m.loss_pct;
+        e.latency_ms = m.latency_ms;
+        e.jitter_ms = m.jitter_ms;
+        e.down_mbps = m.down_mbps;
+        e.up_mbps = m.up_mbps;
+    }
+
+    g_since_ms[wan_id] = now;
+    g_next_seq++;
+}
+
+// Keep the events of later WANs on their new ids; a forgotten WAN's own
+// events stay in the ring without a name
+static void on_forget(int wan_id) {
+    for (WanEvent& e : g_ring) {
+        if (e.source == wan_id) {
+            e.source = EVENT_SOURCE_FORGOTTEN;
+        } else if (e.source > wan_id) {
+            e.source--;
+        }
+    }
+    wan_id_erase(g_since_ms, wan_id);
+}
+
+void events_init() {
+    wan_metrics_on_state_change(on_state_change);
+    wan_metrics_on_forget(on_forget);
+}
+
+uint32_t events_next_seq() {
+    return g_next_seq;
+}
+
+uint32_t events_oldest_seq() {
+    return (g_next_seq > EVENT_RING_LEN) ? g_next_seq - EVENT_RING_LEN : 1;
+}
+
+bool events_read(uint32_t seq, WanEvent& out) {
+    if (seq < events_oldest_seq() || seq >= g_next_seq) return false;
+    out = g_ring[seq % EVENT_RING_LEN];
+    return true;
+}
+
+const char* events_source_name(const WanEvent& e) {
+    if (e.source == EVENT_SOURCE_FORGOTTEN) return "";
+    return (e.source == LOCAL_PINGER_ID) ? "local" : wan_metrics_key(e.source);
+}
@@ -0,0 +1,48 @@
+// event_journal.h
+// Fixed-size journal of state transitions for every WAN and the local pinger
+//
+// Registered as a wan_metrics state listener, so every transition reported
+// by wan_metrics_commit_at() or the local pinger's stats pass lands here in
+// O(1): one slot write, no allocation. Each event keeps the time spent in
+// the previous state and the metrics that triggered the change, so a short
+// DEGRADED spell still shows after it has recovered.
+//
+// Sequence numbers only grow (like the log ring); GET /api/events?since=
+// resumes from the "next" value it was given. Events are only written and
+// read from loop() context.
+#pragma once
+
+#include <Arduino.h>
+#include "wan_metrics.h"
+
+static const int EVENT_RING_LEN = 64;
+static const int8_t EVENT_SOURCE_FORGOTTEN = -1;   // WAN forgotten since (see wan_metrics_forget())
+
+struct WanEvent {
+    uint32_t seq;
+    uint32_t t_s;               // history clock (see metrics_history.h)
+    uint32_t duration_s;        // time in `from`; since boot for a source's first event
+    int8_t source;              // LOCAL_PINGER_ID, a WAN id or EVENT_SOURCE_FORGOTTEN
+    WanState from;
+    WanState to;
+    uint8_t loss_pct;
+    uint16_t latency_ms;
+    uint16_t jitter_ms;
+    float down_mbps;            // 0 for the local pinger
+    float up_mbps;
+};
+
+// Start listening for transitions (call in setup(), after wan_metrics_init())
+void events_init();
+
+// Sequence number the next event will get (events start at 1)
+uint32_t events_next_seq();
+
+// Oldest sequence number still in the ring
+uint32_t events_oldest_seq();
+
+// Copy one event; false if it was overwritten or not written yet
+bool events_read(uint32_t seq, WanEvent& out);
+
+// Name of an event's source ("local", the WAN name, or "" if forgotten)
+const char* events_source_name(const WanEvent& e);
@@ -1,11 +1,13 @@
 // freshness_bar.cpp
 #include "freshness_bar.h"
+#include "logger.h"
 
 FreshnessBar::FreshnessBar()
     : _wire(nullptr)
     , _i2c_addr(0)
     , _ready(false)
     , _brightness(8)
+    , _write_count(0)
     , _blink_on(false)
     , _last_blink_ms(0)
     , _last_green_count(-1)
@@ -21,15 +23,24 @@ bool FreshnessBar::begin(uint8_t i2c_addr, TwoWire* wire) {
     _ready = _bar.begin(i2c_addr, wire);
     if (_ready) {
         _bar.clear();
-        _bar.writeDisplay();
+        writeDisplay();
         _bar.setBrightness(_brightness);
-        Serial.printf("FreshnessBar initialized at 0x%02X\n", i2c_addr);
+        LOG_INFO("FreshnessBar initialized at 0x%02X", i2c_addr);
     } else {
-        Serial.printf("FreshnessBar at 0x%02X: not found\n", i2c_addr);
+        LOG_WARN("FreshnessBar at 0x%02X: not found", i2c_addr);
     }
     return _ready;
 }
 
+uint32_t FreshnessBar::writeCount() const {
+    return _write_count;
+}
+
+void FreshnessBar::writeDisplay() {
+    _bar.writeDisplay();
+    _write_count++;
+}
+
 bool FreshnessBar::isReady() const {
     return _ready;
 }
@@ -55,12 +66,13 @@ void FreshnessBar::setDisplayOn(bool on) {
     _wire->beginTransmission(_i2c_addr);
     _wire->write(on ? 0x81 : 0x80);
     _wire->endTransmission();
+    _write_count++;
 }
 
 void FreshnessBar::clear() {
     if (!_ready) return;
     _bar.clear();
-    _bar.writeDisplay();
+    writeDisplay();
     _last_green_count = 0;
     _last_yellow_count = 0;
     _last_red_count = 0;
@@ -163,7 +175,7 @@ void FreshnessBar::renderBarOverwrite(int green_count, int yellow_count, int red
         _bar.setBar(i, color);
     }
 
-    _bar.writeDisplay();
+    writeDisplay();
 }
 
 void FreshnessBar::renderBlinkingRed(bool on) {
@@ -173,7 +185,7 @@ void FreshnessBar::renderBlinkingRed(bool on) {
         _bar.setBar(i, color);
     }
 
-    _bar.writeDisplay();
+    writeDisplay();
 }
 
 bool FreshnessBar::stateChanged(int green, int yellow, int red, bool blinking, bool blink_state) {
@@ -58,12 +58,16 @@ public:
     // Clear all LEDs
     void clear();
 
+    // Number of I2C frame/command writes issued to the bargraph
+    uint32_t writeCount() const;
+
 private:
     Adafruit_24bargraph _bar;
     TwoWire* _wire;
     uint8_t _i2c_addr;
     bool _ready;
     uint8_t _brightness;
+    uint32_t _write_count;
 
     // Blink state tracking
     bool _blink_on;
@@ -77,6 +81,7 @@ private:
     bool _last_blink_state;
 
     // Internal helpers
+    void writeDisplay();
     void renderBarOverwrite(int green_count, int yellow_count, int red_count);
     void renderBlinkingRed(bool on);
     bool stateChanged(int green, int yellow, int red, bool blinking, bool blink_state);
@@ -0,0 +1,143 @@
+// gorilla_codec.cpp
+#include "gorilla_codec.h"
+
+void bit_writer_init(BitWriter& w, uint8_t* buf, size_t cap_bytes) {
+    memset(buf, 0, cap_bytes);
+    w = { buf, cap_bytes * 8, 0, true };
+}
+
+void bit_reader_init(BitReader& r, const uint8_t* buf, size_t len_bytes) {
+    r = { buf, len_bytes * 8, 0, true };
+}
+
+// MSB first; the buffer starts zeroed, so only 1 bits are written
+void bits_put(BitWriter& w, uint32_t value, int bits) {
+    if (w.pos_bits + bits > w.cap_bits) {
+        w.ok = false;
+        return;
+    }
+    for (int i = bits - 1; i >= 0; i--) {
+        if ((value >> i) & 1) w.buf[w.pos_bits >> 3] |= 0x80 >> (w.pos_bits & 7);
+        w.pos_bits++;
+    }
+}
+
+uint32_t bits_get(BitReader& r, int bits) {
+    if (r.pos_bits + bits > r.len_bits) {
+        r.ok = false;
+        return 0;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < bits; i++) {
+        value = (value << 1) | ((r.buf[r.pos_bits >> 3] >> (7 - (r.pos_bits & 7))) & 1);
+        r.pos_bits++;
+    }
+    return value;
+}
+
+// ---- Timestamps ----
+
+// Prefix and payload width per delta-of-delta range
+struct DodClass {
+    uint32_t prefix;
+    int prefix_bits;
+    int bits;
+};
+static const DodClass DOD_CLASSES[] = {
+    { 0b10, 2, 7 },
+    { 0b110, 3, 9 },
+    { 0b1110, 4, 12 },
+    { 0b1111, 4, 32 },
+};
+
+void gorilla_time_init(GorillaTime& s, uint32_t t0) {
+    s.prev_t = t0;
+    s.prev_delta = 0;
+}
+
+void gorilla_put_time(BitWriter& w, GorillaTime& s, uint32_t t) {
+    int32_t delta = (int32_t)(t - s.prev_t);
+    int32_t dod = delta - s.prev_delta;
+    s.prev_t = t;
+    s.prev_delta = delta;
+
+    if (dod == 0) {
+        bits_put(w, 0, 1);
+        return;
+    }
+    for (const DodClass& c : DOD_CLASSES) {
+        int32_t limit = (c.bits == 32) ? INT32_MAX : (1 << (c.bits - 1));
+        if (c.bits == 32 || (dod >= -limit && dod < limit)) {
+            bits_put(w, c.prefix, c.prefix_bits);
+            bits_put(w, (uint32_t)dod & (c.bits == 32 ? 0xFFFFFFFFu : ((1u << c.bits) - 1)), c.bits);
+            return;
+        }
+    }
+}
+
+uint32_t gorilla_get_time(BitReader& r, GorillaTime& s) {
+    int32_t dod = 0;
+    if (bits_get(r, 1) != 0) {
+        int ones = 1;
+        while (ones < 4 && bits_get(r, 1) != 0) ones++;
+        int bits = DOD_CLASSES[ones - 1].bits;
+        uint32_t raw = bits_get(r, bits);
+        if (bits < 32 && (raw & (1u << (bits - 1)))) raw |= ~((1u << bits) - 1);  // sign-extend
+        dod = (int32_t)raw;
+    }
+    s.prev_delta += dod;
+    s.prev_t += s.prev_delta;
+    return s.prev_t;
+}
+
+// ---- Values ----
+
+void gorilla_xor_init(GorillaXor& s) {
+    s.prev = 0;
+    s.lead = 0;
+    s.len = 0;
+}
+
+void gorilla_put_xor(BitWriter& w, GorillaXor& s, uint32_t value) {
+    uint32_t x = value ^ s.prev;
+    s.prev = value;
+    if (x == 0) {
+        bits_put(w, 0, 1);
+        return;
+    }
+
+    int lead = __builtin_clz(x);
+    int trail = __builtin_ctz(x);
+    if (lead > 31) lead = 31;
+
+    // Reuse the previous window when the meaningful bits fall inside it
+    if (s.len > 0 && lead >= s.lead && trail >= 32 - s.lead - s.len) {
+        bits_put(w, 0b10, 2);
+        bits_put(w, x >> (32 - s.lead - s.len), s.len);
+        return;
+    }
+
+    int len = 32 - lead - trail;
+    bits_put(w, 0b11, 2);
+    bits_put(w, lead, 5);
+    bits_put(w, len - 1, 5);
+    bits_put(w, x >> trail, len);
+    s.lead = lead;
+    s.len = len;
+}
+
+uint32_t gorilla_get_xor(BitReader& r, GorillaXor& s) {
+    if (bits_get(r, 1) == 0) return s.prev;
+
+    if (bits_get(r, 1) != 0) {
+        s.lead = bits_get(r, 5);
+        s.len = bits_get(r, 5) + 1;
+    }
+    if (s.len == 0 || s.lead + s.len > 32) {
+        r.ok = false;  // window reuse before any window: corrupt stream
+        return s.prev;
+    }
+    uint32_t bits = bits_get(r, s.len);
+    s.prev ^= bits << (32 - s.lead - s.len);
+    return s.prev;
+}
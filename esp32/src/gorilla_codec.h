@@ -0,0 +1,58 @@
+// gorilla_codec.h
+// Bit-level time series compression (the scheme of Facebook's Gorilla TSDB)
+//
+// Timestamps are stored as delta-of-delta: a steady reporting interval
+// costs one bit per sample. Values are stored as the XOR with the previous
+// value of the same field: an unchanged value costs one bit, and a changed
+// one only its meaningful (non-zero) bits, reusing the previous bit window
+// when it still fits. Values are 32-bit words (floats by their bit pattern).
+//
+// Each encoder state starts from zero, so a stream decodes on its own from
+// its first bit; the metrics log starts a new stream per block.
+#pragma once
+
+#include <Arduino.h>
+
+struct BitWriter {
+    uint8_t* buf;
+    size_t cap_bits;
+    size_t pos_bits;
+    bool ok;                    // false once a write did not fit
+};
+
+struct BitReader {
+    const uint8_t* buf;
+    size_t len_bits;
+    size_t pos_bits;
+    bool ok;                    // false once a read ran past the end
+};
+
+struct GorillaTime {
+    uint32_t prev_t;
+    int32_t prev_delta;
+};
+
+struct GorillaXor {
+    uint32_t prev;
+    uint8_t lead;               // leading zeros of the current window
+    uint8_t len;                // meaningful bits of the current window, 0 = none
+};
+
+// Worst case for one timestamp / one value, in bits
+static const int GORILLA_TIME_MAX_BITS = 4 + 32;
+static const int GORILLA_XOR_MAX_BITS = 2 + 5 + 5 + 32;
+
+void bit_writer_init(BitWriter& w, uint8_t* buf, size_t cap_bytes);
+void bit_reader_init(BitReader& r, const uint8_t* buf, size_t len_bytes);
+
+void bits_put(BitWriter& w, uint32_t value, int bits);
+uint32_t bits_get(BitReader& r, int bits);
+
+// The time stream starts at t0 (stored by the caller)
+void gorilla_time_init(GorillaTime& s, uint32_t t0);
+void gorilla_put_time(BitWriter& w, GorillaTime& s, uint32_t t);
+uint32_t gorilla_get_time(BitReader& r, GorillaTime& s);
+
+void gorilla_xor_init(GorillaXor& s);
+void gorilla_put_xor(BitWriter& w, GorillaXor& s, uint32_t value);
+uint32_t gorilla_get_xor(BitReader& r, GorillaXor& s);
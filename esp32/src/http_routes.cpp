@@ -1,6 +1,7 @@
 // http_routes.cpp
 #include <Arduino.h>
 #include <WebServer.h>
+#include <uri/UriBraces.h>
 #include <ETH.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
@@ -8,8 +9,32 @@
 #include "hostname.h"
 #include "leds.h"
 #include "wan_metrics.h"
+#include "wan_fields.h"
+#include "wan_ingest.h"
 #include "local_pinger.h"
 #include "freshness_bar.h"
+#include "udp_ingest.h"
+#include "stream_ingest.h"
+#include "metrics_exporter.h"
+#include "http_server.h"
+#include "admission.h"
+#include "config_store.h"
+#include "mqtt_publisher.h"
+#include "webhook_alerts.h"
+#include "snmp_poller.h"
+#include "peer_gossip.h"
+#include "metrics_log.h"
+#include "wan_counters.h"
+#include "state_policy.h"
+#include "wan_freshness.h"
+#include "event_journal.h"
+#include "availability.h"
+#include "billing_cycle.h"
+#include "bw_percentile.h"
+#include "data_usage.h"
+#include "metrics_history.h"
+#include "route_timing.h"
+#include "logger.h"
 
 // ---- Favicon SVGs ----
 static const char* FAVICON_GREEN = R"(<svg xmlns="http://www.w3.org/2000/svg" viewBox="0 0 32 32">
@@ -41,6 +66,74 @@ static String get_content_type(const String& filename) {
     return "text/plain";
 }
 
+// ---- Content negotiation ----
+// POST /api/wans accepts MessagePack as well as JSON, and any JSON API
+// response can be returned as MessagePack when the client asks for it via
+// the Accept header. ArduinoJson has no CBOR support, so CBOR is rejected.
+static const char* MSGPACK_CONTENT_TYPE = "application/msgpack";
+
+static bool is_msgpack_type(const String& type) {
+    // Matches application/msgpack, application/x-msgpack, application/vnd.msgpack
+    return type.indexOf("msgpack") >= 0;
+}
+
+static bool is_cbor_type(const String& type) {
+    return type.indexOf("cbor") >= 0;
+}
+
+// ---- Helper: Send a JSON document, encoded per the Accept header ----
+static void send_doc(WebServer& server, int code, const JsonDocument& doc) {
+    route_timing_mark(TimingPhase::HANDLER);
+    if (is_msgpack_type(server.header("Accept"))) {
+        size_t len = measureMsgPack(doc);
+        uint8_t* buf = (uint8_t*)malloc(len);
+        if (buf != nullptr) {
+            serializeMsgPack(doc, buf, len);
+            route_timing_mark(TimingPhase::SERIALIZE);
+            server.send_P(code, MSGPACK_CONTENT_TYPE, (const char*)buf, len);
+            free(buf);
+            return;
+        }
+    }
+
+    String output;
+    serializeJson(doc, output);
+    route_timing_mark(TimingPhase::SERIALIZE);
+    server.send(code, "application/json", output);
+}
+
+// ---- Raw request body capture ----
+// WebServer copies non-form bodies into the "plain" arg via String(char*),
+// which truncates at the first NUL byte. MessagePack bodies contain NULs, so
+// /api/wans collects its body through the raw upload callback instead.
+static const size_t MAX_BODY_BYTES = 4096;
+static uint8_t g_body[MAX_BODY_BYTES];
+static size_t g_body_len = 0;
+static bool g_body_overflow = false;
+
+static void handle_body_raw(WebServer& server) {
+    HTTPRaw& raw = server.raw();
+    switch (raw.status) {
+        case RAW_START:
+            g_body_len = 0;
+            g_body_overflow = false;
+            break;
+        case RAW_WRITE:
+            if (g_body_len + raw.currentSize > MAX_BODY_BYTES) {
+                g_body_overflow = true;
+                break;
+            }
+            memcpy(g_body + g_body_len, raw.buf, raw.currentSize);
+            g_body_len += raw.currentSize;
+            break;
+        case RAW_ABORTED:
+            g_body_len = 0;
+            break;
+        default:
+            break;
+    }
+}
+
 // ---- Generic file handler ----
 static void handle_file_read(WebServer& server, String path) {
     if (path.endsWith("/")) {
@@ -62,101 +155,164 @@ static void handle_not_found(WebServer& server) {
     handle_file_read(server, server.uri());
 }
 
-// ---- Helper: Parse JSON and update WAN metrics ----
-static bool parse_wan_json(JsonObject& obj, int wan_id) {
-    const char* state_str = obj["state"] | "down";
-    WanState state = wan_state_from_string(state_str);
-    uint8_t loss_pct = obj["loss_pct"] | 100;
-    uint16_t latency_ms = obj["latency_ms"] | 0;
-    uint16_t jitter_ms = obj["jitter_ms"] | 0;
-    float down_mbps = obj["down_mbps"] | 0.0f;
-    float up_mbps = obj["up_mbps"] | 0.0f;
-    float down_1m = obj["down_1m"] | 0.0f;
-    float down_5m = obj["down_5m"] | 0.0f;
-    float down_15m = obj["down_15m"] | 0.0f;
-    float up_1m = obj["up_1m"] | 0.0f;
-    float up_5m = obj["up_5m"] | 0.0f;
-    float up_15m = obj["up_15m"] | 0.0f;
-    const char* local_ip = obj["local_ip"] | "";
-    const char* gateway_ip = obj["gateway_ip"] | "";
-    const char* monitor_ip = obj["monitor_ip"] | "";
+// ---- Helper: billing cycle bandwidth of one WAN ----
+static void add_peak_time(JsonObject obj, const char* key, uint32_t unix_s) {
+    if (unix_s == 0) {
+        obj[key] = nullptr;
+        return;
+    }
+    char text[24];
+    format_iso8601(unix_s, text, sizeof(text));
+    obj[key] = text;
+}
+
+static void add_percentiles(JsonObject obj, int wan_id) {
+    const WanBandwidthPercentiles& p = bw_percentile_get(wan_id);
+    obj["down_p95"] = p2_value(p.down);
+    obj["up_p95"] = p2_value(p.up);
+    obj["down_peak"] = p.down_peak_mbps;
+    obj["up_peak"] = p.up_peak_mbps;
+    add_peak_time(obj, "down_peak_at", p.down_peak_at);
+    add_peak_time(obj, "up_peak_at", p.up_peak_at);
+}
+
+// ---- Helper: WAN table as JSON ----
+// "wans" lists every WAN in table order. Older clients read "wan1"/"wan2"
+// directly, so those two (only) are repeated as top-level objects; copying
+// every WAN would double the response with 8 WANs.
+static bool is_legacy_wan_key(const char* name) {
+    return strcmp(name, "wan1") == 0 || strcmp(name, "wan2") == 0;
+}
+
+static void add_wans(JsonDocument& doc) {
+    JsonArray wans = doc["wans"].to<JsonArray>();
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        JsonObject obj = wans.add<JsonObject>();
+        obj["name"] = wan_metrics_key(id);
+        wan_fields_to_json(wan_metrics_get(id), obj);
+        long age_ms = wan_age_ms(id);
+        obj["freshness"] = freshness_to_string(wan_freshness(id));
+        obj["age_s"] = (age_ms < 0) ? -1 : age_ms / 1000;
+        add_percentiles(obj, id);
+        if (is_legacy_wan_key(wan_metrics_key(id))) doc[wan_metrics_key(id)] = obj;
+    }
+}
 
-    wan_metrics_update(wan_id, state, loss_pct, latency_ms, jitter_ms,
-                       down_mbps, up_mbps,
-                       down_1m, down_5m, down_15m, up_1m, up_5m, up_15m,
-                       local_ip, gateway_ip, monitor_ip);
+// ---- Helper: time in state per window ----
+// Percentages are of the time observed in the window (2 decimals)
+static const char* const SECONDS_KEYS[AVAIL_CLASSES] = { "up_s", "degraded_s", "down_s", "stale_s" };
+static const char* const PCT_KEYS[AVAIL_CLASSES] = { "up_pct", "degraded_pct", "down_pct", "stale_pct" };
 
-    // Update LEDs based on WAN
-    if (wan_id == 1) {
-        wan1_set_leds(state);
-    } else if (wan_id == 2) {
-        wan2_set_leds(state);
+static void add_availability(JsonObject parent, const char* name, int source) {
+    JsonObject src_obj;
+    for (int w = 0; w < AVAIL_WINDOWS; w++) {
+        AvailTotals t;
+        if (!avail_get(source, (AvailWindow)w, t)) return;
+        if (src_obj.isNull()) src_obj = parent[name].to<JsonObject>();
+        JsonObject win = src_obj[avail_window_to_string((AvailWindow)w)].to<JsonObject>();
+        win["observed_s"] = t.observed_s;
+        for (int c = 0; c < AVAIL_CLASSES; c++) {
+            uint32_t secs = t.seconds[c];
+            win[SECONDS_KEYS[c]] = secs;
+            win[PCT_KEYS[c]] = t.observed_s ? (uint64_t)secs * 10000 / t.observed_s / 100.0f : 0.0f;
+        }
     }
+}
+
+// ---- Helper: data usage this billing cycle ----
+// Keyed by WAN name; the cap fields are null for WANs without a cap
+static void add_usage(JsonObject parent) {
+    const WanUsage* slots = data_usage_slots();
+    for (int i = 0; i < MAX_WANS; i++) {
+        const WanUsage& u = slots[i];
+        if (u.name[0] == '\0') continue;
+        const char* name = u.name;
+        JsonObject obj = parent[name].to<JsonObject>();
+        uint64_t used = u.rx_bytes + u.tx_bytes;
+        obj["rx_bytes"] = u.rx_bytes;
+        obj["tx_bytes"] = u.tx_bytes;
+        obj["total_bytes"] = used;
+        obj["source"] = u.from_counters ? "counters" : "rates";
 
-    Serial.printf("WAN%d updated: state=%s loss=%d%% lat=%dms local=%s gw=%s\n",
-                  wan_id, state_str, loss_pct, latency_ms, local_ip, gateway_ip);
+        uint64_t projected = 0;
+        bool have_projection = data_usage_projection(u, projected);
+        if (have_projection) obj["projected_bytes"] = projected;
+        else obj["projected_bytes"] = nullptr;
 
-    return true;
+        uint64_t cap = data_usage_cap_bytes(name);
+        if (cap == 0) {
+            obj["cap_bytes"] = nullptr;
+            obj["used_pct"] = nullptr;
+            obj["projected_pct"] = nullptr;
+            continue;
+        }
+        obj["cap_bytes"] = cap;
+        obj["used_pct"] = (float)((double)used * 100.0 / cap);
+        if (have_projection) obj["projected_pct"] = (float)((double)projected * 100.0 / cap);
+        else obj["projected_pct"] = nullptr;
+    }
 }
 
 // ---- Handler: POST /api/wans (batch) ----
 static void handle_wans_post(WebServer& server) {
-    if (!server.hasArg("plain")) {
+    String content_type = server.header("Content-Type");
+    size_t body_len = g_body_len;
+    bool overflow = g_body_overflow;
+    g_body_len = 0;  // consumed; stale data must not leak into the next request
+    g_body_overflow = false;
+
+    if (is_cbor_type(content_type)) {
+        server.send(415, "application/json", "{\"error\":\"CBOR not supported, use MessagePack\"}");
+        return;
+    }
+    if (overflow) {
+        server.send(413, "application/json", "{\"error\":\"body too large\"}");
+        return;
+    }
+    if (body_len == 0) {
         server.send(400, "application/json", "{\"error\":\"no body\"}");
         return;
     }
 
-    String body = server.arg("plain");
     JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, body);
+    DeserializationError error = wan_ingest_decode(doc, g_body, body_len,
+                                                   is_msgpack_type(content_type));
+    route_timing_mark(TimingPhase::PARSE);
 
     if (error) {
-        Serial.printf("JSON parse error: %s\n", error.c_str());
-        server.send(400, "application/json", "{\"error\":\"invalid JSON\"}");
+        LOG_WARN("Body parse error: %s", error.c_str());
+        server.send(400, "application/json", "{\"error\":\"invalid body\"}");
         return;
     }
 
-    // Extract top-level router info
-    const char* router_ip = doc["router_ip"] | "";
-    const char* timestamp = doc["timestamp"] | "";
-    wan_metrics_set_router_info(router_ip, timestamp);
-
-    // Process wan1 if present
-    if (doc["wan1"].is<JsonObject>()) {
-        JsonObject wan1 = doc["wan1"];
-        parse_wan_json(wan1, 1);
-    }
-
-    // Process wan2 if present
-    if (doc["wan2"].is<JsonObject>()) {
-        JsonObject wan2 = doc["wan2"];
-        parse_wan_json(wan2, 2);
-    }
+    wan_ingest_apply(doc);
 
     // Build response with all WANs
     JsonDocument resp;
     resp["status"] = "ok";
+    add_wans(resp);
 
-    for (int i = 1; i <= MAX_WANS; i++) {
-        const WanMetrics& m = wan_metrics_get(i);
-        JsonObject wan = resp["wan" + String(i)].to<JsonObject>();
-        wan["state"] = wan_state_to_string(m.state);
-        wan["loss_pct"] = m.loss_pct;
-        wan["latency_ms"] = m.latency_ms;
-        wan["jitter_ms"] = m.jitter_ms;
-        wan["down_mbps"] = m.down_mbps;
-        wan["up_mbps"] = m.up_mbps;
+    send_doc(server, 200, resp);
+}
+
+// ---- Handler: DELETE /api/wans/<name> ----
+static void handle_wans_delete(WebServer& server) {
+    String name = server.pathArg(0);
+    if (!wan_metrics_forget(name.c_str())) {
+        server.send(404, "application/json", "{\"error\":\"unknown WAN\"}");
+        return;
     }
+    LOG_INFO("WAN %s forgotten", name.c_str());
 
-    String output;
-    serializeJson(resp, output);
-    server.send(200, "application/json", output);
+    JsonDocument resp;
+    resp["status"] = "ok";
+    add_wans(resp);
+
+    send_doc(server, 200, resp);
 }
 
 // ---- Handler: GET /api/status ----
 static void handle_status_get(WebServer& server) {
-    const WanMetrics& w1 = wan_metrics_get(1);
-    const WanMetrics& w2 = wan_metrics_get(2);
     const LocalPingerMetrics& lp = local_pinger_get();
     const char* timestamp = wan_metrics_get_timestamp();
 
@@ -164,40 +320,7 @@ static void handle_status_get(WebServer& server) {
     doc["hostname"] = get_network_hostname();
     doc["timestamp"] = timestamp;
     doc["router_ip"] = wan_metrics_get_router_ip();
-
-    JsonObject wan1 = doc["wan1"].to<JsonObject>();
-    wan1["state"] = wan_state_to_string(w1.state);
-    wan1["latency_ms"] = w1.latency_ms;
-    wan1["jitter_ms"] = w1.jitter_ms;
-    wan1["loss_pct"] = w1.loss_pct;
-    wan1["down_mbps"] = w1.down_mbps;
-    wan1["up_mbps"] = w1.up_mbps;
-    wan1["down_1m"] = w1.down_1m;
-    wan1["down_5m"] = w1.down_5m;
-    wan1["down_15m"] = w1.down_15m;
-    wan1["up_1m"] = w1.up_1m;
-    wan1["up_5m"] = w1.up_5m;
-    wan1["up_15m"] = w1.up_15m;
-    wan1["monitor_ip"] = w1.monitor_ip;
-    wan1["gateway_ip"] = w1.gateway_ip;
-    wan1["local_ip"] = w1.local_ip;
-
-    JsonObject wan2 = doc["wan2"].to<JsonObject>();
-    wan2["state"] = wan_state_to_string(w2.state);
-    wan2["latency_ms"] = w2.latency_ms;
-    wan2["jitter_ms"] = w2.jitter_ms;
-    wan2["loss_pct"] = w2.loss_pct;
-    wan2["down_mbps"] = w2.down_mbps;
-    wan2["up_mbps"] = w2.up_mbps;
-    wan2["down_1m"] = w2.down_1m;
-    wan2["down_5m"] = w2.down_5m;
-    wan2["down_15m"] = w2.down_15m;
-    wan2["up_1m"] = w2.up_1m;
-    wan2["up_5m"] = w2.up_5m;
-    wan2["up_15m"] = w2.up_15m;
-    wan2["monitor_ip"] = w2.monitor_ip;
-    wan2["gateway_ip"] = w2.gateway_ip;
-    wan2["local_ip"] = w2.local_ip;
+    add_wans(doc);
 
     JsonObject local = doc["local"].to<JsonObject>();
     local["state"] = wan_state_to_string(lp.state);
@@ -207,6 +330,13 @@ static void handle_status_get(WebServer& server) {
     local["local_ip"] = get_network_ip();
     local["monitor_ip"] = local_pinger_get_target();
 
+    // Rolling time in state ("local" first, then WANs in table order)
+    JsonObject avail_obj = doc["availability"].to<JsonObject>();
+    add_availability(avail_obj, "local", LOCAL_PINGER_ID);
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        add_availability(avail_obj, wan_metrics_key(id), id);
+    }
+
     // Freshness bar timing constants (in seconds, matching hardware)
     JsonObject freshness = doc["freshness"].to<JsonObject>();
     freshness["green_fill_end"] = FRESHNESS_GREEN_FILL_END_MS / 1000;
@@ -218,9 +348,182 @@ static void handle_status_get(WebServer& server) {
     freshness["fill_duration"] = FRESHNESS_FILL_DURATION_MS / 1000;
     freshness["led_count"] = TOTAL_LEDS;
 
-    String output;
-    serializeJson(doc, output);
-    server.send(200, "application/json", output);
+    // Alternative ingest transports
+    const UdpIngestStats& udp = udp_ingest_get_stats();
+    JsonObject udp_obj = doc["ingest"]["udp"].to<JsonObject>();
+    udp_obj["enabled"] = udp.enabled;
+    udp_obj["received"] = udp.received;
+    udp_obj["accepted"] = udp.accepted;
+    udp_obj["bad_mac"] = udp.bad_mac;
+    udp_obj["malformed"] = udp.malformed;
+    udp_obj["lost"] = udp.lost;
+    udp_obj["duplicate"] = udp.duplicate;
+    udp_obj["out_of_order"] = udp.out_of_order;
+    udp_obj["stale"] = udp.stale;
+    udp_obj["ahead"] = udp.ahead;
+    udp_obj["sessions"] = udp.sessions;
+    udp_obj["session"] = udp.session;
+    udp_obj["last_seq"] = udp.last_seq;
+    udp_obj["newest_time"] = udp.newest_time;
+
+    const StreamIngestStats& stream = stream_ingest_get_stats();
+    JsonObject stream_obj = doc["ingest"]["stream"].to<JsonObject>();
+    stream_obj["connected"] = stream.connected;
+    stream_obj["client_ip"] = stream.client_ip;
+    stream_obj["connected_secs"] = stream.connected ? (millis() - stream.connected_ms) / 1000 : 0;
+    stream_obj["connects"] = stream.connects;
+    stream_obj["rejected"] = stream.rejected;
+    stream_obj["auth_failures"] = stream.auth_failures;
+    stream_obj["authenticated"] = stream.authenticated;
+    stream_obj["records"] = stream.records;
+    stream_obj["parse_errors"] = stream.parse_errors;
+    stream_obj["records_per_sec"] = stream.records_per_sec;
+
+    const SnmpStats& snmp = snmp_get_stats();
+    JsonObject snmp_obj = doc["ingest"]["snmp"].to<JsonObject>();
+    snmp_obj["enabled"] = snmp.enabled;
+    snmp_obj["requests"] = snmp.requests;
+    snmp_obj["responses"] = snmp.responses;
+    snmp_obj["timeouts"] = snmp.timeouts;
+    snmp_obj["errors"] = snmp.errors;
+    snmp_obj["counter_resets"] = snmp.counter_resets;
+    snmp_obj["last_rtt_ms"] = snmp.last_rtt_ms;
+    snmp_obj["last_error_status"] = snmp.last_error_status;
+
+    const WanCounterStats& counters = wan_counters_get_stats();
+    JsonObject counters_obj = doc["ingest"]["counters"].to<JsonObject>();
+    counters_obj["samples"] = counters.samples;
+    counters_obj["rates"] = counters.rates;
+    counters_obj["resets"] = counters.resets;
+    counters_obj["wraps"] = counters.wraps;
+
+    // State grading (profiles are in /api/config)
+    const StatePolicyStats& policy = state_policy_get_stats();
+    JsonObject policy_obj = doc["state_policy"].to<JsonObject>();
+    policy_obj["evaluations"] = policy.evaluations;
+    policy_obj["transitions"] = policy.transitions;
+    policy_obj["held"] = policy.held;
+
+    // Billing cycle of the p95/peak figures (cycle_day is in /api/config)
+    JsonObject billing_obj = doc["billing"].to<JsonObject>();
+    uint32_t now_unix;
+    bool clock_set = billing_clock_now(now_unix);
+    billing_obj["clock_set"] = clock_set;
+    if (clock_set) {
+        char text[24];
+        format_iso8601(billing_cycle_start(now_unix), text, sizeof(text));
+        billing_obj["cycle_start"] = text;
+        format_iso8601(billing_cycle_end(now_unix), text, sizeof(text));
+        billing_obj["cycle_end"] = text;
+    }
+    billing_obj["samples"] = bw_percentile_get_stats().samples;
+    const UsageStats& usage = data_usage_get_stats();
+    billing_obj["usage_restored"] = usage.restored;
+    billing_obj["usage_saves"] = usage.saves;
+    const BwPercentileStats& bw = bw_percentile_get_stats();
+    billing_obj["p95_restored"] = bw.restored;
+    billing_obj["p95_saves"] = bw.saves;
+
+    // Data usage against the caps (caps are in /api/config)
+    add_usage(doc["usage"].to<JsonObject>());
+
+    // Settings persistence
+    const ConfigStoreStats& cfg = config_get_stats();
+    JsonObject cfg_obj = doc["config_store"].to<JsonObject>();
+    cfg_obj["loaded"] = cfg.loaded;
+    cfg_obj["pending"] = cfg.pending;
+    cfg_obj["saves"] = cfg.saves;
+
+    // MQTT publisher
+    const MqttStats& mqtt = mqtt_get_stats();
+    JsonObject mqtt_obj = doc["mqtt"].to<JsonObject>();
+    mqtt_obj["enabled"] = mqtt.enabled;
+    mqtt_obj["connected"] = mqtt.connected;
+    mqtt_obj["connects"] = mqtt.connects;
+    mqtt_obj["connect_failures"] = mqtt.connect_failures;
+    mqtt_obj["published"] = mqtt.published;
+    mqtt_obj["coalesced"] = mqtt.coalesced;
+    mqtt_obj["dropped"] = mqtt.dropped;
+    mqtt_obj["queued"] = mqtt.queued;
+
+    // Webhook alert delivery
+    const WebhookStats& hook = webhook_get_stats();
+    JsonObject hook_obj = doc["webhooks"].to<JsonObject>();
+    hook_obj["events"] = hook.events;
+    hook_obj["batches"] = hook.batches;
+    hook_obj["failures"] = hook.failures;
+    hook_obj["retries"] = hook.retries;
+    hook_obj["dropped_full"] = hook.dropped_full;
+    hook_obj["dropped_failed"] = hook.dropped_failed;
+    hook_obj["queued"] = hook.queued;
+    hook_obj["last_status"] = hook.last_status;
+    hook_obj["last_latency_ms"] = hook.last_latency_ms;
+    hook_obj["max_latency_ms"] = hook.max_latency_ms;
+
+    // Logging
+    const LogStats& logs = log_get_stats();
+    JsonObject log_obj = doc["log"].to<JsonObject>();
+    log_obj["written"] = logs.written;
+    log_obj["dropped"] = logs.dropped;
+    log_obj["syslog_sent"] = logs.syslog_sent;
+    log_obj["syslog_errors"] = logs.syslog_errors;
+
+    // Peer panels
+    const GossipStats& gossip = gossip_get_stats();
+    JsonObject gossip_obj = doc["gossip"].to<JsonObject>();
+    gossip_obj["enabled"] = gossip.enabled;
+    GossipPeer peers[GOSSIP_MAX_PEERS];
+    int peer_count = gossip_get_peers(peers, GOSSIP_MAX_PEERS);
+    JsonArray peer_arr = gossip_obj["peers"].to<JsonArray>();
+    for (int i = 0; i < peer_count; i++) {
+        JsonObject p = peer_arr.add<JsonObject>();
+        p["ip"] = peers[i].ip.toString();
+        p["last_seen_secs"] = (millis() - peers[i].last_seen_ms) / 1000;
+    }
+    gossip_obj["sent"] = gossip.sent;
+    gossip_obj["send_errors"] = gossip.send_errors;
+    gossip_obj["received"] = gossip.received;
+    gossip_obj["malformed"] = gossip.malformed;
+    gossip_obj["applied"] = gossip.applied;
+    gossip_obj["stale"] = gossip.stale;
+    gossip_obj["discoveries"] = gossip.discoveries;
+
+    // Flash metrics log
+    const MlogStats& mlog = mlog_get_stats();
+    JsonObject mlog_obj = doc["metrics_log"].to<JsonObject>();
+    mlog_obj["mounted"] = mlog.mounted;
+    mlog_obj["segment_seq"] = mlog.segment_seq;
+    mlog_obj["samples_logged"] = mlog.samples_logged;
+    mlog_obj["blocks_written"] = mlog.blocks_written;
+    mlog_obj["bytes_written"] = mlog.bytes_written;
+    mlog_obj["write_errors"] = mlog.write_errors;
+    mlog_obj["restored_samples"] = mlog.restored_samples;
+    mlog_obj["restored_wans"] = mlog.restored_wans;
+    mlog_obj["torn_tails"] = mlog.torn_tails;
+    mlog_obj["restore_ms"] = mlog.restore_ms;
+
+    // Persistent connection counters
+    const HttpServerStats& http = http_server_get_stats();
+    JsonObject http_obj = doc["http"].to<JsonObject>();
+    http_obj["idle_timeout_ms"] = http.idle_timeout_ms;
+    http_obj["max_requests"] = http.max_requests;
+    http_obj["connections"] = http.connections;
+    http_obj["requests"] = http.requests;
+    http_obj["reused"] = http.reused;
+    http_obj["pipelined"] = http.pipelined;
+    http_obj["idle_closed"] = http.idle_closed;
+    http_obj["max_closed"] = http.max_closed;
+    http_obj["preempted"] = http.preempted;
+
+    // Admission control counters
+    const AdmissionStats& adm = admission_get_stats();
+    JsonObject adm_obj = http_obj["admission"].to<JsonObject>();
+    adm_obj["admitted"] = adm.admitted;
+    adm_obj["priority"] = adm.priority;
+    adm_obj["rejected"] = adm.rejected;
+    adm_obj["deferred"] = adm.deferred;
+
+    send_doc(server, 200, doc);
 }
 
 // ---- Handler: GET /api/brightness ----
@@ -229,9 +532,7 @@ static void handle_brightness_get(WebServer& server) {
     doc["brightness"] = get_display_brightness();
     doc["pot_level"] = get_brightness_pot_level();
 
-    String output;
-    serializeJson(doc, output);
-    server.send(200, "application/json", output);
+    send_doc(server, 200, doc);
 }
 
 // ---- Handler: POST /api/brightness ----
@@ -244,6 +545,7 @@ static void handle_brightness_post(WebServer& server) {
     String body = server.arg("plain");
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, body);
+    route_timing_mark(TimingPhase::PARSE);
 
     if (error) {
         server.send(400, "application/json", "{\"error\":\"invalid JSON\"}");
@@ -265,9 +567,7 @@ static void handle_brightness_post(WebServer& server) {
     resp["brightness"] = get_display_brightness();
     resp["status"] = "ok";
 
-    String output;
-    serializeJson(resp, output);
-    server.send(200, "application/json", output);
+    send_doc(server, 200, resp);
 }
 
 // ---- Handler: GET /api/display-power ----
@@ -276,9 +576,7 @@ static void handle_display_power_get(WebServer& server) {
     doc["on"] = get_displays_on();
     doc["switch_position"] = get_power_switch_position();
 
-    String output;
-    serializeJson(doc, output);
-    server.send(200, "application/json", output);
+    send_doc(server, 200, doc);
 }
 
 // ---- Handler: POST /api/display-power ----
@@ -291,6 +589,7 @@ static void handle_display_power_post(WebServer& server) {
     String body = server.arg("plain");
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, body);
+    route_timing_mark(TimingPhase::PARSE);
 
     if (error) {
         server.send(400, "application/json", "{\"error\":\"invalid JSON\"}");
@@ -308,9 +607,7 @@ static void handle_display_power_post(WebServer& server) {
     resp["on"] = get_displays_on();
     resp["status"] = "ok";
 
-    String output;
-    serializeJson(resp, output);
-    server.send(200, "application/json", output);
+    send_doc(server, 200, resp);
 }
 
 // ---- Handler: GET /api/bw-source ----
@@ -318,9 +615,7 @@ static void handle_bw_source_get(WebServer& server) {
     JsonDocument doc;
     doc["source"] = bw_source_to_string(wan_metrics_get_bw_source());
 
-    String output;
-    serializeJson(doc, output);
-    server.send(200, "application/json", output);
+    send_doc(server, 200, doc);
 }
 
 // ---- Handler: POST /api/bw-source ----
@@ -333,6 +628,7 @@ static void handle_bw_source_post(WebServer& server) {
     String body = server.arg("plain");
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, body);
+    route_timing_mark(TimingPhase::PARSE);
 
     if (error) {
         server.send(400, "application/json", "{\"error\":\"invalid JSON\"}");
@@ -346,69 +642,390 @@ static void handle_bw_source_post(WebServer& server) {
     resp["source"] = bw_source_to_string(wan_metrics_get_bw_source());
     resp["status"] = "ok";
 
-    String output;
-    serializeJson(resp, output);
-    server.send(200, "application/json", output);
+    send_doc(server, 200, resp);
+}
+
+// ---- Handler: GET /api/config ----
+static void handle_config_get(WebServer& server) {
+    JsonDocument doc;
+    config_to_json(doc.to<JsonObject>());
+
+    send_doc(server, 200, doc);
+}
+
+// ---- Handler: PATCH /api/config ----
+static void handle_config_patch(WebServer& server) {
+    if (!server.hasArg("plain")) {
+        server.send(400, "application/json", "{\"error\":\"no body\"}");
+        return;
+    }
+
+    String body = server.arg("plain");
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, body);
+    route_timing_mark(TimingPhase::PARSE);
+
+    if (error || !doc.is<JsonObject>()) {
+        server.send(400, "application/json", "{\"error\":\"invalid JSON\"}");
+        return;
+    }
+
+    String field;
+    if (!config_patch(doc.as<JsonObjectConst>(), field)) {
+        JsonDocument err;
+        err["error"] = "invalid value";
+        err["field"] = field;
+        send_doc(server, 400, err);
+        return;
+    }
+
+    JsonDocument resp;
+    config_to_json(resp.to<JsonObject>());
+
+    send_doc(server, 200, resp);
+}
+
+// ---- Handler: GET /api/timing ----
+static void handle_timing_get(WebServer& server) {
+    JsonDocument doc;
+    JsonArray bounds = doc["bucket_le_us"].to<JsonArray>();
+    for (int b = 0; b < TIMING_BUCKETS - 1; b++) {
+        bounds.add(TIMING_BUCKET_US[b]);
+    }
+
+    JsonObject routes = doc["routes"].to<JsonObject>();
+    for (int r = 0; r < (int)HttpRoute::COUNT; r++) {
+        HttpRoute route = (HttpRoute)r;
+        if (route_timing_get(route, TimingPhase::TOTAL).count == 0) continue;
+
+        JsonObject route_obj = routes[http_route_name(route)].to<JsonObject>();
+        for (int p = 0; p < (int)TimingPhase::COUNT; p++) {
+            const PhaseHistogram& h = route_timing_get(route, (TimingPhase)p);
+            if (h.count == 0) continue;
+
+            JsonObject phase_obj = route_obj[timing_phase_name((TimingPhase)p)].to<JsonObject>();
+            phase_obj["count"] = h.count;
+            phase_obj["avg_us"] = (uint32_t)(h.sum_us / h.count);
+            JsonArray buckets = phase_obj["buckets"].to<JsonArray>();
+            for (int b = 0; b < TIMING_BUCKETS; b++) {
+                buckets.add(h.buckets[b]);
+            }
+        }
+    }
+
+    send_doc(server, 200, doc);
+}
+
+// ---- Handler: GET /api/log ----
+static void handle_log_get(WebServer& server) {
+    uint32_t next = log_next_seq();
+    uint32_t since = log_oldest_seq();
+    if (server.hasArg("since")) {
+        since = strtoul(server.arg("since").c_str(), nullptr, 10);
+    }
+    if (since > next) since = next;
+
+    // Entries older than the ring are gone: count them without walking them
+    uint32_t oldest = log_oldest_seq();
+    uint32_t missed = 0;
+    if (since < oldest) {
+        missed = oldest - max(since, (uint32_t)1);  // sequence numbers start at 1
+        since = oldest;
+    }
+
+    JsonDocument doc;
+    JsonArray entries = doc["entries"].to<JsonArray>();
+    LogRecord rec;
+    uint32_t seq = since;
+    for (; seq < next; seq++) {
+        if (!log_read(seq, rec)) {
+            if (seq < log_oldest_seq()) {
+                missed++;   // overwritten since the clamp (at most one ring)
+                continue;
+            }
+            break;          // still being written, resume from here
+        }
+        JsonObject e = entries.add<JsonObject>();
+        e["seq"] = rec.seq;
+        e["ms"] = rec.ms;
+        e["level"] = log_level_to_string(rec.level);
+        e["msg"] = rec.msg;
+    }
+    doc["next"] = seq;
+    doc["missed"] = missed;
+
+    send_doc(server, 200, doc);
+}
+
+// ---- Handler: GET /api/events ----
+static void handle_events_get(WebServer& server) {
+    uint32_t next = events_next_seq();
+    uint32_t since = events_oldest_seq();
+    if (server.hasArg("since")) {
+        since = strtoul(server.arg("since").c_str(), nullptr, 10);
+    }
+    if (since > next) since = next;
+
+    // Events older than the journal are gone: count them without walking them
+    uint32_t oldest = events_oldest_seq();
+    uint32_t missed = 0;
+    if (since < oldest) {
+        missed = oldest - max(since, (uint32_t)1);  // sequence numbers start at 1
+        since = oldest;
+    }
+
+    JsonDocument doc;
+    JsonArray events = doc["events"].to<JsonArray>();
+    WanEvent e;
+    for (uint32_t seq = since; seq < next; seq++) {
+        if (!events_read(seq, e)) continue;  // journaled from loop(), so not expected
+        JsonObject o = events.add<JsonObject>();
+        o["seq"] = e.seq;
+        o["t"] = e.t_s;
+        o["source"] = events_source_name(e);
+        o["from"] = wan_state_to_string(e.from);
+        o["to"] = wan_state_to_string(e.to);
+        o["duration_s"] = e.duration_s;
+        o["latency_ms"] = e.latency_ms;
+        o["jitter_ms"] = e.jitter_ms;
+        o["loss_pct"] = e.loss_pct;
+        if (e.source != LOCAL_PINGER_ID) {
+            o["down_mbps"] = e.down_mbps;
+            o["up_mbps"] = e.up_mbps;
+        }
+    }
+    doc["next"] = next;
+    doc["missed"] = missed;
+    doc["now_s"] = history_now_s();
+
+    send_doc(server, 200, doc);
+}
+
+// ---- Handler: GET /api/history ----
+// Streamed with chunked encoding through a fixed buffer: NDJSON by default,
+// or the raw 44-byte buckets after a 12-byte header when the client asks for
+// application/octet-stream.
+static const size_t HISTORY_CHUNK_BYTES = 1024;
+static const size_t HISTORY_LINE_BYTES = 192;
+
+struct HistoryWriter {
+    WebServer* server;
+    bool binary;
+    char buf[HISTORY_CHUNK_BYTES];
+    size_t len;
+};
+
+static void history_flush(HistoryWriter& w) {
+    if (w.len > 0) {
+        w.server->sendContent(w.buf, w.len);
+        w.len = 0;
+    }
+}
+
+static void history_write_bucket(const HistoryBucket& b, void* ctx) {
+    HistoryWriter& w = *(HistoryWriter*)ctx;
+    size_t need = w.binary ? sizeof(b) : HISTORY_LINE_BYTES;
+    if (w.len + need > sizeof(w.buf)) history_flush(w);
+
+    if (w.binary) {
+        memcpy(w.buf + w.len, &b, sizeof(b));
+        w.len += sizeof(b);
+        return;
+    }
+    float n = b.samples;
+    int len = snprintf(w.buf + w.len, sizeof(w.buf) - w.len,
+        "{\"t\":%u,\"n\":%u,\"latency_ms\":[%u,%.1f,%u],\"jitter_ms\":[%u,%.1f,%u],"
+        "\"loss_pct\":[%u,%.1f,%u],\"down_mbps\":[%.1f,%.1f,%.1f],\"up_mbps\":[%.1f,%.1f,%.1f]}\n",
+        b.start_s, b.samples,
+        b.latency_min, b.latency_sum / n, b.latency_max,
+        b.jitter_min, b.jitter_sum / n, b.jitter_max,
+        b.loss_min, b.loss_sum / n, b.loss_max,
+        b.down_min / 10.0f, b.down_sum / n / 10.0f, b.down_max / 10.0f,
+        b.up_min / 10.0f, b.up_sum / n / 10.0f, b.up_max / 10.0f);
+    if (len > 0) w.len += min((size_t)len, sizeof(w.buf) - w.len - 1);
+}
+
+static void handle_history_get(WebServer& server) {
+    String name = server.hasArg("source") ? server.arg("source") : String("local");
+    int source = (name == "local") ? LOCAL_PINGER_ID : wan_metrics_find(name.c_str());
+    if (source != LOCAL_PINGER_ID && (source == 0 || source > HISTORY_MAX_WANS)) {
+        server.send(404, "application/json", "{\"error\":\"unknown source\"}");
+        return;
+    }
+
+    HistoryRes res = HistoryRes::M1;
+    if (server.hasArg("res") && !history_res_from_string(server.arg("res").c_str(), res)) {
+        server.send(400, "application/json", "{\"error\":\"res must be 15s, 1m, 15m or 1h\"}");
+        return;
+    }
+    uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+
+    static HistoryWriter w;
+    w.server = &server;
+    w.binary = server.header("Accept").indexOf("application/octet-stream") >= 0;
+    w.len = 0;
+    uint32_t period = HISTORY_PERIOD_S[(int)res];
+    uint32_t now = history_now_s();
+
+    route_timing_mark(TimingPhase::HANDLER);
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    if (w.binary) {
+        server.send(200, "application/octet-stream", "");
+        // Header: "WH", format 1, resolution, period_s, now_s (little-endian)
+        uint8_t header[12] = { 'W', 'H', 1, (uint8_t)res };
+        memcpy(header + 4, &period, 4);
+        memcpy(header + 8, &now, 4);
+        memcpy(w.buf, header, sizeof(header));
+        w.len = sizeof(header);
+    } else {
+        server.send(200, "application/x-ndjson", "");
+        w.len = snprintf(w.buf, sizeof(w.buf),
+            "{\"source\":\"%s\",\"res\":\"%s\",\"period_s\":%u,\"now_s\":%u}\n",
+            name.c_str(), history_res_to_string(res), period, now);
+    }
+
+    history_visit(source, res, since, history_write_bucket, &w);
+    history_flush(w);
+    server.sendContent("");  // terminating chunk
+}
+
+// ---- Request counters (exported by /metrics) ----
+static const char* ROUTE_NAMES[] = {
+    "root", "status", "wans", "brightness", "display_power",
+    "bw_source", "config", "timing", "metrics", "log", "history", "events", "favicon", "static"
+};
+static uint32_t g_route_requests[(int)HttpRoute::COUNT];
+
+static void count_request(HttpRoute route) {
+    g_route_requests[(int)route]++;
+    route_timing_route(route);
+}
+
+const char* http_route_name(HttpRoute route) {
+    return ROUTE_NAMES[(int)route];
+}
+
+uint32_t http_route_requests(HttpRoute route) {
+    return g_route_requests[(int)route];
 }
 
-// ---- Public: wire up all routes ----
 void setup_routes(WebServer& server) {
     // Initialize LittleFS
     if (!LittleFS.begin()) {
-        Serial.println("An error occurred while mounting LittleFS");
+        LOG_ERROR("An error occurred while mounting LittleFS");
         return;
     }
 
+    // Headers needed for content negotiation and keep-alive (HttpServer)
+    static const char* HEADER_KEYS[] = { "Content-Type", "Accept", "Connection" };
+    server.collectHeaders(HEADER_KEYS, sizeof(HEADER_KEYS) / sizeof(HEADER_KEYS[0]));
+
     // Root: status page
     server.on("/", HTTP_GET, [&server]() {
+        count_request(HttpRoute::ROOT);
         handle_file_read(server, "/index.html");
     });
 
     // JSON API endpoints
     server.on("/api/status", HTTP_GET, [&server]() {
+        count_request(HttpRoute::STATUS);
         handle_status_get(server);
     });
     server.on("/api/wans", HTTP_POST, [&server]() {
+        count_request(HttpRoute::WANS);
         handle_wans_post(server);
+    }, [&server]() {
+        handle_body_raw(server);
+    });
+    server.on(UriBraces("/api/wans/{}"), HTTP_DELETE, [&server]() {
+        count_request(HttpRoute::WANS);
+        handle_wans_delete(server);
     });
     server.on("/api/brightness", HTTP_GET, [&server]() {
+        count_request(HttpRoute::BRIGHTNESS);
         handle_brightness_get(server);
     });
     server.on("/api/brightness", HTTP_POST, [&server]() {
+        count_request(HttpRoute::BRIGHTNESS);
         handle_brightness_post(server);
     });
     server.on("/api/display-power", HTTP_GET, [&server]() {
+        count_request(HttpRoute::DISPLAY_POWER);
         handle_display_power_get(server);
     });
     server.on("/api/display-power", HTTP_POST, [&server]() {
+        count_request(HttpRoute::DISPLAY_POWER);
         handle_display_power_post(server);
     });
     server.on("/api/bw-source", HTTP_GET, [&server]() {
+        count_request(HttpRoute::BW_SOURCE);
         handle_bw_source_get(server);
     });
     server.on("/api/bw-source", HTTP_POST, [&server]() {
+        count_request(HttpRoute::BW_SOURCE);
         handle_bw_source_post(server);
     });
 
+    server.on("/api/timing", HTTP_GET, [&server]() {
+        count_request(HttpRoute::TIMING);
+        handle_timing_get(server);
+    });
+
+    server.on("/api/log", HTTP_GET, [&server]() {
+        count_request(HttpRoute::LOG);
+        handle_log_get(server);
+    });
+
+    server.on("/api/history", HTTP_GET, [&server]() {
+        count_request(HttpRoute::HISTORY);
+        handle_history_get(server);
+    });
+
+    server.on("/api/events", HTTP_GET, [&server]() {
+        count_request(HttpRoute::EVENTS);
+        handle_events_get(server);
+    });
+
+    // Prometheus text exposition
+    server.on("/metrics", HTTP_GET, [&server]() {
+        count_request(HttpRoute::METRICS);
+        metrics_export(server);
+    });
+
+    server.on("/api/config", HTTP_GET, [&server]() {
+        count_request(HttpRoute::CONFIG);
+        handle_config_get(server);
+    });
+    server.on("/api/config", HTTP_PATCH, [&server]() {
+        count_request(HttpRoute::CONFIG);
+        handle_config_patch(server);
+    });
+
     // Favicons (still served from memory for speed)
     server.on("/favicon-green.svg", [&server]() {
+        count_request(HttpRoute::FAVICON);
         server.send(200, "image/svg+xml", FAVICON_GREEN);
     });
     server.on("/favicon-yellow.svg", [&server]() {
+        count_request(HttpRoute::FAVICON);
         server.send(200, "image/svg+xml", FAVICON_YELLOW);
     });
     server.on("/favicon-red.svg", [&server]() {
+        count_request(HttpRoute::FAVICON);
         server.send(200, "image/svg+xml", FAVICON_RED);
     });
     server.on("/favicon.svg", [&server]() {
+        count_request(HttpRoute::FAVICON);
         server.send(200, "image/svg+xml", FAVICON_GREEN);  // Default to green
     });
     server.on("/favicon.ico", [&server]() {
+        count_request(HttpRoute::FAVICON);
         server.send(204);
     });
 
     // Fallback for all other requests
     server.onNotFound([&server]() {
+        count_request(HttpRoute::STATIC);
         handle_not_found(server);
     });
 }
@@ -5,3 +5,14 @@
 
 // Register all HTTP routes on the given server
 void setup_routes(WebServer& server);
+
+// Route groups for request accounting
+enum class HttpRoute : uint8_t {
+    ROOT, STATUS, WANS, BRIGHTNESS, DISPLAY_POWER,
+    BW_SOURCE, CONFIG, TIMING, METRICS, LOG, HISTORY, EVENTS, FAVICON, STATIC,
+    COUNT
+};
+
+// Request counters by route group
+const char* http_route_name(HttpRoute route);
+uint32_t http_route_requests(HttpRoute route);
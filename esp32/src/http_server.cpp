@@ -0,0 +1,234 @@
+// http_server.cpp
+#include "http_server.h"
+#include <string.h>
+#include "admission.h"
+#include "route_timing.h"
+
+static HttpServerStats g_stats;
+
+// Header line WebServer::_prepareHeader() always emits
+static const char CLOSE_HEADER[] = "\r\nConnection: close\r\n";
+
+// Find needle in a length-bounded buffer (returns nullptr if absent)
+static const char* find_bytes(const char* buf, size_t len, const char* needle) {
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (memcmp(buf + i, needle, n) == 0) return buf + i;
+    }
+    return nullptr;
+}
+
+HttpServer::HttpServer(int port)
+    : WebServer(port)
+    , _idle_timeout_ms(HTTP_KEEPALIVE_IDLE_MS)
+    , _max_requests(HTTP_KEEPALIVE_MAX_REQUESTS)
+    , _conn_requests(0)
+    , _keep_alive(false)
+    , _header_pending(false)
+    , _priority(false)
+    , _deferred(false)
+{
+    g_stats.idle_timeout_ms = _idle_timeout_ms;
+    g_stats.max_requests = _max_requests;
+}
+
+void HttpServer::setKeepAlive(unsigned long idle_timeout_ms, uint16_t max_requests) {
+    _idle_timeout_ms = idle_timeout_ms;
+    _max_requests = max_requests;
+    g_stats.idle_timeout_ms = idle_timeout_ms;
+    g_stats.max_requests = max_requests;
+}
+
+bool HttpServer::wantsKeepAlive() {
+    if (_max_requests == 0) return false;
+    if (_conn_requests + 1 >= _max_requests) {
+        g_stats.max_closed++;
+        return false;
+    }
+
+    String connection = header("Connection");
+    if (connection.equalsIgnoreCase("close")) return false;
+    if (_currentVersion == 0) {
+        // HTTP/1.0 defaults to close
+        return connection.equalsIgnoreCase("keep-alive");
+    }
+    return true;
+}
+
+size_t HttpServer::writeHeader(const char* b, size_t l) {
+    const char* close_at = find_bytes(b, l, CLOSE_HEADER);
+    if (close_at == nullptr) {
+        _keep_alive = false;
+        return _currentClient.write(b, l);
+    }
+
+    // A body without a length (HTTP/1.0 with unknown size) is delimited by
+    // closing the connection, so keep-alive is off for it.
+    bool delimited = find_bytes(b, l, "\r\nContent-Length: ") != nullptr ||
+                     find_bytes(b, l, "\r\nTransfer-Encoding: chunked\r\n") != nullptr;
+    if (!delimited) {
+        _keep_alive = false;
+    }
+
+    // Replacement for the Connection line, plus Server-Timing
+    char extra[200];
+    int n;
+    if (_keep_alive) {
+        n = snprintf(extra, sizeof(extra),
+                     "\r\nConnection: keep-alive\r\nKeep-Alive: timeout=%lu, max=%u\r\n",
+                     _idle_timeout_ms / 1000, (unsigned)(_max_requests - _conn_requests));
+    } else {
+        n = snprintf(extra, sizeof(extra), "%s", CLOSE_HEADER);
+    }
+    size_t timing = route_timing_header(extra + n, sizeof(extra) - n - 2);
+    if (timing > 0) {
+        n += timing;
+        extra[n++] = '\r';
+        extra[n++] = '\n';
+    }
+
+    size_t head = close_at - b;
+    size_t tail_at = head + strlen(CLOSE_HEADER);
+    size_t written = _currentClient.write(b, head);
+    written += _currentClient.write(extra, n);
+    written += _currentClient.write(b + tail_at, l - tail_at);
+    return (written == head + n + (l - tail_at)) ? l : 0;
+}
+
+size_t HttpServer::_currentClientWrite(const char* b, size_t l) {
+    // The first write of every response is the complete header block
+    if (_header_pending && l >= 7 && memcmp(b, "HTTP/1.", 7) == 0) {
+        _header_pending = false;
+        return writeHeader(b, l);
+    }
+    return _currentClient.write(b, l);
+}
+
+void HttpServer::sendRateLimited() {
+    // Close afterwards so a flooding client cannot hold the only slot
+    _keep_alive = false;
+    sendHeader("Retry-After", "1");
+    send(429, "application/json", "{\"error\":\"rate limited\"}");
+}
+
+void HttpServer::closeClient() {
+    _currentClient = WiFiClient();
+    _currentStatus = HC_NONE;
+    _currentUpload.reset();
+    _currentRaw.reset();
+    _conn_requests = 0;
+    g_stats.open_requests = 0;
+}
+
+void HttpServer::handleClient() {
+    if (_currentStatus == HC_NONE) {
+        WiFiClient client = _server.available();
+        if (!client) {
+            if (_nullDelay) {
+                delay(1);
+            }
+            return;
+        }
+        _currentClient = client;
+        _currentStatus = HC_WAIT_READ;
+        _statusChange = millis();
+        _conn_requests = 0;
+        _client_ip = client.remoteIP();
+        _priority = admission_is_priority(_client_ip);
+        _deferred = false;
+        g_stats.connections++;
+    }
+
+    bool keep_client = false;
+    bool call_yield = false;
+
+    if (_currentClient.connected() || _currentClient.available()) {
+        switch (_currentStatus) {
+            case HC_NONE:
+                break;
+
+            case HC_WAIT_READ:
+                if (_currentClient.available()) {
+                    // Global budget spent: leave the request in the socket
+                    // until the next period (router requests are exempt)
+                    if (!_priority && !admission_take_budget()) {
+                        if (!_deferred) {
+                            _deferred = true;
+                            admission_note_deferred();
+                        }
+                        keep_client = true;
+                        call_yield = true;
+                        break;
+                    }
+                    _deferred = false;
+
+                    // One request per call; pipelined requests stay buffered
+                    // in the socket and are served on the next pass, in order.
+                    route_timing_begin();
+                    if (!_parseRequest(_currentClient)) break;
+                    route_timing_mark(TimingPhase::READ);
+
+                    _keep_alive = wantsKeepAlive();
+                    _conn_requests++;
+                    g_stats.requests++;
+                    g_stats.open_requests = _conn_requests;
+                    if (_conn_requests > 1) g_stats.reused++;
+
+                    _currentClient.setTimeout(HTTP_MAX_SEND_WAIT / 1000);
+                    _contentLength = CONTENT_LENGTH_NOT_SET;
+                    _header_pending = true;
+                    if (_priority) {
+                        admission_note_priority();
+                        _handleRequest();
+                    } else if (admission_take_client(_client_ip)) {
+                        _handleRequest();
+                    } else {
+                        sendRateLimited();
+                    }
+                    _header_pending = false;
+                    route_timing_end();
+
+                    if (!_currentClient.connected()) break;
+
+                    _currentStatus = _keep_alive ? HC_WAIT_READ : HC_WAIT_CLOSE;
+                    _statusChange = millis();
+                    keep_client = true;
+                    if (_keep_alive && _currentClient.available()) {
+                        g_stats.pipelined++;
+                    }
+                } else if (_conn_requests > 0 && _server.hasClient()) {
+                    // Idle persistent connection: make room for the waiting client
+                    g_stats.preempted++;
+                } else {
+                    unsigned long limit = (_conn_requests == 0) ? HTTP_MAX_DATA_WAIT : _idle_timeout_ms;
+                    if (millis() - _statusChange <= limit) {
+                        keep_client = true;
+                    } else if (_conn_requests > 0) {
+                        g_stats.idle_closed++;
+                    }
+                    call_yield = true;
+                }
+                break;
+
+            case HC_WAIT_CLOSE:
+                // Response said "Connection: close"; wait for the client to hang up
+                if (millis() - _statusChange <= HTTP_MAX_CLOSE_WAIT) {
+                    keep_client = true;
+                    call_yield = true;
+                }
+                break;
+        }
+    }
+
+    if (!keep_client) {
+        closeClient();
+    }
+
+    if (call_yield) {
+        yield();
+    }
+}
+
+const HttpServerStats& http_server_get_stats() {
+    return g_stats;
+}
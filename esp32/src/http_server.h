@@ -0,0 +1,77 @@
+// http_server.h
+// WebServer with HTTP/1.1 persistent connections
+//
+// The stock WebServer answers every request with "Connection: close" and
+// drops the socket. HttpServer keeps the connection open between requests
+// (HTTP/1.1 by default, HTTP/1.0 only on "Connection: keep-alive") and
+// serves pipelined requests from the same socket in order. Requests pass
+// admission control (admission.h) before a handler runs.
+//
+// WebServer handles one client at a time, so an idle persistent connection
+// is dropped as soon as another client is waiting to be accepted.
+//
+// Only clients that keep their socket gain: the Web UI and other pollers.
+// The pfSense daemon's http transport starts a new curl per POST, so each
+// report is still a new connection (its stream transport is the
+// persistent option).
+#pragma once
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+// Defaults (override with setKeepAlive())
+static const unsigned long HTTP_KEEPALIVE_IDLE_MS = 5000;  // idle time before closing
+static const uint16_t HTTP_KEEPALIVE_MAX_REQUESTS = 100;   // requests per connection (0 = no keep-alive)
+
+struct HttpServerStats {
+    uint32_t connections;     // TCP connections accepted
+    uint32_t requests;        // requests handled
+    uint32_t reused;          // requests served on an already-used connection
+    uint32_t pipelined;       // requests already buffered when the previous response finished
+    uint32_t idle_closed;     // persistent connections closed by the idle timeout
+    uint32_t max_closed;      // connections closed after the per-connection request limit
+    uint32_t preempted;       // idle persistent connections dropped for a waiting client
+    uint16_t open_requests;   // requests served on the current connection
+    unsigned long idle_timeout_ms;
+    uint16_t max_requests;
+};
+
+class HttpServer : public WebServer {
+public:
+    explicit HttpServer(int port = 80);
+
+    // Configure persistent connections
+    void setKeepAlive(unsigned long idle_timeout_ms, uint16_t max_requests);
+
+    // Process the current connection or accept a new one (call from loop())
+    void handleClient() override;
+
+protected:
+    // Rewrites the Connection header of each response on its way out
+    size_t _currentClientWrite(const char* b, size_t l) override;
+
+private:
+    unsigned long _idle_timeout_ms;
+    uint16_t _max_requests;
+    uint16_t _conn_requests;    // requests served on the current connection
+    bool _keep_alive;           // current response keeps the connection open
+    bool _header_pending;       // next write is the response header
+    IPAddress _client_ip;
+    bool _priority;             // router connection: exempt from admission control
+    bool _deferred;             // current request is waiting for budget
+
+    // Decide whether the connection survives the current request
+    bool wantsKeepAlive();
+
+    // Write the response header with the Connection header rewritten
+    size_t writeHeader(const char* b, size_t l);
+
+    // Answer 429 without running a handler (admission control)
+    void sendRateLimited();
+
+    // Release the current client
+    void closeClient();
+};
+
+// Counters for the server instance
+const HttpServerStats& http_server_get_stats();
@@ -0,0 +1,71 @@
+// ingest_key.cpp
+#include "ingest_key.h"
+#include <LittleFS.h>
+#include "mbedtls/md.h"
+
+static uint8_t g_key[64];
+static size_t g_key_len = 0;
+static bool g_loaded = false;
+
+bool ingest_key_load() {
+    if (g_loaded) return g_key_len > 0;
+    g_loaded = true;
+
+    if (!LittleFS.exists(INGEST_KEY_PATH)) return false;
+    File f = LittleFS.open(INGEST_KEY_PATH, "r");
+    if (!f) return false;
+    String key = f.readString();
+    f.close();
+    key.trim();
+
+    g_key_len = min((size_t)key.length(), sizeof(g_key));
+    memcpy(g_key, key.c_str(), g_key_len);
+    return g_key_len > 0;
+}
+
+bool ingest_key_present() {
+    return g_key_len > 0;
+}
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ingest_mac_parse(const char* hex, size_t hex_len, uint8_t* out) {
+    if (hex_len != INGEST_MAC_BYTES * 2) return false;
+    for (size_t i = 0; i < INGEST_MAC_BYTES; i++) {
+        int hi = hex_nibble(hex[2 * i]);
+        int lo = hex_nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+bool ingest_mac_matches(const uint8_t* head, size_t head_len,
+                        const uint8_t* tail, size_t tail_len,
+                        const uint8_t* expected) {
+    if (g_key_len == 0) return false;
+
+    uint8_t digest[32];
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    bool ok = mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) == 0 &&
+              mbedtls_md_hmac_starts(&ctx, g_key, g_key_len) == 0 &&
+              mbedtls_md_hmac_update(&ctx, head, head_len) == 0 &&
+              mbedtls_md_hmac_update(&ctx, (const uint8_t*)"\n", 1) == 0 &&
+              mbedtls_md_hmac_update(&ctx, tail, tail_len) == 0 &&
+              mbedtls_md_hmac_finish(&ctx, digest) == 0;
+    mbedtls_md_free(&ctx);
+    if (!ok) return false;
+
+    // Constant-time compare
+    uint8_t diff = 0;
+    for (size_t i = 0; i < INGEST_MAC_BYTES; i++) {
+        diff |= digest[i] ^ expected[i];
+    }
+    return diff == 0;
+}
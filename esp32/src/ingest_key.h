@@ -0,0 +1,27 @@
+// ingest_key.h
+// Shared secret of the push transports: signed UDP datagrams and the
+// stream ingest handshake
+//
+// The key is a line of text in /ingest.key on LittleFS, the same secret the
+// daemon keeps on the router. Both transports send the first
+// INGEST_MAC_BYTES of HMAC-SHA256(key, "<head>\n<tail>") as hex.
+#pragma once
+
+#include <Arduino.h>
+
+constexpr const char* INGEST_KEY_PATH = "/ingest.key";
+static const size_t INGEST_MAC_BYTES = 16;
+
+// Read the key (call after LittleFS is mounted; later calls return the
+// first result). False when no key is installed.
+bool ingest_key_load();
+
+bool ingest_key_present();
+
+// Decode a MAC sent as 2 * INGEST_MAC_BYTES hex chars
+bool ingest_mac_parse(const char* hex, size_t hex_len, uint8_t* out);
+
+// Compare a MAC against HMAC(key, "<head>\n<tail>") in constant time
+bool ingest_mac_matches(const uint8_t* head, size_t head_len,
+                        const uint8_t* tail, size_t tail_len,
+                        const uint8_t* expected);
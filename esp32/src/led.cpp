@@ -1,6 +1,8 @@
 // led.cpp
 #include "led.h"
 
+static uint32_t g_mcp_transfers = 0;
+
 Led::Led(uint8_t pin, LedPinType type, Adafruit_MCP23X17* mcp)
     : _pin(pin), _type(type), _mcp(mcp) {}
 
@@ -17,6 +19,7 @@ void Led::begin() {
 void Led::set(bool on) {
     if (_type == LedPinType::MCP && _mcp) {
         _mcp->digitalWrite(_pin, on ? HIGH : LOW);
+        g_mcp_transfers++;
     } else {
         digitalWrite(_pin, on ? HIGH : LOW);
     }
@@ -24,8 +27,13 @@ void Led::set(bool on) {
 
 bool Led::state() const {
     if (_type == LedPinType::MCP && _mcp) {
+        g_mcp_transfers++;
         return _mcp->digitalRead(_pin) == HIGH;
     } else {
         return digitalRead(_pin) == HIGH;
     }
 }
+
+uint32_t Led::mcpTransferCount() {
+    return g_mcp_transfers;
+}
@@ -17,6 +17,9 @@ public:
     uint8_t pin() const { return _pin; }
     LedPinType type() const { return _type; }
 
+    // Total MCP23017 pin writes/reads across all LEDs (each is an I2C transaction)
+    static uint32_t mcpTransferCount();
+
 private:
     uint8_t _pin;
     LedPinType _type;
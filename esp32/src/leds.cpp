@@ -4,6 +4,8 @@
 #include <Adafruit_MCP23X17.h>
 #include <Adafruit_LEDBackpack.h>
 #include "leds.h"
+#include "wan_freshness.h"
+#include "logger.h"
 
 // I2C pins for Olimex ESP32-POE-ISO
 static const int I2C_SDA = 13;
@@ -25,13 +27,16 @@ ButtonHandler g_button_handler_bandwidth;
 FreshnessBar g_freshness_bar;
 static bool g_use_display_manager = false;
 
-// MCP-based bicolor LEDs - WAN1 (pins 0-1)
-Led g_led_wan1_green(0, LedPinType::MCP, &g_mcp);
-Led g_led_wan1_red(1, LedPinType::MCP, &g_mcp);
-
-// MCP-based bicolor LEDs - WAN2 (pins 2-3)
-Led g_led_wan2_green(2, LedPinType::MCP, &g_mcp);
-Led g_led_wan2_red(3, LedPinType::MCP, &g_mcp);
+// MCP-based bicolor LEDs, one pair per WAN table position:
+// WAN1 (pins 0-1), WAN2 (pins 2-3), WAN3 (pins 8-9), WAN4 (pins 10-11)
+Led g_led_wan_green[WAN_LED_COUNT] = {
+    Led(0, LedPinType::MCP, &g_mcp), Led(2, LedPinType::MCP, &g_mcp),
+    Led(8, LedPinType::MCP, &g_mcp), Led(10, LedPinType::MCP, &g_mcp),
+};
+Led g_led_wan_red[WAN_LED_COUNT] = {
+    Led(1, LedPinType::MCP, &g_mcp), Led(3, LedPinType::MCP, &g_mcp),
+    Led(9, LedPinType::MCP, &g_mcp), Led(11, LedPinType::MCP, &g_mcp),
+};
 
 // MCP-based bicolor LEDs - Local pinger (pins 4-5)
 Led g_led_local_green(4, LedPinType::MCP, &g_mcp);
@@ -40,8 +45,8 @@ Led g_led_local_red(5, LedPinType::MCP, &g_mcp);
 // MCP-based status LED (Ethernet indicator)
 Led g_led_status1(7, LedPinType::MCP, &g_mcp);
 
-// Router timeout tracking (monitors pfSense daemon connection)
-static bool g_router_timed_out = false;
+// Per-WAN report timeout tracking (for logging the transitions once)
+static bool g_wan_timed_out[WAN_LED_COUNT];
 
 // Global brightness level (0-15, where 0 = off)
 static uint8_t g_brightness = 8;
@@ -90,50 +95,29 @@ static void on_bandwidth_long_press() {
     g_display_manager.toggleBandwidthAutoCycle();
 }
 
-void wan1_set_leds(WanState state) {
-    if (!g_displays_on) return;  // All LEDs off when displays disabled
-    switch (state) {
-        case WanState::UP:
-            g_led_wan1_green.set(true);
-            g_led_wan1_red.set(false);
-            Serial.println("WAN1 LED -> GREEN (UP)");
-            break;
-
-        case WanState::DEGRADED:
-            g_led_wan1_green.set(true);
-            g_led_wan1_red.set(true);  // Both on = yellow/amber
-            Serial.println("WAN1 LED -> YELLOW (DEGRADED)");
-            break;
-
-        case WanState::DOWN:
-        default:
-            g_led_wan1_green.set(false);
-            g_led_wan1_red.set(true);
-            Serial.println("WAN1 LED -> RED (DOWN)");
-            break;
-    }
-}
-
-void wan2_set_leds(WanState state) {
+void wan_set_leds(int wan_id, WanState state) {
     if (!g_displays_on) return;  // All LEDs off when displays disabled
+    if (wan_id < 1 || wan_id > WAN_LED_COUNT) return;  // no indicator for this WAN
+    Led& green = g_led_wan_green[wan_id - 1];
+    Led& red = g_led_wan_red[wan_id - 1];
     switch (state) {
         case WanState::UP:
-            g_led_wan2_green.set(true);
-            g_led_wan2_red.set(false);
-            Serial.println("WAN2 LED -> GREEN (UP)");
+            green.set(true);
+            red.set(false);
+            LOG_DEBUG("WAN%d LED -> GREEN (UP)", wan_id);
             break;
 
         case WanState::DEGRADED:
-            g_led_wan2_green.set(true);
-            g_led_wan2_red.set(true);  // Both on = yellow/amber
-            Serial.println("WAN2 LED -> YELLOW (DEGRADED)");
+            green.set(true);
+            red.set(true);  // Both on = yellow/amber
+            LOG_DEBUG("WAN%d LED -> YELLOW (DEGRADED)", wan_id);
             break;
 
         case WanState::DOWN:
         default:
-            g_led_wan2_green.set(false);
-            g_led_wan2_red.set(true);
-            Serial.println("WAN2 LED -> RED (DOWN)");
+            green.set(false);
+            red.set(true);
+            LOG_DEBUG("WAN%d LED -> RED (DOWN)", wan_id);
             break;
     }
 }
@@ -161,19 +145,16 @@ void local_pinger_set_leds(WanState state) {
 
 // Helper to turn off all WAN LEDs (used during blink-off phase)
 static void wan_leds_all_off() {
-    g_led_wan1_green.set(false);
-    g_led_wan1_red.set(false);
-    g_led_wan2_green.set(false);
-    g_led_wan2_red.set(false);
+    for (int i = 0; i < WAN_LED_COUNT; i++) {
+        g_led_wan_green[i].set(false);
+        g_led_wan_red[i].set(false);
+    }
 }
 
 // Helper to turn off ALL indicator LEDs (used when displays are disabled)
 // Note: Status LED is managed separately by loop() based on Ethernet state
 static void all_leds_off() {
-    g_led_wan1_green.set(false);
-    g_led_wan1_red.set(false);
-    g_led_wan2_green.set(false);
-    g_led_wan2_red.set(false);
+    wan_leds_all_off();
     g_led_local_green.set(false);
     g_led_local_red.set(false);
 }
@@ -181,53 +162,59 @@ static void all_leds_off() {
 void router_heartbeat_check() {
     if (!g_displays_on) return;  // Skip when displays disabled
 
-    const WanMetrics& m = wan_metrics_get(1);
-    bool is_stale = false;
-
-    if (m.last_update_ms == 0) {
-        // Never received an update - treat as stale
-        is_stale = true;
-    } else {
-        unsigned long elapsed = millis() - m.last_update_ms;
-        is_stale = (elapsed > FRESHNESS_RED_BUFFER_END_MS);
-    }
+    // Blink with the freshness bar while it blinks (every WAN stale), else
+    // on the same period by the clock
+    bool blink_on = g_freshness_bar.isBlinking()
+        ? g_freshness_bar.isBlinkOn()
+        : (millis() / FRESHNESS_BLINK_INTERVAL_MS) % 2 == 0;
+
+    for (int id = 1; id <= min(wan_metrics_count(), WAN_LED_COUNT); id++) {
+        bool& timed_out = g_wan_timed_out[id - 1];
+        if (!wan_is_stale(id)) {
+            // Fresh again: the report that ended the timeout set the LEDs
+            if (timed_out) LOG_INFO("WAN %s reporting again", wan_metrics_key(id));
+            timed_out = false;
+            continue;
+        }
 
-    if (is_stale) {
         // Log once when entering stale state
-        if (!g_router_timed_out) {
-            g_router_timed_out = true;
-            Serial.println("Router timeout -> blinking WANs DOWN");
+        if (!timed_out) {
+            timed_out = true;
+            LOG_INFO("WAN %s report timeout -> blinking DOWN", wan_metrics_key(id));
         }
 
-        // Sync WAN LED blinking with freshness bar
-        if (g_freshness_bar.isBlinkOn()) {
-            // Blink on: show DOWN state (red only)
-            g_led_wan1_green.set(false);
-            g_led_wan1_red.set(true);
-            g_led_wan2_green.set(false);
-            g_led_wan2_red.set(true);
+        // Blink on: DOWN (red only); blink off: dark
+        g_led_wan_green[id - 1].set(false);
+        g_led_wan_red[id - 1].set(blink_on);
+    }
+}
+
+// The WAN that moves into a forgotten WAN's position takes over its LEDs
+static void on_forget(int wan_id) {
+    wan_id_erase(g_wan_timed_out, wan_id - 1);
+    if (!g_displays_on) return;
+    for (int pos = wan_id; pos <= WAN_LED_COUNT; pos++) {
+        if (pos < wan_metrics_count()) {
+            wan_set_leds(pos, wan_metrics_get(pos + 1).state);
         } else {
-            // Blink off: all LEDs off
-            wan_leds_all_off();
+            g_led_wan_green[pos - 1].set(false);
+            g_led_wan_red[pos - 1].set(false);
         }
-    } else {
-        // Reset timeout flag when we have fresh data
-        g_router_timed_out = false;
     }
 }
 
 void freshness_bar_update() {
     if (!g_freshness_bar.isReady()) return;
 
-    const WanMetrics& m = wan_metrics_get(1);
-
-    if (m.last_update_ms == 0) {
+    // The router feed as a whole: the most recent report of any WAN
+    unsigned long updated = wan_freshest_update_ms();
+    if (updated == 0) {
         // Never received an update
         g_freshness_bar.update(0, true);
         return;
     }
 
-    unsigned long elapsed = millis() - m.last_update_ms;
+    unsigned long elapsed = millis() - updated;
     g_freshness_bar.update(elapsed, false);
 }
 
@@ -236,9 +223,9 @@ void leds_init() {
     Wire.begin(I2C_SDA, I2C_SCL);
 
     if (!g_mcp.begin_I2C(MCP23017_ADDR, &Wire)) {
-        Serial.println("ERROR: MCP23017 not found!");
+        LOG_ERROR("MCP23017 not found!");
     } else {
-        Serial.println("MCP23017 initialized");
+        LOG_INFO("MCP23017 initialized");
         // Immediately clear all 16 MCP pins
         for (int i = 0; i < 16; i++) {
             g_mcp.pinMode(i, OUTPUT);
@@ -248,10 +235,10 @@ void leds_init() {
 
     // Initialize 7-segment display
     if (!g_display.begin(DISPLAY_ADDR, &Wire)) {
-        Serial.println("ERROR: 7-segment display not found!");
+        LOG_ERROR("7-segment display not found!");
         g_display_ok = false;
     } else {
-        Serial.println("7-segment display initialized");
+        LOG_INFO("7-segment display initialized");
         g_display_ok = true;
         g_display.clear();
         g_display.writeDisplay();
@@ -259,16 +246,17 @@ void leds_init() {
     }
 
     // Initialize all LEDs (bicolor: green/red pairs)
-    g_led_wan1_green.begin();
-    g_led_wan1_red.begin();
-    g_led_wan2_green.begin();
-    g_led_wan2_red.begin();
+    for (int i = 0; i < WAN_LED_COUNT; i++) {
+        g_led_wan_green[i].begin();
+        g_led_wan_red[i].begin();
+    }
     g_led_local_green.begin();
     g_led_local_red.begin();
     g_led_status1.begin();
 
     // Reset timeout state
-    g_router_timed_out = false;
+    memset(g_wan_timed_out, 0, sizeof(g_wan_timed_out));
+    wan_metrics_on_forget(on_forget);
 
     // Not using display manager in legacy mode
     g_use_display_manager = false;
@@ -279,9 +267,9 @@ void leds_init_with_displays(const DisplaySystemConfig& config) {
     Wire.begin(I2C_SDA, I2C_SCL);
 
     if (!g_mcp.begin_I2C(MCP23017_ADDR, &Wire)) {
-        Serial.println("ERROR: MCP23017 not found!");
+        LOG_ERROR("MCP23017 not found!");
     } else {
-        Serial.println("MCP23017 initialized");
+        LOG_INFO("MCP23017 initialized");
         // Immediately clear all 16 MCP pins
         for (int i = 0; i < 16; i++) {
             g_mcp.pinMode(i, OUTPUT);
@@ -321,10 +309,10 @@ void leds_init_with_displays(const DisplaySystemConfig& config) {
     }
 
     // Initialize all LEDs (bicolor: green/red pairs)
-    g_led_wan1_green.begin();
-    g_led_wan1_red.begin();
-    g_led_wan2_green.begin();
-    g_led_wan2_red.begin();
+    for (int i = 0; i < WAN_LED_COUNT; i++) {
+        g_led_wan_green[i].begin();
+        g_led_wan_red[i].begin();
+    }
     g_led_local_green.begin();
     g_led_local_red.begin();
     g_led_status1.begin();
@@ -333,10 +321,11 @@ void leds_init_with_displays(const DisplaySystemConfig& config) {
     ledcSetup(STATUS_LED_PWM_CHANNEL, STATUS_LED_PWM_FREQ, STATUS_LED_PWM_RESOLUTION);
     ledcAttachPin(STATUS_LED_PWM_PIN, STATUS_LED_PWM_CHANNEL);
     ledcWrite(STATUS_LED_PWM_CHANNEL, 255);  // Start at full brightness
-    Serial.printf("Status LED PWM initialized on GPIO %d\n", STATUS_LED_PWM_PIN);
+    LOG_INFO("Status LED PWM initialized on GPIO %d", STATUS_LED_PWM_PIN);
 
     // Reset timeout state
-    g_router_timed_out = false;
+    memset(g_wan_timed_out, 0, sizeof(g_wan_timed_out));
+    wan_metrics_on_forget(on_forget);
 }
 
 void display_update() {
@@ -351,16 +340,16 @@ void display_update() {
     // Legacy single display mode
     if (!g_display_ok) return;
 
-    const WanMetrics& m = wan_metrics_get(1);
+    unsigned long updated = wan_freshest_update_ms();
 
-    if (m.last_update_ms == 0) {
+    if (updated == 0) {
         // Never updated - show actual dashes (segment G = 0x40)
         g_display.writeDigitRaw(0, 0x40);
         g_display.writeDigitRaw(1, 0x40);
         g_display.writeDigitRaw(3, 0x40);  // position 2 is the colon
         g_display.writeDigitRaw(4, 0x40);
     } else {
-        unsigned long elapsed_secs = (millis() - m.last_update_ms) / 1000UL;
+        unsigned long elapsed_secs = (millis() - updated) / 1000UL;
         if (elapsed_secs > 9999) {
             elapsed_secs = 9999;  // cap at 4 digits
         }
@@ -404,10 +393,9 @@ void set_displays_on(bool on) {
         ledcWrite(STATUS_LED_PWM_CHANNEL, 0);
     } else {
         // Restore WAN LED states from current metrics
-        const WanMetrics& m1 = wan_metrics_get(1);
-        const WanMetrics& m2 = wan_metrics_get(2);
-        wan1_set_leds(m1.state);
-        wan2_set_leds(m2.state);
+        for (int id = 1; id <= wan_metrics_count(); id++) {
+            wan_set_leds(id, wan_metrics_get(id).state);
+        }
         // Local pinger LEDs are restored by the normal loop() update cycle
         // Status LED is managed by loop() based on Ethernet state
         // Restore status LED PWM brightness with gamma correction
@@ -431,7 +419,7 @@ void power_switch_init() {
     // Set initial display state to match switch
     set_displays_on(g_power_switch_last_state);
 
-    Serial.printf("Power switch initialized on MCP pin %d, state: %s\n",
+    LOG_INFO("Power switch initialized on MCP pin %d, state: %s",
                   POWER_SWITCH_PIN, g_power_switch_last_state ? "ON" : "OFF");
 }
 
@@ -455,7 +443,7 @@ void power_switch_update() {
 
         // Physical switch change overrides current state
         set_displays_on(current_state);
-        Serial.printf("Power switch toggled: %s\n", current_state ? "ON" : "OFF");
+        LOG_INFO("Power switch toggled: %s", current_state ? "ON" : "OFF");
     }
 }
 
@@ -466,3 +454,9 @@ bool get_power_switch_position() {
 uint8_t get_brightness_pot_level() {
     return g_brightness_pot.getPotLevel();
 }
+
+uint32_t get_i2c_transfer_count() {
+    return g_display_manager.i2cWriteCount() +
+           g_freshness_bar.writeCount() +
+           Led::mcpTransferCount();
+}
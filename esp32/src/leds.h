@@ -12,10 +12,10 @@
 
 // Bicolor LED objects (defined in leds.cpp)
 // Each indicator has green and red LEDs; yellow/amber = both on
-extern Led g_led_wan1_green;
-extern Led g_led_wan1_red;
-extern Led g_led_wan2_green;
-extern Led g_led_wan2_red;
+// WAN indicators exist for the first WAN_LED_COUNT table positions
+static const int WAN_LED_COUNT = 4;
+extern Led g_led_wan_green[WAN_LED_COUNT];
+extern Led g_led_wan_red[WAN_LED_COUNT];
 extern Led g_led_local_green;
 extern Led g_led_local_red;
 extern Led g_led_status1;
@@ -34,21 +34,18 @@ void leds_init();
 // New init with multi-display support
 void leds_init_with_displays(const DisplaySystemConfig& config);
 
-// Update WAN1 LEDs based on state
-void wan1_set_leds(WanState state);
-
-// Update WAN2 LEDs based on state
-void wan2_set_leds(WanState state);
+// Update a WAN's LEDs based on state (no-op for ids without an indicator)
+void wan_set_leds(int wan_id, WanState state);
 
 // Update local pinger LEDs based on state
 void local_pinger_set_leds(WanState state);
 
 // Router heartbeat check - call regularly from loop()
-// Monitors pfSense daemon connection, forces all WANs DOWN on timeout
+// Blinks a WAN's LEDs DOWN while its own reports are stale (see wan_freshness.h)
 void router_heartbeat_check();
 
 // Freshness bar update - call regularly from loop()
-// Updates the bicolor LED bargraph based on data freshness
+// Updates the bicolor LED bargraph from the most recent report of any WAN
 void freshness_bar_update();
 
 // 7-segment display update
@@ -68,6 +65,9 @@ void power_switch_init();   // Call after leds_init_with_displays()
 void power_switch_update(); // Call from loop()
 bool get_power_switch_position(); // Get physical switch state (true=on position)
 
+// Total I2C transactions to displays, freshness bar and MCP LEDs (for /metrics)
+uint32_t get_i2c_transfer_count();
+
 // Brightness potentiometer (analog input on GPIO)
 extern BrightnessPotentiometer g_brightness_pot;
 uint8_t get_brightness_pot_level(); // Get pot position as brightness level (0-15)
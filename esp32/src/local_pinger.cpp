@@ -7,6 +7,9 @@
 #include "lwip/netdb.h"
 #include "lwip/sockets.h"
 #include <math.h>
+#include "metrics_history.h"
+#include "state_policy.h"
+#include "logger.h"
 
 // Maximum samples in rolling window (60s / 500ms = 120)
 static const int MAX_SAMPLES = 120;
@@ -37,7 +40,6 @@ static void ping_on_success(esp_ping_handle_t hdl, void* args);
 static void ping_on_timeout(esp_ping_handle_t hdl, void* args);
 static void ping_on_end(esp_ping_handle_t hdl, void* args);
 static void calculate_stats();
-static WanState determine_state(uint16_t latency_ms, uint8_t loss_pct);
 static void start_ping_session();
 static void stop_ping_session();
 
@@ -63,7 +65,7 @@ void local_pinger_init() {
     g_last_stats_ms = millis();
     g_initialized = true;
 
-    Serial.printf("Local pinger initialized, target: %s\n", g_target);
+    LOG_INFO("Local pinger initialized, target: %s", g_target);
 }
 
 void local_pinger_update() {
@@ -97,7 +99,7 @@ void local_pinger_set_target(const char* target) {
         start_ping_session();
     }
 
-    Serial.printf("Local pinger target changed to: %s\n", g_target);
+    LOG_INFO("Local pinger target changed to: %s", g_target);
 }
 
 const char* local_pinger_get_target() {
@@ -147,7 +149,7 @@ static void start_ping_session() {
     memset(&target_addr, 0, sizeof(target_addr));
 
     if (getaddrinfo(g_target, nullptr, &hint, &res) != 0) {
-        Serial.printf("Local pinger: failed to resolve %s\n", g_target);
+        LOG_WARN("Local pinger: failed to resolve %s", g_target);
         return;
     }
 
@@ -155,7 +157,7 @@ static void start_ping_session() {
         struct in_addr addr4 = ((struct sockaddr_in*)(res->ai_addr))->sin_addr;
         inet_addr_to_ip4addr(ip_2_ip4(&target_addr), &addr4);
     } else {
-        Serial.println("Local pinger: IPv6 not supported");
+        LOG_WARN("Local pinger: IPv6 not supported");
         freeaddrinfo(res);
         return;
     }
@@ -181,20 +183,20 @@ static void start_ping_session() {
     // Create and start session
     esp_err_t err = esp_ping_new_session(&ping_config, &cbs, &g_ping_handle);
     if (err != ESP_OK) {
-        Serial.printf("Local pinger: failed to create session: %d\n", err);
+        LOG_WARN("Local pinger: failed to create session: %d", err);
         g_ping_handle = nullptr;
         return;
     }
 
     err = esp_ping_start(g_ping_handle);
     if (err != ESP_OK) {
-        Serial.printf("Local pinger: failed to start: %d\n", err);
+        LOG_WARN("Local pinger: failed to start: %d", err);
         esp_ping_delete_session(g_ping_handle);
         g_ping_handle = nullptr;
         return;
     }
 
-    Serial.printf("Local pinger: started pinging %s\n", g_target);
+    LOG_INFO("Local pinger: started pinging %s", g_target);
 }
 
 static void stop_ping_session() {
@@ -281,21 +283,11 @@ static void calculate_stats() {
     g_metrics.loss_pct = loss_pct;
     g_metrics.sample_count = (uint16_t)total;
     g_metrics.window_secs = window_secs;
-    g_metrics.state = determine_state(avg_latency_ms, loss_pct);
+    WanState previous = g_metrics.state;
+    g_metrics.state = state_policy_evaluate(LOCAL_PINGER_ID, WanState::UP, loss_pct, avg_latency_ms);
     g_metrics.last_update_ms = now;
-}
-
-static WanState determine_state(uint16_t latency_ms, uint8_t loss_pct) {
-    // DOWN: loss > 50%
-    if (loss_pct > LOSS_DOWN_PCT) {
-        return WanState::DOWN;
-    }
-
-    // DEGRADED: loss > 5% OR latency > 200ms
-    if (loss_pct > LOSS_DEGRADED_PCT || latency_ms > LATENCY_DEGRADED_MS) {
-        return WanState::DEGRADED;
-    }
+    wan_metrics_notify_state(LOCAL_PINGER_ID, previous, g_metrics.state);
 
-    // UP: everything looks good
-    return WanState::UP;
+    // No bandwidth of its own (the local displays show the WAN sum)
+    history_add(LOCAL_PINGER_ID, { avg_latency_ms, jitter_ms, loss_pct, 0.0f, 0.0f });
 }
@@ -7,7 +7,7 @@
 
 // Local pinger metrics (similar to WanMetrics but for local ping results)
 struct LocalPingerMetrics {
-    WanState state;              // UP/DEGRADED/DOWN based on thresholds
+    WanState state;              // UP/DEGRADED/DOWN (see state_policy.h)
     uint16_t latency_ms;         // Average latency in ms
     uint16_t jitter_ms;          // Standard deviation (jitter) in ms
     uint8_t loss_pct;            // Packet loss percentage (0-100)
@@ -23,11 +23,6 @@ static const unsigned long SAMPLE_WINDOW_MS = 60000;    // 60 second window
 static const unsigned long LOSS_TIMEOUT_MS = 5000;      // Mark as lost after 5s
 static const unsigned long STATS_UPDATE_MS = 1000;      // Recalculate stats every 1s
 
-// Thresholds
-static const uint16_t LATENCY_DEGRADED_MS = 200;  // >200ms = degraded
-static const uint8_t LOSS_DEGRADED_PCT = 5;       // >5% loss = degraded
-static const uint8_t LOSS_DOWN_PCT = 50;          // >50% loss = down
-
 // Initialize the local pinger (call once in setup())
 void local_pinger_init();
 
@@ -0,0 +1,186 @@
+// logger.cpp
+#include "logger.h"
+#include <stdarg.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "hostname.h"
+
+static const uint32_t SEQ_BUSY = 0xFFFFFFFF;    // slot is being written
+static const uint8_t SYSLOG_FACILITY = 16;      // local0
+static const uint8_t SYSLOG_SEVERITY[] = { 7, 6, 4, 3 };  // debug, info, warning, err
+static const char* LEVEL_NAMES[] = { "debug", "info", "warn", "error" };
+static const char* SERIAL_PREFIX[] = { "DEBUG: ", "", "WARN: ", "ERROR: " };
+
+struct LogSlot {
+    uint32_t seq;               // committed sequence number, SEQ_BUSY or 0 (never used)
+    uint32_t ms;
+    LogLevel level;
+    char msg[LOG_LINE_LEN];
+};
+
+static LogSlot g_ring[LOG_RING_LEN];
+static uint32_t g_next_seq = 1;
+static LogStats g_stats;
+
+static LogSettings g_settings = { (uint8_t)LogLevel::INFO, true, "", LOG_SYSLOG_DEFAULT_PORT };
+static uint32_t g_settings_gen = 0;
+static portMUX_TYPE g_settings_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// ---- Writers ----
+
+void log_write(LogLevel level, const char* fmt, ...) {
+    if ((uint8_t)level < g_settings.level) return;
+
+    uint32_t seq = __atomic_fetch_add(&g_next_seq, 1, __ATOMIC_RELAXED);
+    LogSlot& slot = g_ring[seq % LOG_RING_LEN];
+
+    __atomic_store_n(&slot.seq, SEQ_BUSY, __ATOMIC_SEQ_CST);
+    slot.ms = millis();
+    slot.level = level;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(slot.msg, sizeof(slot.msg), fmt, args);
+    va_end(args);
+    __atomic_store_n(&slot.seq, seq, __ATOMIC_RELEASE);
+
+    __atomic_fetch_add(&g_stats.written, 1, __ATOMIC_RELAXED);
+}
+
+// ---- Readers ----
+
+uint32_t log_next_seq() {
+    return __atomic_load_n(&g_next_seq, __ATOMIC_ACQUIRE);
+}
+
+uint32_t log_oldest_seq() {
+    uint32_t next = log_next_seq();
+    return (next > (uint32_t)LOG_RING_LEN) ? next - LOG_RING_LEN : 1;
+}
+
+bool log_read(uint32_t seq, LogRecord& out) {
+    const LogSlot& slot = g_ring[seq % LOG_RING_LEN];
+    if (__atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE) != seq) return false;
+
+    out.seq = seq;
+    out.ms = slot.ms;
+    out.level = slot.level;
+    memcpy(out.msg, slot.msg, sizeof(out.msg));
+    out.msg[sizeof(out.msg) - 1] = '\0';
+
+    // Overwritten while copying?
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot.seq, __ATOMIC_RELAXED) == seq;
+}
+
+// ---- Drain task ----
+
+static WiFiUDP g_udp;
+static IPAddress g_syslog_ip;
+static bool g_syslog_ok = false;
+static char g_hostname[48] = "";
+
+// Resolve the syslog host after a settings change
+static void apply_settings(const LogSettings& s) {
+    g_syslog_ok = false;
+    if (s.syslog_host[0] == '\0') return;
+    strlcpy(g_hostname, get_network_hostname().c_str(), sizeof(g_hostname));
+    if (WiFi.hostByName(s.syslog_host, g_syslog_ip) != 1) {
+        g_stats.syslog_errors++;
+        return;
+    }
+    g_syslog_ok = true;
+}
+
+static void send_syslog(const LogRecord& r, uint16_t port) {
+    int pri = SYSLOG_FACILITY * 8 + SYSLOG_SEVERITY[(int)r.level];
+    if (!g_udp.beginPacket(g_syslog_ip, port)) {
+        g_stats.syslog_errors++;
+        return;
+    }
+    g_udp.printf("<%d>%s wan-watcher: %s", pri, g_hostname, r.msg);
+    if (g_udp.endPacket()) {
+        g_stats.syslog_sent++;
+    } else {
+        g_stats.syslog_errors++;
+    }
+}
+
+static void drain_task(void*) {
+    uint32_t cursor = 1;
+    uint32_t applied_gen = 0;
+    LogSettings settings;
+    LogRecord rec;
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+
+        taskENTER_CRITICAL(&g_settings_mux);
+        settings = g_settings;
+        uint32_t gen = g_settings_gen;
+        taskEXIT_CRITICAL(&g_settings_mux);
+        if (gen != applied_gen) {
+            applied_gen = gen;
+            apply_settings(settings);
+        }
+
+        uint32_t next = log_next_seq();
+        while (cursor < next) {
+            uint32_t oldest = log_oldest_seq();
+            if (cursor < oldest) {
+                g_stats.dropped += oldest - cursor;
+                cursor = oldest;
+            }
+            if (!log_read(cursor, rec)) {
+                if (cursor >= log_oldest_seq()) break;  // still being written
+                continue;                               // lapped while copying
+            }
+            cursor++;
+
+            if (settings.serial) {
+                Serial.printf("%s%s\n", SERIAL_PREFIX[(int)rec.level], rec.msg);
+            }
+            if (g_syslog_ok) {
+                send_syslog(rec, settings.syslog_port);
+            }
+        }
+    }
+}
+
+void log_init() {
+    // Core 0, so console and network writes stay off the render loop's core
+    xTaskCreatePinnedToCore(drain_task, "log", 4096, nullptr, 1, nullptr, 0);
+}
+
+// ---- Settings ----
+
+void log_set_settings(const LogSettings& settings) {
+    taskENTER_CRITICAL(&g_settings_mux);
+    g_settings = settings;
+    g_settings.syslog_host[sizeof(g_settings.syslog_host) - 1] = '\0';
+    if (g_settings.level > (uint8_t)LogLevel::ERROR) g_settings.level = (uint8_t)LogLevel::ERROR;
+    if (g_settings.syslog_port == 0) g_settings.syslog_port = LOG_SYSLOG_DEFAULT_PORT;
+    g_settings_gen++;
+    taskEXIT_CRITICAL(&g_settings_mux);
+}
+
+const LogSettings& log_get_settings() {
+    return g_settings;
+}
+
+const char* log_level_to_string(LogLevel level) {
+    return LEVEL_NAMES[(int)level];
+}
+
+bool log_level_from_string(const char* str, LogLevel& out) {
+    for (int i = 0; i <= (int)LogLevel::ERROR; i++) {
+        if (strcmp(str, LEVEL_NAMES[i]) == 0) {
+            out = (LogLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const LogStats& log_get_stats() {
+    return g_stats;
+}
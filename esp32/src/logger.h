@@ -0,0 +1,78 @@
+// logger.h
+// Leveled logging into a RAM ring, drained to Serial and syslog in the background
+//
+// LOG_INFO() and friends format the message straight into a ring slot and
+// return; they never wait for the UART or the network. A drain task
+// copies new entries to the enabled sinks:
+//   Serial   optional, so a slow console cannot stall anything
+//   syslog   RFC 3164 over UDP, sent in batches on each drain pass
+// The ring also backs GET /api/log?since=<seq>. Sequence numbers only
+// grow, so a client can resume from the "next" value it was given.
+//
+// Writers reserve a sequence number atomically and publish the slot by
+// storing that number last; readers check it before and after copying, so
+// there are no locks on either side. When writers lap a reader the lost
+// entries are counted as dropped.
+#pragma once
+
+#include <Arduino.h>
+
+enum class LogLevel : uint8_t { DEBUG, INFO, WARN, ERROR };
+
+static const int LOG_RING_LEN = 64;                 // entries kept in RAM
+static const size_t LOG_LINE_LEN = 120;             // per entry, longer lines are cut
+static const unsigned long LOG_DRAIN_MS = 50;       // drain task period
+static const uint16_t LOG_SYSLOG_DEFAULT_PORT = 514;
+
+// Persisted by config_store. An empty syslog_host disables syslog.
+struct LogSettings {
+    uint8_t level;              // LogLevel: lower levels are discarded
+    bool serial;                // Serial sink on/off
+    char syslog_host[64];
+    uint16_t syslog_port;
+};
+
+struct LogRecord {
+    uint32_t seq;
+    uint32_t ms;                // millis() when written
+    LogLevel level;
+    char msg[LOG_LINE_LEN];
+};
+
+struct LogStats {
+    uint32_t written;           // entries written since boot
+    uint32_t dropped;           // overwritten before the drain task sent them
+    uint32_t syslog_sent;       // datagrams sent
+    uint32_t syslog_errors;     // send or resolve failures
+};
+
+void log_write(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#define LOG_DEBUG(...) log_write(LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  log_write(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(...)  log_write(LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) log_write(LogLevel::ERROR, __VA_ARGS__)
+
+// Start the drain task (call right after Serial.begin(); earlier entries are kept)
+void log_init();
+
+// ---- Ring access ----
+
+// Sequence number the next entry will get (entries start at 1)
+uint32_t log_next_seq();
+
+// Oldest sequence number still in the ring
+uint32_t log_oldest_seq();
+
+// Copy one entry; false if it was overwritten or is being written
+bool log_read(uint32_t seq, LogRecord& out);
+
+// ---- Settings ----
+
+void log_set_settings(const LogSettings& settings);
+const LogSettings& log_get_settings();
+
+const char* log_level_to_string(LogLevel level);
+bool log_level_from_string(const char* str, LogLevel& out);
+
+const LogStats& log_get_stats();
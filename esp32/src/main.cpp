@@ -1,17 +1,31 @@
 // main.cpp
 #include <Arduino.h>
 #include <ETH.h>
-#include <WebServer.h>
 #include <ESPmDNS.h>
 
 #include "hostname.h"
 #include "leds.h"
+#include "http_server.h"
 #include "http_routes.h"
 #include "wan_metrics.h"
 #include "display_config.h"
 #include "local_pinger.h"
-
-WebServer server(80);
+#include "udp_ingest.h"
+#include "stream_ingest.h"
+#include "config_store.h"
+#include "mdns_status.h"
+#include "mqtt_publisher.h"
+#include "webhook_alerts.h"
+#include "snmp_poller.h"
+#include "peer_gossip.h"
+#include "metrics_log.h"
+#include "event_journal.h"
+#include "availability.h"
+#include "data_usage.h"
+#include "bw_percentile.h"
+#include "logger.h"
+
+HttpServer server(80);
 
 // Ethernet configuration for Olimex ESP32-POE-ISO
 #define ETH_CLK_MODE    ETH_CLOCK_GPIO17_OUT
@@ -57,13 +71,14 @@ static DisplaySystemConfig build_display_config() {
 // start mDNS
 static void start_mdns(const char* hostname) {
     if (MDNS.begin(hostname)) {
-        Serial.println("mDNS started");
+        LOG_INFO("mDNS started");
 
         // Advertise HTTP service over mDNS
         MDNS.addService("http", "tcp", 80);
+        mdns_status_init();
 
     } else {
-        Serial.println("mDNS failed to start");
+        LOG_WARN("mDNS failed to start");
     }
 }
 
@@ -71,26 +86,25 @@ static void start_mdns(const char* hostname) {
 static void eth_event(WiFiEvent_t event) {
     switch (event) {
         case ARDUINO_EVENT_ETH_START:
-            Serial.println("ETH Started");
+            LOG_INFO("ETH Started");
             ETH.setHostname(build_hostname().c_str());
             break;
         case ARDUINO_EVENT_ETH_CONNECTED:
-            Serial.println("ETH Connected");
+            LOG_INFO("ETH Connected");
             break;
         case ARDUINO_EVENT_ETH_GOT_IP:
-            Serial.print("ETH IP: ");
-            Serial.println(ETH.localIP());
-            Serial.printf("ETH Speed: %dMbps, %s\n",
+            LOG_INFO("ETH IP: %s", ETH.localIP().toString().c_str());
+            LOG_INFO("ETH Speed: %dMbps, %s",
                 ETH.linkSpeed(),
                 ETH.fullDuplex() ? "Full Duplex" : "Half Duplex");
             g_eth_connected = true;
             break;
         case ARDUINO_EVENT_ETH_DISCONNECTED:
-            Serial.println("ETH Disconnected");
+            LOG_INFO("ETH Disconnected");
             g_eth_connected = false;
             break;
         case ARDUINO_EVENT_ETH_STOP:
-            Serial.println("ETH Stopped");
+            LOG_INFO("ETH Stopped");
             g_eth_connected = false;
             break;
         default:
@@ -103,8 +117,8 @@ static void connect_ethernet_blocking() {
     g_led_status1.set(false);
 
     String hostname = build_hostname();
-    Serial.printf("Hostname: %s\n", hostname.c_str());
-    Serial.println("Connecting via Ethernet...");
+    LOG_INFO("Hostname: %s", hostname.c_str());
+    LOG_INFO("Connecting via Ethernet...");
 
     WiFi.onEvent(eth_event);
     ETH.begin(ETH_ADDR, ETH_POWER_PIN, ETH_MDC_PIN, ETH_MDIO_PIN, ETH_TYPE, ETH_CLK_MODE);
@@ -115,7 +129,7 @@ static void connect_ethernet_blocking() {
         g_led_status1.set(!g_led_status1.state());
     }
 
-    Serial.println("Ethernet connected");
+    LOG_INFO("Ethernet connected");
     g_led_status1.set(true);
     start_mdns(hostname.c_str());
 }
@@ -124,11 +138,17 @@ void setup() {
     Serial.begin(115200);
     delay(1000);
     Serial.println();
-    Serial.println("ESP32 LED webserver starting...");
+
+    // Background log drain (Serial and syslog sinks)
+    log_init();
+    LOG_INFO("ESP32 LED webserver starting...");
 
     // Initialize WAN metrics storage
     wan_metrics_init();
 
+    // Journal of state transitions (listens before any source can change state)
+    events_init();
+
     // Initialize I2C, MCP23017, displays, and LEDs
     DisplaySystemConfig config = build_display_config();
     leds_init_with_displays(config);
@@ -139,16 +159,49 @@ void setup() {
     // Initialize brightness potentiometer (GPIO 36 / VP)
     g_brightness_pot.begin(36);
 
+    // Restore saved settings (overrides switch/pot positions until they move)
+    config_init();
+
+    // Replay the flash metrics log: history and last WAN states survive a reboot
+    mlog_init();
+
+    // Availability rings saved before the reboot (merged once the clock is known)
+    avail_init();
+
+    // Data usage totals of the billing cycle (restored once the clock is known)
+    data_usage_init();
+
+    // Bandwidth p95/peak estimators of the billing cycle (same restore rule)
+    bw_percentile_init();
+
     // Block here until Ethernet is up; g_led_status1 shows progress
     connect_ethernet_blocking();
 
     // Start HTTP server and routes
     setup_routes(server);
     server.begin();
-    Serial.println("HTTP server started");
+    LOG_INFO("HTTP server started");
+
+    // Signed UDP metrics ingest (needs LittleFS for the key, mounted by mlog_init)
+    udp_ingest_init();
+
+    // Persistent TCP streaming ingest
+    stream_ingest_init();
 
     // Initialize local pinger (needs network to be up)
     local_pinger_init();
+
+    // MQTT publisher (broker settings come from config_init)
+    mqtt_init();
+
+    // Webhook alerts on state transitions (background delivery task)
+    webhook_init();
+
+    // Optional SNMP pull mode (polls only when a host is configured)
+    snmp_init();
+
+    // Relay WAN records to other panels found over mDNS
+    gossip_init();
 }
 
 void loop() {
@@ -166,14 +219,26 @@ void loop() {
     }
 
     server.handleClient();
+    udp_ingest_update();
+    stream_ingest_update();
+    snmp_update();
+    gossip_update();
     power_switch_update();
     g_brightness_pot.update();
     router_heartbeat_check();
     freshness_bar_update();
     display_update();
+    config_update();
+    mdns_status_update();
 
     // Update local pinger and its LEDs
     local_pinger_update();
     const LocalPingerMetrics& lp = local_pinger_get();
     local_pinger_set_leds(lp.state);
+
+    mqtt_update();
+    mlog_update();
+    avail_update();
+    data_usage_update();
+    bw_percentile_update();
 }
@@ -0,0 +1,118 @@
+// mdns_status.cpp
+#include "mdns_status.h"
+#include <ESPmDNS.h>
+#include "wan_metrics.h"
+#include "local_pinger.h"
+#include "wan_freshness.h"
+#include "logger.h"
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "dev"
+#endif
+
+// Dynamic records, in publish order
+enum TxtRecord { TXT_STATE, TXT_AGE, TXT_LOCAL, TXT_WAN_FIRST, TXT_COUNT = TXT_WAN_FIRST + MAX_WANS };
+
+static const size_t TXT_VALUE_LEN = 12;
+
+static char g_published[TXT_COUNT][TXT_VALUE_LEN];
+static bool g_started = false;
+static unsigned long g_last_check_ms = 0;
+static unsigned long g_last_publish_ms = 0;
+
+static const char* record_key(int record) {
+    switch (record) {
+        case TXT_STATE: return "state";
+        case TXT_AGE:   return "age";
+        case TXT_LOCAL: return "local";
+        default:        return wan_metrics_key(record - TXT_WAN_FIRST + 1);
+    }
+}
+
+// Compute the current value of every dynamic record
+static void compute(char values[TXT_COUNT][TXT_VALUE_LEN]) {
+    // Router feed age follows the freshness bar (most recent report of any WAN)
+    const char* age = freshness_to_string(freshness_of(wan_freshest_update_ms()));
+
+    // Positions not in the WAN table yet stay empty and are not published
+    int count = wan_metrics_count();
+    int up = 0;
+    int down = 0;
+    for (int id = 1; id <= MAX_WANS; id++) {
+        char* value = values[TXT_WAN_FIRST + id - 1];
+        if (id > count) {
+            value[0] = '\0';
+            continue;
+        }
+        if (wan_is_stale(id)) {
+            // Its last reported state is no longer trusted: counts as down
+            down++;
+            strlcpy(value, "stale", TXT_VALUE_LEN);
+            continue;
+        }
+        WanState state = wan_metrics_get(id).state;
+        if (state == WanState::UP) up++;
+        if (state == WanState::DOWN) down++;
+        strlcpy(value, wan_state_to_string(state), TXT_VALUE_LEN);
+    }
+
+    const char* overall;
+    if (strcmp(age, "none") == 0) {
+        overall = "none";
+    } else if (strcmp(age, "stale") == 0) {
+        overall = "stale";
+    } else if (up == count) {
+        overall = "up";
+    } else if (down == count) {
+        overall = "down";
+    } else {
+        overall = "degraded";
+    }
+
+    strlcpy(values[TXT_STATE], overall, TXT_VALUE_LEN);
+    strlcpy(values[TXT_AGE], age, TXT_VALUE_LEN);
+    strlcpy(values[TXT_LOCAL], wan_state_to_string(local_pinger_get().state), TXT_VALUE_LEN);
+}
+
+void mdns_status_init() {
+    MDNS.addServiceTxt("http", "tcp", "txtvers", "1");
+    MDNS.addServiceTxt("http", "tcp", "fw", FIRMWARE_VERSION);
+
+    compute(g_published);
+    for (int r = 0; r < TXT_COUNT; r++) {
+        if (g_published[r][0] == '\0') continue;
+        MDNS.addServiceTxt("http", "tcp", record_key(r), g_published[r]);
+    }
+
+    g_started = true;
+    g_last_publish_ms = millis();
+}
+
+void mdns_status_update() {
+    if (!g_started) return;
+
+    unsigned long now = millis();
+    if (now - g_last_check_ms < MDNS_TXT_CHECK_MS) return;
+    g_last_check_ms = now;
+
+    // Transitions inside the rate limit wait; the latest values go out later
+    if (now - g_last_publish_ms < MDNS_TXT_MIN_INTERVAL_MS) return;
+
+    char current[TXT_COUNT][TXT_VALUE_LEN];
+    compute(current);
+
+    bool changed = false;
+    for (int r = 0; r < TXT_COUNT; r++) {
+        if (current[r][0] != '\0' && strcmp(current[r], g_published[r]) != 0) {
+            MDNS.addServiceTxt("http", "tcp", record_key(r), current[r]);
+            strlcpy(g_published[r], current[r], TXT_VALUE_LEN);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        g_last_publish_ms = now;
+        LOG_DEBUG("mDNS TXT updated: state=%s age=%s",
+                      g_published[TXT_STATE], g_published[TXT_AGE]);
+    }
+}
@@ -0,0 +1,27 @@
+// mdns_status.h
+// Live panel state published as TXT records on the _http._tcp service
+//
+// LAN tools can read panel health from their mDNS cache without opening an
+// HTTP connection. Records (all short strings):
+//   txtvers  TXT layout version ("1")
+//   fw       firmware version
+//   state    overall: up / degraded / down / stale (router feed lost) / none
+//   <wan>    per-WAN state, keyed by WAN name: up / degraded / down
+//   local    panel's own ping state
+//   age      router update age bucket, matching the freshness bar colours:
+//            fresh (<20s) / late (<40s) / old (<60s) / stale / none
+//
+// Records change only on transitions, and re-announcements are rate
+// limited; a transition inside the limit is published when it expires.
+#pragma once
+
+#include <Arduino.h>
+
+static const unsigned long MDNS_TXT_CHECK_MS = 1000;          // state sampling
+static const unsigned long MDNS_TXT_MIN_INTERVAL_MS = 10000;  // between announcements
+
+// Add the TXT records (call right after the _http._tcp service is added)
+void mdns_status_init();
+
+// Republish records that changed (call from loop())
+void mdns_status_update();
@@ -3,6 +3,8 @@
 #include "wan_metrics.h"
 #include "local_pinger.h"
 #include "freshness_bar.h"
+#include "wan_freshness.h"
+#include "data_usage.h"
 
 // 7-segment patterns for letters (active-low segments: 0bPGFEDCBA)
 // Segment layout:
@@ -24,6 +26,7 @@ static const uint8_t LETTER_J = SEG_B | SEG_C | SEG_D | SEG_E;              // J
 static const uint8_t LETTER_P = SEG_A | SEG_B | SEG_E | SEG_F | SEG_G;      // P
 static const uint8_t LETTER_d = SEG_B | SEG_C | SEG_D | SEG_E | SEG_G;      // d (lowercase)
 static const uint8_t LETTER_U = SEG_B | SEG_C | SEG_D | SEG_E | SEG_F;      // U
+static const uint8_t LETTER_C = SEG_A | SEG_D | SEG_E | SEG_F;              // C
 static const uint8_t LETTER_DASH = SEG_G;                                    // -
 
 MetricDisplay::MetricDisplay()
@@ -34,6 +37,7 @@ MetricDisplay::MetricDisplay()
     , _wan_id(1)
     , _packet_metric(PacketMetric::LATENCY)
     , _bandwidth_metric(BandwidthMetric::DOWNLOAD)
+    , _write_count(0)
 {}
 
 bool MetricDisplay::begin(uint8_t i2c_addr, TwoWire* wire) {
@@ -42,7 +46,7 @@ bool MetricDisplay::begin(uint8_t i2c_addr, TwoWire* wire) {
     _ready = _display.begin(i2c_addr, wire);
     if (_ready) {
         _display.clear();
-        _display.writeDisplay();
+        writeDisplay();
         _display.setBrightness(8);
     }
     return _ready;
@@ -69,6 +73,7 @@ void MetricDisplay::setDisplayOn(bool on) {
     _wire->beginTransmission(_i2c_addr);
     _wire->write(on ? 0x81 : 0x80);
     _wire->endTransmission();
+    _write_count++;
 }
 
 void MetricDisplay::setPacketMetric(PacketMetric metric) {
@@ -95,6 +100,15 @@ int MetricDisplay::wanId() const {
     return _wan_id;
 }
 
+uint32_t MetricDisplay::writeCount() const {
+    return _write_count;
+}
+
+void MetricDisplay::writeDisplay() {
+    _display.writeDisplay();
+    _write_count++;
+}
+
 void MetricDisplay::writeLetterDigit(char letter) {
     uint8_t pattern = 0;
     switch (letter) {
@@ -103,6 +117,7 @@ void MetricDisplay::writeLetterDigit(char letter) {
         case 'P': pattern = LETTER_P; break;
         case 'd': pattern = LETTER_d; break;
         case 'U': pattern = LETTER_U; break;
+        case 'C': pattern = LETTER_C; break;
         default:  pattern = LETTER_DASH; break;
     }
     _display.writeDigitRaw(0, pattern);
@@ -146,8 +161,8 @@ void MetricDisplay::render() {
         // Local pinger packet metrics
         last_update_ms = local_pinger_get().last_update_ms;
     } else if (_wan_id == 0 && _type == DisplayType::BANDWIDTH) {
-        // Local bandwidth (sum of WANs) - use WAN1 timestamp
-        last_update_ms = wan_metrics_get(1).last_update_ms;
+        // Local bandwidth (sum of the WANs that are not stale)
+        last_update_ms = wan_freshest_update_ms();
     } else {
         // WAN metrics
         last_update_ms = wan_metrics_get(_wan_id).last_update_ms;
@@ -156,7 +171,7 @@ void MetricDisplay::render() {
     // Show dashes if never updated
     if (last_update_ms == 0) {
         showDashes();
-        _display.writeDisplay();
+        writeDisplay();
         return;
     }
 
@@ -164,7 +179,7 @@ void MetricDisplay::render() {
     unsigned long elapsed = millis() - last_update_ms;
     if (elapsed > FRESHNESS_RED_BUFFER_END_MS) {
         showDashes();
-        _display.writeDisplay();
+        writeDisplay();
         return;
     }
 
@@ -176,7 +191,7 @@ void MetricDisplay::render() {
         renderBandwidthValue();
     }
 
-    _display.writeDisplay();
+    writeDisplay();
 }
 
 void MetricDisplay::renderPacketValue() {
@@ -225,14 +240,21 @@ void MetricDisplay::renderPacketValue() {
 }
 
 void MetricDisplay::renderBandwidthValue() {
+    if (_bandwidth_metric == BandwidthMetric::CAP) {
+        renderCapValue();
+        return;
+    }
+
     float value = 0.0f;
     char letter = 'd';
 
     switch (_bandwidth_metric) {
         case BandwidthMetric::DOWNLOAD:
             if (_wan_id == 0) {
-                // Local bandwidth: sum of WAN1 + WAN2
-                value = wan_metrics_get_down(1) + wan_metrics_get_down(2);
+                // Local bandwidth: sum of the WANs still reporting
+                for (int id = 1; id <= wan_metrics_count(); id++) {
+                    if (!wan_is_stale(id)) value += wan_metrics_get_down(id);
+                }
             } else {
                 value = wan_metrics_get_down(_wan_id);
             }
@@ -240,13 +262,17 @@ void MetricDisplay::renderBandwidthValue() {
             break;
         case BandwidthMetric::UPLOAD:
             if (_wan_id == 0) {
-                // Local bandwidth: sum of WAN1 + WAN2
-                value = wan_metrics_get_up(1) + wan_metrics_get_up(2);
+                // Local bandwidth: sum of the WANs still reporting
+                for (int id = 1; id <= wan_metrics_count(); id++) {
+                    if (!wan_is_stale(id)) value += wan_metrics_get_up(id);
+                }
             } else {
                 value = wan_metrics_get_up(_wan_id);
             }
             letter = 'U';
             break;
+        case BandwidthMetric::CAP:
+            break;
     }
 
     writeLetterDigit(letter);
@@ -280,3 +306,29 @@ void MetricDisplay::renderBandwidthValue() {
     }
     _display.writeDigitNum(4, display_val % 10);
 }
+
+void MetricDisplay::renderCapValue() {
+    // Percent of the data cap used this cycle; the local display shows the
+    // WAN closest to (or furthest over) its cap
+    float pct = 0.0f;
+    bool have_cap = false;
+    if (_wan_id == 0) {
+        for (int id = 1; id <= wan_metrics_count(); id++) {
+            float p;
+            if (!data_usage_cap_pct(wan_metrics_key(id), p)) continue;
+            if (!have_cap || p > pct) pct = p;
+            have_cap = true;
+        }
+    } else {
+        have_cap = data_usage_cap_pct(wan_metrics_key(_wan_id), pct);
+    }
+
+    writeLetterDigit('C');
+    if (!have_cap) {
+        _display.writeDigitRaw(1, LETTER_DASH);
+        _display.writeDigitRaw(3, LETTER_DASH);
+        _display.writeDigitRaw(4, LETTER_DASH);
+        return;
+    }
+    write3DigitValue((int)(pct + 0.5f));
+}
@@ -41,6 +41,9 @@ public:
     DisplayType displayType() const;
     int wanId() const;
 
+    // Number of I2C frame/command writes issued to this display
+    uint32_t writeCount() const;
+
 private:
     Adafruit_7segment _display;
     TwoWire* _wire;
@@ -50,10 +53,15 @@ private:
     int _wan_id;
     PacketMetric _packet_metric;
     BandwidthMetric _bandwidth_metric;
+    uint32_t _write_count;
+
+    // Push the display buffer over I2C
+    void writeDisplay();
 
     // Render helpers
     void renderPacketValue();
     void renderBandwidthValue();
+    void renderCapValue();
 
     // Write a letter to first digit position
     void writeLetterDigit(char letter);
@@ -0,0 +1,472 @@
+// metrics_exporter.cpp
+// Streams Prometheus text exposition straight from the live metric stores
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include "esp_timer.h"
+#include "metrics_exporter.h"
+#include "http_routes.h"
+#include "http_server.h"
+#include "admission.h"
+#include "route_timing.h"
+#include "wan_metrics.h"
+#include "wan_fields.h"
+#include "local_pinger.h"
+#include "leds.h"
+#include "udp_ingest.h"
+#include "stream_ingest.h"
+#include "mqtt_publisher.h"
+#include "webhook_alerts.h"
+#include "logger.h"
+#include "snmp_poller.h"
+#include "peer_gossip.h"
+#include "metrics_history.h"
+#include "metrics_log.h"
+#include "wan_counters.h"
+#include "state_policy.h"
+#include "event_journal.h"
+#include "bw_percentile.h"
+#include "data_usage.h"
+
+static const char* CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+// ---- Chunked writer ----
+// Lines are formatted into a fixed buffer, which is flushed as one HTTP
+// chunk when the next line does not fit.
+
+static WebServer* g_server = nullptr;
+static char g_buf[METRICS_CHUNK_BYTES];
+static size_t g_len = 0;
+
+static void flush_chunk() {
+    if (g_len > 0) {
+        g_server->sendContent(g_buf, g_len);
+        g_len = 0;
+    }
+}
+
+static void emit(const char* fmt, ...) {
+    va_list args, retry;
+    va_start(args, fmt);
+    va_copy(retry, args);
+    int n = vsnprintf(g_buf + g_len, sizeof(g_buf) - g_len, fmt, args);
+    if (n >= 0 && (size_t)n >= sizeof(g_buf) - g_len && g_len > 0) {
+        // Did not fit after what is buffered: send that, format again
+        flush_chunk();
+        n = vsnprintf(g_buf, sizeof(g_buf), fmt, retry);
+    }
+    va_end(retry);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(g_buf)) {
+        // Longer than a whole chunk; a cut line would corrupt the exposition
+        LOG_WARN("Metrics: dropped a %d-byte line", n);
+        return;
+    }
+    g_len += n;
+}
+
+// Escape a label value as the text format requires: backslash, double
+// quote and newline. out needs twice the input length plus one.
+static const char* label(const char* value, char* out, size_t size) {
+    size_t n = 0;
+    for (const char* p = value; *p != '\0' && n + 2 < size; p++) {
+        char c = *p;
+        if (c == '\\' || c == '"' || c == '\n') {
+            out[n++] = '\\';
+            if (c == '\n') c = 'n';
+        }
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    return out;
+}
+
+static void family(const char* name, const char* type, const char* help) {
+    emit("# HELP wan_watcher_%s %s\n# TYPE wan_watcher_%s %s\n", name, help, name, type);
+}
+
+// ---- Families ----
+// Per-WAN values come from the generated field table; each field's scale
+// converts it to base units (seconds, ratio, bits per second).
+
+static void wan_gauge(const char* name, const char* help, WanFieldId id) {
+    family(name, "gauge", help);
+    for (int wan = 1; wan <= wan_metrics_count(); wan++) {
+        emit("wan_watcher_%s{wan=\"%s\"} %g\n", name, wan_metrics_key(wan),
+             wan_field_scaled(wan_metrics_get(wan), id));
+    }
+}
+
+static const char* WINDOW_LABELS[] = { "15s", "1m", "5m", "15m" };
+static const WanFieldId DOWN_FIELDS[] = {
+    WanFieldId::DOWN_MBPS, WanFieldId::DOWN_1M, WanFieldId::DOWN_5M, WanFieldId::DOWN_15M
+};
+static const WanFieldId UP_FIELDS[] = {
+    WanFieldId::UP_MBPS, WanFieldId::UP_1M, WanFieldId::UP_5M, WanFieldId::UP_15M
+};
+
+static void wan_rate_gauge(const char* name, const char* help, const WanFieldId* fields) {
+    family(name, "gauge", help);
+    for (int wan = 1; wan <= wan_metrics_count(); wan++) {
+        const WanMetrics& m = wan_metrics_get(wan);
+        for (int w = 0; w < 4; w++) {
+            emit("wan_watcher_%s{wan=\"%s\",window=\"%s\"} %.0f\n", name,
+                 wan_metrics_key(wan), WINDOW_LABELS[w], wan_field_scaled(m, fields[w]));
+        }
+    }
+}
+
+static void export_wans() {
+    wan_gauge("wan_state", "Router-reported WAN state (0=down, 1=degraded, 2=up).", WanFieldId::STATE);
+    wan_gauge("wan_loss_ratio", "Router-reported packet loss (0-1).", WanFieldId::LOSS_PCT);
+    wan_gauge("wan_latency_seconds", "Router-reported latency.", WanFieldId::LATENCY_MS);
+    wan_gauge("wan_jitter_seconds", "Router-reported jitter.", WanFieldId::JITTER_MS);
+    wan_rate_gauge("wan_down_bits_per_second", "Download rate by averaging window.", DOWN_FIELDS);
+    wan_rate_gauge("wan_up_bits_per_second", "Upload rate by averaging window.", UP_FIELDS);
+
+    family("wan_last_update_age_seconds", "gauge", "Seconds since this WAN was last reported (-1 if never).");
+    unsigned long now = millis();
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        const WanMetrics& m = wan_metrics_get(id);
+        if (m.last_update_ms == 0) {
+            emit("wan_watcher_wan_last_update_age_seconds{wan=\"%s\"} -1\n", wan_metrics_key(id));
+        } else {
+            emit("wan_watcher_wan_last_update_age_seconds{wan=\"%s\"} %.1f\n",
+                 wan_metrics_key(id), (now - m.last_update_ms) / 1000.0f);
+        }
+    }
+
+    // The addresses are whatever the collector sent, so escape them
+    family("wan_info", "gauge", "WAN addressing as labels (always 1).");
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        const WanMetrics& m = wan_metrics_get(id);
+        char local_ip[2 * sizeof(m.local_ip)];
+        char gateway_ip[2 * sizeof(m.gateway_ip)];
+        char monitor_ip[2 * sizeof(m.monitor_ip)];
+        emit("wan_watcher_wan_info{wan=\"%s\",local_ip=\"%s\",gateway_ip=\"%s\",monitor_ip=\"%s\"} 1\n",
+             wan_metrics_key(id), label(m.local_ip, local_ip, sizeof(local_ip)),
+             label(m.gateway_ip, gateway_ip, sizeof(gateway_ip)),
+             label(m.monitor_ip, monitor_ip, sizeof(monitor_ip)));
+    }
+}
+
+static void export_local_pinger() {
+    const LocalPingerMetrics& lp = local_pinger_get();
+
+    family("local_state", "gauge", "Panel's own ping state (0=down, 1=degraded, 2=up).");
+    emit("wan_watcher_local_state %d\n", (int)lp.state);
+    family("local_latency_seconds", "gauge", "Panel's own ping latency.");
+    emit("wan_watcher_local_latency_seconds %.3f\n", lp.latency_ms / 1000.0f);
+    family("local_jitter_seconds", "gauge", "Panel's own ping jitter.");
+    emit("wan_watcher_local_jitter_seconds %.3f\n", lp.jitter_ms / 1000.0f);
+    family("local_loss_ratio", "gauge", "Panel's own ping loss (0-1).");
+    emit("wan_watcher_local_loss_ratio %.2f\n", lp.loss_pct / 100.0f);
+    family("local_samples", "gauge", "Ping samples in the current window.");
+    emit("wan_watcher_local_samples %u\n", lp.sample_count);
+    family("local_window_seconds", "gauge", "Time span covered by the ping window.");
+    emit("wan_watcher_local_window_seconds %u\n", lp.window_secs);
+    family("local_info", "gauge", "Ping target as a label (always 1).");
+    char target[128];
+    emit("wan_watcher_local_info{target=\"%s\"} 1\n",
+         label(local_pinger_get_target(), target, sizeof(target)));
+}
+
+static void export_panel() {
+    family("display_brightness", "gauge", "Display brightness level (0-15).");
+    emit("wan_watcher_display_brightness %u\n", get_display_brightness());
+    family("brightness_pot_level", "gauge", "Brightness potentiometer position (0-15).");
+    emit("wan_watcher_brightness_pot_level %u\n", get_brightness_pot_level());
+    family("displays_on", "gauge", "Whether the displays are on.");
+    emit("wan_watcher_displays_on %d\n", get_displays_on() ? 1 : 0);
+    family("power_switch_on", "gauge", "Physical power switch position.");
+    emit("wan_watcher_power_switch_on %d\n", get_power_switch_position() ? 1 : 0);
+    family("i2c_transfers_total", "counter", "I2C display and expander writes since boot.");
+    emit("wan_watcher_i2c_transfers_total %u\n", get_i2c_transfer_count());
+}
+
+static void export_system() {
+    family("uptime_seconds", "gauge", "Seconds since boot.");
+    emit("wan_watcher_uptime_seconds %llu\n", (unsigned long long)(esp_timer_get_time() / 1000000));
+    family("heap_free_bytes", "gauge", "Free heap.");
+    emit("wan_watcher_heap_free_bytes %u\n", ESP.getFreeHeap());
+    family("heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+    emit("wan_watcher_heap_min_free_bytes %u\n", ESP.getMinFreeHeap());
+
+    family("http_requests_total", "counter", "HTTP requests by route.");
+    for (int r = 0; r < (int)HttpRoute::COUNT; r++) {
+        emit("wan_watcher_http_requests_total{route=\"%s\"} %u\n",
+             http_route_name((HttpRoute)r), http_route_requests((HttpRoute)r));
+    }
+
+    // Request latency: full histogram for the total, sum/count per phase
+    family("http_request_duration_seconds", "histogram", "HTTP request duration by route.");
+    for (int r = 0; r < (int)HttpRoute::COUNT; r++) {
+        const PhaseHistogram& h = route_timing_get((HttpRoute)r, TimingPhase::TOTAL);
+        if (h.count == 0) continue;
+        const char* route = http_route_name((HttpRoute)r);
+        uint32_t cumulative = 0;
+        for (int b = 0; b < TIMING_BUCKETS - 1; b++) {
+            cumulative += h.buckets[b];
+            emit("wan_watcher_http_request_duration_seconds_bucket{route=\"%s\",le=\"%g\"} %u\n",
+                 route, TIMING_BUCKET_US[b] / 1e6, cumulative);
+        }
+        emit("wan_watcher_http_request_duration_seconds_bucket{route=\"%s\",le=\"+Inf\"} %u\n", route, h.count);
+        emit("wan_watcher_http_request_duration_seconds_sum{route=\"%s\"} %.6f\n", route, h.sum_us / 1e6);
+        emit("wan_watcher_http_request_duration_seconds_count{route=\"%s\"} %u\n", route, h.count);
+    }
+
+    family("http_phase_seconds_total", "counter", "Time spent per request phase by route.");
+    for (int r = 0; r < (int)HttpRoute::COUNT; r++) {
+        for (int p = 0; p < (int)TimingPhase::TOTAL; p++) {
+            const PhaseHistogram& h = route_timing_get((HttpRoute)r, (TimingPhase)p);
+            if (h.count == 0) continue;
+            emit("wan_watcher_http_phase_seconds_total{route=\"%s\",phase=\"%s\"} %.6f\n",
+                 http_route_name((HttpRoute)r), timing_phase_name((TimingPhase)p), h.sum_us / 1e6);
+        }
+    }
+
+    const HttpServerStats& http = http_server_get_stats();
+    family("http_connections_total", "counter", "TCP connections accepted by the HTTP server.");
+    emit("wan_watcher_http_connections_total %u\n", http.connections);
+    family("http_reused_requests_total", "counter", "Requests served on a persistent connection.");
+    emit("wan_watcher_http_reused_requests_total %u\n", http.reused);
+    family("http_pipelined_requests_total", "counter", "Requests pipelined behind a previous request.");
+    emit("wan_watcher_http_pipelined_requests_total %u\n", http.pipelined);
+    family("http_connection_closes_total", "counter", "Persistent connections closed by the server.");
+    emit("wan_watcher_http_connection_closes_total{reason=\"idle\"} %u\n", http.idle_closed);
+    emit("wan_watcher_http_connection_closes_total{reason=\"max_requests\"} %u\n", http.max_closed);
+    emit("wan_watcher_http_connection_closes_total{reason=\"preempted\"} %u\n", http.preempted);
+
+    const AdmissionStats& adm = admission_get_stats();
+    family("http_admission_total", "counter", "HTTP admission control decisions.");
+    emit("wan_watcher_http_admission_total{result=\"admitted\"} %u\n", adm.admitted);
+    emit("wan_watcher_http_admission_total{result=\"priority\"} %u\n", adm.priority);
+    emit("wan_watcher_http_admission_total{result=\"rejected\"} %u\n", adm.rejected);
+    emit("wan_watcher_http_admission_total{result=\"deferred\"} %u\n", adm.deferred);
+}
+
+static void export_log() {
+    const LogStats& lg = log_get_stats();
+    family("log_entries_total", "counter", "Log entries written to the ring.");
+    emit("wan_watcher_log_entries_total %u\n", lg.written);
+    family("log_dropped_total", "counter", "Log entries overwritten before reaching the sinks.");
+    emit("wan_watcher_log_dropped_total %u\n", lg.dropped);
+    family("syslog_datagrams_total", "counter", "Syslog datagrams by outcome.");
+    emit("wan_watcher_syslog_datagrams_total{result=\"sent\"} %u\n", lg.syslog_sent);
+    emit("wan_watcher_syslog_datagrams_total{result=\"error\"} %u\n", lg.syslog_errors);
+}
+
+static void export_gossip() {
+    const GossipStats& g = gossip_get_stats();
+    family("gossip_peers", "gauge", "Peer panels currently known.");
+    emit("wan_watcher_gossip_peers %u\n", g.peers);
+    family("gossip_datagrams_total", "counter", "Peer gossip datagrams by outcome.");
+    emit("wan_watcher_gossip_datagrams_total{result=\"sent\"} %u\n", g.sent);
+    emit("wan_watcher_gossip_datagrams_total{result=\"send_error\"} %u\n", g.send_errors);
+    emit("wan_watcher_gossip_datagrams_total{result=\"received\"} %u\n", g.received);
+    emit("wan_watcher_gossip_datagrams_total{result=\"malformed\"} %u\n", g.malformed);
+    family("gossip_records_total", "counter", "Relayed WAN records by outcome.");
+    emit("wan_watcher_gossip_records_total{result=\"applied\"} %u\n", g.applied);
+    emit("wan_watcher_gossip_records_total{result=\"stale\"} %u\n", g.stale);
+}
+
+static void export_history() {
+    const HistoryStats& h = history_get_stats();
+    family("history_samples_total", "counter", "Samples offered to the history rings by outcome.");
+    emit("wan_watcher_history_samples_total{result=\"recorded\"} %u\n", h.samples);
+    emit("wan_watcher_history_samples_total{result=\"skipped\"} %u\n", h.skipped);
+}
+
+static void export_events() {
+    family("state_events_total", "counter", "State transitions recorded in the event journal.");
+    emit("wan_watcher_state_events_total %u\n", events_next_seq() - 1);
+}
+
+static void export_state_policy() {
+    const StatePolicyStats& p = state_policy_get_stats();
+    family("state_evaluations_total", "counter", "Loss/latency reports graded against a state profile.");
+    emit("wan_watcher_state_evaluations_total %u\n", p.evaluations);
+    family("state_changes_total", "counter", "Graded state changes by outcome (taken, or held back until they reverted).");
+    emit("wan_watcher_state_changes_total{result=\"taken\"} %u\n", p.transitions);
+    emit("wan_watcher_state_changes_total{result=\"held\"} %u\n", p.held);
+}
+
+static void export_billing() {
+    family("wan_p95_bits_per_second", "gauge", "95th percentile rate over the billing cycle.");
+    for (int wan = 1; wan <= wan_metrics_count(); wan++) {
+        const WanBandwidthPercentiles& p = bw_percentile_get(wan);
+        emit("wan_watcher_wan_p95_bits_per_second{wan=\"%s\",direction=\"down\"} %.0f\n",
+             wan_metrics_key(wan), p2_value(p.down) * 1e6f);
+        emit("wan_watcher_wan_p95_bits_per_second{wan=\"%s\",direction=\"up\"} %.0f\n",
+             wan_metrics_key(wan), p2_value(p.up) * 1e6f);
+    }
+    family("wan_peak_bits_per_second", "gauge", "Highest rate over the billing cycle.");
+    for (int wan = 1; wan <= wan_metrics_count(); wan++) {
+        const WanBandwidthPercentiles& p = bw_percentile_get(wan);
+        emit("wan_watcher_wan_peak_bits_per_second{wan=\"%s\",direction=\"down\"} %.0f\n",
+             wan_metrics_key(wan), p.down_peak_mbps * 1e6f);
+        emit("wan_watcher_wan_peak_bits_per_second{wan=\"%s\",direction=\"up\"} %.0f\n",
+             wan_metrics_key(wan), p.up_peak_mbps * 1e6f);
+    }
+}
+
+static void export_usage() {
+    const WanUsage* slots = data_usage_slots();
+    family("wan_usage_bytes", "gauge", "Bytes transferred over the billing cycle.");
+    for (int i = 0; i < MAX_WANS; i++) {
+        const WanUsage& u = slots[i];
+        if (u.name[0] == '\0') continue;
+        emit("wan_watcher_wan_usage_bytes{wan=\"%s\",direction=\"down\"} %llu\n",
+             u.name, (unsigned long long)u.rx_bytes);
+        emit("wan_watcher_wan_usage_bytes{wan=\"%s\",direction=\"up\"} %llu\n",
+             u.name, (unsigned long long)u.tx_bytes);
+    }
+    family("wan_usage_projected_bytes", "gauge", "Projected bytes (down + up) at the end of the billing cycle.");
+    for (int i = 0; i < MAX_WANS; i++) {
+        uint64_t projected;
+        if (slots[i].name[0] == '\0' || !data_usage_projection(slots[i], projected)) continue;
+        emit("wan_watcher_wan_usage_projected_bytes{wan=\"%s\"} %llu\n",
+             slots[i].name, (unsigned long long)projected);
+    }
+    family("wan_usage_cap_bytes", "gauge", "Configured data cap per billing cycle.");
+    const UsageSettings& s = data_usage_get_settings();
+    for (int i = 0; i < MAX_WANS; i++) {
+        if (s.cap_wan[i][0] == '\0') continue;
+        emit("wan_watcher_wan_usage_cap_bytes{wan=\"%s\"} %llu\n",
+             s.cap_wan[i], (unsigned long long)s.cap_gb[i] * 1000000000ULL);
+    }
+    family("usage_saves_total", "counter", "Data usage totals written to NVS.");
+    emit("wan_watcher_usage_saves_total %u\n", data_usage_get_stats().saves);
+}
+
+static void export_metrics_log() {
+    const MlogStats& m = mlog_get_stats();
+    family("metrics_log_samples_total", "counter", "Samples appended to the flash metrics log.");
+    emit("wan_watcher_metrics_log_samples_total %u\n", m.samples_logged);
+    family("metrics_log_bytes_written_total", "counter", "Bytes written to the flash metrics log.");
+    emit("wan_watcher_metrics_log_bytes_written_total %u\n", m.bytes_written);
+    family("metrics_log_write_errors_total", "counter", "Failed metrics log writes.");
+    emit("wan_watcher_metrics_log_write_errors_total %u\n", m.write_errors);
+    family("metrics_log_restored_samples", "gauge", "Samples replayed from the metrics log at boot.");
+    emit("wan_watcher_metrics_log_restored_samples %u\n", m.restored_samples);
+    family("metrics_log_torn_tails", "gauge", "Damaged metrics log blocks skipped at boot.");
+    emit("wan_watcher_metrics_log_torn_tails %u\n", m.torn_tails);
+}
+
+static void export_ingest() {
+    const UdpIngestStats& udp = udp_ingest_get_stats();
+    family("udp_ingest_datagrams_total", "counter", "UDP ingest datagrams by outcome.");
+    emit("wan_watcher_udp_ingest_datagrams_total{result=\"received\"} %u\n", udp.received);
+    emit("wan_watcher_udp_ingest_datagrams_total{result=\"accepted\"} %u\n", udp.accepted);
+    emit("wan_watcher_udp_ingest_datagrams_total{result=\"bad_mac\"} %u\n", udp.bad_mac);
+    emit("wan_watcher_udp_ingest_datagrams_total{result=\"malformed\"} %u\n", udp.malformed);
+    emit("wan_watcher_udp_ingest_datagrams_total{result=\"duplicate\"} %u\n", udp.duplicate);
+    emit("wan_watcher_udp_ingest_datagrams_total{result=\"out_of_order\"} %u\n", udp.out_of_order);
+    emit("wan_watcher_udp_ingest_datagrams_total{result=\"stale\"} %u\n", udp.stale);
+    family("udp_ingest_ahead_total", "counter", "UDP datagrams applied without moving the time mark.");
+    emit("wan_watcher_udp_ingest_ahead_total %u\n", udp.ahead);
+    family("udp_ingest_lost_total", "counter", "UDP ingest sequence gaps.");
+    emit("wan_watcher_udp_ingest_lost_total %u\n", udp.lost);
+    family("udp_ingest_sessions_total", "counter", "UDP ingest sender sessions started.");
+    emit("wan_watcher_udp_ingest_sessions_total %u\n", udp.sessions);
+
+    const StreamIngestStats& st = stream_ingest_get_stats();
+    family("stream_ingest_connected", "gauge", "Whether a stream collector is connected.");
+    emit("wan_watcher_stream_ingest_connected %d\n", st.connected ? 1 : 0);
+    family("stream_ingest_connects_total", "counter", "Stream connections accepted.");
+    emit("wan_watcher_stream_ingest_connects_total %u\n", st.connects);
+    family("stream_ingest_refused_total", "counter", "Stream connections closed before ingest, by reason.");
+    emit("wan_watcher_stream_ingest_refused_total{reason=\"rejected\"} %u\n", st.rejected);
+    emit("wan_watcher_stream_ingest_refused_total{reason=\"auth\"} %u\n", st.auth_failures);
+    family("stream_ingest_records_total", "counter", "Stream records applied.");
+    emit("wan_watcher_stream_ingest_records_total %u\n", st.records);
+    family("stream_ingest_parse_errors_total", "counter", "Malformed stream records.");
+    emit("wan_watcher_stream_ingest_parse_errors_total %u\n", st.parse_errors);
+
+    const SnmpStats& sn = snmp_get_stats();
+    family("snmp_requests_total", "counter", "SNMP GetRequests sent, including retries.");
+    emit("wan_watcher_snmp_requests_total %u\n", sn.requests);
+    family("snmp_polls_total", "counter", "SNMP polls by outcome.");
+    emit("wan_watcher_snmp_polls_total{result=\"ok\"} %u\n", sn.responses);
+    emit("wan_watcher_snmp_polls_total{result=\"timeout\"} %u\n", sn.timeouts);
+    emit("wan_watcher_snmp_polls_total{result=\"error\"} %u\n", sn.errors);
+    family("snmp_counter_resets_total", "counter", "Interface octet counters that went backwards.");
+    emit("wan_watcher_snmp_counter_resets_total %u\n", sn.counter_resets);
+    family("snmp_rtt_seconds", "gauge", "Round trip time of the last SNMP poll.");
+    emit("wan_watcher_snmp_rtt_seconds %.3f\n", sn.last_rtt_ms / 1000.0f);
+
+    const WanCounterStats& wc = wan_counters_get_stats();
+    family("counter_samples_total", "counter", "Reported byte counter samples by outcome.");
+    emit("wan_watcher_counter_samples_total{result=\"rate\"} %u\n", wc.rates);
+    emit("wan_watcher_counter_samples_total{result=\"primed\"} %u\n", wc.samples - wc.rates);
+    family("counter_resets_total", "counter", "Reported byte counters or clocks that went backwards.");
+    emit("wan_watcher_counter_resets_total %u\n", wc.resets);
+    family("counter_wraps_total", "counter", "Reported 32-bit byte counters that wrapped.");
+    emit("wan_watcher_counter_wraps_total %u\n", wc.wraps);
+}
+
+static void export_mqtt() {
+    const MqttStats& mq = mqtt_get_stats();
+    family("mqtt_connected", "gauge", "Whether the MQTT broker session is up.");
+    emit("wan_watcher_mqtt_connected %d\n", mq.connected ? 1 : 0);
+    family("mqtt_connects_total", "counter", "MQTT connection attempts by outcome.");
+    emit("wan_watcher_mqtt_connects_total{result=\"ok\"} %u\n", mq.connects);
+    emit("wan_watcher_mqtt_connects_total{result=\"failed\"} %u\n", mq.connect_failures);
+    family("mqtt_messages_total", "counter", "MQTT messages by outcome.");
+    emit("wan_watcher_mqtt_messages_total{result=\"published\"} %u\n", mq.published);
+    emit("wan_watcher_mqtt_messages_total{result=\"coalesced\"} %u\n", mq.coalesced);
+    emit("wan_watcher_mqtt_messages_total{result=\"dropped\"} %u\n", mq.dropped);
+    family("mqtt_queue_length", "gauge", "MQTT messages waiting to be sent.");
+    emit("wan_watcher_mqtt_queue_length %u\n", mq.queued);
+}
+
+static void export_webhooks() {
+    const WebhookStats& wh = webhook_get_stats();
+    family("webhook_events_total", "counter", "State transitions by webhook outcome.");
+    emit("wan_watcher_webhook_events_total{result=\"queued\"} %u\n", wh.events);
+    emit("wan_watcher_webhook_events_total{result=\"dropped_full\"} %u\n", wh.dropped_full);
+    emit("wan_watcher_webhook_events_total{result=\"dropped_failed\"} %u\n", wh.dropped_failed);
+    family("webhook_batches_total", "counter", "Webhook batches delivered to every URL.");
+    emit("wan_watcher_webhook_batches_total %u\n", wh.batches);
+    family("webhook_failures_total", "counter", "Failed webhook POST attempts.");
+    emit("wan_watcher_webhook_failures_total %u\n", wh.failures);
+    family("webhook_retries_total", "counter", "Webhook delivery retries.");
+    emit("wan_watcher_webhook_retries_total %u\n", wh.retries);
+    family("webhook_queue_length", "gauge", "Webhook events waiting to be sent.");
+    emit("wan_watcher_webhook_queue_length %u\n", wh.queued);
+    family("webhook_last_latency_seconds", "gauge", "Transition to delivery time of the last batch.");
+    emit("wan_watcher_webhook_last_latency_seconds %.3f\n", wh.last_latency_ms / 1000.0f);
+    family("webhook_max_latency_seconds", "gauge", "Longest transition to delivery time since boot.");
+    emit("wan_watcher_webhook_max_latency_seconds %.3f\n", wh.max_latency_ms / 1000.0f);
+}
+
+// ---- Public API ----
+
+void metrics_export(WebServer& server) {
+    g_server = &server;
+    g_len = 0;
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, CONTENT_TYPE, "");
+
+    export_wans();
+    export_local_pinger();
+    export_panel();
+    export_system();
+    export_ingest();
+    export_mqtt();
+    export_webhooks();
+    export_log();
+    export_gossip();
+    export_history();
+    export_metrics_log();
+    export_events();
+    export_state_policy();
+    export_billing();
+    export_usage();
+
+    flush_chunk();
+    server.sendContent("");  // terminating chunk
+    g_server = nullptr;
+}
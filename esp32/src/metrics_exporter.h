@@ -0,0 +1,13 @@
+// metrics_exporter.h
+// Prometheus text exposition (format 0.0.4) for GET /metrics
+//
+// The response is streamed with chunked transfer encoding through a small
+// fixed buffer, so no intermediate document or String is ever built.
+#pragma once
+
+#include <WebServer.h>
+
+static const size_t METRICS_CHUNK_BYTES = 1024;  // flush threshold for one chunk
+
+// Write all metric families to the client
+void metrics_export(WebServer& server);
@@ -0,0 +1,138 @@
+// metrics_history.cpp
+#include "metrics_history.h"
+#include "esp_timer.h"
+
+static const char* RES_NAMES[(int)HistoryRes::COUNT] = { "15s", "1m", "15m", "1h" };
+
+static HistoryBucket g_s15[HISTORY_SOURCES][HISTORY_SLOTS_15S];
+static HistoryBucket g_m1[HISTORY_SOURCES][HISTORY_SLOTS_1M];
+static HistoryBucket g_m15[HISTORY_SOURCES][HISTORY_SLOTS_15M];
+static HistoryBucket g_h1[HISTORY_SOURCES][HISTORY_SLOTS_1H];
+
+static HistoryStats g_stats;
+static uint32_t g_clock_base_s = 0;
+
+// First slot of a source's ring for one resolution
+static HistoryBucket* ring(int source, HistoryRes res) {
+    switch (res) {
+        case HistoryRes::S15: return g_s15[source];
+        case HistoryRes::M1:  return g_m1[source];
+        case HistoryRes::M15: return g_m15[source];
+        default:              return g_h1[source];
+    }
+}
+
+static uint16_t to_tenths(float mbps) {
+    if (!(mbps > 0.0f)) return 0;
+    float tenths = mbps * 10.0f + 0.5f;
+    return (tenths >= 65535.0f) ? 65535 : (uint16_t)tenths;
+}
+
+static void fold(HistoryBucket& b, uint32_t start_s, const HistorySample& s) {
+    uint16_t down = to_tenths(s.down_mbps);
+    uint16_t up = to_tenths(s.up_mbps);
+
+    if (b.samples == 0 || b.start_s != start_s) {
+        memset(&b, 0, sizeof(b));
+        b.start_s = start_s;
+        b.latency_min = b.latency_max = s.latency_ms;
+        b.jitter_min = b.jitter_max = s.jitter_ms;
+        b.loss_min = b.loss_max = s.loss_pct;
+        b.down_min = b.down_max = down;
+        b.up_min = b.up_max = up;
+    } else if (b.samples == UINT16_MAX) {
+        return;  // saturated; keep the summary so far
+    }
+
+    b.samples++;
+    b.latency_min = min(b.latency_min, s.latency_ms);
+    b.latency_max = max(b.latency_max, s.latency_ms);
+    b.jitter_min = min(b.jitter_min, s.jitter_ms);
+    b.jitter_max = max(b.jitter_max, s.jitter_ms);
+    b.loss_min = min(b.loss_min, s.loss_pct);
+    b.loss_max = max(b.loss_max, s.loss_pct);
+    b.down_min = min(b.down_min, down);
+    b.down_max = max(b.down_max, down);
+    b.up_min = min(b.up_min, up);
+    b.up_max = max(b.up_max, up);
+    b.latency_sum += s.latency_ms;
+    b.jitter_sum += s.jitter_ms;
+    b.loss_sum += s.loss_pct;
+    b.down_sum += down;
+    b.up_sum += up;
+}
+
+uint32_t history_now_s() {
+    return g_clock_base_s + (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+void history_set_clock_base(uint32_t base_s) {
+    g_clock_base_s = base_s;
+}
+
+void history_add(int source, const HistorySample& sample) {
+    history_add_at(source, sample, history_now_s());
+}
+
+void history_add_at(int source, const HistorySample& sample, uint32_t t_s) {
+    if (source < 0 || source > HISTORY_MAX_WANS) {
+        g_stats.skipped++;
+        return;
+    }
+
+    for (int r = 0; r < (int)HistoryRes::COUNT; r++) {
+        uint32_t period = HISTORY_PERIOD_S[r];
+        uint32_t n = t_s / period;
+        HistoryBucket& b = ring(source, (HistoryRes)r)[n % HISTORY_SLOTS[r]];
+        fold(b, n * period, sample);
+    }
+    g_stats.samples++;
+}
+
+void history_forget(int wan_id) {
+    if (wan_id < 1) return;
+    wan_id_erase(g_s15, wan_id);
+    wan_id_erase(g_m1, wan_id);
+    wan_id_erase(g_m15, wan_id);
+    wan_id_erase(g_h1, wan_id);
+}
+
+bool history_res_from_string(const char* text, HistoryRes& out) {
+    for (int r = 0; r < (int)HistoryRes::COUNT; r++) {
+        if (strcmp(text, RES_NAMES[r]) == 0) {
+            out = (HistoryRes)r;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* history_res_to_string(HistoryRes res) {
+    return RES_NAMES[(int)res];
+}
+
+int history_visit(int source, HistoryRes res, uint32_t since_s, HistoryVisitor visit, void* ctx) {
+    if (source < 0 || source > HISTORY_MAX_WANS) return 0;
+
+    const HistoryBucket* slots = ring(source, res);
+    uint32_t period = HISTORY_PERIOD_S[(int)res];
+    uint32_t slot_count = HISTORY_SLOTS[(int)res];
+    uint32_t current = history_now_s() / period;
+
+    // Oldest first: the slot after the current one is the oldest period still
+    // in the ring. A slot is valid only if it holds exactly that period.
+    int visited = 0;
+    for (uint32_t age = slot_count; age-- > 0;) {
+        if (age > current) continue;            // before the clock started
+        uint32_t n = current - age;
+        const HistoryBucket& b = slots[n % slot_count];
+        if (b.samples == 0 || b.start_s != n * period || b.start_s < since_s) continue;
+        visit(b, ctx);
+        visited++;
+    }
+    return visited;
+}
+
+const HistoryStats& history_get_stats() {
+    return g_stats;
+}
@@ -0,0 +1,90 @@
+// metrics_history.h
+// Fixed-memory min/max/avg history per WAN and for the local pinger
+//
+// Each source keeps one ring per resolution. A ring slot covers one period
+// and is keyed by the period's start time, so adding a sample is O(1): find
+// the slot for "now", restart it if it still holds an older period, then
+// fold the sample in. Periods without samples are never written; readers
+// skip slots whose start is outside the ring's span. All rings are static,
+// so memory use is fixed at compile time (about 12 KB per source).
+//
+// Times are on the history clock: seconds since boot (esp_timer, no wrap)
+// plus a base that the metrics log sets at boot, so the clock continues
+// from the last logged sample and restored buckets stay in place (downtime
+// is not counted). Samples come from wan_metrics_commit_at() (each report)
+// and the local pinger's stats pass (once a second). Only the first
+// HISTORY_MAX_WANS WANs are recorded.
+#pragma once
+
+#include <Arduino.h>
+#include "wan_metrics.h"
+
+static const int HISTORY_MAX_WANS = 4;
+static const int HISTORY_SOURCES = HISTORY_MAX_WANS + 1;   // local, then WANs
+
+enum class HistoryRes : uint8_t { S15, M1, M15, H1, COUNT };
+
+static const uint32_t HISTORY_PERIOD_S[(int)HistoryRes::COUNT] = { 15, 60, 900, 3600 };
+static const int HISTORY_SLOTS_15S = 60;    // 15 min
+static const int HISTORY_SLOTS_1M = 60;     // 1 h
+static const int HISTORY_SLOTS_15M = 64;    // 16 h
+static const int HISTORY_SLOTS_1H = 96;     // 4 days
+static const int HISTORY_SLOTS[(int)HistoryRes::COUNT] = {
+    HISTORY_SLOTS_15S, HISTORY_SLOTS_1M, HISTORY_SLOTS_15M, HISTORY_SLOTS_1H
+};
+
+// One period. Bandwidth is kept in 0.1 Mbit/s steps (saturating at
+// 6553.5 Mbit/s) so a slot fits in 44 bytes.
+struct HistoryBucket {
+    uint32_t start_s;           // period start (history clock)
+    uint16_t samples;           // 0 = slot never used
+    uint16_t latency_min, latency_max;
+    uint16_t jitter_min, jitter_max;
+    uint8_t loss_min, loss_max;
+    uint16_t down_min, down_max;    // 0.1 Mbit/s
+    uint16_t up_min, up_max;
+    uint32_t latency_sum;
+    uint32_t jitter_sum;
+    uint32_t loss_sum;
+    uint32_t down_sum;
+    uint32_t up_sum;
+};
+
+struct HistorySample {
+    uint16_t latency_ms;
+    uint16_t jitter_ms;
+    uint8_t loss_pct;
+    float down_mbps;
+    float up_mbps;
+};
+
+struct HistoryStats {
+    uint32_t samples;           // samples folded in since boot
+    uint32_t skipped;           // samples for WANs beyond HISTORY_MAX_WANS
+};
+
+// Current history clock time (seconds)
+uint32_t history_now_s();
+
+// Continue the clock from base_s (call once at boot, before new samples)
+void history_set_clock_base(uint32_t base_s);
+
+// Fold a sample into every resolution (source: LOCAL_PINGER_ID or a WAN id)
+void history_add(int source, const HistorySample& sample);
+
+// Same, at an earlier time (restoring logged samples, oldest first)
+void history_add_at(int source, const HistorySample& sample, uint32_t t_s);
+
+// Drop a forgotten WAN's rings; later WANs move down with their ids
+void history_forget(int wan_id);
+
+// Parse "15s", "1m", "15m", "1h"; false if unknown
+bool history_res_from_string(const char* text, HistoryRes& out);
+const char* history_res_to_string(HistoryRes res);
+
+// Walk the valid buckets of one ring, oldest first, that started at or after
+// since_s. Returns the number passed to the callback.
+typedef void (*HistoryVisitor)(const HistoryBucket& bucket, void* ctx);
+int history_visit(int source, HistoryRes res, uint32_t since_s, HistoryVisitor visit, void* ctx);
+
+const HistoryStats& history_get_stats();
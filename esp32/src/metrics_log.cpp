@@ -0,0 +1,447 @@
+// metrics_log.cpp
+#include "metrics_log.h"
+#include "gorilla_codec.h"
+#include "metrics_history.h"
+#include "wan_metrics.h"
+#include "local_pinger.h"
+#include "logger.h"
+#include <LittleFS.h>
+#include <stddef.h>
+#include "esp_rom_crc.h"
+
+static const uint8_t MLOG_FORMAT = 1;
+static const int MLOG_SOURCES = MAX_WANS + 1;   // local, then WAN ids
+static const char* LOCAL_SOURCE_NAME = "local";
+static const uint8_t FORGET_SOURCE_ID = 0xFF;   // empty block: the WAN was forgotten
+
+// Fields after the timestamp, in stream order: state (2 raw bits), then
+// latency, jitter, loss, down, up as XOR-coded 32-bit words
+enum MlogField { F_LATENCY, F_JITTER, F_LOSS, F_DOWN, F_UP, F_COUNT };
+static const int SAMPLE_MAX_BITS = GORILLA_TIME_MAX_BITS + 2 + F_COUNT * GORILLA_XOR_MAX_BITS;
+
+struct __attribute__((packed)) SegmentHeader {
+    char magic[2];              // "MS"
+    uint8_t format;
+    uint8_t reserved;
+    uint32_t seq;               // higher = newer
+};
+
+struct __attribute__((packed)) BlockHeader {
+    char magic[2];              // "MB"
+    uint8_t format;
+    uint8_t source_id;          // WAN id when written (LOCAL_PINGER_ID for local)
+    char source[WAN_NAME_LEN];  // WAN name or "local"
+    uint16_t count;             // samples in the payload
+    uint16_t payload_len;
+    uint32_t t0;                // history clock the time stream starts from
+    uint32_t crc;               // CRC-32 of the header up to here, then the payload
+};
+
+// One source's open block
+struct SourceLog {
+    uint8_t payload[MLOG_BLOCK_PAYLOAD];
+    BitWriter w;
+    GorillaTime time;
+    GorillaXor fields[F_COUNT];
+    uint16_t count;
+    uint32_t t0;
+    unsigned long opened_ms;
+    WanState last_state;
+    bool have_sample;
+    uint32_t last_sample_s;
+    unsigned long seen_update_ms;   // WAN record already logged
+};
+
+// Last logged record per WAN, collected while replaying
+struct RestoredRecord {
+    bool valid;
+    WanState state;
+    HistorySample sample;
+};
+
+static SourceLog g_src[MLOG_SOURCES];
+static MlogStats g_stats;
+static int g_seg_index = MLOG_SEGMENTS - 1;     // next rotation starts at 0
+static size_t g_seg_bytes = 0;
+static bool g_need_rotate = true;               // no usable segment yet
+
+// While restoring: WANs whose last word in the log is a forget block
+static char g_forgotten[MAX_WANS][WAN_NAME_LEN];
+
+static void segment_path(int index, char* out, size_t len) {
+    snprintf(out, len, "%s/%d.bin", MLOG_DIR, index);
+}
+
+static uint32_t block_crc(const BlockHeader& h, const uint8_t* payload) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&h, offsetof(BlockHeader, crc));
+    return esp_rom_crc32_le(crc, payload, h.payload_len);
+}
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bits_float(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// ---- Writing ----
+
+// Truncate the oldest segment and make it the current one
+static bool rotate() {
+    g_seg_index = (g_seg_index + 1) % MLOG_SEGMENTS;
+    char path[24];
+    segment_path(g_seg_index, path, sizeof(path));
+
+    SegmentHeader h = { { 'M', 'S' }, MLOG_FORMAT, 0, g_stats.segment_seq + 1 };
+    File f = LittleFS.open(path, "w");
+    bool ok = f && f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h);
+    if (f) f.close();
+    if (!ok) {
+        g_stats.write_errors++;
+        return false;
+    }
+
+    g_stats.segment_seq = h.seq;
+    g_stats.bytes_written += sizeof(h);
+    g_seg_bytes = sizeof(h);
+    g_need_rotate = false;
+    return true;
+}
+
+static void write_block(const BlockHeader& h, const uint8_t* payload) {
+    size_t len = sizeof(h) + h.payload_len;
+    if (g_need_rotate || g_seg_bytes + len > MLOG_SEGMENT_BYTES) {
+        if (!rotate()) return;
+    }
+
+    char path[24];
+    segment_path(g_seg_index, path, sizeof(path));
+    File f = LittleFS.open(path, "a");
+    bool ok = f &&
+              f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+              f.write(payload, h.payload_len) == h.payload_len;
+    if (f) f.close();
+
+    if (!ok) {
+        // The tail may hold part of this block now; don't append after it
+        g_stats.write_errors++;
+        g_need_rotate = true;
+        return;
+    }
+    g_seg_bytes += len;
+    g_stats.blocks_written++;
+    g_stats.bytes_written += len;
+}
+
+static void init_header(BlockHeader& h, uint8_t source_id, const char* name) {
+    memset(&h, 0, sizeof(h));
+    h.magic[0] = 'M';
+    h.magic[1] = 'B';
+    h.format = MLOG_FORMAT;
+    h.source_id = source_id;
+    strlcpy(h.source, name, sizeof(h.source));
+}
+
+static void flush(int source) {
+    SourceLog& s = g_src[source];
+    if (s.count == 0) return;
+
+    BlockHeader h;
+    init_header(h, (uint8_t)source,
+                source == LOCAL_PINGER_ID ? LOCAL_SOURCE_NAME : wan_metrics_key(source));
+    h.count = s.count;
+    h.payload_len = (uint16_t)((s.w.pos_bits + 7) / 8);
+    h.t0 = s.t0;
+    h.crc = block_crc(h, s.payload);
+
+    write_block(h, s.payload);
+    s.count = 0;
+}
+
+static void log_sample(int source, uint32_t t, WanState state, const HistorySample& sample) {
+    SourceLog& s = g_src[source];
+    if (s.count > 0 && s.w.cap_bits - s.w.pos_bits < (size_t)SAMPLE_MAX_BITS) flush(source);
+
+    if (s.count == 0) {
+        bit_writer_init(s.w, s.payload, sizeof(s.payload));
+        gorilla_time_init(s.time, t);
+        for (GorillaXor& x : s.fields) gorilla_xor_init(x);
+        s.t0 = t;
+        s.opened_ms = millis();
+    }
+
+    gorilla_put_time(s.w, s.time, t);
+    bits_put(s.w, (uint32_t)state, 2);
+    gorilla_put_xor(s.w, s.fields[F_LATENCY], sample.latency_ms);
+    gorilla_put_xor(s.w, s.fields[F_JITTER], sample.jitter_ms);
+    gorilla_put_xor(s.w, s.fields[F_LOSS], sample.loss_pct);
+    gorilla_put_xor(s.w, s.fields[F_DOWN], float_bits(sample.down_mbps));
+    gorilla_put_xor(s.w, s.fields[F_UP], float_bits(sample.up_mbps));
+    s.count++;
+    g_stats.samples_logged++;
+
+    bool state_changed = s.have_sample && state != s.last_state;
+    s.have_sample = true;
+    s.last_sample_s = t;
+    s.last_state = state;
+
+    // Persist transitions at once, so a restart restores the latest state
+    if (state_changed) flush(source);
+}
+
+// Write out the other WANs' open blocks while their ids still hold, drop the
+// forgotten WAN's, and log a forget block so the next boot leaves it out
+static void on_forget(int wan_id) {
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        if (id != wan_id) flush(id);
+    }
+    g_src[wan_id].count = 0;
+    wan_id_erase(g_src, wan_id);
+
+    BlockHeader h;
+    init_header(h, FORGET_SOURCE_ID, wan_metrics_key(wan_id));
+    h.t0 = history_now_s();
+    h.crc = block_crc(h, nullptr);
+    write_block(h, nullptr);
+}
+
+// ---- Restoring ----
+
+static int forgotten_find(const char* name) {
+    for (int i = 0; i < MAX_WANS; i++) {
+        if (strcmp(g_forgotten[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static void replay_block(const BlockHeader& h, const uint8_t* payload,
+                         RestoredRecord* restored, uint32_t& last_t) {
+    char name[WAN_NAME_LEN];
+    strlcpy(name, h.source, sizeof(name));
+
+    // Forgotten unless it is logged again later; only names in the table
+    // matter, so the list can't overflow
+    int slot = forgotten_find(name);
+    if (h.source_id == FORGET_SOURCE_ID) {
+        if (slot < 0 && wan_metrics_find(name) != 0) slot = forgotten_find("");
+        if (slot >= 0) strlcpy(g_forgotten[slot], name, WAN_NAME_LEN);
+        return;
+    }
+    if (slot >= 0) g_forgotten[slot][0] = '\0';
+
+    bool local = strcmp(name, LOCAL_SOURCE_NAME) == 0;
+    int id = local ? LOCAL_PINGER_ID : wan_metrics_find_or_add(name);
+    if (!local && id == 0) return;   // invalid name or table full
+
+    BitReader r;
+    bit_reader_init(r, payload, h.payload_len);
+    GorillaTime time;
+    GorillaXor fields[F_COUNT];
+    gorilla_time_init(time, h.t0);
+    for (GorillaXor& x : fields) gorilla_xor_init(x);
+
+    for (uint16_t i = 0; i < h.count; i++) {
+        uint32_t t = gorilla_get_time(r, time);
+        uint32_t state = bits_get(r, 2);
+        HistorySample s;
+        s.latency_ms = (uint16_t)gorilla_get_xor(r, fields[F_LATENCY]);
+        s.jitter_ms = (uint16_t)gorilla_get_xor(r, fields[F_JITTER]);
+        s.loss_pct = (uint8_t)gorilla_get_xor(r, fields[F_LOSS]);
+        s.down_mbps = bits_float(gorilla_get_xor(r, fields[F_DOWN]));
+        s.up_mbps = bits_float(gorilla_get_xor(r, fields[F_UP]));
+        if (!r.ok || state > (uint32_t)WanState::UP) break;
+
+        history_add_at(id, s, t);
+        g_stats.restored_samples++;
+        if (t > last_t) last_t = t;
+        if (!local) restored[id - 1] = { true, (WanState)state, s };
+    }
+}
+
+// Collect the WAN names of one segment by the id they had when written
+static void scan_names(File& f, char (*names)[WAN_NAME_LEN]) {
+    BlockHeader h;
+    while (f.read((uint8_t*)&h, sizeof(h)) == sizeof(h)) {
+        if (h.magic[0] != 'M' || h.magic[1] != 'B' || h.format != MLOG_FORMAT) break;
+        if (h.source_id >= 1 && h.source_id <= MAX_WANS) {
+            strlcpy(names[h.source_id - 1], h.source, WAN_NAME_LEN);
+        } else if (h.source_id == FORGET_SOURCE_ID) {
+            for (int i = 0; i < MAX_WANS; i++) {
+                if (strncmp(names[i], h.source, WAN_NAME_LEN) == 0) names[i][0] = '\0';
+            }
+        }
+        if (!f.seek(f.position() + h.payload_len)) break;
+    }
+}
+
+// Replay one segment's blocks; returns the offset after the last good block
+static size_t replay_segment(File& f, RestoredRecord* restored, uint32_t& last_t) {
+    static uint8_t payload[MLOG_BLOCK_PAYLOAD];
+    size_t good = sizeof(SegmentHeader);
+
+    while (f.available() > 0) {
+        BlockHeader h;
+        bool ok = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+                  h.magic[0] == 'M' && h.magic[1] == 'B' &&
+                  h.format == MLOG_FORMAT &&
+                  h.payload_len <= sizeof(payload) &&
+                  f.read(payload, h.payload_len) == h.payload_len &&
+                  block_crc(h, payload) == h.crc;
+        if (!ok) {
+            g_stats.torn_tails++;
+            break;
+        }
+        replay_block(h, payload, restored, last_t);
+        good += sizeof(h) + h.payload_len;
+    }
+    return good;
+}
+
+static void restore() {
+    unsigned long start = millis();
+
+    // Find the segments and order them oldest first
+    int order[MLOG_SEGMENTS];
+    uint32_t seqs[MLOG_SEGMENTS];
+    int found = 0;
+    for (int i = 0; i < MLOG_SEGMENTS; i++) {
+        char path[24];
+        segment_path(i, path, sizeof(path));
+        File f = LittleFS.open(path, "r");
+        if (!f) continue;
+        SegmentHeader h;
+        bool ok = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+                  h.magic[0] == 'M' && h.magic[1] == 'S' && h.format == MLOG_FORMAT;
+        f.close();
+        if (!ok) continue;
+
+        int pos = found++;
+        while (pos > 0 && seqs[pos - 1] > h.seq) {
+            seqs[pos] = seqs[pos - 1];
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        seqs[pos] = h.seq;
+        order[pos] = i;
+    }
+
+    // Re-register the WANs in their last id order, so ids match the
+    // previous boot (the log itself is ordered by flush time)
+    static char names[MAX_WANS][WAN_NAME_LEN];
+    for (int k = 0; k < found; k++) {
+        char path[24];
+        segment_path(order[k], path, sizeof(path));
+        File f = LittleFS.open(path, "r");
+        if (!f) continue;
+        f.seek(sizeof(SegmentHeader));
+        scan_names(f, names);
+        f.close();
+    }
+    for (int i = 0; i < MAX_WANS; i++) {
+        if (names[i][0] != '\0') wan_metrics_find_or_add(names[i]);
+    }
+
+    static RestoredRecord restored[MAX_WANS];
+    uint32_t last_t = 0;
+    for (int k = 0; k < found; k++) {
+        char path[24];
+        segment_path(order[k], path, sizeof(path));
+        File f = LittleFS.open(path, "r");
+        if (!f) continue;
+        f.seek(sizeof(SegmentHeader));
+        size_t size = f.size();
+        size_t good = replay_segment(f, restored, last_t);
+        f.close();
+
+        // Keep appending to the newest segment unless its tail is torn
+        if (k == found - 1) {
+            g_seg_index = order[k];
+            g_seg_bytes = good;
+            g_stats.segment_seq = seqs[k];
+            g_need_rotate = good != size;
+        }
+    }
+
+    // Forgotten WANs that came back in older blocks go again
+    for (int i = 0; i < MAX_WANS; i++) {
+        int id = wan_metrics_find(g_forgotten[i]);
+        if (g_forgotten[i][0] == '\0' || id == 0) continue;
+        wan_id_erase(restored, id - 1);
+        wan_metrics_forget(g_forgotten[i]);
+    }
+
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        const RestoredRecord& rec = restored[id - 1];
+        if (!rec.valid) continue;
+        WanMetrics& m = *wan_metrics_edit(id);   // id is 1..count
+        m.state = rec.state;
+        m.latency_ms = rec.sample.latency_ms;
+        m.jitter_ms = rec.sample.jitter_ms;
+        m.loss_pct = rec.sample.loss_pct;
+        m.down_mbps = m.down_1m = m.down_5m = m.down_15m = rec.sample.down_mbps;
+        m.up_mbps = m.up_1m = m.up_5m = m.up_15m = rec.sample.up_mbps;
+        wan_metrics_restore(id);
+        g_src[id].seen_update_ms = m.last_update_ms;   // not a new report
+        g_stats.restored_wans++;
+    }
+
+    // New samples continue after the last logged one
+    if (g_stats.restored_samples > 0) history_set_clock_base(last_t + 1);
+    g_stats.restore_ms = millis() - start;
+}
+
+// ---- Public API ----
+
+void mlog_init() {
+    // Mounted here rather than in setup_routes() so the restore runs before
+    // any ingest; a second begin() is a no-op
+    if (!LittleFS.begin()) {
+        LOG_ERROR("Metrics log: LittleFS mount failed, logging disabled");
+        return;
+    }
+    if (!LittleFS.exists(MLOG_DIR)) LittleFS.mkdir(MLOG_DIR);
+    g_stats.mounted = true;
+
+    restore();
+    wan_metrics_on_forget(on_forget);
+    LOG_INFO("Metrics log: restored %u samples, %u WANs in %u ms (%u torn)",
+             g_stats.restored_samples, g_stats.restored_wans,
+             g_stats.restore_ms, g_stats.torn_tails);
+}
+
+void mlog_update() {
+    if (!g_stats.mounted) return;
+    uint32_t now_s = history_now_s();
+
+    SourceLog& local = g_src[LOCAL_PINGER_ID];
+    const LocalPingerMetrics& lp = local_pinger_get();
+    if (lp.last_update_ms != 0 && (!local.have_sample || now_s - local.last_sample_s >= MLOG_SAMPLE_S)) {
+        log_sample(LOCAL_PINGER_ID, now_s, lp.state,
+                   { lp.latency_ms, lp.jitter_ms, lp.loss_pct, 0.0f, 0.0f });
+    }
+
+    // WANs: the newest report, at most one per MLOG_SAMPLE_S
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        SourceLog& s = g_src[id];
+        const WanMetrics& m = wan_metrics_get(id);
+        if (m.last_update_ms == 0 || m.last_update_ms == s.seen_update_ms) continue;
+        if (s.have_sample && now_s - s.last_sample_s < MLOG_SAMPLE_S) continue;
+        s.seen_update_ms = m.last_update_ms;
+        log_sample(id, now_s, m.state,
+                   { m.latency_ms, m.jitter_ms, m.loss_pct, m.down_mbps, m.up_mbps });
+    }
+
+    unsigned long now = millis();
+    for (int i = 0; i < MLOG_SOURCES; i++) {
+        if (g_src[i].count > 0 && now - g_src[i].opened_ms >= MLOG_FLUSH_MS) flush(i);
+    }
+}
+
+const MlogStats& mlog_get_stats() {
+    return g_stats;
+}
@@ -0,0 +1,53 @@
+// metrics_log.h
+// Crash-safe metrics log on LittleFS, replayed at boot
+//
+// Every MLOG_SAMPLE_S the log takes one sample per source (the local pinger
+// and each WAN with a new report) and appends it, Gorilla-compressed (see
+// gorilla_codec.h), to that source's block in RAM. A block is written out
+// when it is full, after MLOG_FLUSH_MS, or right after a state change, as
+// one append of a CRC-protected record. A typical sample costs 4-8 bytes,
+// so the panel writes a few hundred bytes every few minutes.
+//
+// The log is a ring of MLOG_SEGMENTS files. When the current segment is
+// full the oldest one is truncated and reused, so flash use is fixed.
+// Segment and block headers carry a sequence number / CRC; a torn tail
+// (power lost mid-append) fails its CRC, is counted and skipped, and the
+// next write starts a fresh segment.
+//
+// mlog_init() replays the whole log (bounded by its size) into the metrics
+// history, restores each WAN's last logged record so the panel comes up
+// showing the last known state instead of DOWN, and continues the history
+// clock from the last logged sample. A forgotten WAN (wan_metrics_forget())
+// gets an empty forget block, and is not restored unless logged again after it.
+#pragma once
+
+#include <Arduino.h>
+
+static const char* MLOG_DIR = "/mlog";
+static const int MLOG_SEGMENTS = 4;
+static const size_t MLOG_SEGMENT_BYTES = 32 * 1024;
+static const size_t MLOG_BLOCK_PAYLOAD = 224;               // compressed samples per block
+static const uint32_t MLOG_SAMPLE_S = 15;                   // per source
+static const unsigned long MLOG_FLUSH_MS = 5 * 60 * 1000;   // max age of a RAM block
+
+struct MlogStats {
+    bool mounted;               // LittleFS available; nothing is logged otherwise
+    uint32_t segment_seq;       // sequence number of the segment being written
+    uint32_t samples_logged;
+    uint32_t blocks_written;
+    uint32_t bytes_written;
+    uint32_t write_errors;
+    uint32_t restored_samples;  // replayed into the history at boot
+    uint32_t restored_wans;     // WANs whose last record was restored
+    uint32_t torn_tails;        // blocks dropped at boot (bad CRC or short)
+    uint32_t restore_ms;        // time spent replaying the log at boot
+};
+
+// Mount LittleFS, replay the log and restore the last WAN records
+// (call in setup() after wan_metrics_init(), before any ingest starts)
+void mlog_init();
+
+// Sample sources and write out due blocks (call from loop())
+void mlog_update();
+
+const MlogStats& mlog_get_stats();
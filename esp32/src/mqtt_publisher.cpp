@@ -0,0 +1,353 @@
+// mqtt_publisher.cpp
+#include "mqtt_publisher.h"
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <ArduinoJson.h>
+#include "wan_metrics.h"
+#include "wan_fields.h"
+#include "local_pinger.h"
+#include "hostname.h"
+#include "logger.h"
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "dev"
+#endif
+
+static const char* DISCOVERY_PREFIX = "homeassistant";
+
+struct MqttMessage {
+    char topic[MQTT_TOPIC_LEN];
+    char payload[MQTT_PAYLOAD_LEN];
+    bool retain;
+    bool coalesce;              // may be replaced by a newer value for the same topic
+};
+
+// Home Assistant sensors: one per (source, field); local has no bandwidth
+struct DiscoverySensor {
+    const char* field;          // JSON key in the state payload
+    const char* label;
+    const char* unit;           // nullptr = none
+    const char* device_class;   // nullptr = none
+    bool wan_only;
+};
+
+static const DiscoverySensor SENSORS[] = {
+    { "state",      "state",    nullptr,  "enum",      false },
+    { "latency_ms", "latency",  "ms",     "duration",  false },
+    { "jitter_ms",  "jitter",   "ms",     "duration",  false },
+    { "loss_pct",   "loss",     "%",      nullptr,     false },
+    { "down_1m",    "download", "Mbit/s", "data_rate", true  },
+    { "up_1m",      "upload",   "Mbit/s", "data_rate", true  },
+};
+static const int SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+static const int SOURCE_COUNT = MAX_WANS + 1;  // wans, then local
+
+static WiFiClient g_net;
+static PubSubClient g_client(g_net);
+static MqttSettings g_settings = { "", MQTT_DEFAULT_PORT, "", "", MQTT_DEFAULT_INTERVAL_S };
+static MqttStats g_stats;
+
+static bool g_initialized = false;
+static char g_hostname[48] = "";
+static char g_base[64] = "";
+
+// Outbound queue (ring, oldest at g_head)
+static MqttMessage g_queue[MQTT_QUEUE_LEN];
+static int g_head = 0;
+static int g_count = 0;
+
+static unsigned long g_retry_ms = MQTT_RETRY_MIN_MS;
+static unsigned long g_last_attempt_ms = 0;
+static bool g_attempted = false;
+static unsigned long g_last_publish_ms = 0;
+static unsigned long g_published_update_ms[MAX_WANS];
+static int g_discovery_next = -1;  // next discovery config to send (-1 = done)
+static int g_discovered_wans = 0;  // WAN table size when discovery last ran
+
+// ---- Queue ----
+
+static void enqueue(const char* topic, const char* payload, bool retain, bool coalesce) {
+    if (coalesce) {
+        for (int i = 0; i < g_count; i++) {
+            MqttMessage& m = g_queue[(g_head + i) % MQTT_QUEUE_LEN];
+            if (m.coalesce && strcmp(m.topic, topic) == 0) {
+                strlcpy(m.payload, payload, sizeof(m.payload));
+                g_stats.coalesced++;
+                return;
+            }
+        }
+    }
+
+    if (g_count == MQTT_QUEUE_LEN) {
+        g_head = (g_head + 1) % MQTT_QUEUE_LEN;  // drop the oldest
+        g_count--;
+        g_stats.dropped++;
+    }
+
+    MqttMessage& m = g_queue[(g_head + g_count) % MQTT_QUEUE_LEN];
+    strlcpy(m.topic, topic, sizeof(m.topic));
+    strlcpy(m.payload, payload, sizeof(m.payload));
+    m.retain = retain;
+    m.coalesce = coalesce;
+    g_count++;
+}
+
+// Publish queued messages; a failed publish stays at the head for the next session
+static void drain() {
+    for (int n = 0; n < MQTT_DRAIN_PER_UPDATE && g_count > 0; n++) {
+        MqttMessage& m = g_queue[g_head];
+        if (!g_client.publish(m.topic, m.payload, m.retain)) return;
+        g_stats.published++;
+        g_head = (g_head + 1) % MQTT_QUEUE_LEN;
+        g_count--;
+    }
+}
+
+// ---- Payloads ----
+
+static const char* source_key(int source) {
+    return (source < MAX_WANS) ? wan_metrics_key(source + 1) : "local";
+}
+
+static void queue_wan(int wan_id) {
+    JsonDocument doc;
+    wan_fields_to_json(wan_metrics_get(wan_id), doc.to<JsonObject>());
+
+    char topic[MQTT_TOPIC_LEN];
+    char payload[MQTT_PAYLOAD_LEN];
+    snprintf(topic, sizeof(topic), "%s/%s", g_base, wan_metrics_key(wan_id));
+    serializeJson(doc, payload, sizeof(payload));
+    enqueue(topic, payload, true, true);
+    g_published_update_ms[wan_id - 1] = wan_metrics_get(wan_id).last_update_ms;
+}
+
+static void queue_local() {
+    const LocalPingerMetrics& lp = local_pinger_get();
+    char topic[MQTT_TOPIC_LEN];
+    char payload[MQTT_PAYLOAD_LEN];
+    snprintf(topic, sizeof(topic), "%s/local", g_base);
+    snprintf(payload, sizeof(payload),
+             "{\"state\":\"%s\",\"latency_ms\":%u,\"jitter_ms\":%u,\"loss_pct\":%u}",
+             wan_state_to_string(lp.state), lp.latency_ms, lp.jitter_ms, lp.loss_pct);
+    enqueue(topic, payload, true, true);
+}
+
+// Queue updates for sources with new data since their last publish
+static void queue_metrics() {
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        unsigned long updated = wan_metrics_get(id).last_update_ms;
+        if (updated != 0 && updated != g_published_update_ms[id - 1]) {
+            queue_wan(id);
+        }
+    }
+    if (local_pinger_get().last_update_ms != 0) {
+        queue_local();
+    }
+}
+
+static void on_state_change(int wan_id, WanState from, WanState to) {
+    if (!g_initialized || g_settings.host[0] == '\0') return;
+
+    const char* key = (wan_id == LOCAL_PINGER_ID) ? "local" : wan_metrics_key(wan_id);
+    char topic[MQTT_TOPIC_LEN];
+    char payload[MQTT_PAYLOAD_LEN];
+    snprintf(topic, sizeof(topic), "%s/event", g_base);
+    snprintf(payload, sizeof(payload), "{\"wan\":\"%s\",\"from\":\"%s\",\"to\":\"%s\"}",
+             key, wan_state_to_string(from), wan_state_to_string(to));
+    enqueue(topic, payload, false, false);
+
+    // The state topic follows right away instead of at the next interval
+    if (wan_id == LOCAL_PINGER_ID) {
+        queue_local();
+    } else {
+        queue_wan(wan_id);
+    }
+}
+
+// Clear a forgotten WAN's retained state topic and discovery configs
+// (an empty retained message deletes them at the broker)
+static void on_forget(int wan_id) {
+    wan_id_erase(g_published_update_ms, wan_id - 1);
+    if (!g_initialized || g_settings.host[0] == '\0') return;
+
+    const char* key = wan_metrics_key(wan_id);
+    char topic[MQTT_TOPIC_LEN];
+    snprintf(topic, sizeof(topic), "%s/%s", g_base, key);
+    enqueue(topic, "", true, false);
+    for (const DiscoverySensor& s : SENSORS) {
+        snprintf(topic, sizeof(topic), "%s/sensor/%s/%s_%s/config",
+                 DISCOVERY_PREFIX, g_hostname, key, s.field);
+        enqueue(topic, "", true, false);
+    }
+}
+
+// Publish one discovery config (sent directly, not queued: they are
+// regenerated on every connect)
+static bool publish_discovery(int index) {
+    int source = index / SENSOR_COUNT;
+    const DiscoverySensor& s = SENSORS[index % SENSOR_COUNT];
+    const char* key = source_key(source);
+    if (s.wan_only && source == MAX_WANS) return true;
+    if (source < MAX_WANS && source >= wan_metrics_count()) return true;  // unused position
+
+    JsonDocument doc;
+    char name[32];
+    char uid[96];
+    char state_topic[MQTT_TOPIC_LEN];
+    char avty_topic[MQTT_TOPIC_LEN];
+    char tpl[48];
+    snprintf(name, sizeof(name), "%s %s", key, s.label);
+    snprintf(uid, sizeof(uid), "%s_%s_%s", g_hostname, key, s.field);
+    snprintf(state_topic, sizeof(state_topic), "%s/%s", g_base, key);
+    snprintf(avty_topic, sizeof(avty_topic), "%s/availability", g_base);
+    snprintf(tpl, sizeof(tpl), "{{ value_json.%s }}", s.field);
+
+    doc["name"] = name;
+    doc["uniq_id"] = uid;
+    doc["stat_t"] = state_topic;
+    doc["val_tpl"] = tpl;
+    doc["avty_t"] = avty_topic;
+    if (s.unit) {
+        doc["unit_of_meas"] = s.unit;
+        doc["stat_cla"] = "measurement";
+    }
+    if (s.device_class) doc["dev_cla"] = s.device_class;
+    if (strcmp(s.field, "state") == 0) {
+        JsonArray options = doc["ops"].to<JsonArray>();
+        options.add("up");
+        options.add("degraded");
+        options.add("down");
+    }
+    JsonObject dev = doc["dev"].to<JsonObject>();
+    dev["ids"].to<JsonArray>().add(g_hostname);
+    dev["name"] = g_hostname;
+    dev["mdl"] = "WAN Watcher";
+    dev["sw"] = FIRMWARE_VERSION;
+
+    char topic[MQTT_TOPIC_LEN];
+    char payload[MQTT_PACKET_LEN - MQTT_TOPIC_LEN - 16];
+    snprintf(topic, sizeof(topic), "%s/sensor/%s/%s_%s/config",
+             DISCOVERY_PREFIX, g_hostname, key, s.field);
+    size_t len = serializeJson(doc, payload, sizeof(payload));
+    return g_client.publish(topic, (const uint8_t*)payload, len, true);
+}
+
+// ---- Connection ----
+
+static void try_connect() {
+    unsigned long now = millis();
+    if (g_attempted && now - g_last_attempt_ms < g_retry_ms) return;
+    g_attempted = true;
+    g_last_attempt_ms = now;
+
+    // Connect the socket with a bounded timeout; PubSubClient reuses it
+    if (!g_net.connect(g_settings.host, g_settings.port, MQTT_CONNECT_TIMEOUT_MS)) {
+        g_stats.connect_failures++;
+        g_retry_ms = min(g_retry_ms * 2, MQTT_RETRY_MAX_MS);
+        LOG_WARN("MQTT: %s:%u unreachable, retry in %lus",
+                      g_settings.host, g_settings.port, g_retry_ms / 1000);
+        return;
+    }
+
+    char will_topic[MQTT_TOPIC_LEN];
+    snprintf(will_topic, sizeof(will_topic), "%s/availability", g_base);
+    const char* user = g_settings.user[0] ? g_settings.user : nullptr;
+    const char* pass = g_settings.password[0] ? g_settings.password : nullptr;
+
+    if (!g_client.connect(g_hostname, user, pass, will_topic, 0, true, "offline")) {
+        g_net.stop();
+        g_stats.connect_failures++;
+        g_retry_ms = min(g_retry_ms * 2, MQTT_RETRY_MAX_MS);
+        LOG_WARN("MQTT: broker refused session (rc=%d)", g_client.state());
+        return;
+    }
+
+    g_retry_ms = MQTT_RETRY_MIN_MS;
+    g_stats.connects++;
+    g_client.publish(will_topic, "online", true);
+    g_discovery_next = 0;
+    g_discovered_wans = wan_metrics_count();
+    queue_metrics();  // fresh retained state for the new session
+    LOG_INFO("MQTT: connected to %s:%u", g_settings.host, g_settings.port);
+}
+
+// ---- Public API ----
+
+void mqtt_init() {
+    strlcpy(g_hostname, get_network_hostname().c_str(), sizeof(g_hostname));
+    snprintf(g_base, sizeof(g_base), "wan-watcher/%s", g_hostname);
+
+    g_client.setBufferSize(MQTT_PACKET_LEN);
+    wan_metrics_on_state_change(on_state_change);
+    wan_metrics_on_forget(on_forget);
+    g_initialized = true;
+
+    if (g_settings.host[0] != '\0') {
+        LOG_INFO("MQTT: broker %s:%u, topics under %s", g_settings.host, g_settings.port, g_base);
+    }
+}
+
+void mqtt_update() {
+    g_stats.enabled = g_settings.host[0] != '\0';
+    if (!g_initialized || !g_stats.enabled) return;
+
+    unsigned long now = millis();
+    if (now - g_last_publish_ms >= g_settings.interval_s * 1000UL) {
+        g_last_publish_ms = now;
+        queue_metrics();
+    }
+
+    if (!g_client.connected()) {
+        g_stats.connected = false;
+        try_connect();
+    }
+
+    if (g_client.connected()) {
+        g_stats.connected = true;
+        g_client.loop();
+
+        // A WAN seen for the first time needs its configs: resend them all
+        if (g_discovery_next < 0 && wan_metrics_count() != g_discovered_wans) {
+            g_discovery_next = 0;
+            g_discovered_wans = wan_metrics_count();
+        }
+
+        // Discovery configs first, one per loop()
+        if (g_discovery_next >= 0) {
+            if (publish_discovery(g_discovery_next)) g_discovery_next++;
+            if (g_discovery_next >= SOURCE_COUNT * SENSOR_COUNT) g_discovery_next = -1;
+        } else {
+            drain();
+        }
+    }
+
+    g_stats.queued = g_count;
+}
+
+void mqtt_set_settings(const MqttSettings& settings) {
+    g_settings = settings;
+    g_settings.host[sizeof(g_settings.host) - 1] = '\0';
+    g_settings.user[sizeof(g_settings.user) - 1] = '\0';
+    g_settings.password[sizeof(g_settings.password) - 1] = '\0';
+    if (g_settings.port == 0) g_settings.port = MQTT_DEFAULT_PORT;
+    g_settings.interval_s = constrain(g_settings.interval_s, 1, 3600);
+
+    // Reconnect with the new settings right away; queued messages are kept
+    if (g_client.connected()) {
+        char will_topic[MQTT_TOPIC_LEN];
+        snprintf(will_topic, sizeof(will_topic), "%s/availability", g_base);
+        g_client.publish(will_topic, "offline", true);  // a clean disconnect skips the will
+        g_client.disconnect();
+    }
+    g_net.stop();
+    g_attempted = false;
+    g_retry_ms = MQTT_RETRY_MIN_MS;
+}
+
+const MqttSettings& mqtt_get_settings() {
+    return g_settings;
+}
+
+const MqttStats& mqtt_get_stats() {
+    return g_stats;
+}
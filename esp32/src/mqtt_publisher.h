@@ -0,0 +1,63 @@
+// mqtt_publisher.h
+// Publishes WAN and local pinger metrics to an MQTT broker, with Home
+// Assistant discovery
+//
+// Topics (base = wan-watcher/<hostname>):
+//   <base>/availability  "online" / "offline" (retained, broker-side will)
+//   <base>/<wan>         WAN record per WAN name, same fields as /api/status (retained)
+//   <base>/local         local pinger state/latency/jitter/loss (retained)
+//   <base>/event         {"wan":"wan1","from":"up","to":"down"} per transition
+//   homeassistant/sensor/<hostname>/<object>/config  discovery (retained)
+//
+// Metric updates are coalesced: each topic is published at most once per
+// interval with its latest value. State transitions are queued at once and
+// go out on the next loop(). The queue has a fixed number of slots and is
+// kept across broker reconnects; when it is full the oldest message is
+// dropped. A queued metric update is replaced in place, so only events can
+// fill the queue.
+#pragma once
+
+#include <Arduino.h>
+
+static const uint16_t MQTT_DEFAULT_PORT = 1883;
+static const uint16_t MQTT_DEFAULT_INTERVAL_S = 30;   // metric publish interval
+static const int MQTT_QUEUE_LEN = 16;                 // outbound message slots
+static const size_t MQTT_TOPIC_LEN = 96;
+static const size_t MQTT_PAYLOAD_LEN = 512;
+static const size_t MQTT_PACKET_LEN = 768;            // client buffer (discovery configs)
+static const int MQTT_DRAIN_PER_UPDATE = 4;           // publishes per loop()
+static const unsigned long MQTT_CONNECT_TIMEOUT_MS = 1000;
+static const unsigned long MQTT_RETRY_MIN_MS = 5000;  // reconnect backoff
+static const unsigned long MQTT_RETRY_MAX_MS = 60000;
+
+// Broker settings (persisted by config_store). An empty host disables MQTT.
+struct MqttSettings {
+    char host[64];
+    uint16_t port;
+    char user[32];
+    char password[64];
+    uint16_t interval_s;        // metric publish interval (1-3600)
+};
+
+struct MqttStats {
+    bool enabled;               // a broker is configured
+    bool connected;
+    uint32_t connects;          // successful broker sessions since boot
+    uint32_t connect_failures;
+    uint32_t published;         // messages handed to the broker
+    uint32_t coalesced;         // metric updates replaced before sending
+    uint32_t dropped;           // messages lost to a full queue
+    uint8_t queued;             // messages waiting now
+};
+
+// Register for state transitions (call once in setup(), after the network is up)
+void mqtt_init();
+
+// Connect, queue due metric updates and publish (call from loop())
+void mqtt_update();
+
+// Change broker settings; an active session is closed and reopened
+void mqtt_set_settings(const MqttSettings& settings);
+const MqttSettings& mqtt_get_settings();
+
+const MqttStats& mqtt_get_stats();
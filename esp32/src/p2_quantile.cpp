@@ -0,0 +1,87 @@
+// p2_quantile.cpp
+#include "p2_quantile.h"
+
+void p2_init(P2Quantile& q, float p) {
+    memset(&q, 0, sizeof(q));
+    q.p = p;
+}
+
+static void sort5(float* v, int n) {
+    for (int i = 1; i < n; i++) {
+        float x = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+}
+
+// Desired position of marker i after count samples
+static float desired(const P2Quantile& q, int i) {
+    const float step[5] = { 0.0f, q.p / 2, q.p, (1.0f + q.p) / 2, 1.0f };
+    return (q.count - 1) * step[i];
+}
+
+static float parabolic(const P2Quantile& q, int i, int d) {
+    const float* h = q.height;
+    const int32_t* n = q.pos;
+    return h[i] + (float)d / (n[i + 1] - n[i - 1]) *
+           ((n[i] - n[i - 1] + d) * (h[i + 1] - h[i]) / (n[i + 1] - n[i]) +
+            (n[i + 1] - n[i] - d) * (h[i] - h[i - 1]) / (n[i] - n[i - 1]));
+}
+
+void p2_add(P2Quantile& q, float x) {
+    if (q.count < 5) {
+        q.height[q.count++] = x;
+        if (q.count == 5) {
+            sort5(q.height, 5);
+            for (int i = 0; i < 5; i++) q.pos[i] = i;
+        }
+        return;
+    }
+
+    // Cell the sample falls in; the extremes stretch to include it
+    int k;
+    if (x < q.height[0]) {
+        q.height[0] = x;
+        k = 0;
+    } else if (x >= q.height[4]) {
+        q.height[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && x >= q.height[k + 1]) k++;
+    }
+    for (int i = k + 1; i < 5; i++) q.pos[i]++;
+    q.count++;
+
+    // Move the middle markers towards their desired positions
+    for (int i = 1; i <= 3; i++) {
+        float off = desired(q, i) - q.pos[i];
+        bool up = off >= 1.0f && q.pos[i + 1] - q.pos[i] > 1;
+        bool down = off <= -1.0f && q.pos[i - 1] - q.pos[i] < -1;
+        if (!up && !down) continue;
+
+        int d = up ? 1 : -1;
+        float h = parabolic(q, i, d);
+        if (h <= q.height[i - 1] || h >= q.height[i + 1]) {
+            h = q.height[i] + d * (q.height[i + d] - q.height[i]) / (q.pos[i + d] - q.pos[i]);
+        }
+        q.height[i] = h;
+        q.pos[i] += d;
+    }
+}
+
+float p2_value(const P2Quantile& q) {
+    if (q.count == 0) return 0.0f;
+    if (q.count >= 5) return q.height[2];
+
+    // Nearest rank over the samples kept so far
+    float v[5];
+    memcpy(v, q.height, sizeof(v));
+    sort5(v, q.count);
+    int rank = (int)(q.p * (q.count - 1) + 0.5f);
+    return v[rank];
+}
@@ -0,0 +1,27 @@
+// p2_quantile.h
+// Streaming quantile estimate in fixed memory (P² algorithm)
+//
+// Jain & Chlamtac's P²: five markers track the minimum, the maximum, the
+// target quantile and the two midpoints around it. Each sample moves the
+// marker positions by one and adjusts heights with a parabolic (or, when
+// that would break the ordering, linear) fit, so an update is O(1) and the
+// estimator is 48 bytes whatever the number of samples. The first five
+// samples are kept exactly.
+#pragma once
+
+#include <Arduino.h>
+
+struct P2Quantile {
+    float p;                    // target quantile (0-1)
+    uint32_t count;             // samples seen
+    float height[5];            // marker heights (the samples themselves while count < 5)
+    int32_t pos[5];             // marker positions (0-based sample ranks)
+};
+static_assert(sizeof(P2Quantile) == 48, "P2Quantile size in the comment above is out of date");
+
+void p2_init(P2Quantile& q, float p);
+
+void p2_add(P2Quantile& q, float x);
+
+// Current estimate (0 before the first sample)
+float p2_value(const P2Quantile& q);
@@ -0,0 +1,432 @@
+// peer_gossip.cpp
+#include "peer_gossip.h"
+#include <ETH.h>
+#include <ESPmDNS.h>
+#include <WiFiUdp.h>
+#include "wan_metrics.h"
+#include "freshness_bar.h"
+#include "leds.h"
+#include "logger.h"
+
+static const uint8_t GOSSIP_FORMAT = 3;
+
+// Datagrams handled per gossip_update() call, so a burst can't stall loop()
+static const int MAX_DATAGRAMS_PER_UPDATE = 4;
+
+// Wire format, little-endian (every panel is an ESP32)
+struct __attribute__((packed)) GossipHeader {
+    char magic[2];              // "WG"
+    uint8_t format;             // GOSSIP_FORMAT
+    uint8_t count;              // records that follow
+    uint32_t sender;            // panel id of the sender (not the origin)
+};
+
+struct __attribute__((packed)) GossipRecord {
+    char name[WAN_NAME_LEN];    // WAN name, NUL-padded
+    uint8_t state;              // WanState
+    uint8_t loss_pct;
+    uint8_t reserved;
+    uint16_t latency_ms;
+    uint16_t jitter_ms;
+    uint64_t version;
+    uint32_t origin;            // panel that received the report from the collector
+    uint32_t age_ms;            // report age when this datagram was sent
+    float down_mbps;
+    float up_mbps;
+    float down_avg[3];          // 1m, 5m, 15m
+    float up_avg[3];
+    uint32_t local_ip;          // IPv4, 0 = unset
+    uint32_t gateway_ip;
+    uint32_t monitor_ip;
+};
+
+struct RecordVersion {
+    uint64_t version;
+    uint32_t origin;
+};
+
+// A WAN forgotten here, so peers' copies of its old reports don't add it back
+struct ForgottenWan {
+    char name[WAN_NAME_LEN];
+    unsigned long at_ms;
+};
+
+static const size_t MAX_DATAGRAM_BYTES = sizeof(GossipHeader) + MAX_WANS * sizeof(GossipRecord);
+
+static WiFiUDP g_udp;
+static bool g_started = false;
+static uint32_t g_self_id = 0;
+static GossipSettings g_settings = { true };
+static GossipStats g_stats;
+
+static RecordVersion g_versions[MAX_WANS];
+static uint64_t g_clock = 0;                        // highest version seen
+static bool g_seeded = false;                       // g_clock caught up with the peers
+static unsigned long g_start_ms = 0;
+static unsigned long g_known_update_ms[MAX_WANS];   // last_update_ms already versioned
+static unsigned long g_last_sync_ms = 0;
+static ForgottenWan g_forgotten[MAX_WANS];         // ring, oldest overwritten
+static int g_forgotten_next = 0;
+
+static GossipPeer g_peers[GOSSIP_MAX_PEERS];
+static int g_peer_count = 0;
+static portMUX_TYPE g_peers_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// ---- Peers ----
+
+// Add or refresh a peer; when the table is full the least recently seen goes
+static void add_peer(IPAddress ip, unsigned long now) {
+    taskENTER_CRITICAL(&g_peers_mux);
+    int slot = -1;
+    for (int i = 0; i < g_peer_count; i++) {
+        if (g_peers[i].ip == ip) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        if (g_peer_count < GOSSIP_MAX_PEERS) {
+            slot = g_peer_count++;
+        } else {
+            slot = 0;
+            for (int i = 1; i < g_peer_count; i++) {
+                if (g_peers[i].last_seen_ms < g_peers[slot].last_seen_ms) slot = i;
+            }
+        }
+        g_peers[slot].ip = ip;
+    }
+    g_peers[slot].last_seen_ms = now;
+    taskEXIT_CRITICAL(&g_peers_mux);
+}
+
+static void expire_peers(unsigned long now) {
+    taskENTER_CRITICAL(&g_peers_mux);
+    int kept = 0;
+    for (int i = 0; i < g_peer_count; i++) {
+        if (now - g_peers[i].last_seen_ms < GOSSIP_PEER_EXPIRE_MS) {
+            g_peers[kept++] = g_peers[i];
+        }
+    }
+    g_peer_count = kept;
+    taskEXIT_CRITICAL(&g_peers_mux);
+}
+
+int gossip_get_peers(GossipPeer* out, int max_peers) {
+    taskENTER_CRITICAL(&g_peers_mux);
+    int n = min(g_peer_count, max_peers);
+    for (int i = 0; i < n; i++) out[i] = g_peers[i];
+    taskEXIT_CRITICAL(&g_peers_mux);
+    return n;
+}
+
+// mDNS queries block for a few seconds, so they run on core 0
+static void discovery_task(void*) {
+    for (;;) {
+        if (g_settings.enabled) {
+            int found = MDNS.queryService("wanwatcher", "udp");
+            g_stats.discoveries++;
+            IPAddress self = ETH.localIP();
+            unsigned long now = millis();
+            for (int i = 0; i < found; i++) {
+                IPAddress ip = MDNS.IP(i);
+                if ((uint32_t)ip == 0 || ip == self) continue;
+                add_peer(ip, now);
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(GOSSIP_DISCOVER_MS));
+    }
+}
+
+// ---- Encoding ----
+
+static uint32_t ip_to_u32(const char* text) {
+    IPAddress ip;
+    return ip.fromString(text) ? (uint32_t)ip : 0;
+}
+
+static void u32_to_ip(uint32_t value, char* out, size_t size) {
+    if (value == 0) {
+        out[0] = '\0';
+        return;
+    }
+    strlcpy(out, IPAddress(value).toString().c_str(), size);
+}
+
+static void encode_record(GossipRecord& r, int wan_id, unsigned long now) {
+    const WanMetrics& m = wan_metrics_get(wan_id);
+    const RecordVersion& v = g_versions[wan_id - 1];
+    memset(&r, 0, sizeof(r));
+    strlcpy(r.name, wan_metrics_key(wan_id), sizeof(r.name));
+    r.state = (uint8_t)m.state;
+    r.loss_pct = m.loss_pct;
+    r.latency_ms = m.latency_ms;
+    r.jitter_ms = m.jitter_ms;
+    r.version = v.version;
+    r.origin = v.origin;
+    r.age_ms = now - m.last_update_ms;
+    r.down_mbps = m.down_mbps;
+    r.up_mbps = m.up_mbps;
+    r.down_avg[0] = m.down_1m;
+    r.down_avg[1] = m.down_5m;
+    r.down_avg[2] = m.down_15m;
+    r.up_avg[0] = m.up_1m;
+    r.up_avg[1] = m.up_5m;
+    r.up_avg[2] = m.up_15m;
+    r.local_ip = ip_to_u32(m.local_ip);
+    r.gateway_ip = ip_to_u32(m.gateway_ip);
+    r.monitor_ip = ip_to_u32(m.monitor_ip);
+}
+
+// Build a datagram with the records in mask (bit n = WAN id n+1)
+static size_t build(uint8_t* buf, uint32_t mask, unsigned long now) {
+    GossipHeader h = { { 'W', 'G' }, GOSSIP_FORMAT, 0, g_self_id };
+    size_t pos = sizeof(h);
+    for (int w = 0; w < wan_metrics_count(); w++) {
+        if (!(mask & (1u << w)) || g_versions[w].version == 0) continue;
+        GossipRecord r;
+        encode_record(r, w + 1, now);
+        memcpy(buf + pos, &r, sizeof(r));
+        pos += sizeof(r);
+        h.count++;
+    }
+    memcpy(buf, &h, sizeof(h));
+    return h.count > 0 ? pos : 0;
+}
+
+static void send_to(IPAddress ip, const uint8_t* buf, size_t len) {
+    if (g_udp.beginPacket(ip, GOSSIP_PORT) && g_udp.write(buf, len) == len && g_udp.endPacket()) {
+        g_stats.sent++;
+    } else {
+        g_stats.send_errors++;
+    }
+}
+
+// Send records to every peer except the one they came from
+static void broadcast(uint32_t mask, IPAddress except, unsigned long now) {
+    uint8_t buf[MAX_DATAGRAM_BYTES];
+    size_t len = build(buf, mask, now);
+    if (len == 0) return;
+
+    GossipPeer peers[GOSSIP_MAX_PEERS];
+    int n = gossip_get_peers(peers, GOSSIP_MAX_PEERS);
+    for (int i = 0; i < n; i++) {
+        if (peers[i].ip == except) continue;
+        send_to(peers[i].ip, buf, len);
+    }
+}
+
+// ---- Receiving ----
+
+static bool is_newer(const GossipRecord& r, const RecordVersion& cur) {
+    if (r.version != cur.version) return r.version > cur.version;
+    return r.origin > cur.origin;
+}
+
+// Only a report the collector made recently may add a WAN: not one that is
+// stale already, nor one made before the WAN was forgotten here
+static bool may_add(const GossipRecord& r, unsigned long now) {
+    if (r.age_ms > FRESHNESS_RED_BUFFER_END_MS) return false;
+    for (const ForgottenWan& f : g_forgotten) {
+        if (strcmp(f.name, r.name) == 0 && r.age_ms >= now - f.at_ms) return false;
+    }
+    return true;
+}
+
+static void apply_record(int wan_id, const GossipRecord& r, unsigned long now) {
+    int w = wan_id - 1;
+    WanMetrics& m = *wan_metrics_edit(wan_id);     // id from the table
+    m.state = (WanState)r.state;
+    m.loss_pct = r.loss_pct;
+    m.latency_ms = r.latency_ms;
+    m.jitter_ms = r.jitter_ms;
+    m.down_mbps = r.down_mbps;
+    m.up_mbps = r.up_mbps;
+    m.down_1m = r.down_avg[0];
+    m.down_5m = r.down_avg[1];
+    m.down_15m = r.down_avg[2];
+    m.up_1m = r.up_avg[0];
+    m.up_5m = r.up_avg[1];
+    m.up_15m = r.up_avg[2];
+    u32_to_ip(r.local_ip, m.local_ip, sizeof(m.local_ip));
+    u32_to_ip(r.gateway_ip, m.gateway_ip, sizeof(m.gateway_ip));
+    u32_to_ip(r.monitor_ip, m.monitor_ip, sizeof(m.monitor_ip));
+
+    // Freshness counts from the collector's report, not from this datagram
+    wan_metrics_commit_at(wan_id, (r.age_ms < now) ? now - r.age_ms : 1);
+    g_known_update_ms[w] = m.last_update_ms;
+    g_versions[w] = { r.version, r.origin };
+
+    wan_set_leds(wan_id, m.state);
+}
+
+static void handle_datagram(const uint8_t* buf, size_t len, IPAddress from, unsigned long now) {
+    GossipHeader h;
+    if (len < sizeof(h)) {
+        g_stats.malformed++;
+        return;
+    }
+    memcpy(&h, buf, sizeof(h));
+    if (h.magic[0] != 'W' || h.magic[1] != 'G' || h.format != GOSSIP_FORMAT ||
+        len != sizeof(h) + h.count * sizeof(GossipRecord)) {
+        g_stats.malformed++;
+        return;
+    }
+    if (h.sender == g_self_id) return;  // our own datagram
+
+    g_stats.received++;
+    add_peer(from, now);
+
+    uint32_t applied = 0;
+    uint32_t behind = 0;    // records the sender has an older copy of
+    uint32_t reversioned = 0;
+    for (int i = 0; i < h.count; i++) {
+        GossipRecord r;
+        memcpy(&r, buf + sizeof(h) + i * sizeof(r), sizeof(r));
+        if (r.name[WAN_NAME_LEN - 1] != '\0' || r.state > (uint8_t)WanState::UP ||
+            r.version == 0 || r.version > GOSSIP_VERSION_MAX) {
+            g_stats.malformed++;
+            continue;
+        }
+        // New names join the table (invalid names and a full table count as malformed)
+        int wan_id = wan_metrics_find(r.name);
+        if (wan_id == 0) {
+            if (!may_add(r, now)) {
+                g_stats.stale++;
+                continue;
+            }
+            wan_id = wan_metrics_find_or_add(r.name);
+        }
+        if (wan_id == 0) {
+            g_stats.malformed++;
+            continue;
+        }
+        int w = wan_id - 1;
+        if (r.version > g_clock) g_clock = r.version;
+
+        if (!is_newer(r, g_versions[w])) {
+            g_stats.stale++;
+            if (r.version < g_versions[w].version) behind |= 1u << w;
+            continue;
+        }
+
+        // Our own report may carry a lower version than a copy of an older
+        // one when our clock was behind (after a reboot). Keep the report: a
+        // pending one is versioned once seeded, a versioned one gets a new
+        // version and goes out again.
+        unsigned long local_ms = wan_metrics_get(wan_id).last_update_ms;
+        bool local_pending = local_ms != g_known_update_ms[w];
+        if ((local_pending || g_versions[w].origin == g_self_id) && r.age_ms >= now - local_ms) {
+            g_stats.stale++;
+            if (!local_pending) {
+                g_versions[w] = { ++g_clock, g_self_id };
+                reversioned |= 1u << w;
+            }
+            continue;
+        }
+        apply_record(wan_id, r, now);
+        applied |= 1u << w;
+        g_stats.applied++;
+    }
+
+    g_seeded = true;
+
+    // Relay what was new to us; answer an out-of-date sender with our copy
+    if (applied) broadcast(applied, from, now);
+    if (reversioned) broadcast(reversioned, IPAddress(), now);
+    if (behind) {
+        uint8_t reply[MAX_DATAGRAM_BYTES];
+        size_t reply_len = build(reply, behind, now);
+        if (reply_len > 0) send_to(from, reply, reply_len);
+    }
+}
+
+static void receive(unsigned long now) {
+    for (int i = 0; i < MAX_DATAGRAMS_PER_UPDATE; i++) {
+        int len = g_udp.parsePacket();
+        if (len <= 0) return;
+
+        uint8_t buf[MAX_DATAGRAM_BYTES];
+        if ((size_t)len > sizeof(buf)) {
+            g_udp.flush();
+            g_stats.malformed++;
+            continue;
+        }
+        g_udp.read(buf, len);
+        handle_datagram(buf, len, g_udp.remoteIP(), now);
+    }
+}
+
+static void on_forget(int wan_id) {
+    ForgottenWan& f = g_forgotten[g_forgotten_next];
+    g_forgotten_next = (g_forgotten_next + 1) % MAX_WANS;
+    strlcpy(f.name, wan_metrics_key(wan_id), sizeof(f.name));
+    f.at_ms = millis();
+    wan_id_erase(g_versions, wan_id - 1);
+    wan_id_erase(g_known_update_ms, wan_id - 1);
+}
+
+// ---- Public ----
+
+void gossip_init() {
+    uint8_t mac[6];
+    ETH.macAddress(mac);
+    g_self_id = ((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) |
+                ((uint32_t)mac[4] << 8) | mac[5];
+
+    for (int w = 0; w < wan_metrics_count(); w++) {
+        g_known_update_ms[w] = wan_metrics_get(w + 1).last_update_ms;
+    }
+    wan_metrics_on_forget(on_forget);
+    g_start_ms = millis();
+
+    if (!g_udp.begin(GOSSIP_PORT)) {
+        LOG_WARN("Peer gossip: failed to open UDP port %u", GOSSIP_PORT);
+        return;
+    }
+    MDNS.addService("wanwatcher", "udp", GOSSIP_PORT);
+    xTaskCreatePinnedToCore(discovery_task, "gossip", 4096, nullptr, 1, nullptr, 0);
+
+    g_started = true;
+    LOG_INFO("Peer gossip on UDP %u (id %08x)", GOSSIP_PORT, g_self_id);
+}
+
+void gossip_update() {
+    g_stats.enabled = g_started && g_settings.enabled;
+    if (!g_stats.enabled) return;
+
+    unsigned long now = millis();
+    receive(now);
+
+    // Any other commit is a report from the collector (or SNMP): version it,
+    // once the clock is past what peers already hold
+    if (!g_seeded && now - g_start_ms >= GOSSIP_SEED_WAIT_MS) g_seeded = true;
+    uint32_t fresh = 0;
+    for (int w = 0; g_seeded && w < wan_metrics_count(); w++) {
+        unsigned long update_ms = wan_metrics_get(w + 1).last_update_ms;
+        if (update_ms == g_known_update_ms[w]) continue;
+        g_known_update_ms[w] = update_ms;
+        g_versions[w] = { ++g_clock, g_self_id };
+        fresh |= 1u << w;
+    }
+    if (fresh) broadcast(fresh, IPAddress(), now);
+
+    if (now - g_last_sync_ms >= GOSSIP_SYNC_MS) {
+        g_last_sync_ms = now;
+        expire_peers(now);
+        broadcast(0xFFFFFFFF, IPAddress(), now);
+    }
+
+    g_stats.peers = (uint8_t)g_peer_count;
+}
+
+void gossip_set_settings(const GossipSettings& settings) {
+    g_settings = settings;
+}
+
+const GossipSettings& gossip_get_settings() {
+    return g_settings;
+}
+
+const GossipStats& gossip_get_stats() {
+    return g_stats;
+}
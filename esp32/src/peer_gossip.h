@@ -0,0 +1,79 @@
+// peer_gossip.h
+// Relays WAN records between panels, so the collector only has to post to one
+//
+// Panels advertise _wanwatcher._udp over mDNS and find each other with a
+// periodic query (in a background task; a query blocks for seconds). Peers
+// are also learned from the source address of incoming datagrams.
+//
+// Every WAN record carries a version (Lamport counter, ties broken by the
+// origin panel's id). A report received from the collector gets a version
+// above any seen so far; a relayed record is applied only when its version
+// is newer than ours, and only then relayed on. Old or looping copies are
+// therefore dropped at the first panel that already has them. Versions are
+// 64-bit and anything above GOSSIP_VERSION_MAX is dropped as malformed, so
+// the counter can't be pushed to where it would wrap.
+//
+// A rebooted panel starts its counter at 0, so it doesn't version its own
+// reports until it has heard from a peer (whose records raise the counter
+// past the versions already out there) or GOSSIP_SEED_WAIT_MS has passed
+// without one. Until then a pending local report is kept over relayed
+// copies of an older report; later, a report of ours that a peer's copy of
+// an older one outranks is versioned again and resent.
+//
+// A record for a name not in the table adds the WAN only while the report
+// is fresh and newer than any wan_metrics_forget() of that name here, so
+// peers' old copies don't bring back a forgotten WAN.
+//
+// Datagrams carry the record's age when sent, and the receiver backdates
+// last_update_ms by it, so freshness reflects the original report time. New
+// records are pushed at once; all records are also resent every
+// GOSSIP_SYNC_MS, which bounds the delay after a lost datagram or a reboot.
+//
+// Datagrams are not authenticated (same trust as POST /api/wans).
+#pragma once
+
+#include <Arduino.h>
+
+static const uint16_t GOSSIP_PORT = 5582;
+static const int GOSSIP_MAX_PEERS = 8;
+static const unsigned long GOSSIP_SYNC_MS = 10000;        // resend all records
+static const unsigned long GOSSIP_DISCOVER_MS = 60000;    // mDNS query period
+static const unsigned long GOSSIP_PEER_EXPIRE_MS = 300000; // not seen for this long
+static const unsigned long GOSSIP_SEED_WAIT_MS = 2 * GOSSIP_SYNC_MS; // alone if no peer by then
+static const uint64_t GOSSIP_VERSION_MAX = 1ULL << 62;
+
+// Persisted by config_store
+struct GossipSettings {
+    bool enabled;
+};
+
+struct GossipPeer {
+    IPAddress ip;
+    unsigned long last_seen_ms;  // last discovery or datagram from it
+};
+
+struct GossipStats {
+    bool enabled;
+    uint8_t peers;              // peers currently known
+    uint32_t sent;              // datagrams sent
+    uint32_t send_errors;
+    uint32_t received;          // datagrams received from peers
+    uint32_t malformed;
+    uint32_t applied;           // records newer than ours, applied and relayed
+    uint32_t stale;             // records not newer than ours (ignored)
+    uint32_t discoveries;       // mDNS queries run
+};
+
+// Advertise the service and start discovery (call once in setup(), after mDNS)
+void gossip_init();
+
+// Push new local reports, receive and relay (call from loop(); never blocks)
+void gossip_update();
+
+void gossip_set_settings(const GossipSettings& settings);
+const GossipSettings& gossip_get_settings();
+
+// Copy the current peer list; returns the number of entries written
+int gossip_get_peers(GossipPeer* out, int max_peers);
+
+const GossipStats& gossip_get_stats();
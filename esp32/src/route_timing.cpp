@@ -0,0 +1,81 @@
+// route_timing.cpp
+#include "route_timing.h"
+
+static const char* PHASE_NAMES[] = { "read", "parse", "handler", "serialize", "write", "total" };
+
+static PhaseHistogram g_hist[(int)HttpRoute::COUNT][(int)TimingPhase::COUNT];
+
+// Current request
+static bool g_active = false;
+static HttpRoute g_route = HttpRoute::COUNT;
+static uint32_t g_start_us = 0;
+static uint32_t g_mark_us = 0;
+static uint32_t g_phase_us[(int)TimingPhase::COUNT];
+
+static void record(PhaseHistogram& h, uint32_t us) {
+    int b = 0;
+    while (b < TIMING_BUCKETS - 1 && us > TIMING_BUCKET_US[b]) b++;
+    h.buckets[b]++;
+    h.count++;
+    h.sum_us += us;
+}
+
+void route_timing_begin() {
+    g_active = true;
+    g_route = HttpRoute::COUNT;
+    g_start_us = micros();
+    g_mark_us = g_start_us;
+    memset(g_phase_us, 0, sizeof(g_phase_us));
+}
+
+void route_timing_route(HttpRoute route) {
+    g_route = route;
+}
+
+void route_timing_mark(TimingPhase phase) {
+    if (!g_active) return;
+    uint32_t now = micros();
+    g_phase_us[(int)phase] += now - g_mark_us;
+    g_mark_us = now;
+}
+
+size_t route_timing_header(char* buf, size_t size) {
+    if (!g_active) return 0;
+
+    // Unattributed time up to the header is handler time
+    route_timing_mark(TimingPhase::HANDLER);
+
+    int n = snprintf(buf, size, "Server-Timing: ");
+    for (int p = 0; p < (int)TimingPhase::WRITE && n > 0 && (size_t)n < size; p++) {
+        if (p != (int)TimingPhase::READ && p != (int)TimingPhase::HANDLER && g_phase_us[p] == 0) {
+            continue;  // phase did not happen
+        }
+        n += snprintf(buf + n, size - n, "%s%s;dur=%.2f",
+                      (p == 0) ? "" : ", ", PHASE_NAMES[p], g_phase_us[p] / 1000.0f);
+    }
+    return ((size_t)n < size) ? n : 0;
+}
+
+void route_timing_end() {
+    if (!g_active) return;
+    route_timing_mark(TimingPhase::WRITE);
+    g_active = false;
+    if (g_route == HttpRoute::COUNT) return;
+
+    g_phase_us[(int)TimingPhase::TOTAL] = g_mark_us - g_start_us;
+    for (int p = 0; p < (int)TimingPhase::COUNT; p++) {
+        bool always = (p == (int)TimingPhase::READ || p == (int)TimingPhase::HANDLER ||
+                       p == (int)TimingPhase::WRITE || p == (int)TimingPhase::TOTAL);
+        if (always || g_phase_us[p] > 0) {
+            record(g_hist[(int)g_route][p], g_phase_us[p]);
+        }
+    }
+}
+
+const PhaseHistogram& route_timing_get(HttpRoute route, TimingPhase phase) {
+    return g_hist[(int)route][(int)phase];
+}
+
+const char* timing_phase_name(TimingPhase phase) {
+    return PHASE_NAMES[(int)phase];
+}
@@ -0,0 +1,56 @@
+// route_timing.h
+// Per-route HTTP latency histograms, split by request phase
+//
+// A stopwatch runs for each request. Code marks the end of a phase with
+// route_timing_mark(), which attributes the time since the previous mark to
+// that phase:
+//   READ       request line, headers and body (HttpServer)
+//   PARSE      body decoding (JSON / MessagePack)
+//   HANDLER    route logic, including LittleFS lookups
+//   SERIALIZE  encoding the response document
+//   WRITE      sending the response (header and body)
+// The phases known when the response header goes out are also reported in
+// a Server-Timing header. WRITE is still in progress at that point, so it
+// only shows up in the histograms.
+#pragma once
+
+#include <Arduino.h>
+#include "http_routes.h"
+
+enum class TimingPhase : uint8_t { READ, PARSE, HANDLER, SERIALIZE, WRITE, TOTAL, COUNT };
+
+// Histogram bucket upper bounds in microseconds (the last bucket is +Inf)
+static const uint32_t TIMING_BUCKET_US[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000
+};
+static const int TIMING_BUCKETS = sizeof(TIMING_BUCKET_US) / sizeof(TIMING_BUCKET_US[0]) + 1;
+
+struct PhaseHistogram {
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t buckets[TIMING_BUCKETS];  // non-cumulative
+};
+
+// ---- Per-request stopwatch (single request at a time) ----
+
+// Start timing a request (before the request is read)
+void route_timing_begin();
+
+// Attribute the route once it is known (from the route handler)
+void route_timing_route(HttpRoute route);
+
+// End the given phase now
+void route_timing_mark(TimingPhase phase);
+
+// Write "Server-Timing: ..." (without CRLF) for the current request.
+// Returns the number of characters written.
+size_t route_timing_header(char* buf, size_t size);
+
+// Finish the request: the remaining time counts as WRITE, and all phases
+// are recorded under the route (requests without a route are dropped)
+void route_timing_end();
+
+// ---- Results ----
+
+const PhaseHistogram& route_timing_get(HttpRoute route, TimingPhase phase);
+const char* timing_phase_name(TimingPhase phase);
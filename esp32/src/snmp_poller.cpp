@@ -0,0 +1,550 @@
+// snmp_poller.cpp
+#include "snmp_poller.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "billing_cycle.h"
+#include "counter_rate.h"
+#include "data_usage.h"
+#include "leds.h"
+#include "logger.h"
+
+static const uint16_t LOCAL_PORT = 16161;
+static const int MAX_ARCS = 20;
+static const int MAX_VARS = SNMP_MAX_WANS * 4 + 1;    // + hrSystemDate
+
+// BER tags
+static const uint8_t TAG_INTEGER = 0x02;
+static const uint8_t TAG_OCTETS = 0x04;
+static const uint8_t TAG_NULL = 0x05;
+static const uint8_t TAG_OID = 0x06;
+static const uint8_t TAG_SEQUENCE = 0x30;
+static const uint8_t TAG_COUNTER32 = 0x41;
+static const uint8_t TAG_COUNTER64 = 0x46;
+static const uint8_t TAG_GET_REQUEST = 0xA0;
+static const uint8_t TAG_RESPONSE = 0xA2;
+
+// Table prefixes; the ifIndex is appended
+static const uint32_t OID_IF_HC_IN[] = { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 6 };
+static const uint32_t OID_IF_HC_OUT[] = { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 10 };
+static const uint32_t OID_IF_OPER[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 8 };
+static const uint32_t OID_HR_SYSTEM[] = { 1, 3, 6, 1, 2, 1, 25, 1, 2 };   // hrSystemDate, .0
+
+enum class VarKind : uint8_t { IN_OCTETS, OUT_OCTETS, OPER_STATUS, GATEWAY, SYSTEM_DATE };
+
+struct PollVar {
+    uint8_t pos;                // settings position (1-based), not the table id; 0 = agent
+    VarKind kind;
+    uint32_t arcs[MAX_ARCS];
+    uint8_t arc_count;
+};
+
+// Values collected from one reply
+struct WanSample {
+    bool has_in, has_out;
+    uint64_t in, out;
+    uint8_t in_bits, out_bits;
+    int oper;                   // ifOperStatus, -1 = not in reply
+    int gateway;                // WanState, -1 = not in reply
+};
+
+static SnmpSettings g_settings = { "", "public", SNMP_DEFAULT_INTERVAL_S, {}, {} };
+static SnmpStats g_stats;
+static WiFiUDP g_udp;
+static IPAddress g_agent_ip;
+static bool g_resolved = false;
+static bool g_socket_open = false;
+static bool g_settings_changed = true;
+
+static PollVar g_vars[MAX_VARS];
+static int g_var_count = 0;
+static uint8_t g_packet[SNMP_PACKET_LEN];
+static size_t g_packet_len = 0;
+
+static int32_t g_request_id = 1;
+static bool g_in_flight = false;
+static int g_attempts = 0;
+static unsigned long g_sent_ms = 0;
+static unsigned long g_last_poll_ms = 0;
+static bool g_polled = false;
+
+static CounterRate g_rx[SNMP_MAX_WANS];
+static CounterRate g_tx[SNMP_MAX_WANS];
+static int g_table_ids[SNMP_MAX_WANS];   // settings position -> WAN table id (0 = none)
+
+// ---- OIDs ----
+
+static bool parse_oid(const char* text, uint32_t* arcs, uint8_t& count) {
+    count = 0;
+    const char* p = text;
+    if (*p == '.') p++;
+    while (*p) {
+        if (!isdigit((unsigned char)*p) || count >= MAX_ARCS) return false;
+        arcs[count++] = strtoul(p, (char**)&p, 10);
+        if (*p == '.') {
+            p++;
+            if (*p == '\0') return false;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+    return count >= 2 && arcs[0] <= 2;
+}
+
+bool snmp_oid_is_valid(const char* text) {
+    uint32_t arcs[MAX_ARCS];
+    uint8_t count;
+    return parse_oid(text, arcs, count);
+}
+
+static void add_var(uint8_t pos, VarKind kind, const uint32_t* prefix, int prefix_len, uint32_t index) {
+    if (g_var_count >= MAX_VARS) return;
+    PollVar& v = g_vars[g_var_count++];
+    v.pos = pos;
+    v.kind = kind;
+    memcpy(v.arcs, prefix, prefix_len * sizeof(uint32_t));
+    v.arcs[prefix_len] = index;
+    v.arc_count = prefix_len + 1;
+}
+
+// ---- BER encoding (written back to front, so lengths are known) ----
+
+struct BerWriter {
+    uint8_t* buf;
+    size_t pos;                 // start of the encoded data
+    bool ok;
+};
+
+static void put_byte(BerWriter& w, uint8_t b) {
+    if (w.pos == 0) { w.ok = false; return; }
+    w.buf[--w.pos] = b;
+}
+
+static void put_header(BerWriter& w, uint8_t tag, size_t len) {
+    if (len < 0x80) {
+        put_byte(w, len);
+    } else if (len <= 0xFF) {
+        put_byte(w, len);
+        put_byte(w, 0x81);
+    } else {
+        put_byte(w, len & 0xFF);
+        put_byte(w, len >> 8);
+        put_byte(w, 0x82);
+    }
+    put_byte(w, tag);
+}
+
+static void put_integer(BerWriter& w, int32_t value) {
+    size_t start = w.pos;
+    int32_t v = value;
+    for (;;) {
+        uint8_t b = v & 0xFF;
+        put_byte(w, b);
+        v >>= 8;
+        bool done = (v == 0 && !(b & 0x80)) || (v == -1 && (b & 0x80));  // minimal two's complement
+        if (done || !w.ok) break;
+    }
+    put_header(w, TAG_INTEGER, start - w.pos);
+}
+
+static void put_base128(BerWriter& w, uint32_t v) {
+    put_byte(w, v & 0x7F);
+    for (v >>= 7; v != 0; v >>= 7) {
+        put_byte(w, 0x80 | (v & 0x7F));
+    }
+}
+
+static void put_oid(BerWriter& w, const uint32_t* arcs, int count) {
+    size_t start = w.pos;
+    for (int i = count - 1; i >= 2; i--) {
+        put_base128(w, arcs[i]);
+    }
+    put_base128(w, arcs[0] * 40 + arcs[1]);
+    put_header(w, TAG_OID, start - w.pos);
+}
+
+static bool build_request() {
+    BerWriter w = { g_packet, sizeof(g_packet), true };
+
+    size_t list_end = w.pos;
+    for (int i = g_var_count - 1; i >= 0; i--) {
+        size_t vb_end = w.pos;
+        put_byte(w, 0x00);
+        put_byte(w, TAG_NULL);
+        put_oid(w, g_vars[i].arcs, g_vars[i].arc_count);
+        put_header(w, TAG_SEQUENCE, vb_end - w.pos);
+    }
+    put_header(w, TAG_SEQUENCE, list_end - w.pos);
+
+    put_integer(w, 0);             // error-index
+    put_integer(w, 0);             // error-status
+    put_integer(w, g_request_id);
+    put_header(w, TAG_GET_REQUEST, list_end - w.pos);
+
+    size_t community_len = strlen(g_settings.community);
+    for (size_t i = community_len; i > 0; i--) {
+        put_byte(w, g_settings.community[i - 1]);
+    }
+    put_header(w, TAG_OCTETS, community_len);
+    put_integer(w, 1);             // version: v2c
+    put_header(w, TAG_SEQUENCE, sizeof(g_packet) - w.pos);
+
+    if (!w.ok) return false;
+    g_packet_len = sizeof(g_packet) - w.pos;
+    memmove(g_packet, g_packet + w.pos, g_packet_len);
+    return true;
+}
+
+// ---- BER decoding ----
+
+struct BerReader {
+    const uint8_t* p;
+    const uint8_t* end;
+};
+
+static bool read_tlv(BerReader& r, uint8_t& tag, BerReader& value) {
+    if (r.end - r.p < 2) return false;
+    tag = *r.p++;
+    size_t len = *r.p++;
+    if (len & 0x80) {
+        int n = len & 0x7F;
+        if (n == 0 || n > 2 || r.end - r.p < n) return false;
+        len = 0;
+        while (n--) len = (len << 8) | *r.p++;
+    }
+    if ((size_t)(r.end - r.p) < len) return false;
+    value.p = r.p;
+    value.end = r.p + len;
+    r.p += len;
+    return true;
+}
+
+static bool read_unsigned(const BerReader& v, uint64_t& out) {
+    size_t len = v.end - v.p;
+    if (len == 0 || len > 9) return false;
+    out = 0;
+    for (const uint8_t* q = v.p; q < v.end; q++) out = (out << 8) | *q;
+    return true;
+}
+
+static bool read_signed(const BerReader& v, int32_t& out) {
+    size_t len = v.end - v.p;
+    if (len == 0 || len > 4) return false;
+    int32_t n = (v.p[0] & 0x80) ? -1 : 0;
+    for (const uint8_t* q = v.p; q < v.end; q++) n = (n << 8) | *q;
+    out = n;
+    return true;
+}
+
+static bool expect_int(BerReader& r, int32_t& out) {
+    uint8_t tag;
+    BerReader v;
+    return read_tlv(r, tag, v) && tag == TAG_INTEGER && read_signed(v, out);
+}
+
+static bool oid_matches(const BerReader& v, const PollVar& var) {
+    uint8_t enc[64];
+    BerWriter w = { enc, sizeof(enc), true };
+    put_oid(w, var.arcs, var.arc_count);
+    if (!w.ok) return false;
+    BerReader r = { enc + w.pos, enc + sizeof(enc) };
+    uint8_t tag;
+    BerReader content;
+    read_tlv(r, tag, content);
+    size_t len = content.end - content.p;
+    return (size_t)(v.end - v.p) == len && memcmp(v.p, content.p, len) == 0;
+}
+
+static void store_value(WanSample& s, const PollVar& var, uint8_t tag, const BerReader& v) {
+    uint64_t u;
+    int32_t i;
+    switch (var.kind) {
+        case VarKind::IN_OCTETS:
+        case VarKind::OUT_OCTETS: {
+            if ((tag != TAG_COUNTER64 && tag != TAG_COUNTER32) || !read_unsigned(v, u)) return;
+            uint8_t bits = (tag == TAG_COUNTER64) ? 64 : 32;
+            if (var.kind == VarKind::IN_OCTETS) {
+                s.has_in = true; s.in = u; s.in_bits = bits;
+            } else {
+                s.has_out = true; s.out = u; s.out_bits = bits;
+            }
+            break;
+        }
+        case VarKind::OPER_STATUS:
+            if (tag == TAG_INTEGER && read_signed(v, i)) s.oper = i;
+            break;
+        case VarKind::GATEWAY:
+            if (tag == TAG_INTEGER && read_signed(v, i) && i >= 0 && i <= 2) {
+                s.gateway = i;  // WanState order: down, degraded, up
+            } else if (tag == TAG_OCTETS) {
+                char text[16];
+                size_t len = min((size_t)(v.end - v.p), sizeof(text) - 1);
+                memcpy(text, v.p, len);
+                text[len] = '\0';
+                char* nl = strpbrk(text, "\r\n ");
+                if (nl) *nl = '\0';
+                s.gateway = (int)wan_state_from_string(text);
+            }
+            break;
+        case VarKind::SYSTEM_DATE:
+            break;                  // not per WAN, see store_system_date()
+    }
+}
+
+// hrSystemDate is a DateAndTime: year (2 bytes), month, day, hour, minute,
+// second, deci-seconds, then optionally '+'/'-' and the hours and minutes
+// from UTC. It becomes the router timestamp the billing clock runs on.
+static void store_system_date(uint8_t tag, const BerReader& v) {
+    size_t len = v.end - v.p;
+    if (tag != TAG_OCTETS || (len != 8 && len != 11)) return;
+    const uint8_t* b = v.p;
+    char text[32];
+    int n = snprintf(text, sizeof(text), "%04u-%02u-%02uT%02u:%02u:%02u",
+                     (unsigned)((b[0] << 8) | b[1]), b[2], b[3], b[4], b[5], b[6]);
+    if (len == 11 && (b[8] == '+' || b[8] == '-')) {
+        snprintf(text + n, sizeof(text) - n, "%c%02u:%02u", b[8], b[9], b[10]);
+    } else {
+        strlcpy(text + n, "Z", sizeof(text) - n);   // no zone: take it as UTC
+    }
+    uint32_t unix_s;
+    if (!parse_iso8601(text, unix_s)) return;
+    wan_metrics_set_router_info(g_agent_ip.toString().c_str(), text);
+}
+
+// ---- Applying a reply ----
+
+static void apply_sample(int pos, const WanSample& s) {
+    WanMetrics* record = wan_metrics_edit(g_table_ids[pos - 1]);
+    if (record == nullptr) return;
+    int wan_id = g_table_ids[pos - 1];
+    WanMetrics& m = *record;
+    uint32_t now = millis();
+    CounterRate& rx = g_rx[pos - 1];
+    CounterRate& tx = g_tx[pos - 1];
+    uint32_t resets_before = rx.resets + tx.resets;
+
+    uint64_t rx_added = 0, tx_added = 0;
+
+    if (s.has_in && counter_rate_update(rx, s.in, now, s.in_bits)) {
+        rx_added = rx.delta;
+        m.down_mbps = rx.mbps;
+        m.down_1m = rx.avg_mbps[0];
+        m.down_5m = rx.avg_mbps[1];
+        m.down_15m = rx.avg_mbps[2];
+    }
+    if (s.has_out && counter_rate_update(tx, s.out, now, s.out_bits)) {
+        tx_added = tx.delta;
+        m.up_mbps = tx.mbps;
+        m.up_1m = tx.avg_mbps[0];
+        m.up_5m = tx.avg_mbps[1];
+        m.up_15m = tx.avg_mbps[2];
+    }
+    g_stats.counter_resets += rx.resets + tx.resets - resets_before;
+    data_usage_add_bytes(wan_id, rx_added, tx_added);
+
+    if (s.oper > 1) {
+        m.state = WanState::DOWN;               // link not up(1)
+    } else if (s.gateway >= 0) {
+        m.state = (WanState)s.gateway;
+    } else if (s.oper == 1) {
+        m.state = WanState::UP;
+    }
+    wan_metrics_commit(wan_id);
+
+    wan_set_leds(wan_id, m.state);
+}
+
+static bool handle_reply(const uint8_t* data, size_t len) {
+    BerReader r = { data, data + len };
+    uint8_t tag;
+    BerReader msg, pdu, list;
+    int32_t version, request_id, error_status, error_index;
+
+    if (!read_tlv(r, tag, msg) || tag != TAG_SEQUENCE) return false;
+    if (!expect_int(msg, version)) return false;
+    BerReader community;
+    if (!read_tlv(msg, tag, community) || tag != TAG_OCTETS) return false;
+    if (!read_tlv(msg, tag, pdu) || tag != TAG_RESPONSE) return false;
+    if (!expect_int(pdu, request_id) || request_id != g_request_id) return false;
+    if (!expect_int(pdu, error_status) || !expect_int(pdu, error_index)) return false;
+    if (!read_tlv(pdu, tag, list) || tag != TAG_SEQUENCE) return false;
+
+    g_stats.last_error_status = error_status;
+    if (error_status != 0) return false;
+
+    WanSample samples[SNMP_MAX_WANS];
+    memset(samples, 0, sizeof(samples));
+    for (int w = 0; w < SNMP_MAX_WANS; w++) {
+        samples[w].oper = -1;
+        samples[w].gateway = -1;
+    }
+
+    // Varbinds come back in request order
+    for (int i = 0; i < g_var_count; i++) {
+        BerReader vb, oid, value;
+        uint8_t vtag;
+        if (!read_tlv(list, tag, vb) || tag != TAG_SEQUENCE) return false;
+        if (!read_tlv(vb, tag, oid) || tag != TAG_OID) return false;
+        if (!read_tlv(vb, vtag, value)) return false;
+        if (!oid_matches(oid, g_vars[i])) return false;
+        if (g_vars[i].kind == VarKind::SYSTEM_DATE) {
+            store_system_date(vtag, value);
+            continue;
+        }
+        store_value(samples[g_vars[i].pos - 1], g_vars[i], vtag, value);
+    }
+
+    for (int pos = 1; pos <= SNMP_MAX_WANS; pos++) {
+        if (g_settings.ifindex[pos - 1] != 0) apply_sample(pos, samples[pos - 1]);
+    }
+    return true;
+}
+
+// ---- Polling ----
+
+// Rebuild the variable list and resolve the agent after a settings change
+static void prepare() {
+    g_settings_changed = false;
+    g_in_flight = false;
+    g_resolved = false;
+    g_var_count = 0;
+    for (int w = 0; w < SNMP_MAX_WANS; w++) {
+        counter_rate_reset(g_rx[w]);
+        counter_rate_reset(g_tx[w]);
+    }
+    if (!g_stats.enabled) return;
+
+    for (int pos = 1; pos <= SNMP_MAX_WANS; pos++) {
+        g_table_ids[pos - 1] = 0;
+        uint16_t idx = g_settings.ifindex[pos - 1];
+        if (idx == 0) continue;
+
+        // Position n reports as WAN "wan<n>"
+        char name[WAN_NAME_LEN];
+        snprintf(name, sizeof(name), "wan%d", pos);
+        g_table_ids[pos - 1] = wan_metrics_find_or_add(name);
+        if (g_table_ids[pos - 1] == 0) {
+            LOG_WARN("SNMP: no room for WAN %s", name);
+            continue;
+        }
+
+        add_var(pos, VarKind::IN_OCTETS, OID_IF_HC_IN, 11, idx);
+        add_var(pos, VarKind::OUT_OCTETS, OID_IF_HC_OUT, 11, idx);
+        add_var(pos, VarKind::OPER_STATUS, OID_IF_OPER, 10, idx);
+        PollVar gw;
+        if (g_settings.gateway_oid[pos - 1][0] != '\0' &&
+            parse_oid(g_settings.gateway_oid[pos - 1], gw.arcs, gw.arc_count) &&
+            g_var_count < MAX_VARS) {
+            gw.pos = pos;
+            gw.kind = VarKind::GATEWAY;
+            g_vars[g_var_count++] = gw;
+        }
+    }
+
+    // The agent's clock, for billing cycles and usage (there is no daemon
+    // timestamp in this mode)
+    if (g_var_count > 0) add_var(0, VarKind::SYSTEM_DATE, OID_HR_SYSTEM, 9, 0);
+
+    if (WiFi.hostByName(g_settings.host, g_agent_ip) != 1) {
+        LOG_WARN("SNMP: cannot resolve %s", g_settings.host);
+        g_stats.errors++;
+        return;
+    }
+    g_resolved = true;
+    LOG_INFO("SNMP: polling %s every %us (%d OIDs)", g_settings.host,
+             g_settings.interval_s, g_var_count);
+}
+
+static void send_request() {
+    if (!build_request()) {
+        g_stats.errors++;
+        return;
+    }
+    g_udp.beginPacket(g_agent_ip, SNMP_PORT);
+    g_udp.write(g_packet, g_packet_len);
+    g_udp.endPacket();
+    g_stats.requests++;
+    g_sent_ms = millis();
+    g_in_flight = true;
+}
+
+// A forgotten position stays unpolled until the settings are saved again
+static void on_forget(int wan_id) {
+    for (int& id : g_table_ids) {
+        if (id == wan_id) {
+            id = 0;
+        } else if (id > wan_id) {
+            id--;
+        }
+    }
+}
+
+void snmp_init() {
+    wan_metrics_on_forget(on_forget);
+    g_socket_open = g_udp.begin(LOCAL_PORT);
+    if (!g_socket_open) {
+        LOG_WARN("SNMP: failed to open socket");
+    }
+}
+
+void snmp_update() {
+    g_stats.enabled = g_settings.host[0] != '\0';
+    if (!g_socket_open) return;
+    if (g_settings_changed) prepare();
+    if (!g_stats.enabled || !g_resolved || g_var_count == 0) return;
+
+    unsigned long now = millis();
+
+    // Collect the reply
+    int size = g_udp.parsePacket();
+    if (size > 0) {
+        uint8_t buf[SNMP_PACKET_LEN];
+        int len = g_udp.read(buf, sizeof(buf));
+        if (g_in_flight && len > 0 && size <= (int)sizeof(buf)) {
+            if (handle_reply(buf, len)) {
+                g_in_flight = false;
+                g_stats.responses++;
+                g_stats.last_rtt_ms = now - g_sent_ms;
+            } else {
+                g_stats.errors++;
+            }
+        }
+        g_udp.flush();
+    }
+
+    if (g_in_flight && now - g_sent_ms >= SNMP_TIMEOUT_MS) {
+        if (g_attempts <= SNMP_RETRIES) {
+            g_attempts++;
+            send_request();  // same request-id, so a late first reply still counts
+        } else {
+            g_in_flight = false;
+            g_stats.timeouts++;
+        }
+    }
+
+    if (!g_in_flight && (!g_polled || now - g_last_poll_ms >= g_settings.interval_s * 1000UL)) {
+        g_polled = true;
+        g_last_poll_ms = now;
+        g_request_id++;
+        g_attempts = 1;
+        send_request();
+    }
+}
+
+void snmp_set_settings(const SnmpSettings& settings) {
+    g_settings = settings;
+    g_settings.host[sizeof(g_settings.host) - 1] = '\0';
+    g_settings.community[sizeof(g_settings.community) - 1] = '\0';
+    for (int w = 0; w < SNMP_MAX_WANS; w++) {
+        g_settings.gateway_oid[w][SNMP_OID_TEXT_LEN - 1] = '\0';
+    }
+    g_settings.interval_s = constrain(g_settings.interval_s, 1, 3600);
+    g_settings_changed = true;
+}
+
+const SnmpSettings& snmp_get_settings() {
+    return g_settings;
+}
+
+const SnmpStats& snmp_get_stats() {
+    return g_stats;
+}
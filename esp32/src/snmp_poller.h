@@ -0,0 +1,66 @@
+// snmp_poller.h
+// Optional pull mode: poll the router's SNMP agent directly (SNMPv2c)
+//
+// Every interval one GetRequest carries all OIDs for all configured WANs:
+//   ifHCInOctets.<ifIndex>   1.3.6.1.2.1.31.1.1.1.6   -> down rate
+//   ifHCOutOctets.<ifIndex>  1.3.6.1.2.1.31.1.1.1.10  -> up rate
+//   ifOperStatus.<ifIndex>   1.3.6.1.2.1.2.2.1.8      -> down when not up(1)
+//   gateway OID (optional)   INTEGER 0/1/2 (down/degraded/up) or a
+//                            string "up"/"degraded"/"down"
+//   hrSystemDate.0           1.3.6.1.2.1.25.1.2.0     -> billing wall clock
+// Rates and the 1/5/15 minute averages are computed on the panel (see
+// counter_rate.h). Loss, latency and jitter are not available over SNMP and
+// keep their last values. The request is sent and the reply collected from
+// loop() without blocking; a missing reply is retried once. Settings
+// position n (ifindex[n-1], gateway_oid[n-1]) reports as the WAN named wan<n>.
+//
+// Use either this mode or the pfSense daemon: both write the same WAN records.
+#pragma once
+
+#include <Arduino.h>
+#include "wan_metrics.h"
+
+static const uint16_t SNMP_PORT = 161;
+static const uint16_t SNMP_DEFAULT_INTERVAL_S = 15;
+static const unsigned long SNMP_TIMEOUT_MS = 2000;
+static const int SNMP_RETRIES = 1;
+static const size_t SNMP_OID_TEXT_LEN = 48;
+static const size_t SNMP_PACKET_LEN = 512;
+
+// WANs that can be polled. Fixed by the persisted settings layout (below),
+// independent of the WAN table size.
+static const int SNMP_MAX_WANS = 2;
+
+// Persisted by config_store. An empty host disables polling.
+struct SnmpSettings {
+    char host[64];
+    char community[32];
+    uint16_t interval_s;                                // 1-3600
+    uint16_t ifindex[SNMP_MAX_WANS];                    // 0 = WAN not polled
+    char gateway_oid[SNMP_MAX_WANS][SNMP_OID_TEXT_LEN]; // dotted, empty = none
+};
+
+struct SnmpStats {
+    bool enabled;
+    uint32_t requests;          // GetRequests sent (including retries)
+    uint32_t responses;         // valid replies applied
+    uint32_t timeouts;          // polls with no reply after the retries
+    uint32_t errors;            // malformed replies or agent error-status
+    uint32_t counter_resets;    // octet counters that went backwards
+    uint32_t last_rtt_ms;       // request to reply, last poll
+    int last_error_status;      // SNMP error-status of the last reply (0 = noError)
+};
+
+// Call once in setup(), after the network is up
+void snmp_init();
+
+// Send due polls and process replies (call from loop(); never blocks)
+void snmp_update();
+
+void snmp_set_settings(const SnmpSettings& settings);
+const SnmpSettings& snmp_get_settings();
+
+// Dotted numeric OID check (for settings validation)
+bool snmp_oid_is_valid(const char* text);
+
+const SnmpStats& snmp_get_stats();
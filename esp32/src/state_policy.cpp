@@ -0,0 +1,157 @@
+// state_policy.cpp
+#include "state_policy.h"
+#include "logger.h"
+
+// Per-source state machine (index = LOCAL_PINGER_ID or wan_id)
+struct Track {
+    bool primed;                // first evaluation takes the graded state directly
+    WanState state;             // state in effect
+    WanState pending;           // graded state waiting for its dwell time (== state: none)
+    unsigned long since_ms;     // when pending started
+};
+
+static StateSettings g_settings = { { STATE_DEFAULT_LIMITS } };
+static Track g_tracks[MAX_WANS + 1];
+static StatePolicyStats g_stats;
+
+static const char* source_name(int source) {
+    return (source == LOCAL_PINGER_ID) ? "local" : wan_metrics_key(source);
+}
+
+static const StateProfile* find_profile(const StateSettings& s, const char* name) {
+    for (const StateProfile& p : s.profiles) {
+        if (p.name[0] != '\0' && strcmp(p.name, name) == 0) return &p;
+    }
+    return nullptr;
+}
+
+void state_policy_forget(int wan_id) {
+    if (wan_id < 1) return;
+    wan_id_erase(g_tracks, wan_id);
+}
+
+const StateProfile& state_policy_profile_for(int source) {
+    const char* name = source_name(source);
+    for (int a = 0; a < STATE_MAX_ASSIGNMENTS; a++) {
+        if (strcmp(g_settings.assign_source[a], name) != 0) continue;
+        const StateProfile* p = find_profile(g_settings, g_settings.assign_profile[a]);
+        if (p != nullptr) return *p;
+        break;
+    }
+    return g_settings.profiles[0];
+}
+
+// Grade against the enter limits, or the exit limits of a state already held
+static WanState grade(const StateProfile& p, WanState current, uint8_t loss_pct, uint16_t latency_ms) {
+    uint8_t down_limit = (current == WanState::DOWN) ? p.down_exit_pct : p.down_enter_pct;
+    if (loss_pct > down_limit) return WanState::DOWN;
+
+    bool held = current != WanState::UP;
+    uint8_t loss_limit = held ? p.loss_exit_pct : p.loss_enter_pct;
+    uint16_t latency_limit = held ? p.latency_exit_ms : p.latency_enter_ms;
+    if (loss_pct > loss_limit || latency_ms > latency_limit) return WanState::DEGRADED;
+    return WanState::UP;
+}
+
+WanState state_policy_evaluate(int source, WanState reported,
+                               uint8_t loss_pct, uint16_t latency_ms) {
+    if (source < 0 || source > MAX_WANS) return reported;
+
+    const StateProfile& p = state_policy_profile_for(source);
+    Track& t = g_tracks[source];
+    unsigned long now = millis();
+    g_stats.evaluations++;
+
+    WanState target = grade(p, t.primed ? t.state : WanState::UP, loss_pct, latency_ms);
+    if ((int)reported < (int)target) target = reported;  // DOWN < DEGRADED < UP
+
+    if (!t.primed) {
+        t = { true, target, target, now };
+        return target;
+    }
+
+    if (target == t.state) {
+        if (t.pending != t.state) g_stats.held++;
+        t.pending = t.state;
+        return t.state;
+    }
+
+    // Keep the clock running while the grade stays on the same side of the
+    // current state (DEGRADED then DOWN is one worsening, not two)
+    bool worse = (int)target < (int)t.state;
+    bool same_side = t.pending != t.state && (((int)t.pending < (int)t.state) == worse);
+    if (!same_side) {
+        if (t.pending != t.state) g_stats.held++;
+        t.since_ms = now;
+    }
+    t.pending = target;
+
+    uint32_t dwell_ms = (uint32_t)(worse ? p.dwell_worse_s : p.dwell_better_s) * 1000;
+    if (now - t.since_ms < dwell_ms) return t.state;
+
+    t.state = target;
+    g_stats.transitions++;
+    return target;
+}
+
+// Profile names follow the WAN name rules: [a-z][a-z0-9_-]*
+static bool profile_name_valid(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= STATE_PROFILE_NAME_LEN) return false;
+    if (name[0] < 'a' || name[0] > 'z') return false;
+    for (size_t i = 1; i < len; i++) {
+        char c = name[i];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static bool profile_valid(const StateProfile& p) {
+    if (!profile_name_valid(p.name)) return false;
+    if (p.loss_enter_pct > 100 || p.down_enter_pct > 100) return false;
+    if (p.latency_exit_ms > p.latency_enter_ms) return false;
+    if (p.loss_exit_pct > p.loss_enter_pct || p.down_exit_pct > p.down_enter_pct) return false;
+    if (p.loss_enter_pct > p.down_enter_pct) return false;
+    return p.dwell_worse_s <= 3600 && p.dwell_better_s <= 3600;
+}
+
+bool state_settings_valid(const StateSettings& s) {
+    if (strcmp(s.profiles[0].name, STATE_DEFAULT_PROFILE) != 0) return false;
+    for (int i = 0; i < STATE_MAX_PROFILES; i++) {
+        if (s.profiles[i].name[0] == '\0') continue;
+        if (!profile_valid(s.profiles[i])) return false;
+        if (find_profile(s, s.profiles[i].name) != &s.profiles[i]) return false;  // duplicate
+    }
+    for (int a = 0; a < STATE_MAX_ASSIGNMENTS; a++) {
+        const char* src = s.assign_source[a];
+        if (src[0] == '\0') continue;
+        if (strcmp(src, "local") != 0 && !wan_name_is_valid(src)) return false;
+        if (find_profile(s, s.assign_profile[a]) == nullptr) return false;
+        for (int b = 0; b < a; b++) {
+            if (strcmp(s.assign_source[b], src) == 0) return false;
+        }
+    }
+    return true;
+}
+
+void state_policy_set_settings(const StateSettings& settings) {
+    if (!state_settings_valid(settings)) {
+        LOG_WARN("State policy: invalid settings ignored");
+        return;
+    }
+    g_settings = settings;
+
+    // New limits apply from the next evaluation; a change still waiting for
+    // its dwell time is judged again from scratch
+    for (Track& t : g_tracks) t.pending = t.state;
+    LOG_INFO("State policy: settings updated");
+}
+
+const StateSettings& state_policy_get_settings() {
+    return g_settings;
+}
+
+const StatePolicyStats& state_policy_get_stats() {
+    return g_stats;
+}
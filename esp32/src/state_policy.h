@@ -0,0 +1,72 @@
+// state_policy.h
+// WAN state evaluation: threshold profiles with hysteresis and dwell times
+//
+// The panel grades every source itself (the local pinger and each WAN
+// reported by the collector) from its loss and latency, so the state
+// machine is the same whatever the transport. A profile has separate enter
+// and exit limits: a link that went DEGRADED above 5% loss only returns to
+// UP at or below the exit limit, so a link hovering around one limit does
+// not flap. A new state must also hold for the profile's dwell time before
+// it is taken (dwell_worse_s towards DOWN, dwell_better_s towards UP).
+//
+// Profiles are named; "default" always exists. Sources are assigned to a
+// profile by name ("local" for the pinger, or a WAN name); unassigned
+// sources use "default".
+#pragma once
+
+#include <Arduino.h>
+#include "wan_metrics.h"
+
+static const int STATE_MAX_PROFILES = 4;
+static const size_t STATE_PROFILE_NAME_LEN = 12;        // including the terminator
+static const int STATE_MAX_ASSIGNMENTS = MAX_WANS + 1;  // every WAN plus "local"
+static const char* STATE_DEFAULT_PROFILE = "default";
+
+struct StateProfile {
+    char name[STATE_PROFILE_NAME_LEN];  // "" = unused slot
+    uint16_t latency_enter_ms;  // DEGRADED above this latency...
+    uint16_t latency_exit_ms;   // ...until it is at or below this
+    uint8_t loss_enter_pct;     // DEGRADED above this loss...
+    uint8_t loss_exit_pct;
+    uint8_t down_enter_pct;     // DOWN above this loss...
+    uint8_t down_exit_pct;
+    uint16_t dwell_worse_s;     // time a worse state must hold before it is taken
+    uint16_t dwell_better_s;    // same, for a better state
+};
+
+// Built-in "default" profile: the old fixed thresholds as enter limits
+static const StateProfile STATE_DEFAULT_LIMITS = { "default", 200, 150, 5, 2, 50, 30, 0, 30 };
+
+// Persisted as part of PanelConfig. Slot 0 is always "default".
+struct StateSettings {
+    StateProfile profiles[STATE_MAX_PROFILES];
+    char assign_source[STATE_MAX_ASSIGNMENTS][WAN_NAME_LEN];             // "" = unused
+    char assign_profile[STATE_MAX_ASSIGNMENTS][STATE_PROFILE_NAME_LEN];  // profile name
+};
+
+struct StatePolicyStats {
+    uint32_t evaluations;
+    uint32_t transitions;       // state changes taken
+    uint32_t held;              // changes that reverted before their dwell time
+};
+
+// Grade a source's latest metrics and return its (debounced) state.
+// source is LOCAL_PINGER_ID or a wan_id. reported is the collector's own
+// state, if any: the result is never better than it, so a collector can
+// still force a link DOWN (pass UP when there is nothing to cap).
+WanState state_policy_evaluate(int source, WanState reported,
+                               uint8_t loss_pct, uint16_t latency_ms);
+
+// Drop a forgotten WAN's state machine; later WANs move down with their ids
+void state_policy_forget(int wan_id);
+
+// Profile in use for a source
+const StateProfile& state_policy_profile_for(int source);
+
+// Check a settings block (names, limit order, assignments)
+bool state_settings_valid(const StateSettings& settings);
+
+void state_policy_set_settings(const StateSettings& settings);
+const StateSettings& state_policy_get_settings();
+
+const StatePolicyStats& state_policy_get_stats();
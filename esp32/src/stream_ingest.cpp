@@ -0,0 +1,301 @@
+// stream_ingest.cpp
+#include "stream_ingest.h"
+#include <WiFi.h>
+#include "wan_metrics.h"
+#include "wan_fields.h"
+#include "wan_counters.h"
+#include "state_policy.h"
+#include "admission.h"
+#include "ingest_key.h"
+#include "leds.h"
+#include "logger.h"
+
+// Longest record we accept; longer lines are discarded up to the next newline
+static const size_t MAX_LINE_BYTES = 384;
+
+// Bytes consumed from the socket per stream_ingest_update() call
+static const size_t MAX_READ_PER_UPDATE = 512;
+
+// Record rate is recomputed over this window
+static const unsigned long RATE_WINDOW_MS = 5000;
+
+static WiFiServer g_server(STREAM_INGEST_PORT);
+static WiFiClient g_client;
+static StreamIngestStats g_stats;
+
+static char g_line[MAX_LINE_BYTES];
+static size_t g_line_len = 0;
+static bool g_discarding = false;
+static bool g_drop = false;             // close once the current read is done
+static unsigned long g_last_rx_ms = 0;
+static char g_nonce[17];                // challenge of the current connection
+
+static uint32_t g_rate_records = 0;
+static unsigned long g_rate_start_ms = 0;
+
+static void copy_str(char* dst, size_t dst_size, const char* src) {
+    strncpy(dst, src, dst_size - 1);
+    dst[dst_size - 1] = '\0';
+}
+
+// Split the next space-delimited token off *cursor, NUL-terminating it in place
+static char* next_token(char** cursor) {
+    char* p = *cursor;
+    while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+    if (*p == '\0') return nullptr;
+
+    char* start = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r') p++;
+    if (*p != '\0') *p++ = '\0';
+    *cursor = p;
+    return start;
+}
+
+// Parse one NUL-terminated record in place
+static bool handle_record(char* line) {
+    char* cursor = line;
+    char* kind = next_token(&cursor);
+    if (kind == nullptr) return true;  // blank line (keepalive)
+
+    if (strcmp(kind, "router") == 0) {
+        // Fields missing from the record keep their current values
+        char router_ip[16];
+        char timestamp[32];
+        copy_str(router_ip, sizeof(router_ip), wan_metrics_get_router_ip());
+        copy_str(timestamp, sizeof(timestamp), wan_metrics_get_timestamp());
+        char* tok;
+        while ((tok = next_token(&cursor)) != nullptr) {
+            char* eq = strchr(tok, '=');
+            if (eq == nullptr) return false;
+            *eq = '\0';
+            if (strcmp(tok, "router_ip") == 0) copy_str(router_ip, sizeof(router_ip), eq + 1);
+            else if (strcmp(tok, "timestamp") == 0) copy_str(timestamp, sizeof(timestamp), eq + 1);
+        }
+        wan_metrics_set_router_info(router_ip, timestamp);
+        return true;
+    }
+
+    // WAN record, kind = WAN name. Parse into a copy so a malformed line
+    // changes nothing and does not take a slot in the WAN table.
+    int wan_id = wan_metrics_find(kind);
+    WanMetrics m;
+    if (wan_id != 0) {
+        m = wan_metrics_get(wan_id);
+    } else {
+        wan_fields_set_defaults(m);
+        m.last_update_ms = 0;
+    }
+    WanCounterSample counters = { 0, 0, (uint32_t)millis(), 64 };
+    int counter_keys = 0;
+    WanState reported = WanState::UP;  // the panel grades the state; a reported one caps it
+    char* tok;
+    while ((tok = next_token(&cursor)) != nullptr) {
+        char* eq = strchr(tok, '=');
+        if (eq == nullptr) return false;
+        *eq = '\0';
+        const char* value = eq + 1;
+        if (strcmp(tok, "rx_bytes") == 0) {
+            counters.rx_bytes = strtoull(value, nullptr, 10);
+            counter_keys++;
+        } else if (strcmp(tok, "tx_bytes") == 0) {
+            counters.tx_bytes = strtoull(value, nullptr, 10);
+            counter_keys++;
+        } else if (strcmp(tok, "counters_ms") == 0) {
+            counters.at_ms = (uint32_t)strtoull(value, nullptr, 10);
+        } else if (strcmp(tok, "counter_bits") == 0) {
+            counters.bits = (atoi(value) == 32) ? 32 : 64;
+        } else if (strcmp(tok, "state") == 0) {
+            reported = wan_state_from_string(value);
+        } else {
+            const WanField* field = wan_field_find(tok);
+            // Unknown keys are ignored; a bad value rejects the whole line
+            if (field != nullptr && !wan_field_from_text(m, *field, value)) return false;
+        }
+    }
+
+    // The whole line parsed: now the WAN may be added
+    if (wan_id == 0) wan_id = wan_metrics_find_or_add(kind);
+    WanMetrics* record = wan_metrics_edit(wan_id);
+    if (record == nullptr) return false;
+
+    if (counter_keys == 2) wan_counters_apply(wan_id, m, counters);
+    m.state = state_policy_evaluate(wan_id, reported, m.loss_pct, m.latency_ms);
+    *record = m;
+    wan_metrics_commit(wan_id);
+
+    wan_set_leds(wan_id, m.state);
+    return true;
+}
+
+// First line of a keyed connection: "auth <mac>"
+static bool check_auth(char* line) {
+    char* cursor = line;
+    char* kind = next_token(&cursor);
+    char* mac_hex = next_token(&cursor);
+    if (kind == nullptr || strcmp(kind, "auth") != 0 || mac_hex == nullptr) return false;
+
+    uint8_t mac[INGEST_MAC_BYTES];
+    char head[32];
+    int head_len = snprintf(head, sizeof(head), "stream %s", g_nonce);
+    return ingest_mac_parse(mac_hex, strlen(mac_hex), mac) &&
+           ingest_mac_matches((const uint8_t*)head, head_len, nullptr, 0, mac);
+}
+
+static void consume_byte(char c) {
+    if (c == '\n') {
+        if (g_discarding) {
+            g_discarding = false;
+        } else if (!g_stats.authenticated) {
+            g_line[g_line_len] = '\0';
+            if (check_auth(g_line)) {
+                g_stats.authenticated = true;
+                LOG_INFO("Stream ingest: %s authenticated", g_stats.client_ip);
+            } else {
+                g_stats.auth_failures++;
+                g_drop = true;
+            }
+        } else {
+            g_line[g_line_len] = '\0';
+            if (handle_record(g_line)) {
+                g_stats.records++;
+                g_rate_records++;
+            } else {
+                g_stats.parse_errors++;
+            }
+        }
+        g_line_len = 0;
+        return;
+    }
+
+    if (g_discarding) return;
+
+    if (g_line_len >= MAX_LINE_BYTES - 1) {
+        // Over-long record: drop it entirely
+        g_stats.parse_errors++;
+        g_discarding = true;
+        g_line_len = 0;
+        return;
+    }
+    g_line[g_line_len++] = c;
+}
+
+static void disconnect(const char* reason) {
+    if (g_stats.connected) {
+        LOG_INFO("Stream ingest: %s disconnected (%s)", g_stats.client_ip, reason);
+    }
+    g_client.stop();
+    g_stats.connected = false;
+    g_stats.authenticated = false;
+    g_stats.client_ip[0] = '\0';
+    g_line_len = 0;
+    g_discarding = false;
+    g_drop = false;
+}
+
+// Refuse a connection without touching the current one
+static void refuse(WiFiClient& client, const char* reason) {
+    g_stats.rejected++;
+    LOG_WARN("Stream ingest: refused %s (%s)", client.remoteIP().toString().c_str(), reason);
+    client.stop();
+}
+
+// Accept a connection, or refuse it to keep the current collector
+static void accept_client(unsigned long now) {
+    WiFiClient incoming = g_server.available();
+    if (!incoming) return;
+
+    IPAddress ip = incoming.remoteIP();
+    const AdmissionSettings& trusted = admission_get_settings();
+    if (trusted.router_ip[0] != '\0' && !admission_is_priority(ip)) {
+        refuse(incoming, "not the router");
+        return;
+    }
+    if (g_stats.connected && g_client.connected() && now - g_last_rx_ms < STREAM_REPLACE_AFTER_MS) {
+        refuse(incoming, "collector already connected");
+        return;
+    }
+
+    if (g_stats.connected) disconnect("replaced");
+    g_client = incoming;
+    g_stats.connected = true;
+    g_stats.connects++;
+    g_stats.connected_ms = now;
+    g_last_rx_ms = now;
+    copy_str(g_stats.client_ip, sizeof(g_stats.client_ip), ip.toString().c_str());
+
+    // Challenge when a key is installed; otherwise records are taken as they come
+    g_stats.authenticated = !ingest_key_present();
+    if (!g_stats.authenticated) {
+        snprintf(g_nonce, sizeof(g_nonce), "%08lx%08lx",
+                 (unsigned long)esp_random(), (unsigned long)esp_random());
+        char hello[24];
+        int len = snprintf(hello, sizeof(hello), "WW2 %s\n", g_nonce);
+        g_client.write((const uint8_t*)hello, len);
+    }
+    LOG_INFO("Stream ingest: %s connected", g_stats.client_ip);
+}
+
+static void update_rate(unsigned long now) {
+    unsigned long elapsed = now - g_rate_start_ms;
+    if (elapsed < RATE_WINDOW_MS) return;
+    g_stats.records_per_sec = (g_rate_records * 1000.0f) / elapsed;
+    g_rate_records = 0;
+    g_rate_start_ms = now;
+}
+
+void stream_ingest_init() {
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_server.begin();
+    g_server.setNoDelay(true);
+    g_rate_start_ms = millis();
+    bool keyed = ingest_key_load();
+    LOG_INFO("Stream ingest listening on port %u (%s)", STREAM_INGEST_PORT,
+             keyed ? "auth required" : "no key, open");
+}
+
+void stream_ingest_update() {
+    unsigned long now = millis();
+    update_rate(now);
+
+    if (g_server.hasClient()) accept_client(now);
+
+    if (!g_stats.connected) return;
+
+    if (!g_client.connected() && !g_client.available()) {
+        disconnect("closed");
+        return;
+    }
+
+    size_t budget = MAX_READ_PER_UPDATE;
+    uint8_t chunk[128];
+    while (budget > 0) {
+        int avail = g_client.available();
+        if (avail <= 0) break;
+        size_t want = min((size_t)avail, min(budget, sizeof(chunk)));
+        int n = g_client.read(chunk, want);
+        if (n <= 0) break;
+        for (int i = 0; i < n && !g_drop; i++) {
+            consume_byte((char)chunk[i]);
+        }
+        budget -= n;
+        g_last_rx_ms = now;
+        if (g_drop) {
+            disconnect("auth failed");
+            return;
+        }
+    }
+
+    if (!g_stats.authenticated && now - g_stats.connected_ms > STREAM_AUTH_TIMEOUT_MS) {
+        g_stats.auth_failures++;
+        disconnect("no auth");
+        return;
+    }
+
+    if (now - g_last_rx_ms > STREAM_IDLE_TIMEOUT_MS) {
+        disconnect("idle");
+    }
+}
+
+const StreamIngestStats& stream_ingest_get_stats() {
+    return g_stats;
+}
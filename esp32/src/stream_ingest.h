@@ -0,0 +1,60 @@
+// stream_ingest.h
+// Persistent TCP ingest: the collector holds one connection open and streams
+// newline-delimited metric records, parsed incrementally without allocation
+//
+// Record format (space separated key=value pairs, one record per line):
+//   router router_ip=192.168.1.1 timestamp=2025-01-15T10:30:00Z
+//   wan1 state=up loss_pct=0 latency_ms=6 jitter_ms=0 down_mbps=2.0 ...
+// The record kind is the WAN name (anything but "router"), and keys use the
+// same names as the JSON batch, including the raw counter keys (rx_bytes,
+// tx_bytes, counters_ms; see wan_counters.h). Keys missing from a WAN
+// record keep their previous values. A record is applied only if the whole
+// line parses, and a new WAN is added to the table only then.
+//
+// One collector at a time: while the current connection is healthy (it
+// has sent something in the last STREAM_REPLACE_AFTER_MS), new connections
+// are refused rather than replacing it. When trusted_router_ip is set (see
+// admission.h), only that address may connect. When an ingest key is
+// installed (ingest_key.h), the panel opens with a challenge line
+//   WW2 <nonce>
+// (16 hex chars) and the first line from the collector must be
+//   auth <mac>
+// with mac = first 32 hex chars of HMAC-SHA256(key, "stream <nonce>\n").
+// Anything else, or no answer within STREAM_AUTH_TIMEOUT_MS, closes the
+// connection.
+#pragma once
+
+#include <Arduino.h>
+
+static const uint16_t STREAM_INGEST_PORT = 5581;
+
+// Drop a connection that has been silent this long
+static const unsigned long STREAM_IDLE_TIMEOUT_MS = 90UL * 1000UL;
+
+// A newcomer may take over a connection that has been silent this long
+static const unsigned long STREAM_REPLACE_AFTER_MS = 45UL * 1000UL;
+
+// Time allowed for the auth line
+static const unsigned long STREAM_AUTH_TIMEOUT_MS = 10UL * 1000UL;
+
+struct StreamIngestStats {
+    bool connected;             // collector currently connected
+    char client_ip[16];         // collector address (empty when disconnected)
+    uint32_t connects;          // connections accepted since boot
+    uint32_t rejected;          // connections refused (not the router, or one already active)
+    uint32_t auth_failures;     // bad or missing auth line
+    bool authenticated;         // the current connection passed the handshake (or no key is set)
+    uint32_t records;           // records applied
+    uint32_t parse_errors;      // malformed or over-long records
+    float records_per_sec;      // recent record rate
+    unsigned long connected_ms; // millis() when the current connection opened
+};
+
+// Start listening (call once in setup(), after the network is up)
+void stream_ingest_init();
+
+// Accept connections and parse buffered bytes (call from loop(); never blocks)
+void stream_ingest_update();
+
+// Get connection state and counters
+const StreamIngestStats& stream_ingest_get_stats();
@@ -0,0 +1,243 @@
+// udp_ingest.cpp
+#include "udp_ingest.h"
+#include "wan_ingest.h"
+#include <WiFiUdp.h>
+#include <Preferences.h>
+#include "ingest_key.h"
+#include "logger.h"
+
+// Datagrams handled per udp_ingest_update() call, so a burst can't stall loop()
+static const int MAX_DATAGRAMS_PER_UPDATE = 4;
+
+// Largest datagram we accept (one Ethernet MTU worth of payload)
+static const size_t MAX_DATAGRAM_BYTES = 1472;
+
+// Sliding replay window (bit i set = highest_seq - i already seen)
+static const uint32_t SEQ_WINDOW = 64;
+
+static WiFiUDP g_udp;
+static UdpIngestStats g_stats;
+static uint8_t g_buf[MAX_DATAGRAM_BYTES];
+static uint64_t g_seen_window = 0;
+static uint64_t g_session = 0;
+static bool g_have_session = false;
+
+static Preferences g_prefs;
+static bool g_nvs_ok = false;
+static uint32_t g_saved_time = 0;   // high-water mark as stored in NVS
+static unsigned long g_mark_ms = 0; // millis() when the mark last moved
+static uint32_t g_jump_time = 0;    // sender time of an unconfirmed jump (0 = none)
+static unsigned long g_jump_ms = 0; // millis() when that jump was first seen
+
+static uint32_t seconds_since(unsigned long ms) {
+    return (millis() - ms) / 1000;
+}
+
+static void set_mark(uint32_t time_s) {
+    g_stats.newest_time = time_s;
+    g_mark_ms = millis();
+    g_jump_time = 0;
+    if (!g_nvs_ok || time_s - g_saved_time < UDP_HWM_SAVE_S) return;
+    if (g_prefs.putUInt("hwm", time_s) == sizeof(uint32_t)) g_saved_time = time_s;
+}
+
+// Advance the newest accepted sender time. Within the panel's own estimate
+// of the sender clock it moves at once; further ahead (or with no mark at
+// all) the time must be confirmed by datagrams that keep to it.
+static void note_time(uint32_t time_s) {
+    if (time_s <= g_stats.newest_time) return;
+    if (g_stats.newest_time != 0 &&
+        time_s <= g_stats.newest_time + seconds_since(g_mark_ms) + UDP_MAX_AGE_S) {
+        set_mark(time_s);
+        return;
+    }
+
+    if (g_stats.newest_time != 0) g_stats.ahead++;
+    uint32_t expected = g_jump_time + seconds_since(g_jump_ms);
+    if (g_jump_time == 0 || time_s + UDP_MAX_AGE_S < expected || time_s > expected + UDP_MAX_AGE_S) {
+        g_jump_time = time_s;
+        g_jump_ms = millis();
+        return;
+    }
+    if (seconds_since(g_jump_ms) >= UDP_JUMP_CONFIRM_S) {
+        LOG_INFO("UDP ingest: sender time moved to %lu", (unsigned long)time_s);
+        set_mark(time_s);
+    }
+}
+
+// Classify a datagram against the time limit and the replay window.
+// Returns true if the datagram is new and in order (should be applied).
+static bool track_sequence(uint64_t session, uint32_t seq, uint32_t time_s) {
+    if (time_s + UDP_MAX_AGE_S < g_stats.newest_time) {
+        // Older than anything the sender could still have in flight
+        g_stats.stale++;
+        return false;
+    }
+
+    if (!g_have_session || session != g_session) {
+        // First datagram, or the sender restarted (any new session will do:
+        // its time has just been checked)
+        g_session = session;
+        g_have_session = true;
+        snprintf(g_stats.session, sizeof(g_stats.session), "%08lx%08lx",
+                 (unsigned long)(session >> 32), (unsigned long)(session & 0xFFFFFFFFUL));
+        g_stats.sessions++;
+        g_stats.last_seq = seq;
+        g_seen_window = 1;
+        note_time(time_s);
+        return true;
+    }
+
+    if (seq > g_stats.last_seq) {
+        uint32_t gap = seq - g_stats.last_seq;
+        g_stats.lost += gap - 1;
+        g_seen_window = (gap >= SEQ_WINDOW) ? 0 : (g_seen_window << gap);
+        g_seen_window |= 1;
+        g_stats.last_seq = seq;
+        note_time(time_s);
+        return true;
+    }
+
+    uint32_t behind = g_stats.last_seq - seq;
+    if (behind >= SEQ_WINDOW) {
+        g_stats.out_of_order++;
+        return false;
+    }
+
+    uint64_t bit = (uint64_t)1 << behind;
+    if (g_seen_window & bit) {
+        g_stats.duplicate++;
+        return false;
+    }
+
+    // Late arrival fills a gap we had counted as lost. Newer data has already
+    // been applied, so the late sample is only counted.
+    g_seen_window |= bit;
+    if (g_stats.lost > 0) g_stats.lost--;
+    g_stats.out_of_order++;
+    return false;
+}
+
+static void handle_datagram(size_t len) {
+    // Header: "WW2 <session> <seq> <time> <mac>\n"
+    const uint8_t* nl = (const uint8_t*)memchr(g_buf, '\n', len);
+    if (len < 4 || memcmp(g_buf, "WW2 ", 4) != 0 || nl == nullptr) {
+        g_stats.malformed++;
+        return;
+    }
+
+    const char* hdr = (const char*)g_buf + 4;
+    size_t hdr_len = (const char*)nl - hdr;
+    const char* mac_sep = hdr + hdr_len;
+    while (mac_sep > hdr && *mac_sep != ' ') mac_sep--;
+    if (mac_sep == hdr) {
+        g_stats.malformed++;
+        return;
+    }
+
+    char numbers[48];
+    size_t numbers_len = mac_sep - hdr;
+    if (numbers_len == 0 || numbers_len >= sizeof(numbers)) {
+        g_stats.malformed++;
+        return;
+    }
+    memcpy(numbers, hdr, numbers_len);
+    numbers[numbers_len] = '\0';
+
+    char session_hex[17];
+    unsigned long seq = 0, time_s = 0;
+    if (sscanf(numbers, "%16[0-9a-fA-F] %lu %lu", session_hex, &seq, &time_s) != 3 ||
+        strlen(session_hex) != 16) {
+        g_stats.malformed++;
+        return;
+    }
+    uint64_t session = strtoull(session_hex, nullptr, 16);
+
+    uint8_t mac[INGEST_MAC_BYTES];
+    if (!ingest_mac_parse(mac_sep + 1, (const char*)nl - (mac_sep + 1), mac)) {
+        g_stats.malformed++;
+        return;
+    }
+
+    const uint8_t* payload = nl + 1;
+    size_t payload_len = len - (payload - g_buf);
+    if (!ingest_mac_matches((const uint8_t*)numbers, numbers_len, payload, payload_len, mac)) {
+        g_stats.bad_mac++;
+        return;
+    }
+
+    if (!track_sequence(session, (uint32_t)seq, (uint32_t)time_s)) return;
+
+    // JSON may start with whitespace; a MessagePack batch starts with a map
+    size_t first = 0;
+    while (first < payload_len && isspace(payload[first])) first++;
+    JsonDocument doc;
+    bool msgpack = first < payload_len && payload[first] != '{';
+    if (wan_ingest_decode(doc, payload, payload_len, msgpack)) {
+        g_stats.malformed++;
+        return;
+    }
+
+    wan_ingest_apply(doc);
+    g_stats.accepted++;
+}
+
+void udp_ingest_init() {
+    memset(&g_stats, 0, sizeof(g_stats));
+
+    if (!ingest_key_load()) {
+        LOG_INFO("UDP ingest disabled (no key at %s)", INGEST_KEY_PATH);
+        return;
+    }
+
+    // Newest sender time from before the reboot: older datagrams stay stale
+    g_nvs_ok = g_prefs.begin(UDP_INGEST_NVS_NAMESPACE, false);
+    if (g_nvs_ok) {
+        g_saved_time = g_prefs.getUInt("hwm", 0);
+        g_stats.newest_time = g_saved_time;
+        g_mark_ms = millis();
+    } else {
+        LOG_WARN("UDP ingest: NVS unavailable, replay limit starts over at boot");
+    }
+
+    if (!g_udp.begin(UDP_INGEST_PORT)) {
+        LOG_WARN("UDP ingest: failed to open socket");
+        return;
+    }
+
+    g_stats.enabled = true;
+    LOG_INFO("UDP ingest listening on port %u", UDP_INGEST_PORT);
+}
+
+void udp_ingest_update() {
+    if (!g_stats.enabled) return;
+
+    for (int i = 0; i < MAX_DATAGRAMS_PER_UPDATE; i++) {
+        int size = g_udp.parsePacket();
+        if (size <= 0) return;
+
+        g_stats.received++;
+        if ((size_t)size > MAX_DATAGRAM_BYTES) {
+            g_udp.flush();
+            g_stats.malformed++;
+            continue;
+        }
+
+        int len = g_udp.read(g_buf, MAX_DATAGRAM_BYTES);
+        if (len > 0) {
+            handle_datagram((size_t)len);
+        }
+    }
+}
+
+void udp_ingest_reset_time() {
+    g_stats.newest_time = 0;
+    g_jump_time = 0;
+    g_saved_time = 0;
+    if (g_nvs_ok) g_prefs.remove("hwm");
+    LOG_INFO("UDP ingest: newest sender time cleared");
+}
+
+const UdpIngestStats& udp_ingest_get_stats() {
+    return g_stats;
+}
@@ -0,0 +1,67 @@
+// udp_ingest.h
+// Signed UDP datagram ingest for pfSense metrics (alternative to POST /api/wans)
+//
+// Datagram layout (one self-contained batch per datagram):
+//   WW2 <session> <seq> <time> <mac>\n<payload>
+// - session: random 64-bit nonce (16 hex chars) picked at every sender start;
+//            any new session replaces the current one
+// - seq:     per-session sequence number, incremented for every datagram
+// - time:    sender clock, Unix seconds
+// - mac:     first 16 bytes (32 hex chars) of
+//            HMAC-SHA256(key, "<session> <seq> <time>\n<payload>"), keyed
+//            with the shared secret (see ingest_key.h)
+// - payload: the same batch schema as POST /api/wans, JSON or MessagePack
+//
+// Replays are caught by the sequence window within a session, and across
+// sessions by the time: a datagram more than UDP_MAX_AGE_S older than the
+// newest time accepted (the mark) is dropped as stale. The mark is saved to
+// NVS (every UDP_HWM_SAVE_S of sender time), so a reboot does not reopen
+// the door to old datagrams.
+//
+// The mark only follows the sender clock as far as the panel's own elapsed
+// time since the last advance allows (plus UDP_MAX_AGE_S). A datagram
+// further ahead (a router RTC that is wrong before NTP sync) is applied but
+// leaves the mark alone; the jump is taken only once later datagrams have
+// stayed on that clock for UDP_JUMP_CONFIRM_S. A sender clock that steps
+// back further than UDP_MAX_AGE_S behind the mark is dropped as stale until
+// it catches up, or until the mark is cleared with PATCH /api/config
+// {"udp_reset_time": true}.
+#pragma once
+
+#include <Arduino.h>
+
+static const uint16_t UDP_INGEST_PORT = 5580;
+constexpr const char* UDP_INGEST_NVS_NAMESPACE = "udpingest";
+static const uint32_t UDP_MAX_AGE_S = 300;     // tolerated reordering and clock steps
+static const uint32_t UDP_HWM_SAVE_S = 600;    // high-water mark save interval
+static const uint32_t UDP_JUMP_CONFIRM_S = 600; // panel time a jump ahead must hold before the mark takes it
+
+struct UdpIngestStats {
+    bool enabled;             // false when no key file is present
+    uint32_t received;        // datagrams read from the socket
+    uint32_t accepted;        // datagrams applied to the metrics store
+    uint32_t bad_mac;         // MAC mismatch
+    uint32_t malformed;       // bad header or undecodable payload
+    uint32_t lost;            // sequence gaps not (yet) filled by late datagrams
+    uint32_t duplicate;       // sequence already seen
+    uint32_t out_of_order;    // late datagrams (counted, not applied)
+    uint32_t stale;           // older than the newest accepted time allows (replay or clock step)
+    uint32_t ahead;           // applied, but too far ahead of the mark to move it (unconfirmed jump)
+    uint32_t sessions;        // sender sessions started since boot
+    char session[17];         // current sender session (hex, "" before the first)
+    uint32_t last_seq;        // highest sequence accepted in this session
+    uint32_t newest_time;     // newest sender time accepted (Unix seconds, 0 = none)
+};
+
+// Open the UDP socket (call once in setup(), after LittleFS is mounted)
+void udp_ingest_init();
+
+// Drain pending datagrams (call from loop(); never blocks)
+void udp_ingest_update();
+
+// Forget the newest sender time (in RAM and NVS), e.g. after the router
+// clock ran ahead for a while and was then corrected
+void udp_ingest_reset_time();
+
+// Get ingest counters
+const UdpIngestStats& udp_ingest_get_stats();
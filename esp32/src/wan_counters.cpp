@@ -0,0 +1,47 @@
+// wan_counters.cpp
+#include "wan_counters.h"
+#include "counter_rate.h"
+#include "data_usage.h"
+
+static CounterRate g_rx[MAX_WANS];
+static CounterRate g_tx[MAX_WANS];
+static WanCounterStats g_stats;
+
+void wan_counters_apply(int wan_id, WanMetrics& m, const WanCounterSample& sample) {
+    if (wan_id < 1 || wan_id > MAX_WANS) return;
+    CounterRate& rx = g_rx[wan_id - 1];
+    CounterRate& tx = g_tx[wan_id - 1];
+    uint32_t resets_before = rx.resets + tx.resets;
+    uint32_t wraps_before = rx.wraps + tx.wraps;
+    g_stats.samples++;
+
+    bool rx_rate = counter_rate_update(rx, sample.rx_bytes, sample.at_ms, sample.bits);
+    bool tx_rate = counter_rate_update(tx, sample.tx_bytes, sample.at_ms, sample.bits);
+    if (rx_rate || tx_rate) g_stats.rates++;
+    data_usage_add_bytes(wan_id, rx_rate ? rx.delta : 0, tx_rate ? tx.delta : 0);
+    g_stats.resets += rx.resets + tx.resets - resets_before;
+    g_stats.wraps += rx.wraps + tx.wraps - wraps_before;
+
+    // Report the latest known rates, also while re-priming after a reset
+    if (rx.has_rate) {
+        m.down_mbps = rx.mbps;
+        m.down_1m = rx.avg_mbps[0];
+        m.down_5m = rx.avg_mbps[1];
+        m.down_15m = rx.avg_mbps[2];
+    }
+    if (tx.has_rate) {
+        m.up_mbps = tx.mbps;
+        m.up_1m = tx.avg_mbps[0];
+        m.up_5m = tx.avg_mbps[1];
+        m.up_15m = tx.avg_mbps[2];
+    }
+}
+
+void wan_counters_forget(int wan_id) {
+    wan_id_erase(g_rx, wan_id - 1);
+    wan_id_erase(g_tx, wan_id - 1);
+}
+
+const WanCounterStats& wan_counters_get_stats() {
+    return g_stats;
+}
@@ -0,0 +1,37 @@
+// wan_counters.h
+// Bandwidth from raw interface byte counters reported by the collector
+//
+// Instead of rates and averages, a WAN record may carry rx_bytes/tx_bytes,
+// optionally with the monotonic router clock they were read at
+// (counters_ms; without it the arrival time on millis()). The panel keeps
+// the previous sample per WAN and derives down/up and the 1/5/15 minute
+// averages with counter_rate.h, the same code the SNMP poller uses. A
+// counter or clock that goes backwards re-primes the baseline and keeps
+// the averages; 32-bit counters (counter_bits=32) may also wrap.
+#pragma once
+
+#include <Arduino.h>
+#include "wan_metrics.h"
+
+struct WanCounterSample {
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    uint32_t at_ms;             // router clock (ms, any origin, only moves forward)
+    uint8_t bits;               // counter width: 32 or 64
+};
+
+struct WanCounterStats {
+    uint32_t samples;           // counter pairs received
+    uint32_t rates;             // samples that produced a new rate
+    uint32_t resets;            // counters or clock went backwards
+    uint32_t wraps;             // 32-bit counters wrapped
+};
+
+// Feed a sample while the WAN's record is being edited: sets the rate and
+// average fields of m from the counters (wan_id: 1..count)
+void wan_counters_apply(int wan_id, WanMetrics& m, const WanCounterSample& sample);
+
+// Drop a forgotten WAN's baselines; later WANs move down with their ids
+void wan_counters_forget(int wan_id);
+
+const WanCounterStats& wan_counters_get_stats();
@@ -0,0 +1,124 @@
+// wan_fields.cpp
+#include "wan_fields.h"
+#include <string.h>
+#include <stdlib.h>
+
+// ---- Raw field access ----
+template <typename T>
+static T& field_ref(WanMetrics& m, const WanField& f) {
+    return *reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(&m) + f.offset);
+}
+
+template <typename T>
+static const T& field_ref(const WanMetrics& m, const WanField& f) {
+    return *reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(&m) + f.offset);
+}
+
+static void set_number(WanMetrics& m, const WanField& f, float value) {
+    switch (f.type) {
+        case WanFieldType::STATE: field_ref<WanState>(m, f) = (WanState)(int)value; break;
+        case WanFieldType::U8:    field_ref<uint8_t>(m, f) = (uint8_t)constrain(value, 0.0f, 255.0f); break;
+        case WanFieldType::U16:   field_ref<uint16_t>(m, f) = (uint16_t)constrain(value, 0.0f, 65535.0f); break;
+        case WanFieldType::F32:   field_ref<float>(m, f) = value; break;
+        case WanFieldType::STR:   break;
+    }
+}
+
+static void set_string(WanMetrics& m, const WanField& f, const char* value) {
+    char* dst = &field_ref<char>(m, f);
+    strncpy(dst, value ? value : "", f.size - 1);
+    dst[f.size - 1] = '\0';
+}
+
+// ---- Public API ----
+
+const WanField* wan_field_find(const char* name) {
+    for (size_t i = 0; i < WAN_FIELD_COUNT; i++) {
+        if (strcmp(WAN_FIELDS[i].name, name) == 0) return &WAN_FIELDS[i];
+    }
+    return nullptr;
+}
+
+void wan_field_set_default(WanMetrics& m, const WanField& f) {
+    if (f.type == WanFieldType::STR) {
+        set_string(m, f, "");
+    } else {
+        set_number(m, f, f.default_value);
+    }
+}
+
+void wan_field_from_json(WanMetrics& m, const WanField& f, JsonVariantConst value) {
+    if (value.isNull()) {
+        wan_field_set_default(m, f);
+        return;
+    }
+    switch (f.type) {
+        case WanFieldType::STATE:
+            field_ref<WanState>(m, f) = wan_state_from_string(value | "down");
+            break;
+        case WanFieldType::STR:
+            set_string(m, f, value | "");
+            break;
+        default:
+            set_number(m, f, value | f.default_value);
+            break;
+    }
+}
+
+bool wan_field_from_text(WanMetrics& m, const WanField& f, const char* text) {
+    switch (f.type) {
+        case WanFieldType::STATE:
+            field_ref<WanState>(m, f) = wan_state_from_string(text);
+            return true;
+        case WanFieldType::STR:
+            set_string(m, f, text);
+            return true;
+        default: {
+            char* end;
+            float value = strtof(text, &end);
+            if (end == text) return false;
+            set_number(m, f, value);
+            return true;
+        }
+    }
+}
+
+void wan_field_to_json(const WanMetrics& m, const WanField& f, JsonObject obj) {
+    switch (f.type) {
+        case WanFieldType::STATE: obj[f.name] = wan_state_to_string(field_ref<WanState>(m, f)); break;
+        case WanFieldType::U8:    obj[f.name] = field_ref<uint8_t>(m, f); break;
+        case WanFieldType::U16:   obj[f.name] = field_ref<uint16_t>(m, f); break;
+        case WanFieldType::F32:   obj[f.name] = field_ref<float>(m, f); break;
+        case WanFieldType::STR:   obj[f.name] = &field_ref<char>(m, f); break;
+    }
+}
+
+float wan_field_scaled(const WanMetrics& m, WanFieldId id) {
+    const WanField& f = WAN_FIELDS[(size_t)id];
+    switch (f.type) {
+        case WanFieldType::STATE: return (float)(int)field_ref<WanState>(m, f) * f.scale;
+        case WanFieldType::U8:    return field_ref<uint8_t>(m, f) * f.scale;
+        case WanFieldType::U16:   return field_ref<uint16_t>(m, f) * f.scale;
+        case WanFieldType::F32:   return field_ref<float>(m, f) * f.scale;
+        case WanFieldType::STR:
+        default: return 0.0f;
+    }
+}
+
+void wan_fields_set_defaults(WanMetrics& m) {
+    for (size_t i = 0; i < WAN_FIELD_COUNT; i++) {
+        wan_field_set_default(m, WAN_FIELDS[i]);
+    }
+}
+
+void wan_fields_from_json(WanMetrics& m, JsonObjectConst obj) {
+    for (size_t i = 0; i < WAN_FIELD_COUNT; i++) {
+        wan_field_from_json(m, WAN_FIELDS[i], obj[WAN_FIELDS[i].name]);
+    }
+}
+
+void wan_fields_to_json(const WanMetrics& m, JsonObject obj) {
+    for (size_t i = 0; i < WAN_FIELD_COUNT; i++) {
+        wan_field_to_json(m, WAN_FIELDS[i], obj);
+    }
+}
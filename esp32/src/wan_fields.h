@@ -0,0 +1,48 @@
+// wan_fields.h
+// Table-driven access to WanMetrics fields
+//
+// WAN_FIELDS (wan_fields_gen.h) is generated from the WanMetrics schema in
+// data/openapi.yaml by extra_scripts/gen_wan_fields.py. Ingest, /api/status
+// and /metrics loop over it instead of naming each field.
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+#include "wan_metrics.h"
+
+enum class WanFieldType : uint8_t { STATE, U8, U16, F32, STR };
+
+struct WanField {
+    const char* name;    // JSON / wire key
+    uint16_t offset;     // offsetof(WanMetrics, field)
+    uint16_t size;       // storage size (buffer size for STR)
+    WanFieldType type;
+    float scale;         // multiplier to base units (seconds, ratio, bit/s)
+    float default_value; // applied when the field is missing on ingest
+};
+
+#include "wan_fields_gen.h"
+
+// Look up a field by key (nullptr if unknown)
+const WanField* wan_field_find(const char* name);
+
+// Reset a field to its schema default
+void wan_field_set_default(WanMetrics& m, const WanField& f);
+
+// Set a field from a JSON value; null/missing applies the default
+void wan_field_from_json(WanMetrics& m, const WanField& f, JsonVariantConst value);
+
+// Set a field from text (line protocol). Returns false if the text is invalid.
+bool wan_field_from_text(WanMetrics& m, const WanField& f, const char* text);
+
+// Write a field into a JSON object under its key
+void wan_field_to_json(const WanMetrics& m, const WanField& f, JsonObject obj);
+
+// Numeric value multiplied by the field's scale (0 for strings)
+float wan_field_scaled(const WanMetrics& m, WanFieldId id);
+
+// Reset all fields / copy all fields between JSON and a record
+void wan_fields_set_defaults(WanMetrics& m);
+void wan_fields_from_json(WanMetrics& m, JsonObjectConst obj);
+void wan_fields_to_json(const WanMetrics& m, JsonObject obj);
@@ -0,0 +1,59 @@
+// wan_fields_gen.h
+// GENERATED by extra_scripts/gen_wan_fields.py from
+// data/openapi.yaml (components.schemas.WanMetrics). Do not edit.
+#pragma once
+
+// Field ids, in table order
+enum class WanFieldId : uint8_t {
+    STATE,
+    LOSS_PCT,
+    LATENCY_MS,
+    JITTER_MS,
+    DOWN_MBPS,
+    UP_MBPS,
+    DOWN_1M,
+    DOWN_5M,
+    DOWN_15M,
+    UP_1M,
+    UP_5M,
+    UP_15M,
+    LOCAL_IP,
+    GATEWAY_IP,
+    MONITOR_IP,
+    COUNT
+};
+
+static constexpr WanField WAN_FIELDS[] = {
+    { "state", offsetof(WanMetrics, state), sizeof(WanMetrics::state), WanFieldType::STATE, 1.0f, (float)WanState::DOWN },
+    { "loss_pct", offsetof(WanMetrics, loss_pct), sizeof(WanMetrics::loss_pct), WanFieldType::U8, 0.01f, 100.0f },
+    { "latency_ms", offsetof(WanMetrics, latency_ms), sizeof(WanMetrics::latency_ms), WanFieldType::U16, 0.001f, 0.0f },
+    { "jitter_ms", offsetof(WanMetrics, jitter_ms), sizeof(WanMetrics::jitter_ms), WanFieldType::U16, 0.001f, 0.0f },
+    { "down_mbps", offsetof(WanMetrics, down_mbps), sizeof(WanMetrics::down_mbps), WanFieldType::F32, 1000000.0f, 0.0f },
+    { "up_mbps", offsetof(WanMetrics, up_mbps), sizeof(WanMetrics::up_mbps), WanFieldType::F32, 1000000.0f, 0.0f },
+    { "down_1m", offsetof(WanMetrics, down_1m), sizeof(WanMetrics::down_1m), WanFieldType::F32, 1000000.0f, 0.0f },
+    { "down_5m", offsetof(WanMetrics, down_5m), sizeof(WanMetrics::down_5m), WanFieldType::F32, 1000000.0f, 0.0f },
+    { "down_15m", offsetof(WanMetrics, down_15m), sizeof(WanMetrics::down_15m), WanFieldType::F32, 1000000.0f, 0.0f },
+    { "up_1m", offsetof(WanMetrics, up_1m), sizeof(WanMetrics::up_1m), WanFieldType::F32, 1000000.0f, 0.0f },
+    { "up_5m", offsetof(WanMetrics, up_5m), sizeof(WanMetrics::up_5m), WanFieldType::F32, 1000000.0f, 0.0f },
+    { "up_15m", offsetof(WanMetrics, up_15m), sizeof(WanMetrics::up_15m), WanFieldType::F32, 1000000.0f, 0.0f },
+    { "local_ip", offsetof(WanMetrics, local_ip), sizeof(WanMetrics::local_ip), WanFieldType::STR, 1.0f, 0.0f },
+    { "gateway_ip", offsetof(WanMetrics, gateway_ip), sizeof(WanMetrics::gateway_ip), WanFieldType::STR, 1.0f, 0.0f },
+    { "monitor_ip", offsetof(WanMetrics, monitor_ip), sizeof(WanMetrics::monitor_ip), WanFieldType::STR, 1.0f, 0.0f },
+};
+
+static constexpr size_t WAN_FIELD_COUNT = sizeof(WAN_FIELDS) / sizeof(WAN_FIELDS[0]);
+static_assert(WAN_FIELD_COUNT == (size_t)WanFieldId::COUNT, "field id mismatch");
+
+// Schema and struct must agree on storage width
+static_assert(sizeof(WanMetrics::state) == sizeof(WanState), "state: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::loss_pct) == 1, "loss_pct: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::latency_ms) == 2, "latency_ms: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::jitter_ms) == 2, "jitter_ms: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::down_mbps) == 4, "down_mbps: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::up_mbps) == 4, "up_mbps: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::down_1m) == 4, "down_1m: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::down_5m) == 4, "down_5m: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::down_15m) == 4, "down_15m: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::up_1m) == 4, "up_1m: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::up_5m) == 4, "up_5m: schema type does not match WanMetrics");
+static_assert(sizeof(WanMetrics::up_15m) == 4, "up_15m: schema type does not match WanMetrics");
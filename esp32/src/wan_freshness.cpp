@@ -0,0 +1,45 @@
+// wan_freshness.cpp
+#include "wan_freshness.h"
+#include "wan_metrics.h"
+#include "freshness_bar.h"
+
+static const char* FRESHNESS_NAMES[] = { "none", "fresh", "late", "old", "stale" };
+
+Freshness freshness_of(unsigned long last_update_ms) {
+    if (last_update_ms == 0) return Freshness::NONE;
+    unsigned long elapsed = millis() - last_update_ms;
+    if (elapsed <= FRESHNESS_GREEN_BUFFER_END_MS) return Freshness::FRESH;
+    if (elapsed <= FRESHNESS_YELLOW_BUFFER_END_MS) return Freshness::LATE;
+    if (elapsed <= FRESHNESS_RED_BUFFER_END_MS) return Freshness::OLD;
+    return Freshness::STALE;
+}
+
+Freshness wan_freshness(int wan_id) {
+    return freshness_of(wan_metrics_get(wan_id).last_update_ms);
+}
+
+bool wan_is_stale(int wan_id) {
+    Freshness f = wan_freshness(wan_id);
+    return f == Freshness::NONE || f == Freshness::STALE;
+}
+
+long wan_age_ms(int wan_id) {
+    unsigned long updated = wan_metrics_get(wan_id).last_update_ms;
+    if (updated == 0) return -1;
+    return (long)(millis() - updated);
+}
+
+unsigned long wan_freshest_update_ms() {
+    unsigned long now = millis();
+    unsigned long freshest = 0;
+    for (int id = 1; id <= wan_metrics_count(); id++) {
+        unsigned long updated = wan_metrics_get(id).last_update_ms;
+        if (updated == 0) continue;
+        if (freshest == 0 || now - updated < now - freshest) freshest = updated;
+    }
+    return freshest;
+}
+
+const char* freshness_to_string(Freshness f) {
+    return FRESHNESS_NAMES[(int)f];
+}
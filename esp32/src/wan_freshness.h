@@ -0,0 +1,36 @@
+// wan_freshness.h
+// Per-WAN report freshness, on the freshness bar's time scale
+//
+// Each WAN is judged by the age of its own last report, so a WAN the
+// collector stopped reporting goes stale while the others stay fresh. The
+// freshness bar shows the router feed as a whole: the age of the most
+// recent report of any WAN.
+#pragma once
+
+#include <Arduino.h>
+
+enum class Freshness : uint8_t {
+    NONE,   // no report yet
+    FRESH,  // green phase of the bar
+    LATE,   // yellow phase
+    OLD,    // red phase
+    STALE,  // past the bar's red buffer: values are no longer shown
+};
+
+// Freshness of a report stamped at last_update_ms (0 = never)
+Freshness freshness_of(unsigned long last_update_ms);
+
+// Freshness of a WAN (wan_id: 1..count)
+Freshness wan_freshness(int wan_id);
+
+// True when a WAN's values should not be shown (NONE or STALE)
+bool wan_is_stale(int wan_id);
+
+// Age of a WAN's last report in ms, or -1 before the first one
+long wan_age_ms(int wan_id);
+
+// Most recent report of any WAN (0 = none yet)
+unsigned long wan_freshest_update_ms();
+
+// "none", "fresh", "late", "old" or "stale"
+const char* freshness_to_string(Freshness f);
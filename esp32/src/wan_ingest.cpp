@@ -0,0 +1,69 @@
+// wan_ingest.cpp
+#include "wan_ingest.h"
+#include "wan_metrics.h"
+#include "wan_fields.h"
+#include "wan_counters.h"
+#include "state_policy.h"
+#include "leds.h"
+#include "logger.h"
+
+// ---- Helper: Parse JSON and update WAN metrics ----
+// Every schema field is assigned; missing fields fall back to their defaults.
+// Raw counters (rx_bytes/tx_bytes) take precedence over reported rates.
+// The state is graded here from loss and latency; a reported state only caps it.
+static bool parse_wan_json(JsonObjectConst obj, int wan_id) {
+    WanMetrics* record = wan_metrics_edit(wan_id);
+    if (record == nullptr) return false;
+    WanMetrics& m = *record;
+    wan_fields_from_json(m, obj);
+    if (obj["rx_bytes"].is<uint64_t>() && obj["tx_bytes"].is<uint64_t>()) {
+        WanCounterSample sample;
+        sample.rx_bytes = obj["rx_bytes"].as<uint64_t>();
+        sample.tx_bytes = obj["tx_bytes"].as<uint64_t>();
+        sample.at_ms = (uint32_t)(obj["counters_ms"] | (uint64_t)millis());
+        sample.bits = (obj["counter_bits"] | 64) == 32 ? 32 : 64;
+        wan_counters_apply(wan_id, m, sample);
+    }
+    WanState reported = obj["state"].is<const char*>() ? m.state : WanState::UP;
+    m.state = state_policy_evaluate(wan_id, reported, m.loss_pct, m.latency_ms);
+    wan_metrics_commit(wan_id);
+
+    // Update LEDs based on WAN
+    wan_set_leds(wan_id, m.state);
+
+    LOG_INFO("WAN %s updated: state=%s loss=%d%% lat=%dms local=%s gw=%s",
+                  wan_metrics_key(wan_id), wan_state_to_string(m.state), m.loss_pct, m.latency_ms,
+                  m.local_ip, m.gateway_ip);
+
+    return true;
+}
+
+DeserializationError wan_ingest_decode(JsonDocument& doc, const uint8_t* data,
+                                       size_t len, bool msgpack) {
+    if (msgpack) {
+        return deserializeMsgPack(doc, data, len);
+    }
+    return deserializeJson(doc, data, len);
+}
+
+void wan_ingest_apply(JsonDocument& doc) {
+    // Extract top-level router info
+    const char* router_ip = doc["router_ip"] | "";
+    const char* timestamp = doc["timestamp"] | "";
+    wan_metrics_set_router_info(router_ip, timestamp);
+
+    // Every other object member is a WAN, keyed by name; new names are
+    // added to the table in the order they appear
+    for (JsonPairConst kv : doc.as<JsonObjectConst>()) {
+        JsonObjectConst obj = kv.value().as<JsonObjectConst>();
+        if (obj.isNull()) continue;
+
+        const char* name = kv.key().c_str();
+        int id = wan_metrics_find_or_add(name);
+        if (id == 0) {
+            LOG_WARN("WAN %s ignored (invalid name or table full)", name);
+            continue;
+        }
+        parse_wan_json(obj, id);
+    }
+}
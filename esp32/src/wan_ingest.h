@@ -0,0 +1,14 @@
+// wan_ingest.h
+// Applies a decoded metrics batch (same schema for every transport) to the
+// WAN metrics store and LEDs
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Decode a batch body: MessagePack when msgpack is true, JSON otherwise
+DeserializationError wan_ingest_decode(JsonDocument& doc, const uint8_t* data,
+                                       size_t len, bool msgpack);
+
+// Apply a decoded batch: router info plus one object per WAN, keyed by name
+void wan_ingest_apply(JsonDocument& doc);
@@ -1,9 +1,25 @@
 // wan_metrics.cpp
 #include "wan_metrics.h"
+#include "wan_fields.h"
+#include "metrics_history.h"
+#include "bw_percentile.h"
+#include "data_usage.h"
+#include "availability.h"
+#include "state_policy.h"
+#include "wan_counters.h"
 #include <string.h>
 
-// Global metrics storage (index 0 = wan1, index 1 = wan2)
+// Global metrics storage (index = wan_id - 1, in order of first report)
 WanMetrics g_wan_metrics[MAX_WANS];
+static char g_names[MAX_WANS][WAN_NAME_LEN];
+static int g_wan_count = 0;
+
+// Top-level keys of /api/status and the stream/webhook/MQTT sources
+static const char* RESERVED_NAMES[] = {
+    "local", "router", "wans", "status", "hostname", "timestamp", "router_ip",
+    "freshness", "ingest", "config_store", "mqtt", "webhooks", "log", "gossip", "http",
+    "metrics_log", "state_policy", "availability", "billing", "usage",
+};
 
 // Global router-level info
 static char g_router_ip[16] = "";
@@ -12,61 +28,134 @@ static char g_last_timestamp[32] = "";
 // Bandwidth display source (default to 1 minute EWMA)
 static BandwidthSource g_bw_source = BandwidthSource::AVG_1M;
 
+// State before the current edit, for transition detection
+static WanState g_committed_state[MAX_WANS];
+
+static WanStateCallback g_listeners[MAX_STATE_LISTENERS];
+static int g_listener_count = 0;
+
+static WanForgetCallback g_forget_listeners[MAX_FORGET_LISTENERS];
+static int g_forget_listener_count = 0;
+
 void wan_metrics_init() {
     for (int i = 0; i < MAX_WANS; i++) {
-        g_wan_metrics[i].state = WanState::DOWN;
-        g_wan_metrics[i].loss_pct = 100;
-        g_wan_metrics[i].latency_ms = 0;
-        g_wan_metrics[i].jitter_ms = 0;
-        g_wan_metrics[i].down_mbps = 0.0f;
-        g_wan_metrics[i].up_mbps = 0.0f;
-        g_wan_metrics[i].down_1m = 0.0f;
-        g_wan_metrics[i].down_5m = 0.0f;
-        g_wan_metrics[i].down_15m = 0.0f;
-        g_wan_metrics[i].up_1m = 0.0f;
-        g_wan_metrics[i].up_5m = 0.0f;
-        g_wan_metrics[i].up_15m = 0.0f;
+        wan_fields_set_defaults(g_wan_metrics[i]);
         g_wan_metrics[i].last_update_ms = 0;
-        g_wan_metrics[i].local_ip[0] = '\0';
-        g_wan_metrics[i].gateway_ip[0] = '\0';
-        g_wan_metrics[i].monitor_ip[0] = '\0';
+        g_committed_state[i] = g_wan_metrics[i].state;
+        g_names[i][0] = '\0';
     }
+    g_wan_count = 0;
     g_router_ip[0] = '\0';
     g_last_timestamp[0] = '\0';
 }
 
-void wan_metrics_update(int wan_id, WanState state, uint8_t loss_pct,
-                        uint16_t latency_ms, uint16_t jitter_ms,
-                        float down_mbps, float up_mbps,
-                        float down_1m, float down_5m, float down_15m,
-                        float up_1m, float up_5m, float up_15m,
-                        const char* local_ip, const char* gateway_ip,
-                        const char* monitor_ip) {
-    if (wan_id < 1 || wan_id > MAX_WANS) return;
-
-    int idx = wan_id - 1;
-    g_wan_metrics[idx].state = state;
-    g_wan_metrics[idx].loss_pct = loss_pct;
-    g_wan_metrics[idx].latency_ms = latency_ms;
-    g_wan_metrics[idx].jitter_ms = jitter_ms;
-    g_wan_metrics[idx].down_mbps = down_mbps;
-    g_wan_metrics[idx].up_mbps = up_mbps;
-    g_wan_metrics[idx].down_1m = down_1m;
-    g_wan_metrics[idx].down_5m = down_5m;
-    g_wan_metrics[idx].down_15m = down_15m;
-    g_wan_metrics[idx].up_1m = up_1m;
-    g_wan_metrics[idx].up_5m = up_5m;
-    g_wan_metrics[idx].up_15m = up_15m;
-    g_wan_metrics[idx].last_update_ms = millis();
-
-    strncpy(g_wan_metrics[idx].local_ip, local_ip ? local_ip : "", sizeof(g_wan_metrics[idx].local_ip) - 1);
-    g_wan_metrics[idx].local_ip[sizeof(g_wan_metrics[idx].local_ip) - 1] = '\0';
-
-    strncpy(g_wan_metrics[idx].gateway_ip, gateway_ip ? gateway_ip : "", sizeof(g_wan_metrics[idx].gateway_ip) - 1);
-    g_wan_metrics[idx].gateway_ip[sizeof(g_wan_metrics[idx].gateway_ip) - 1] = '\0';
-
-    strncpy(g_wan_metrics[idx].monitor_ip, monitor_ip ? monitor_ip : "", sizeof(g_wan_metrics[idx].monitor_ip) - 1);
-    g_wan_metrics[idx].monitor_ip[sizeof(g_wan_metrics[idx].monitor_ip) - 1] = '\0';
+int wan_metrics_count() {
+    return g_wan_count;
+}
+
+bool wan_name_is_valid(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= WAN_NAME_LEN) return false;
+    if (name[0] < 'a' || name[0] > 'z') return false;
+    for (size_t i = 1; i < len; i++) {
+        char c = name[i];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    for (const char* reserved : RESERVED_NAMES) {
+        if (strcmp(name, reserved) == 0) return false;
+    }
+    return true;
+}
+
+int wan_metrics_find(const char* name) {
+    for (int i = 0; i < g_wan_count; i++) {
+        if (strcmp(g_names[i], name) == 0) return i + 1;
+    }
+    return 0;
+}
+
+int wan_metrics_find_or_add(const char* name) {
+    int id = wan_metrics_find(name);
+    if (id != 0) return id;
+    if (g_wan_count >= MAX_WANS || !wan_name_is_valid(name)) return 0;
+
+    strlcpy(g_names[g_wan_count], name, WAN_NAME_LEN);
+    return ++g_wan_count;
+}
+
+bool wan_metrics_forget(const char* name) {
+    int wan_id = wan_metrics_find(name);
+    if (wan_id == 0) return false;
+
+    for (int i = 0; i < g_forget_listener_count; i++) {
+        g_forget_listeners[i](wan_id);
+    }
+    history_forget(wan_id);
+    avail_forget(wan_id);
+    state_policy_forget(wan_id);
+    wan_counters_forget(wan_id);
+    bw_percentile_forget(wan_id);
+    data_usage_forget(wan_id);
+
+    int w = wan_id - 1;
+    wan_id_erase(g_wan_metrics, w);
+    wan_id_erase(g_names, w);
+    wan_id_erase(g_committed_state, w);
+    g_wan_count--;
+    WanMetrics& freed = g_wan_metrics[MAX_WANS - 1];
+    wan_fields_set_defaults(freed);
+    freed.last_update_ms = 0;
+    g_committed_state[MAX_WANS - 1] = freed.state;
+    return true;
+}
+
+WanMetrics* wan_metrics_edit(int wan_id) {
+    if (wan_id < 1 || wan_id > g_wan_count) return nullptr;
+    return &g_wan_metrics[wan_id - 1];
+}
+
+void wan_metrics_commit(int wan_id) {
+    wan_metrics_commit_at(wan_id, millis());
+}
+
+void wan_metrics_commit_at(int wan_id, unsigned long update_ms) {
+    if (wan_id < 1 || wan_id > g_wan_count) return;
+    WanMetrics& m = g_wan_metrics[wan_id - 1];
+    m.last_update_ms = (update_ms == 0) ? 1 : update_ms;  // 0 means "never"
+    history_add(wan_id, { m.latency_ms, m.jitter_ms, m.loss_pct, m.down_mbps, m.up_mbps });
+    bw_percentile_add(wan_id, m.down_mbps, m.up_mbps);
+    data_usage_add_rates(wan_id, m.down_mbps, m.up_mbps);
+
+    WanState from = g_committed_state[wan_id - 1];
+    g_committed_state[wan_id - 1] = m.state;
+    wan_metrics_notify_state(wan_id, from, m.state);
+}
+
+void wan_metrics_restore(int wan_id) {
+    if (wan_id < 1 || wan_id > g_wan_count) return;
+    unsigned long now = millis();
+    g_wan_metrics[wan_id - 1].last_update_ms = (now == 0) ? 1 : now;
+    g_committed_state[wan_id - 1] = g_wan_metrics[wan_id - 1].state;
+}
+
+bool wan_metrics_on_state_change(WanStateCallback callback) {
+    if (g_listener_count >= MAX_STATE_LISTENERS) return false;
+    g_listeners[g_listener_count++] = callback;
+    return true;
+}
+
+bool wan_metrics_on_forget(WanForgetCallback callback) {
+    if (g_forget_listener_count >= MAX_FORGET_LISTENERS) return false;
+    g_forget_listeners[g_forget_listener_count++] = callback;
+    return true;
+}
+
+void wan_metrics_notify_state(int wan_id, WanState from, WanState to) {
+    if (from == to) return;
+    for (int i = 0; i < g_listener_count; i++) {
+        g_listeners[i](wan_id, from, to);
+    }
 }
 
 void wan_metrics_set_router_info(const char* router_ip, const char* timestamp) {
@@ -85,9 +174,16 @@ const char* wan_metrics_get_timestamp() {
     return g_last_timestamp;
 }
 
+const char* wan_metrics_key(int wan_id) {
+    if (wan_id < 1 || wan_id > MAX_WANS) {
+        return "";
+    }
+    return g_names[wan_id - 1];
+}
+
 const WanMetrics& wan_metrics_get(int wan_id) {
     if (wan_id < 1 || wan_id > MAX_WANS) {
-        return g_wan_metrics[0];  // fallback to wan1
+        return g_wan_metrics[0];  // fallback to the first WAN
     }
     return g_wan_metrics[wan_id - 1];
 }
@@ -121,6 +217,7 @@ float wan_metrics_get_down(int wan_id) {
         case BandwidthSource::INSTANT: return m.down_mbps;
         case BandwidthSource::AVG_5M:  return m.down_5m;
         case BandwidthSource::AVG_15M: return m.down_15m;
+        case BandwidthSource::P95:     return bw_percentile_down(wan_id);
         case BandwidthSource::AVG_1M:
         default: return m.down_1m;
     }
@@ -132,6 +229,7 @@ float wan_metrics_get_up(int wan_id) {
         case BandwidthSource::INSTANT: return m.up_mbps;
         case BandwidthSource::AVG_5M:  return m.up_5m;
         case BandwidthSource::AVG_15M: return m.up_15m;
+        case BandwidthSource::P95:     return bw_percentile_up(wan_id);
         case BandwidthSource::AVG_1M:
         default: return m.up_1m;
     }
@@ -143,6 +241,7 @@ const char* bw_source_to_string(BandwidthSource source) {
         case BandwidthSource::AVG_1M:  return "1m";
         case BandwidthSource::AVG_5M:  return "5m";
         case BandwidthSource::AVG_15M: return "15m";
+        case BandwidthSource::P95:     return "p95";
         default: return "1m";
     }
 }
@@ -151,5 +250,6 @@ BandwidthSource bw_source_from_string(const char* str) {
     if (strcmp(str, "15s") == 0) return BandwidthSource::INSTANT;
     if (strcmp(str, "5m") == 0)  return BandwidthSource::AVG_5M;
     if (strcmp(str, "15m") == 0) return BandwidthSource::AVG_15M;
+    if (strcmp(str, "p95") == 0) return BandwidthSource::P95;
     return BandwidthSource::AVG_1M;  // default
 }
@@ -25,23 +25,51 @@ struct WanMetrics {
     char monitor_ip[16];
 };
 
-// Maximum number of WANs supported
-static const int MAX_WANS = 2;
+// WAN table: one contiguous array, filled in the order names are first
+// reported. wan_id is the 1-based position; ids 1..wan_metrics_count() are
+// in use. An id only changes when a WAN below it is forgotten
+// (wan_metrics_forget()), which moves every later WAN down by one.
+static const int MAX_WANS = 8;
+static const size_t WAN_NAME_LEN = 16;     // including the terminator
 
 // Global metrics storage
 extern WanMetrics g_wan_metrics[MAX_WANS];
 
-// Initialize metrics to defaults
+// Initialize metrics to defaults (empties the table)
 void wan_metrics_init();
 
-// Update metrics for a WAN (wan_id: 1 or 2)
-void wan_metrics_update(int wan_id, WanState state, uint8_t loss_pct,
-                        uint16_t latency_ms, uint16_t jitter_ms,
-                        float down_mbps, float up_mbps,
-                        float down_1m, float down_5m, float down_15m,
-                        float up_1m, float up_5m, float up_15m,
-                        const char* local_ip, const char* gateway_ip,
-                        const char* monitor_ip);
+// Number of WANs in the table
+int wan_metrics_count();
+
+// Id for a name, or 0 if it is not in the table
+int wan_metrics_find(const char* name);
+
+// Id for a name, adding it when new; 0 if the name is invalid or the table is full
+int wan_metrics_find_or_add(const char* name);
+
+// Names are 1-15 of [a-z0-9_-], starting with a letter; names used by other
+// top-level status keys ("local", "router", ...) are reserved
+bool wan_name_is_valid(const char* name);
+
+// Remove a WAN from the table and from every module's per-WAN state
+// (DELETE /api/wans/<name>). Forget listeners run first, while the id and
+// wan_metrics_key() still name the WAN; then later ids move down by one.
+// Returns false if the name is not in the table.
+bool wan_metrics_forget(const char* name);
+
+// Update metrics for a WAN: edit fields of the live record (see
+// wan_fields.h), then commit to stamp last_update_ms. nullptr unless
+// wan_id is 1..count.
+WanMetrics* wan_metrics_edit(int wan_id);
+void wan_metrics_commit(int wan_id);
+
+// Commit with an explicit report time (millis() clock), for records relayed
+// from a peer panel whose report is older than its arrival
+void wan_metrics_commit_at(int wan_id, unsigned long update_ms);
+
+// Stamp a record restored at boot (see metrics_log.h) as updated now,
+// without notifying state listeners or recording history
+void wan_metrics_restore(int wan_id);
 
 // Update router-level info (from top-level JSON fields)
 void wan_metrics_set_router_info(const char* router_ip, const char* timestamp);
@@ -52,9 +80,41 @@ const char* wan_metrics_get_router_ip();
 // Get last timestamp from pfSense
 const char* wan_metrics_get_timestamp();
 
-// Get metrics for a WAN (wan_id: 1 or 2)
+// Name of a WAN, as reported by the collector ("" for an unused id)
+const char* wan_metrics_key(int wan_id);
+
+// Get metrics for a WAN (wan_id: 1..count)
 const WanMetrics& wan_metrics_get(int wan_id);
 
+// State transition listeners. wan_id is 1..MAX_WANS, or LOCAL_PINGER_ID for
+// the panel's own pinger. Called from loop() context, right after the change.
+static const int LOCAL_PINGER_ID = 0;
+static const int MAX_STATE_LISTENERS = 4;
+typedef void (*WanStateCallback)(int wan_id, WanState from, WanState to);
+
+// Register a listener (returns false when all slots are taken)
+bool wan_metrics_on_state_change(WanStateCallback callback);
+
+// Report a transition to all listeners (no-op when from == to)
+void wan_metrics_notify_state(int wan_id, WanState from, WanState to);
+
+// Forget listeners, for modules that keep state per WAN id: drop the
+// entry of wan_id and move the later ones down (see wan_id_erase()).
+static const int MAX_FORGET_LISTENERS = 8;
+typedef void (*WanForgetCallback)(int wan_id);
+
+// Register a listener (returns false when all slots are taken)
+bool wan_metrics_on_forget(WanForgetCallback callback);
+
+// Drop entry `index` of a per-WAN array of plain data, moving the later
+// entries down and zeroing the last one
+template <typename T, size_t N>
+void wan_id_erase(T (&items)[N], int index) {
+    if (index < 0 || (size_t)index >= N) return;
+    memmove(&items[index], &items[index + 1], (N - index - 1) * sizeof(T));
+    memset(&items[N - 1], 0, sizeof(T));
+}
+
 // Parse state string to enum
 WanState wan_state_from_string(const char* str);
 
@@ -66,7 +126,8 @@ enum class BandwidthSource : uint8_t {
     INSTANT = 0,  // 15s (raw sample)
     AVG_1M  = 1,  // 1 minute EWMA (default)
     AVG_5M  = 2,  // 5 minute EWMA
-    AVG_15M = 3   // 15 minute EWMA
+    AVG_15M = 3,  // 15 minute EWMA
+    P95     = 4   // 95th percentile over the billing cycle (see bw_percentile.h)
 };
 
 // Set/get bandwidth display source
@@ -0,0 +1,172 @@
+// webhook_alerts.cpp
+#include "webhook_alerts.h"
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "wan_metrics.h"
+#include "hostname.h"
+#include "logger.h"
+
+struct WebhookEvent {
+    char wan[WAN_NAME_LEN];     // named when queued: ids move when a WAN is forgotten
+    WanState from;
+    WanState to;
+    uint32_t at_ms;             // millis() of the transition
+};
+
+static QueueHandle_t g_queue = nullptr;
+static WebhookSettings g_settings;
+static WebhookStats g_stats;
+static portMUX_TYPE g_settings_mux = portMUX_INITIALIZER_UNLOCKED;
+static char g_hostname[48] = "";
+
+// Called from loop(): never blocks
+static void on_state_change(int wan_id, WanState from, WanState to) {
+    if (g_queue == nullptr) return;
+    bool configured = false;
+    for (int u = 0; u < WEBHOOK_MAX_URLS; u++) {
+        if (g_settings.urls[u][0] != '\0') configured = true;
+    }
+    if (!configured) return;
+
+    WebhookEvent ev;
+    strlcpy(ev.wan, (wan_id == LOCAL_PINGER_ID) ? "local" : wan_metrics_key(wan_id), sizeof(ev.wan));
+    ev.from = from;
+    ev.to = to;
+    ev.at_ms = (uint32_t)millis();
+    if (xQueueSend(g_queue, &ev, 0) != pdTRUE) {
+        g_stats.dropped_full++;
+        return;
+    }
+    g_stats.events++;
+}
+
+static void copy_settings(WebhookSettings& out) {
+    taskENTER_CRITICAL(&g_settings_mux);
+    out = g_settings;
+    taskEXIT_CRITICAL(&g_settings_mux);
+}
+
+static size_t build_payload(const WebhookEvent* events, int count, char* buf, size_t size) {
+    JsonDocument doc;
+    doc["host"] = g_hostname;
+    JsonArray arr = doc["events"].to<JsonArray>();
+    for (int i = 0; i < count; i++) {
+        JsonObject e = arr.add<JsonObject>();
+        e["wan"] = events[i].wan;
+        e["from"] = wan_state_to_string(events[i].from);
+        e["to"] = wan_state_to_string(events[i].to);
+        e["uptime_ms"] = events[i].at_ms;
+    }
+    return serializeJson(doc, buf, size);
+}
+
+static bool post(const char* url, const char* payload, size_t len) {
+    HTTPClient http;
+    http.setTimeout(WEBHOOK_TIMEOUT_MS);
+    http.setConnectTimeout(WEBHOOK_TIMEOUT_MS);
+    if (!http.begin(url)) {
+        g_stats.last_status = -1;
+        return false;
+    }
+    http.addHeader("Content-Type", "application/json");
+    int status = http.POST((uint8_t*)payload, len);
+    http.end();
+
+    g_stats.last_status = status;
+    return status >= 200 && status < 300;
+}
+
+// Deliver one batch to every URL, retrying the ones that fail
+static void deliver(const WebhookEvent* events, int count) {
+    char payload[160 + WEBHOOK_BATCH_MAX * 96];
+    size_t len = build_payload(events, count, payload, sizeof(payload));
+
+    WebhookSettings settings;
+    copy_settings(settings);
+
+    uint8_t pending = 0;  // bit per URL still to deliver
+    for (int u = 0; u < WEBHOOK_MAX_URLS; u++) {
+        if (settings.urls[u][0] != '\0') pending |= 1 << u;
+    }
+
+    unsigned long backoff = WEBHOOK_RETRY_MIN_MS;
+    for (int attempt = 0; pending != 0 && attempt < WEBHOOK_MAX_ATTEMPTS; attempt++) {
+        if (attempt > 0) {
+            g_stats.retries++;
+            vTaskDelay(pdMS_TO_TICKS(backoff));
+            backoff = min(backoff * 2, WEBHOOK_RETRY_MAX_MS);
+        }
+        for (int u = 0; u < WEBHOOK_MAX_URLS; u++) {
+            if (!(pending & (1 << u))) continue;
+            if (post(settings.urls[u], payload, len)) {
+                pending &= ~(1 << u);
+            } else {
+                g_stats.failures++;
+            }
+        }
+    }
+
+    if (pending != 0) {
+        g_stats.dropped_failed += count;
+        LOG_WARN("Webhook: gave up on %d event(s) after %d attempts", count, WEBHOOK_MAX_ATTEMPTS);
+        return;
+    }
+
+    uint32_t latency = millis() - events[0].at_ms;  // oldest event in the batch
+    g_stats.batches++;
+    g_stats.last_latency_ms = latency;
+    if (latency > g_stats.max_latency_ms) g_stats.max_latency_ms = latency;
+}
+
+static void webhook_task(void*) {
+    WebhookEvent batch[WEBHOOK_BATCH_MAX];
+
+    for (;;) {
+        // Block until the first event, then collect for the batch window
+        if (xQueueReceive(g_queue, &batch[0], portMAX_DELAY) != pdTRUE) continue;
+        int count = 1;
+        TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(WEBHOOK_BATCH_WINDOW_MS);
+        while (count < WEBHOOK_BATCH_MAX) {
+            TickType_t now = xTaskGetTickCount();
+            if ((int32_t)(deadline - now) <= 0) break;
+            if (xQueueReceive(g_queue, &batch[count], deadline - now) != pdTRUE) break;
+            count++;
+        }
+
+        deliver(batch, count);
+        g_stats.queued = uxQueueMessagesWaiting(g_queue);
+    }
+}
+
+// ---- Public API ----
+
+void webhook_init() {
+    strlcpy(g_hostname, get_network_hostname().c_str(), sizeof(g_hostname));
+
+    g_queue = xQueueCreate(WEBHOOK_QUEUE_LEN, sizeof(WebhookEvent));
+    if (g_queue == nullptr) {
+        LOG_WARN("Webhook: queue allocation failed, alerts disabled");
+        return;
+    }
+    // Core 0, next to the network stack; loop() runs on core 1
+    xTaskCreatePinnedToCore(webhook_task, "webhook", 8192, nullptr, 1, nullptr, 0);
+    wan_metrics_on_state_change(on_state_change);
+}
+
+void webhook_set_settings(const WebhookSettings& settings) {
+    taskENTER_CRITICAL(&g_settings_mux);
+    g_settings = settings;
+    for (int u = 0; u < WEBHOOK_MAX_URLS; u++) {
+        g_settings.urls[u][WEBHOOK_URL_LEN - 1] = '\0';
+    }
+    taskEXIT_CRITICAL(&g_settings_mux);
+}
+
+const WebhookSettings& webhook_get_settings() {
+    return g_settings;
+}
+
+const WebhookStats& webhook_get_stats() {
+    if (g_queue != nullptr) g_stats.queued = uxQueueMessagesWaiting(g_queue);
+    return g_stats;
+}
@@ -0,0 +1,51 @@
+// webhook_alerts.h
+// POSTs WAN and local pinger state transitions to configured webhook URLs
+//
+// Transitions are queued from loop() and delivered by a background task, so
+// a slow or unreachable receiver never delays rendering. Transitions that
+// happen close together go out as one batch:
+//   {"host":"wan-watcher-...","events":[
+//     {"wan":"wan1","from":"up","to":"down","uptime_ms":123456}, ...]}
+// ("wan" is "local" for the panel's own pinger). A failed delivery is
+// retried with exponential backoff, only to the URLs that failed; the batch
+// is dropped after WEBHOOK_MAX_ATTEMPTS. When the queue is full new events
+// are dropped and counted.
+#pragma once
+
+#include <Arduino.h>
+
+static const int WEBHOOK_MAX_URLS = 2;
+static const size_t WEBHOOK_URL_LEN = 128;
+static const int WEBHOOK_QUEUE_LEN = 16;                // pending events
+static const int WEBHOOK_BATCH_MAX = 8;                 // events per POST
+static const unsigned long WEBHOOK_BATCH_WINDOW_MS = 2000; // wait for more events after the first
+static const unsigned long WEBHOOK_TIMEOUT_MS = 3000;   // per request
+static const unsigned long WEBHOOK_RETRY_MIN_MS = 1000; // backoff doubles per attempt
+static const unsigned long WEBHOOK_RETRY_MAX_MS = 60000;
+static const int WEBHOOK_MAX_ATTEMPTS = 8;
+
+// Receiver URLs (persisted by config_store). Empty entries are unused.
+struct WebhookSettings {
+    char urls[WEBHOOK_MAX_URLS][WEBHOOK_URL_LEN];
+};
+
+struct WebhookStats {
+    uint32_t events;            // transitions queued
+    uint32_t batches;           // batches delivered to every URL
+    uint32_t failures;          // failed POST attempts (any URL)
+    uint32_t retries;           // re-attempts after a failure
+    uint32_t dropped_full;      // events lost to a full queue
+    uint32_t dropped_failed;    // events lost after the last retry
+    uint32_t last_latency_ms;   // transition to delivery, last batch
+    uint32_t max_latency_ms;
+    int last_status;            // HTTP status of the last attempt (<0 = transport error)
+    uint8_t queued;             // events waiting now
+};
+
+// Start the delivery task and register for transitions (call once in setup())
+void webhook_init();
+
+void webhook_set_settings(const WebhookSettings& settings);
+const WebhookSettings& webhook_get_settings();
+
+const WebhookStats& webhook_get_stats();
@@ -10,8 +10,19 @@
 #
 
 INTERVAL="${1:-15}"
+# With several panels, any one will do: they relay reports to each other
 ESP32_HOST="192.168.1.9"
-STATE_DIR="/var/run"
+
+# Transport: "http" (curl POST to /api/wans), "udp" (signed datagram) or
+# "stream" (one persistent TCP connection carrying line records)
+TRANSPORT="${WW_TRANSPORT:-http}"
+UDP_PORT="5580"
+STREAM_PORT="5581"
+# Shared secret for UDP datagrams; must match /ingest.key on the ESP32
+KEY_FILE="/root/wan_watcher.key"
+# Datagram sequence tracking: a random session nonce for every daemon start
+UDP_SESSION=$(openssl rand -hex 8)
+UDP_SEQ=0
 
 # Auto-detect pfSense LAN IP (interface that reaches ESP32)
 get_router_ip() {
@@ -25,13 +36,16 @@ if [ -z "$ROUTER_IP" ]; then
     echo "WARNING: Could not detect router IP (route to ${ESP32_HOST} not found)"
 fi
 
-# Gateway-to-WAN mapping (match substring in socket filename)
-WAN1_PATTERN="WAN_DHCP"      # PeakWifi
-WAN2_PATTERN="WAN2_DHCP"     # Starlink
+# Gateway-to-WAN mapping: space-separated name=pattern pairs, where pattern
+# is a substring of the dpinger socket filename. Names are what the panel
+# shows (a-z, 0-9, _ and -, starting with a letter; up to 8 WANs), and the
+# order here is the order the panel lists them in. A socket matching several
+# patterns belongs to the longest one.
+WAN_MAP="${WW_WAN_MAP:-wan1=WAN_DHCP wan2=WAN2_DHCP}"
 
-# Global variables for collected metrics
-WAN1_JSON=""
-WAN2_JSON=""
+# Global variables for collected metrics (one entry per polled WAN)
+WANS_JSON=""     # ,"name":{...} fragments for the batch
+WANS_REC=""      # stream record lines
 
 ###############################################################################
 # Helpers
@@ -44,23 +58,6 @@ is_numeric() {
     esac
 }
 
-normalize_state() {
-    LOSS="$1"
-    LATENCY="$2"
-
-    if ! is_numeric "$LOSS"; then
-        echo "unknown"
-    elif [ "$LOSS" -gt 50 ]; then
-        echo "down"
-    elif [ "$LOSS" -gt 5 ]; then
-        echo "degraded"
-    elif is_numeric "$LATENCY" && [ "$LATENCY" -gt 200 ]; then
-        echo "degraded"
-    else
-        echo "up"
-    fi
-}
-
 iface_for_ip() {
     IP="$1"
     ifconfig | awk -v ip="$IP" '
@@ -94,42 +91,12 @@ gateway_for_iface() {
     echo "$GW"
 }
 
-# Calculate alpha for EWMA based on actual elapsed time
-# alpha = 1 - e^(-elapsed/window)
-alpha_for_window() {
-    local ELAPSED="$1" WINDOW="$2"
-    awk -v t="$ELAPSED" -v w="$WINDOW" 'BEGIN { printf "%.8f", 1 - exp(-t/w) }'
-}
-
-# Calculate EWMA: ewma_calc <alpha> <current> <previous_ewma>
-# Returns empty string if no valid computation possible (previous is empty)
-ewma_calc() {
-    local ALPHA="$1" CURRENT="$2" PREV_EWMA="$3"
-    if [ -z "$PREV_EWMA" ]; then
-        echo ""
-        return
-    fi
-    awk -v a="$ALPHA" -v cur="$CURRENT" -v prev="$PREV_EWMA" \
-        'BEGIN { printf "%.4f", a * cur + (1 - a) * prev }'
-}
-
-# Format value for JSON output (rounds to 2 decimal places)
-# Returns default if value is empty
-format_json_num() {
-    local VAL="$1" DEFAULT="${2:-0}"
-    if [ -z "$VAL" ]; then
-        echo "$DEFAULT"
-    else
-        awk -v v="$VAL" 'BEGIN { printf "%.2f", v }'
-    fi
-}
-
 ###############################################################################
 # Poll a single WAN (collect metrics only, no POST)
 ###############################################################################
 
 poll_wan() {
-    LABEL="$1"   # "wan1" or "wan2"
+    LABEL="$1"   # WAN name from WAN_MAP
     SOCK="$2"
 
     LOCAL_IP=$(local_ip_from_sock "$SOCK")
@@ -137,16 +104,10 @@ poll_wan() {
     IFACE=$(iface_for_ip "$LOCAL_IP")
     GATEWAY_IP=$(gateway_for_iface "$IFACE")
 
-    # Use interface name in state file so mapping changes don't corrupt data
-    USAGE_PREV_FILE="${STATE_DIR}/wan_watcher_${IFACE}.usage_prev"
-
-    # Initialize all metrics
-    STATE="unknown"
+    # Initialize all metrics (the panel grades UP/DEGRADED/DOWN from these)
     LOSS=""
     LAT_MS=""
     STD_MS=""
-    DOWN_Mbps=""
-    UP_Mbps=""
 
     # Read from dpinger socket
     LINE=$(nc -U "$SOCK" 2>/dev/null)
@@ -160,104 +121,71 @@ poll_wan() {
             LAT_MS=$((LAT_US / 1000))
             STD_MS=$((STD_US / 1000))
         fi
-
-        STATE=$(normalize_state "$LOSS" "$LAT_MS")
     fi
 
-    # Calculate bandwidth from interface counters
+    # Raw interface byte counters (Ibytes, Obytes); the panel derives the
+    # rates and 1/5/15 minute averages, so nothing is kept between polls.
+    # No counters_ms: sh only has date(1), whole seconds of a wall clock that
+    # NTP can step, so the panel's arrival time is the better sample time.
+    COUNTERS=""
     if [ -n "$IFACE" ]; then
-        NETSTAT_LINE=$(netstat -I "${IFACE}" -b -n 2>/dev/null | awk 'NR==2')
-        RX_NOW=$(echo "$NETSTAT_LINE" | awk '{print $8}')
-        TX_NOW=$(echo "$NETSTAT_LINE" | awk '{print $11}')
-        NOW_SEC=$(date +%s)
-
-        if is_numeric "$RX_NOW" && is_numeric "$TX_NOW"; then
-            if [ -f "$USAGE_PREV_FILE" ]; then
-                read PREV_SEC RX_PREV TX_PREV PREV_DOWN_1M PREV_DOWN_5M PREV_DOWN_15M PREV_UP_1M PREV_UP_5M PREV_UP_15M PREV_EWMA_VALID < "$USAGE_PREV_FILE"
-
-                if is_numeric "$RX_PREV" && is_numeric "$TX_PREV" && is_numeric "$PREV_SEC"; then
-                    DELTA_RX=$((RX_NOW - RX_PREV))
-                    DELTA_TX=$((TX_NOW - TX_PREV))
-                    DELTA_T=$((NOW_SEC - PREV_SEC))
-
-                    if [ "$DELTA_T" -gt 0 ] && [ "$DELTA_RX" -ge 0 ] && [ "$DELTA_TX" -ge 0 ]; then
-                        DOWN_BPS=$((DELTA_RX * 8 / DELTA_T))
-                        UP_BPS=$((DELTA_TX * 8 / DELTA_T))
-
-                        # High precision for EWMA input
-                        DOWN_Mbps=$(awk -v bps="$DOWN_BPS" 'BEGIN { printf "%.4f", bps/1000000 }')
-                        UP_Mbps=$(awk -v bps="$UP_BPS" 'BEGIN { printf "%.4f", bps/1000000 }')
-
-                        if [ "$PREV_EWMA_VALID" != "1" ]; then
-                            # First valid sample - seed all windows
-                            DOWN_1M="$DOWN_Mbps"
-                            DOWN_5M="$DOWN_Mbps"
-                            DOWN_15M="$DOWN_Mbps"
-                            UP_1M="$UP_Mbps"
-                            UP_5M="$UP_Mbps"
-                            UP_15M="$UP_Mbps"
-                        else
-                            # Calculate dynamic alphas based on actual elapsed time
-                            ALPHA_1M=$(alpha_for_window "$DELTA_T" 60)
-                            ALPHA_5M=$(alpha_for_window "$DELTA_T" 300)
-                            ALPHA_15M=$(alpha_for_window "$DELTA_T" 900)
-
-                            # Calculate EWMA for bandwidth
-                            DOWN_1M=$(ewma_calc "$ALPHA_1M" "$DOWN_Mbps" "$PREV_DOWN_1M")
-                            DOWN_5M=$(ewma_calc "$ALPHA_5M" "$DOWN_Mbps" "$PREV_DOWN_5M")
-                            DOWN_15M=$(ewma_calc "$ALPHA_15M" "$DOWN_Mbps" "$PREV_DOWN_15M")
-                            UP_1M=$(ewma_calc "$ALPHA_1M" "$UP_Mbps" "$PREV_UP_1M")
-                            UP_5M=$(ewma_calc "$ALPHA_5M" "$UP_Mbps" "$PREV_UP_5M")
-                            UP_15M=$(ewma_calc "$ALPHA_15M" "$UP_Mbps" "$PREV_UP_15M")
-                        fi
-                        EWMA_VALID=1
-                    fi
-                fi
-            fi
-
-            # Store current counters and EWMA values for next interval
-            if [ "$EWMA_VALID" = "1" ]; then
-                # Valid delta - write new EWMA values
-                echo "${NOW_SEC} ${RX_NOW} ${TX_NOW} ${DOWN_1M} ${DOWN_5M} ${DOWN_15M} ${UP_1M} ${UP_5M} ${UP_15M} 1" > "$USAGE_PREV_FILE"
-            else
-                # Invalid delta - preserve previous EWMA values unchanged
-                echo "${NOW_SEC} ${RX_NOW} ${TX_NOW} ${PREV_DOWN_1M} ${PREV_DOWN_5M} ${PREV_DOWN_15M} ${PREV_UP_1M} ${PREV_UP_5M} ${PREV_UP_15M} ${PREV_EWMA_VALID:-0}" > "$USAGE_PREV_FILE"
-            fi
+        BYTES=$(netstat -I "${IFACE}" -b -n 2>/dev/null | awk 'NR==2 {print $8, $11}')
+        RX_BYTES="${BYTES% *}"
+        TX_BYTES="${BYTES#* }"
+        if is_numeric "$RX_BYTES" && is_numeric "$TX_BYTES"; then
+            COUNTERS="rx_bytes=${RX_BYTES} tx_bytes=${TX_BYTES}"
         fi
     fi
 
-    # Skip if state is unknown (couldn't read dpinger)
-    if [ "$STATE" = "unknown" ]; then
-        echo "  ${LABEL}: unknown state, skipping"
+    # Skip if dpinger could not be read
+    if ! is_numeric "$LOSS"; then
+        echo "  ${LABEL}: no dpinger data, skipping"
         return
     fi
 
-    # Default values for missing metrics (only for non-bandwidth fields)
-    : "${LOSS:=100}"
+    # Default values for missing ping metrics
     : "${LAT_MS:=0}"
     : "${STD_MS:=0}"
 
-    # Format bandwidth values for JSON (round to %.2f, default to 0)
-    DOWN_Mbps_JSON=$(format_json_num "$DOWN_Mbps" "0")
-    UP_Mbps_JSON=$(format_json_num "$UP_Mbps" "0")
-    DOWN_1M_JSON=$(format_json_num "$DOWN_1M" "0")
-    DOWN_5M_JSON=$(format_json_num "$DOWN_5M" "0")
-    DOWN_15M_JSON=$(format_json_num "$DOWN_15M" "0")
-    UP_1M_JSON=$(format_json_num "$UP_1M" "0")
-    UP_5M_JSON=$(format_json_num "$UP_5M" "0")
-    UP_15M_JSON=$(format_json_num "$UP_15M" "0")
-
     # Build JSON payload and store in global variable
-    JSON=$(printf '{"state":"%s","loss_pct":%s,"latency_ms":%s,"jitter_ms":%s,"down_mbps":%s,"up_mbps":%s,"down_1m":%s,"down_5m":%s,"down_15m":%s,"up_1m":%s,"up_5m":%s,"up_15m":%s,"local_ip":"%s","gateway_ip":"%s","monitor_ip":"%s"}' \
-        "$STATE" "$LOSS" "$LAT_MS" "$STD_MS" "$DOWN_Mbps_JSON" "$UP_Mbps_JSON" \
-        "$DOWN_1M_JSON" "$DOWN_5M_JSON" "$DOWN_15M_JSON" "$UP_1M_JSON" "$UP_5M_JSON" "$UP_15M_JSON" \
-        "$LOCAL_IP" "$GATEWAY_IP" "$MONITOR_IP")
-
-    # Store in global variable based on label
-    case "$LABEL" in
-        wan1) WAN1_JSON="$JSON" ;;
-        wan2) WAN2_JSON="$JSON" ;;
-    esac
+    JSON=$(printf '{"loss_pct":%s,"latency_ms":%s,"jitter_ms":%s,"local_ip":"%s","gateway_ip":"%s","monitor_ip":"%s"' \
+        "$LOSS" "$LAT_MS" "$STD_MS" "$LOCAL_IP" "$GATEWAY_IP" "$MONITOR_IP")
+    if [ -n "$COUNTERS" ]; then
+        JSON="${JSON},\"rx_bytes\":${RX_BYTES},\"tx_bytes\":${TX_BYTES}"
+    fi
+    JSON="${JSON}}"
+
+    # Same metrics as a stream record line (stream transport)
+    REC=$(printf '%s loss_pct=%s latency_ms=%s jitter_ms=%s local_ip=%s gateway_ip=%s monitor_ip=%s %s' \
+        "$LABEL" "$LOSS" "$LAT_MS" "$STD_MS" "$LOCAL_IP" "$GATEWAY_IP" "$MONITOR_IP" "$COUNTERS")
+
+    # Append to the batch
+    WANS_JSON="${WANS_JSON},\"${LABEL}\":${JSON}"
+    WANS_REC="${WANS_REC}${REC}
+"
+}
+
+###############################################################################
+# Send a batch as a signed UDP datagram
+###############################################################################
+
+# Datagram: "WW2 <session> <seq> <time> <mac>\n<payload>"
+# mac = first 32 hex chars of HMAC-SHA256(key, "<session> <seq> <time>\n<payload>")
+send_udp() {
+    PAYLOAD="$1"
+    UDP_SEQ=$((UDP_SEQ + 1))
+    KEY=$(cat "$KEY_FILE" 2>/dev/null)
+    if [ -z "$KEY" ]; then
+        echo "  UDP transport needs a key in ${KEY_FILE}, skipping"
+        return 1
+    fi
+
+    NOW=$(date +%s)
+    MAC=$(printf '%s %s %s\n%s' "$UDP_SESSION" "$UDP_SEQ" "$NOW" "$PAYLOAD" \
+        | openssl dgst -sha256 -hmac "$KEY" | awk '{print substr($NF, 1, 32)}')
+
+    printf 'WW2 %s %s %s %s\n%s' "$UDP_SESSION" "$UDP_SEQ" "$NOW" "$MAC" "$PAYLOAD" \
+        | nc -u -w 1 "$ESP32_HOST" "$UDP_PORT"
 }
 
 ###############################################################################
@@ -269,24 +197,21 @@ post_all_wans() {
     TIMESTAMP=$(date -u +"%Y-%m-%dT%H:%M:%SZ")
 
     # Build batch JSON payload with top-level fields
-    BATCH_JSON="{\"router_ip\":\"${ROUTER_IP}\",\"timestamp\":\"${TIMESTAMP}\""
-
-    if [ -n "$WAN1_JSON" ]; then
-        BATCH_JSON="${BATCH_JSON},\"wan1\":${WAN1_JSON}"
-    fi
-
-    if [ -n "$WAN2_JSON" ]; then
-        BATCH_JSON="${BATCH_JSON},\"wan2\":${WAN2_JSON}"
-    fi
-
-    BATCH_JSON="${BATCH_JSON}}"
+    BATCH_JSON="{\"router_ip\":\"${ROUTER_IP}\",\"timestamp\":\"${TIMESTAMP}\"${WANS_JSON}}"
 
     # Skip if no WANs collected
-    if [ -z "$WAN1_JSON" ] && [ -z "$WAN2_JSON" ]; then
+    if [ -z "$WANS_JSON" ]; then
         echo "  No WAN data collected, skipping POST"
         return
     fi
 
+    if [ "$TRANSPORT" = "udp" ]; then
+        if send_udp "$BATCH_JSON"; then
+            echo "${BATCH_JSON} -> UDP seq=${UDP_SEQ}"
+        fi
+        return
+    fi
+
     # POST to ESP32
     HTTP_CODE=$(curl -s -o /dev/null -m 5 -w "%{http_code}" \
         -X POST -H "Content-Type: application/json" \
@@ -302,38 +227,130 @@ post_all_wans() {
 }
 
 ###############################################################################
-# Main loop
+# Collect metrics from all WANs
 ###############################################################################
 
-echo "wan_watcher_daemon starting (interval=${INTERVAL}s, esp32=${ESP32_HOST})"
+# Print the WAN_MAP name whose pattern is the longest match for a socket
+wan_for_sock() {
+    BEST_NAME=""
+    BEST_LEN=0
+    for ENTRY in $WAN_MAP; do
+        PATTERN="${ENTRY#*=}"
+        case "$1" in
+            *"$PATTERN"*)
+                if [ "${#PATTERN}" -gt "$BEST_LEN" ]; then
+                    BEST_NAME="${ENTRY%%=*}"
+                    BEST_LEN=${#PATTERN}
+                fi
+                ;;
+        esac
+    done
+    echo "$BEST_NAME"
+}
 
-while true; do
-    # Reset global JSON variables
-    WAN1_JSON=""
-    WAN2_JSON=""
+# Returns non-zero when no dpinger sockets exist
+collect_all_wans() {
+    # Reset global variables
+    WANS_JSON=""
+    WANS_REC=""
 
     # Check if any dpinger sockets exist (using glob, not ls parsing)
     set -- /var/run/dpinger_*.sock
     if [ ! -e "$1" ]; then
         echo "No dpinger sockets found, waiting..."
-    else
-        # Collect metrics from all WANs
+        return 1
+    fi
+
+    for SOCK do
+        if [ -z "$(wan_for_sock "$SOCK")" ]; then
+            echo "Unknown socket (no pattern match): $SOCK"
+        fi
+    done
+
+    # Poll in WAN_MAP order, so the batch order matches the panel's table
+    for ENTRY in $WAN_MAP; do
+        NAME="${ENTRY%%=*}"
         for SOCK do
-            # Check WAN2 first (more specific pattern)
-            case "$SOCK" in
-                *"$WAN2_PATTERN"*)
-                    poll_wan "wan2" "$SOCK"
-                    ;;
-                *"$WAN1_PATTERN"*)
-                    poll_wan "wan1" "$SOCK"
-                    ;;
-                *)
-                    echo "Unknown socket (no pattern match): $SOCK"
-                    ;;
-            esac
+            if [ "$(wan_for_sock "$SOCK")" = "$NAME" ]; then
+                poll_wan "$NAME" "$SOCK"
+            fi
         done
+    done
+    return 0
+}
+
+###############################################################################
+# Stream transport
+###############################################################################
 
-        # Post all collected WANs in a single batch request
+# Emit records forever on stdout (log output goes to stderr)
+stream_records() {
+    while true; do
+        if collect_all_wans >&2; then
+            printf 'router router_ip=%s timestamp=%s\n' "$ROUTER_IP" "$(date -u +"%Y-%m-%dT%H:%M:%SZ")"
+            printf '%s' "$WANS_REC"
+        fi
+        sleep "$INTERVAL"
+    done
+}
+
+# With a key, the panel opens with "WW2 <nonce>" (read from the FIFO nc
+# writes to) and expects "auth <mac>" before any record, where
+# mac = first 32 hex chars of HMAC-SHA256(key, "stream <nonce>\n")
+stream_session() {
+    exec 3< "$STREAM_FIFO"
+    if ! read -r -t 10 HELLO NONCE <&3 || [ "$HELLO" != "WW2" ]; then
+        echo "  No challenge from the panel" >&2
+        return 1
+    fi
+    KEY=$(cat "$KEY_FILE")
+    printf 'stream %s\n' "$NONCE" \
+        | openssl dgst -sha256 -hmac "$KEY" | awk '{print "auth " substr($NF, 1, 32)}'
+    stream_records
+}
+
+# Hold one TCP connection open; reconnect with exponential backoff (1s..60s)
+run_stream() {
+    BACKOFF=1
+    STREAM_FIFO="/tmp/wan_watcher_stream.$$"
+    while true; do
+        STARTED=$(date +%s)
+        echo "Streaming to ${ESP32_HOST}:${STREAM_PORT}"
+        if [ -s "$KEY_FILE" ]; then
+            rm -f "$STREAM_FIFO"
+            mkfifo "$STREAM_FIFO"
+            stream_session | nc "$ESP32_HOST" "$STREAM_PORT" > "$STREAM_FIFO"
+            rm -f "$STREAM_FIFO"
+        else
+            stream_records | nc "$ESP32_HOST" "$STREAM_PORT"
+        fi
+
+        # A connection that stayed up for a while resets the backoff
+        if [ $(($(date +%s) - STARTED)) -ge 60 ]; then
+            BACKOFF=1
+        fi
+        echo "Stream disconnected, reconnecting in ${BACKOFF}s"
+        sleep "$BACKOFF"
+        BACKOFF=$((BACKOFF * 2))
+        if [ "$BACKOFF" -gt 60 ]; then
+            BACKOFF=60
+        fi
+    done
+}
+
+###############################################################################
+# Main loop
+###############################################################################
+
+echo "wan_watcher_daemon starting (interval=${INTERVAL}s, esp32=${ESP32_HOST}, transport=${TRANSPORT})"
+
+if [ "$TRANSPORT" = "stream" ]; then
+    run_stream
+fi
+
+while true; do
+    # Collect metrics from all WANs, then post them in a single batch request
+    if collect_all_wans; then
         post_all_wans
     fi
 
@@ -0,0 +1,117 @@
+# test/lib.sh
+# Shared helpers for the scripted checks in this directory (sourced, not run)
+#
+# The checks drive a real panel over its HTTP API and stand up the other
+# end locally (broker, webhook receiver, SNMP agent), then assert on what
+# arrives. Run them against a bench panel: they post WANs named test1/test2
+# and change settings. On exit the settings are put back and the test WANs
+# are forgotten (DELETE /api/wans/<name>); the panel's own WANs keep the
+# samples and events the checks caused.
+#
+#   PANEL    panel address (default: wan-watcher.local)
+#   HOST_IP  this machine's address as the panel sees it (default: the
+#            source address of the route to the panel)
+#
+# Exit status: 0 pass, 1 fail, 77 skipped (a required tool is missing).
+
+PANEL="${PANEL:-wan-watcher.local}"
+BASE_URL="http://${PANEL}"
+TMP=$(mktemp -d)
+CLEANUP=""
+
+on_exit() {
+    eval "$CLEANUP"
+    rm -rf "$TMP"
+}
+trap on_exit EXIT
+trap 'exit 1' INT TERM
+
+# Run a command on exit (last added runs first)
+at_exit() {
+    CLEANUP="$1; $CLEANUP"
+}
+
+need() {
+    for cmd in "$@"; do
+        if ! command -v "$cmd" >/dev/null 2>&1; then
+            echo "SKIP: $cmd not installed"
+            exit 77
+        fi
+    done
+}
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+pass() {
+    echo "PASS: $*"
+}
+
+detect_host_ip() {
+    if [ -n "$HOST_IP" ]; then
+        return
+    fi
+    PANEL_IP=$(getent hosts "$PANEL" | awk '{print $1; exit}')
+    HOST_IP=$(ip -4 route get "${PANEL_IP:-$PANEL}" 2>/dev/null \
+        | awk '{for (i = 1; i < NF; i++) if ($i == "src") print $(i + 1)}')
+    if [ -z "$HOST_IP" ]; then
+        fail "cannot tell this host's address, set HOST_IP"
+    fi
+}
+
+api_get() {
+    curl -sf "${BASE_URL}$1"
+}
+
+api_patch_config() {
+    curl -sf -X PATCH -H "Content-Type: application/json" -d "$1" "${BASE_URL}/api/config" >/dev/null \
+        || fail "PATCH /api/config $1"
+}
+
+# Post one ingest batch; $1 is the WAN objects, e.g. '"test1":{"state":"up"}'
+post_wans() {
+    curl -sf -X POST -H "Content-Type: application/json" \
+        -d "{\"router_ip\":\"${HOST_IP}\",\"timestamp\":\"$(date -u +%Y-%m-%dT%H:%M:%SZ)\",$1}" \
+        "${BASE_URL}/api/wans" >/dev/null || fail "POST /api/wans"
+}
+
+# Forget a WAN the check posted; $1 is its name
+api_delete_wan() {
+    curl -sf -X DELETE "${BASE_URL}/api/wans/$1" >/dev/null
+}
+
+# Print a value from a JSON file: json_value <file> <python expression on d>
+json_value() {
+    python3 - "$1" "$2" <<'PY'
+import json, sys
+d = json.load(open(sys.argv[1]))
+v = eval(sys.argv[2], {"d": d})
+print(json.dumps(v) if isinstance(v, (dict, list)) else v)
+PY
+}
+
+# Assert on a JSON file: check_json <file> <python expression on d> <description>
+check_json() {
+    python3 - "$1" "$2" <<'PY' || fail "$3"
+import json, sys
+d = json.load(open(sys.argv[1]))
+sys.exit(0 if eval(sys.argv[2], {"d": d}) else 1)
+PY
+    pass "$3"
+}
+
+# Wait up to $1 seconds for a command to succeed
+wait_for() {
+    LIMIT=$1
+    shift
+    WAITED=0
+    until "$@"; do
+        WAITED=$((WAITED + 1))
+        if [ "$WAITED" -ge "$LIMIT" ]; then
+            return 1
+        fi
+        sleep 1
+    done
+}
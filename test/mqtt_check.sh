@@ -0,0 +1,86 @@
+#!/bin/sh
+# test/mqtt_check.sh
+# MQTT publisher against a local Mosquitto broker (docs/api.md, "MQTT and
+# Home Assistant")
+#
+# Posts a WAN, points the panel at a throwaway broker on this host, then
+# takes the WAN down and checks the retained availability, WAN and local
+# topics, the transition event and the Home Assistant discovery configs.
+. "$(dirname "$0")/lib.sh"
+
+MQTT_PORT="${MQTT_PORT:-18830}"
+
+need curl python3 mosquitto mosquitto_sub
+detect_host_ip
+
+api_get /api/status > "$TMP/status.json" || fail "GET /api/status"
+HOSTNAME=$(json_value "$TMP/status.json" 'd["hostname"]')
+TOPIC_BASE="wan-watcher/${HOSTNAME}"
+
+# Put the broker settings back afterwards
+api_get /api/config > "$TMP/config.json" || fail "GET /api/config"
+RESTORE=$(json_value "$TMP/config.json" \
+    '{k: d[k] for k in ("mqtt_host", "mqtt_port", "mqtt_interval_s")}')
+at_exit "api_patch_config '$RESTORE'"
+
+cat > "$TMP/mosquitto.conf" <<EOF
+listener ${MQTT_PORT}
+allow_anonymous true
+EOF
+mosquitto -c "$TMP/mosquitto.conf" > "$TMP/mosquitto.log" 2>&1 &
+at_exit "kill $! 2>/dev/null"
+sleep 1
+
+mosquitto_sub -p "$MQTT_PORT" -v -t "${TOPIC_BASE}/#" -t "homeassistant/sensor/${HOSTNAME}/#" \
+    > "$TMP/mqtt.log" &
+at_exit "kill $! 2>/dev/null"
+
+# The WAN must exist before the panel connects to get discovery configs;
+# forgetting it on exit also clears its retained topics
+at_exit "api_delete_wan test1"
+post_wans '"test1":{"state":"up","loss_pct":0,"latency_ms":7,"jitter_ms":1}'
+api_patch_config "{\"mqtt_host\":\"${HOST_IP}\",\"mqtt_port\":${MQTT_PORT},\"mqtt_interval_s\":5}"
+
+wait_for 30 grep -q "^${TOPIC_BASE}/availability online" "$TMP/mqtt.log" \
+    || fail "panel did not connect to the broker"
+wait_for 15 grep -q "^${TOPIC_BASE}/test1 " "$TMP/mqtt.log" \
+    || fail "no test1 topic"
+
+post_wans '"test1":{"state":"down","loss_pct":100,"latency_ms":0,"jitter_ms":0}'
+wait_for 15 grep -q "^${TOPIC_BASE}/event " "$TMP/mqtt.log" \
+    || fail "no event after test1 went down"
+
+# One JSON document: {topic: [payloads in arrival order]}
+python3 - "$TMP/mqtt.log" > "$TMP/mqtt.json" <<'PY'
+import json, sys
+topics = {}
+for line in open(sys.argv[1]):
+    topic, _, payload = line.rstrip("\n").partition(" ")
+    try:
+        payload = json.loads(payload)
+    except ValueError:
+        pass
+    topics.setdefault(topic, []).append(payload)
+print(json.dumps(topics))
+PY
+
+B="$TOPIC_BASE"
+HA="homeassistant/sensor/${HOSTNAME}"
+check_json "$TMP/mqtt.json" "d['$B/availability'][-1] == 'online'" "availability is online"
+check_json "$TMP/mqtt.json" "d['$B/test1'][0]['state'] == 'up' and d['$B/test1'][0]['latency_ms'] == 7" \
+    "test1 topic carries the WAN record"
+check_json "$TMP/mqtt.json" "d['$B/test1'][-1]['state'] == 'down'" "test1 topic follows the transition"
+check_json "$TMP/mqtt.json" "{'wan': 'test1', 'from': 'up', 'to': 'down'} in d['$B/event']" \
+    "event for test1 up -> down"
+check_json "$TMP/mqtt.json" "'state' in d['$B/local'][-1] and 'latency_ms' in d['$B/local'][-1]" \
+    "local topic carries the pinger record"
+check_json "$TMP/mqtt.json" "d['$HA/test1_state/config'][-1]['stat_t'] == '$B/test1'" \
+    "discovery config for test1 state"
+check_json "$TMP/mqtt.json" "d['$HA/test1_down_1m/config'][-1]['unit_of_meas'] == 'Mbit/s'" \
+    "discovery config for test1 download"
+check_json "$TMP/mqtt.json" "'$HA/local_state/config' in d and '$HA/local_down_1m/config' not in d" \
+    "discovery configs for local (no rates)"
+
+api_get /api/status > "$TMP/status.json" || fail "GET /api/status"
+check_json "$TMP/status.json" "d['mqtt']['connected'] and d['mqtt']['published'] > 0" \
+    "/api/status reports the session"
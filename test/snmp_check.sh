@@ -0,0 +1,79 @@
+#!/bin/sh
+# test/snmp_check.sh
+# SNMP pull mode against a local net-snmp agent (docs/api.md, "SNMP Pull Mode")
+#
+# Serves ifHCInOctets/ifHCOutOctets growing at 10/1 Mbps and a gateway
+# status OID, and checks the rates, the gateway state and the timeout count
+# the panel reports for wan1. snmpd needs port 161, so this runs snmpd with
+# sudo unless already root. SNMP writes wan1 directly: use a bench panel
+# without a collector.
+. "$(dirname "$0")/lib.sh"
+
+GATEWAY_OID="1.3.6.1.4.1.8072.9999.9999.1"  # NET-SNMP-MIB netSnmpPlaypen
+INTERVAL_S=5
+
+need curl python3 snmpd
+detect_host_ip
+SUDO=""
+if [ "$(id -u)" -ne 0 ]; then
+    need sudo
+    SUDO="sudo"
+fi
+
+api_get /api/config > "$TMP/config.json" || fail "GET /api/config"
+RESTORE=$(json_value "$TMP/config.json" \
+    '{k: d[k] for k in ("snmp_host", "snmp_community", "snmp_interval_s", "snmp_ifindex", "snmp_gateway_oids")}')
+at_exit "api_patch_config '$RESTORE'"
+
+# pass script: counters from the clock, gateway status from a file
+echo 2 > "$TMP/gateway"
+chmod 755 "$TMP"
+cat > "$TMP/pass.sh" <<EOF
+#!/bin/sh
+t=\$(date +%s)
+case "\$2" in
+  .1.3.6.1.2.1.31.1.1.1.6.1)  echo "\$2"; echo counter64; echo \$((t * 1250000)) ;;
+  .1.3.6.1.2.1.31.1.1.1.10.1) echo "\$2"; echo counter64; echo \$((t * 125000)) ;;
+  .${GATEWAY_OID})            echo "\$2"; echo integer; cat "$TMP/gateway" ;;
+  *) exit 0 ;;
+esac
+EOF
+chmod 755 "$TMP/pass.sh"
+cat > "$TMP/snmpd.conf" <<EOF
+agentaddress udp:161
+rocommunity public
+pass .1.3.6.1.2.1.31.1.1.1 $TMP/pass.sh
+pass .${GATEWAY_OID%.*} $TMP/pass.sh
+EOF
+
+$SUDO snmpd -f -Lo -C -c "$TMP/snmpd.conf" > "$TMP/snmpd.log" 2>&1 &
+SNMPD_PID=$!
+at_exit "$SUDO kill $SNMPD_PID 2>/dev/null"
+sleep 1
+
+api_patch_config "{\"snmp_host\":\"${HOST_IP}\",\"snmp_community\":\"public\",\"snmp_interval_s\":${INTERVAL_S},\"snmp_ifindex\":[1,0],\"snmp_gateway_oids\":[\"${GATEWAY_OID}\",\"\"]}"
+
+# The first poll only primes the counters; rates come from the next ones
+sleep $((INTERVAL_S * 3 + 2))
+api_get /api/status > "$TMP/status.json" || fail "GET /api/status"
+W1="[w for w in d['wans'] if w['name'] == 'wan1'][0]"
+check_json "$TMP/status.json" "d['ingest']['snmp']['enabled'] and d['ingest']['snmp']['responses'] >= 2" \
+    "panel polls the agent"
+check_json "$TMP/status.json" "7 <= $W1['down_mbps'] <= 13" "wan1 down_mbps is about 10"
+check_json "$TMP/status.json" "0.7 <= $W1['up_mbps'] <= 1.3" "wan1 up_mbps is about 1"
+check_json "$TMP/status.json" "$W1['state'] == 'up'" "gateway INTEGER 2 reads as up"
+check_json "$TMP/status.json" "d['billing']['clock_set'] and d['router_ip'] == '${HOST_IP}'" \
+    "hrSystemDate sets the wall clock"
+
+echo 0 > "$TMP/gateway"
+sleep $((INTERVAL_S * 2 + 2))
+api_get /api/status > "$TMP/status.json" || fail "GET /api/status"
+check_json "$TMP/status.json" "$W1['state'] == 'down'" "gateway INTEGER 0 reads as down"
+
+$SUDO kill "$SNMPD_PID"
+wait "$SNMPD_PID" 2>/dev/null
+sleep $((INTERVAL_S * 3 + 2))
+api_get /api/status > "$TMP/after.json" || fail "GET /api/status"
+TIMEOUTS_BEFORE=$(json_value "$TMP/status.json" "d['ingest']['snmp']['timeouts']")
+check_json "$TMP/after.json" "d['ingest']['snmp']['timeouts'] > $TIMEOUTS_BEFORE" \
+    "timeouts grow once the agent is gone"
@@ -0,0 +1,76 @@
+#!/bin/sh
+# test/webhook_check.sh
+# Webhook alerts against a local HTTP stand-in (docs/api.md, "Webhook Alerts")
+#
+# Takes two test WANs down in one batch and checks that both transitions
+# arrive as one POST, that a 500 from the receiver is retried with the same
+# batch, and that /api/status counts the retry and the delivery.
+. "$(dirname "$0")/lib.sh"
+
+HOOK_PORT="${HOOK_PORT:-18081}"
+
+need curl python3
+detect_host_ip
+
+api_get /api/status > "$TMP/before.json" || fail "GET /api/status"
+HOSTNAME=$(json_value "$TMP/before.json" 'd["hostname"]')
+
+api_get /api/config > "$TMP/config.json" || fail "GET /api/config"
+RESTORE=$(json_value "$TMP/config.json" '{"webhook_urls": d["webhook_urls"]}')
+at_exit "api_patch_config '$RESTORE'"
+
+# Stand-in receiver: one line per POST, the first answered with 500
+: > "$TMP/hooks.jsonl"
+python3 - "$HOOK_PORT" "$TMP/hooks.jsonl" <<'PY' &
+import http.server, json, sys
+port, out = int(sys.argv[1]), sys.argv[2]
+class Receiver(http.server.BaseHTTPRequestHandler):
+    count = 0
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers["Content-Length"])).decode()
+        record = {"path": self.path, "type": self.headers.get("Content-Type", ""), "body": json.loads(body)}
+        with open(out, "a") as f:
+            f.write(json.dumps(record) + "\n")
+        Receiver.count += 1
+        self.send_response(500 if Receiver.count == 1 else 204)
+        self.end_headers()
+    def log_message(self, *args):
+        pass
+http.server.HTTPServer(("", port), Receiver).serve_forever()
+PY
+at_exit "kill $! 2>/dev/null"
+sleep 1
+
+at_exit "api_delete_wan test1; api_delete_wan test2"
+post_wans '"test1":{"state":"up","loss_pct":0,"latency_ms":7},"test2":{"state":"up","loss_pct":0,"latency_ms":9}'
+sleep 3
+api_patch_config "{\"webhook_urls\":[\"http://${HOST_IP}:${HOOK_PORT}/wan\"]}"
+post_wans '"test1":{"state":"down","loss_pct":100,"latency_ms":0},"test2":{"state":"down","loss_pct":100,"latency_ms":0}'
+
+# 2 s batching window, then a 1 s backoff after the 500
+wait_for 20 sh -c "[ \$(wc -l < '$TMP/hooks.jsonl') -ge 2 ]" \
+    || fail "receiver did not get the batch and its retry"
+sleep 1
+
+python3 -c 'import json, sys; print(json.dumps([json.loads(l) for l in open(sys.argv[1])]))' \
+    "$TMP/hooks.jsonl" > "$TMP/hooks.json"
+
+check_json "$TMP/hooks.json" "d[0]['path'] == '/wan' and d[0]['type'].startswith('application/json')" \
+    "POST to the configured path as JSON"
+check_json "$TMP/hooks.json" "d[0]['body']['host'] == '$HOSTNAME'" "batch names the panel"
+check_json "$TMP/hooks.json" \
+    "[(e['wan'], e['from'], e['to']) for e in d[0]['body']['events'] if e['wan'] != 'local'] == [('test1', 'up', 'down'), ('test2', 'up', 'down')]" \
+    "both transitions in one batch, in order"
+check_json "$TMP/hooks.json" "all(isinstance(e['uptime_ms'], int) for e in d[0]['body']['events'])" \
+    "events carry uptime_ms"
+check_json "$TMP/hooks.json" "d[1]['body'] == d[0]['body']" "the batch is resent unchanged after a 500"
+check_json "$TMP/hooks.json" "len(d) == 2" "nothing sent after the 2xx"
+
+api_get /api/status > "$TMP/after.json" || fail "GET /api/status"
+python3 - "$TMP/before.json" "$TMP/after.json" > "$TMP/delta.json" <<'PY'
+import json, sys
+before, after = (json.load(open(p))["webhooks"] for p in sys.argv[1:])
+print(json.dumps({k: after[k] - before[k] for k in ("events", "batches", "failures", "retries")}))
+PY
+check_json "$TMP/delta.json" "d['events'] >= 2 and d['batches'] == 1 and d['failures'] == 1 and d['retries'] == 1" \
+    "/api/status counts the events, the failure, the retry and the delivery"